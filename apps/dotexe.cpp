@@ -26,10 +26,10 @@ static struct {
 std::vector<sigil::platform::compat_profile_t> profiles = {};
 std::vector<sigil::platform::compat_tool_t> runners = {};
 
-::sigil::yield cmd_configure(::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_launcher(::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_special(::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_list(::sigil::platform::cmd_handler_args_t handler_args);
+::sigil::yield cmd_configure(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_launcher(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_special(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_list(const ::sigil::platform::cmd_handler_args_t &handler_args);
 
 int main(const int argc, const char **argv, const char **envp) {
     sigil::platform::process_initialize(dotexe_state.proc_info, argc, argv, envp);
@@ -57,28 +57,28 @@ int main(const int argc, const char **argv, const char **envp) {
 }
 
 // Configuration: take two arguments, first file/profile second path.exe/profile-name
-::sigil::yield cmd_configure(::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_configure(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     sigil::yield st;
     SIGIL_UNUSED(handler_args);
 
     return st;
 }
 
-::sigil::yield cmd_launcher(::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_launcher(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     sigil::yield st;
     SIGIL_UNUSED(handler_args);
 
     return st;
 }
 
-::sigil::yield cmd_list(::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_list(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     sigil::yield st;
     SIGIL_UNUSED(handler_args);
 
     return st;
 }
 
-::sigil::yield cmd_special(::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_special(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     sigil::yield st;
     std::cout << "Help here yes, mhm?" << std::endl;
 
@@ -25,6 +25,7 @@
 #include <sigil/platform/glfw.h>
 #include <sigil/platform/exec.h>
 #include <sigil/platform/app.h>
+#include <sigil/data/parser.h>
 #include <sigil/vm/instance.h>
 #include <sigil/vm/context.h>
 #include <sigil/common.h>
@@ -232,56 +233,28 @@ static std::string character_to_json(const sigil::game::character_state_t& c)
     return out.str();
 }
 
-static bool extract_int(const std::string& src, const std::string& key, int& out)
-{
-    auto pos = src.find(key);
-    if (pos == std::string::npos) return false;
-
-    pos = src.find(":", pos);
-    if (pos == std::string::npos) return false;
-
-    out = std::stoi(src.substr(pos + 1));
-    return true;
-}
-
-static bool extract_string(const std::string& src, const std::string& key, std::string& out)
-{
-    auto pos = src.find(key);
-    if (pos == std::string::npos) return false;
-
-    pos = src.find("\"", pos + key.size());
-    if (pos == std::string::npos) return false;
-
-    auto end = src.find("\"", pos + 1);
-    if (end == std::string::npos) return false;
-
-    out = src.substr(pos + 1, end - pos - 1);
-    return true;
-}
-
-static sigil::game::character_state_t character_from_json(const std::string& text)
+static sigil::game::character_state_t character_from_json(const sigil::data::value_t& root)
 {
     using namespace sigil::game;
 
     character_state_t c;
 
-    extract_string(text, "\"name\"", c.name);
-    extract_int(text, "\"rest_level\"", c.rest_level);
+    if (const auto name = root["name"])
+        c.name = name.decode();
 
-    c.temp_level = c.rest_level;
+    int64_t level = 0;
+    if (root["rest_level"].as_int(level))
+        c.rest_level = static_cast<int>(level);
 
-    size_t pos = text.find("\"attrs\"");
-    if (pos != std::string::npos) {
-        for (int i = 0; i < (int)attribute_t::count; ++i) {
-            pos = text.find("\"rest\"", pos);
-            if (pos == std::string::npos) break;
+    c.temp_level = c.rest_level;
 
-            int value = 0;
-            extract_int(text.substr(pos), "\"rest\"", value);
+    const auto attrs = root["attrs"];
+    for (int i = 0; i < (int)attribute_t::count && i < (int)attrs.size(); ++i) {
+        int64_t value = 0;
+        attrs.at(i)["rest"].as_int(value);
 
-            c.attrs[i].rest = sigil::game::die_clamp(value);
-            c.attrs[i].pending_delta = 0;
-        }
+        c.attrs[i].rest = sigil::game::die_clamp(static_cast<int>(value));
+        c.attrs[i].pending_delta = 0;
     }
 
     return c;
@@ -360,8 +333,8 @@ void read_fd_into_lines(int fd);
 void execute_command(const std::string& cmd);
 
 // Commands for dispatcher
-static ::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t handler_args);
-static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t handler_args);
+static ::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t &handler_args);
+static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t &handler_args);
 
 
 sigil::game::game_logger_t logger {
@@ -701,12 +674,13 @@ static void FramePresent(ImGui_ImplVulkanH_Window* wd) {
     wd->SemaphoreIndex = (wd->SemaphoreIndex + 1) % wd->SemaphoreCount; // Now we can use the next set of semaphores
 }
 
-::sigil::yield cmd_help(sigil::platform::cmd_handler_args_t args);
+::sigil::yield cmd_help(const sigil::platform::cmd_handler_args_t &args);
 
 int main(const int argc, const char **argv, const char **envp) {
     // First, creation of app descriptor
     sigil::platform::process_initialize(editor_state.proc_info, argc, argv, envp);
     sigil::platform::app_initialize(editor_state.app_info, editor_state.proc_info);
+    sigil::platform::resolve_app_paths(editor_state.app_info);
 
     ::sigil::yield st = {};
 
@@ -979,13 +953,13 @@ void save_text_editor_document(text_editor_document_t& doc) {
     log_info("Saved file: " + doc.path.string());
 }
 
-static ::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t handler_args) {
+static ::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
     std::cout << "Run sigilvm-editor to start GUI" << std::endl;
     return {};
 }
 
-static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t handler_args) {
+static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     ::sigil::yield ret;
     SIGIL_UNUSED(handler_args);
 
@@ -1912,17 +1886,17 @@ static void draw_character_editor()
     // --- Import
     if (ImGui::Button("Import All")) {
         int imported = 0;
+        sigil::data::document_t doc;
 
         for (auto& entry : std::filesystem::directory_iterator(dir)) {
             if (!entry.is_regular_file()) continue;
 
-            std::ifstream f(entry.path());
-            if (!f.is_open()) continue;
-
-            std::stringstream buffer;
-            buffer << f.rdbuf();
+            if (doc.load(entry.path(), sigil::data::FORMAT_JSONC).is_failure()) {
+                log_warn("Skipping unreadable character " + entry.path().filename().string());
+                continue;
+            }
 
-            characters.push_back(character_from_json(buffer.str()));
+            characters.push_back(character_from_json(doc.root()));
             imported++;
         }
 
@@ -10,9 +10,11 @@
  * Asset, text, scene editor for SigilVM Game Engine
  */
 
+#include <sigil/platform/dircache.h>
 #include <sigil/platform/context.h>
 #include <sigil/platform/process.h>
 #include <sigil/platform/compat.h>
+#include <sigil/platform/library.h>
 #include <sigil/network/context.h>
 #include <sigil/game/initiative.h>
 #include <sigil/render/context.h>
@@ -31,6 +33,7 @@
 #include <filesystem>
 #include <algorithm>
 #include <stdlib.h>
+#include <cstring>
 #include <fstream>
 #include <stdio.h>
 #include <imgui.h>
@@ -38,6 +41,7 @@
 #include <ostream>
 #include <vector>
 #include <atomic>
+#include <thread>
 
 // --- LOCAL DEFINITIONS ---
 struct output_line_t {
@@ -104,6 +108,9 @@ static struct {
     bool valid = false;
 } explorer_selection;
 
+// Listings for the explorer, refreshed off-thread via inotify
+static sigil::fs::dir_cache_t explorer_cache;
+
 // Console
 static struct {
     std::vector<std::string> lines;
@@ -112,6 +119,21 @@ static struct {
     bool scroll_to_bottom = false;
 } console;
 
+// Console commands, polled once per frame
+static sigil::platform::exec_supervisor_t console_jobs;
+
+// Game library, scanned on a worker and picked up once per frame like the console jobs
+static struct {
+    ::sigil::platform::library_index_t index;
+    std::vector<const ::sigil::platform::library_exe_t*> launchable;   // into index
+    bool scanned = false;
+
+    std::thread worker;
+    std::atomic<bool> done{false};
+    ::sigil::platform::library_index_t next;    // the worker's until done
+    ::sigil::yield result;
+} game_library;
+
 static struct {
     std::vector<text_editor_document_t> documents;
     int active_index = -1;
@@ -176,9 +198,9 @@ static void check_vk_result(VkResult err) {
 
 
 // Commands for dispatcher
-static ::sigil::yield cmd_configure(const ::sigil::platform::cmd_handler_args_t handler_args);
-static ::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t handler_args);
-static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t handler_args);
+static ::sigil::yield cmd_configure(const ::sigil::platform::cmd_handler_args_t &handler_args);
+static ::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t &handler_args);
+static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t &handler_args);
 
 // Main GUI draw
 static void draw_gui();
@@ -211,9 +233,12 @@ static void open_text_editor(const std::filesystem::path& path);
 static std::vector<file_action_t> resolve_actions(const std::filesystem::path& path);
 static void dispatch_file_action(file_action_type action, const std::filesystem::path& path);
 static int input_text_callback(ImGuiInputTextCallbackData* data);
-static void read_fd_into_lines(int fd);
 static void execute_command(const std::string& cmd);
 
+// Game library
+static void start_library_scan();
+static void poll_library_scan();
+
 
 
 GLFWmonitor* GetCurrentMonitor(GLFWwindow* window)
@@ -596,6 +621,8 @@ int main(const int argc, const char **argv, const char **envp) {
         return -1;
     }
 
+    sigil::platform::resolve_app_paths(app_info);
+
     // Command registration
     std::vector<::sigil::platform::command_t> cmds {
         ::sigil::platform::command_t({                      }, false, cmd_gui),
@@ -617,19 +644,19 @@ int main(const int argc, const char **argv, const char **envp) {
     return st.code;
 }
 
-static ::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t handler_args) {
+static ::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
     std::cout << "Run sigilvm-editor to start GUI" << std::endl;
     return {};
 }
 
-static ::sigil::yield cmd_configure(const ::sigil::platform::cmd_handler_args_t handler_args) {
+static ::sigil::yield cmd_configure(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
     std::cout << "CLI Config not yet implemented" << std::endl;
     return {};
 }
 
-static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t handler_args) {
+static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     ::sigil::yield ret;
     SIGIL_UNUSED(handler_args);
 
@@ -638,6 +665,10 @@ static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t handle
     app_info.log_error = log_error;
     app_info.log_debug = log_debug;
 
+    // Before GLFW / Vulkan grow the process, spawns of short tools go through it
+    if (sigil::platform::zygote_start().is_failure())
+        log_debug("Zygote unavailable, spawning directly");
+
     glfwSetErrorCallback(glfw_error_callback);
     if (!glfwInit()) return ret.set_state(sigil::yield_state::fail);
 
@@ -752,6 +783,9 @@ static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t handle
             continue;
         }
 
+        console_jobs.poll(0);
+        poll_library_scan();
+
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -779,6 +813,9 @@ static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t handle
     }
 
     // Cleanup
+    if (game_library.worker.joinable())
+        game_library.worker.join();
+
     err = vkDeviceWaitIdle(g_Device);
     check_vk_result(err);
     ImGui_ImplVulkan_Shutdown();
@@ -790,6 +827,7 @@ static ::sigil::yield cmd_gui(const ::sigil::platform::cmd_handler_args_t handle
 
     glfwDestroyWindow(g_window);
     glfwTerminate();
+    sigil::platform::zygote_stop();
     return {};
 }
 
@@ -931,33 +969,7 @@ static int input_text_callback(ImGuiInputTextCallbackData* data) {
     return 0;
 }
 
-static void read_fd_into_lines(int fd) {
-    if (fd < 0) return;
-
-    char buffer[4096];
-    ssize_t n;
-
-    std::string current;
-
-    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
-        for (ssize_t i = 0; i < n; ++i) {
-            if (buffer[i] == '\n') {
-                console.lines.push_back(current);
-                current.clear();
-            }
-            else {
-                current += buffer[i];
-            }
-        }
-    }
-
-    if (!current.empty())
-        console.lines.push_back(current);
-
-    close(fd);
-    console.scroll_to_bottom = true;
-}
-
+// Runs in the background, output lands in the console as it is printed
 static void execute_command(const std::string& cmd) {
     using namespace sigil::platform;
     proc_exec_unit_t peu;
@@ -965,18 +977,51 @@ static void execute_command(const std::string& cmd) {
     peu.set_target("/bin/sh")
        .push_argument("-c")
        .push_argument(cmd)
-       .set_exec_mode(EXEC_WAIT)
-       .set_stdio_mode(STDIO_INHERIT, STDIO_CAPTURE, STDIO_CAPTURE);
-
-    auto y = execute(peu);
+       .set_stdio_mode(STDIO_NULL, STDIO_STREAM, STDIO_STREAM)
+       .set_line_handler([](int, std::string_view line) {
+           console.lines.emplace_back(line);
+           console.scroll_to_bottom = true;
+       });
+
+    auto y = console_jobs.launch(peu, [](const proc_exec_result_t& r) {
+        if (r.exit_code != 0)
+            console.lines.push_back("[exit " + std::to_string(r.exit_code) + "]");
+        console.scroll_to_bottom = true;
+    });
 
     if (y.is_failure()) {
         console.lines.push_back("[error] execution failed");
         return;
     }
+}
 
-    ::read_fd_into_lines(peu.result.stdout_fd);
-    ::read_fd_into_lines(peu.result.stderr_fd);
+// probe_game_library() reads the library and Steam from disk, keep it off the frame
+static void start_library_scan() {
+    if (game_library.worker.joinable())
+        return;
+
+    game_library.done.store(false, std::memory_order_relaxed);
+    game_library.worker = std::thread([] {
+        game_library.next = {};
+        game_library.result = ::sigil::platform::probe_game_library(app_info, game_library.next);
+        game_library.done.store(true, std::memory_order_release);
+    });
+}
+
+// Swaps a finished scan in, the list keeps showing the previous one until then
+static void poll_library_scan() {
+    if (!game_library.worker.joinable() || !game_library.done.load(std::memory_order_acquire))
+        return;
+    game_library.worker.join();
+
+    if (game_library.result.is_failure())
+        log_warn("Game library scan failed");
+
+    game_library.index = std::move(game_library.next);
+    game_library.launchable.clear();
+    for (const auto &exe : game_library.index.executables)
+        if (::sigil::platform::library_exe_is_launchable(exe))
+            game_library.launchable.push_back(&exe);
 }
 
 static int text_editor_input_callback(ImGuiInputTextCallbackData* data) {
@@ -1203,35 +1248,47 @@ static void draw_file_explorer() {
     // File list
     ImGui::BeginChild("FileList", ImVec2(0, -120), true);
 
-    try {
-        for (const auto& entry : std::filesystem::directory_iterator(current_dir)) {
-            const auto& path = entry.path();
-            std::string label = path.filename().string();
+    auto snapshot = explorer_cache.get(current_dir);
 
-            if (entry.is_directory())
-                label = "[D] " + label;
+    if (!snapshot) {
+        ImGui::TextDisabled("Loading...");
+    } else if (snapshot->error != 0) {
+        ImGui::TextDisabled("Cannot list directory: %s", std::strerror(snapshot->error));
+    } else {
+        const auto& entries = snapshot->entries;
+        std::filesystem::path next_dir;
 
-            bool selected =
-                explorer_selection.valid &&
-                explorer_selection.path == path;
+        // Only visible rows are submitted, large directories stay cheap
+        ImGuiListClipper clipper;
+        clipper.Begin((int)entries.size());
 
-            if (ImGui::Selectable(label.c_str(), selected)) {
-                explorer_selection.path = path;
-                explorer_selection.valid = true;
-            }
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                const auto& entry = entries[i];
 
-            // Double click behavior
-            if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0)) {
-                if (entry.is_directory()) {
-                    current_dir = path;
-                } else {
-                    dispatch_file_action(file_action_type::open, path);
+                bool selected =
+                    explorer_selection.valid &&
+                    explorer_selection.path == entry.path;
+
+                if (ImGui::Selectable(entry.label.c_str(), selected)) {
+                    explorer_selection.path = entry.path;
+                    explorer_selection.valid = true;
+                }
+
+                // Double click behavior
+                if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0)) {
+                    if (entry.is_directory) {
+                        next_dir = entry.path;
+                    } else {
+                        dispatch_file_action(file_action_type::open, entry.path);
+                    }
                 }
             }
         }
-    }
-    catch (const std::exception& e) {
-        log_error(std::string("Filesystem error: ") + e.what());
+
+        // Switch after the loop, entries belong to the current snapshot
+        if (!next_dir.empty())
+            current_dir = next_dir;
     }
 
     ImGui::EndChild();
@@ -1368,6 +1425,37 @@ static void draw_asset_manager() {
         ImGui::EndListBox();
     }
 
+    // --- Game library, executables found under the configured roots ---
+    if (ImGui::CollapsingHeader("Game Library")) {
+        if (!game_library.scanned) {
+            start_library_scan();
+            game_library.scanned = true;
+        }
+
+        if (game_library.worker.joinable())
+            ImGui::TextUnformatted("Scanning...");
+        else if (ImGui::Button("Rescan Library"))
+            start_library_scan();
+
+        if (ImGui::BeginListBox("##game_library", ImVec2(-FLT_MIN, 200))) {
+            for (const auto *exe : game_library.launchable) {
+                std::string label = exe->info.product_name.empty()
+                    ? std::string(exe->name())
+                    : exe->info.product_name + " (" + std::string(exe->name()) + ")";
+                label += "##" + exe->path;
+
+                ImGui::Selectable(label.c_str(), false);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("%s", exe->path.c_str());
+
+                // Same flow as "Run (.exe)" in the File Explorer, ends in a profile
+                if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0))
+                    dispatch_file_action(file_action_type::run_exe, exe->path);
+            }
+            ImGui::EndListBox();
+        }
+    }
+
     // --- Footer info ---
     ImGui::Text("Profiles: %zu", profiles.size());
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
@@ -24,13 +24,13 @@ static struct app_context_t {
 } player_state;
 
 // Command handler declarations
-::sigil::yield cmd_previous(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_playlist(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_unpause(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_pause(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_stop(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_next(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_play(const ::sigil::platform::cmd_handler_args_t handler_args);
+::sigil::yield cmd_previous(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_playlist(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_unpause(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_pause(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_stop(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_next(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_play(const ::sigil::platform::cmd_handler_args_t &handler_args);
 
 int main(const int argc, const  char **argv, const char **envp) {
     // First, creation of app descriptor and command registry
@@ -59,48 +59,48 @@ int main(const int argc, const  char **argv, const char **envp) {
 }
 
 
-::sigil::yield cmd_previous(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_previous(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
 
     return {};
 }
 
-::sigil::yield cmd_playlist(const ::sigil::platform::cmd_handler_args_t handler_args){
+::sigil::yield cmd_playlist(const ::sigil::platform::cmd_handler_args_t &handler_args){
     SIGIL_UNUSED(handler_args);
 
     return {};
 }
 
 
-::sigil::yield cmd_unpause(const ::sigil::platform::cmd_handler_args_t handler_args){
+::sigil::yield cmd_unpause(const ::sigil::platform::cmd_handler_args_t &handler_args){
     SIGIL_UNUSED(handler_args);
 
     return {};
 }
 
 
-::sigil::yield cmd_pause(const ::sigil::platform::cmd_handler_args_t handler_args){
+::sigil::yield cmd_pause(const ::sigil::platform::cmd_handler_args_t &handler_args){
     SIGIL_UNUSED(handler_args);
 
     return {};
 }
 
 
-::sigil::yield cmd_stop(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_stop(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
 
     return {};
 }
 
 
-::sigil::yield cmd_next(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_next(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
 
     return {};
 }
 
 
-::sigil::yield cmd_play(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_play(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
 
     return {};
@@ -11,6 +11,11 @@
  */
 
 #include <sigil/platform/desktop.h>
+#include <sigil/platform/compat.h>
+#include <sigil/platform/library.h>
+#include <sigil/data/parser.h>
+#include <sigil/platform/daemon.h>
+#include <sigil/platform/watcher.h>
 #include <sigil/platform/device.h>
 #include <sigil/platform/paths.h>
 #include <sigil/network/context.h>
@@ -22,12 +27,18 @@
 #include <sigil/platform/app.h>
 #include <sigil/utils/crypto.h>
 #include <sigil/vm/instance.h>
+#include <sigil/vm/ecs.h>
 #include <sigil/platform/fs.h>
 #include <sigil/utils/time.h>
 #include <sigil/math/hash.h>
 #include <sigil/vm/dedup.h>
 #include <sigil/common.h>
+#include <algorithm>
+#include <csignal>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -40,36 +51,80 @@ static struct app_context_t {
     sigil::network::context_t network_ctx;
     sigil::render::context_t render_ctx;
     sigil::media::context_t media_ctx;
+
+    bool resident = false;  // serving as `sigilvm-tools daemon`, probes may be cached
 } app_context;
 
 // Command handler declarations
-::sigil::yield cmd_desktop_reload(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_list_themes(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_interactive(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_build_theme(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_set_theme(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_unix_time(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_hash_dir(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_probe(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_dedup(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_flush(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_test(const ::sigil::platform::cmd_handler_args_t handler_args);
-::sigil::yield cmd_inspect(const ::sigil::platform::cmd_handler_args_t handler_args);
+::sigil::yield cmd_desktop_reload(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_list_themes(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_interactive(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_build_theme(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_set_theme(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_rollback_theme(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_prewarm_themes(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_unix_time(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_hash_dir(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_probe(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_dedup(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_prefix_new(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_library_scan(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_flush(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_test(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_inspect(const ::sigil::platform::cmd_handler_args_t &handler_args);
+::sigil::yield cmd_daemon(const ::sigil::platform::cmd_handler_args_t &handler_args);
+
+// Command table, hashed at compile time, dispatch does no allocation
+static constexpr auto tools_commands = ::sigil::platform::make_command_table<18>({{
+    { { "theme",   "reload"  }, false, cmd_desktop_reload },
+    { { "theme",   "build"   }, true,  cmd_build_theme    },
+    { { "theme",   "list"    }, true,  cmd_list_themes    },
+    { { "theme",   "set"     }, true,  cmd_set_theme      },
+    { { "theme",   "rollback" }, false, cmd_rollback_theme },
+    { { "theme",   "prewarm" }, false, cmd_prewarm_themes },
+    { { "prefix",  "new"     }, true,  cmd_prefix_new     },
+    { { "library", "scan"    }, false, cmd_library_scan   },
+
+    { { "probe"              }, true,  cmd_probe          },
+    { { "dedup"              }, true,  cmd_dedup          },
+    { { "flush"              }, false, cmd_flush          },
+    { { "interactive"        }, false, cmd_interactive    },
+    { { "hash"               }, true,  cmd_hash_dir       },
+    { {                      }, false, cmd_help           },
+    { { "help"               }, true,  cmd_help           },
+    { { "unix-time"          }, false, cmd_unix_time      },
+    { { "test"               }, true,  cmd_test           },
+    { { "daemon"             }, false, cmd_daemon         },
+}});
 
 static std::string build_help_message() {
     return
         "Available commands:\n"
         "\n"
-        "  theme build <args...>\n"
-        "      Build theme assets.\n"
+        "  theme build <args...> [--watch]\n"
+        "      Build theme assets, --watch rebuilds on template changes.\n"
+        "\n"
+        "  theme set <name> [--in-place]\n"
+        "      Set active theme, ~/.config links switch to the theme at once.\n"
+        "      --in-place rewrites the differing files instead.\n"
         "\n"
-        "  theme set <args...>\n"
-        "      Set active theme.\n"
+        "  theme rollback\n"
+        "      Go back to the theme generation active before the last set.\n"
+        "\n"
+        "  theme prewarm\n"
+        "      Render every pattern into the theme cache, theme set then only deploys.\n"
         "\n"
         "  theme list <args...>\n"
         "      List installed themes.\n"
         "\n"
+        "  prefix new <runner> <name>\n"
+        "      Clone a Wine / Proton prefix from the runner's template,\n"
+        "      the template is initialized with wineboot on first use.\n"
+        "\n"
+        "  library scan\n"
+        "      Index executables under the roots of <sigilvm config>/library.yaml.\n"
+        "\n"
         "  project create <args...>\n"
         "      Create a new project.\n"
         "\n"
@@ -94,50 +149,61 @@ static std::string build_help_message() {
         "  hash <args...>\n"
         "      Hash directory contents.\n"
         "\n"
+        "  daemon\n"
+        "      Stay resident, theme set / rollback / list / reload, probe and flush\n"
+        "      are forwarded to it, or run locally while it is busy.\n"
+        "      SIGILVM_NO_DAEMON=1 runs a call in its own process.\n"
+        "\n"
         "  help <command?>\n"
         "      Show this help message.\n";
 }
 
+static int run_command(const int argc, const char* const* argv) {
+    ::sigil::yield st = sigil::platform::dispatch_command(tools_commands, argc, argv);
+    if (st.is_failure()) {
+        std::cout << "Failed to run command" << std::endl;
+    }
+
+    return st.code;
+}
+
+// Calls a resident daemon serves: short ones that gain from its warm state. Watches, wineboot and
+// scans keep their own process, the daemon runs one call at a time and cannot interrupt it
+static constexpr const char *forwarded_commands[][2] = {
+    { "theme", "set"      },
+    { "theme", "rollback" },
+    { "theme", "list"     },
+    { "theme", "reload"   },
+    { "probe", nullptr    },
+    { "flush", nullptr    },
+    { "help",  nullptr    },
+};
+
+static bool forwards_to_daemon(const int argc, const char* const* argv) {
+    for (const auto &c : forwarded_commands) {
+        if (argc > 1 && std::strcmp(argv[1], c[0]) == 0
+            && (!c[1] || (argc > 2 && std::strcmp(argv[2], c[1]) == 0)))
+            return true;
+    }
+    return false;
+}
+
 // Main
 int main(const int argc, const char **argv, const char **envp) {
-    // First, creation of app descriptor and command registry
+    // First, creation of app descriptor
     sigil::platform::process_initialize(app_context.proc_info, argc, argv, envp);
     sigil::platform::app_initialize(app_context.app_info, app_context.proc_info);
 
-    sigil::platform::command_registry_t reg;
-
-    ::sigil::yield st = {};
-
-    std::vector<::sigil::platform::command_t> cmds {
-        ::sigil::platform::command_t({ "theme",   "reload"  }, false, cmd_desktop_reload),
-        ::sigil::platform::command_t({ "theme",   "build"   }, true,  cmd_build_theme),
-        ::sigil::platform::command_t({ "theme",   "list"    }, true,  cmd_list_themes),
-        ::sigil::platform::command_t({ "theme",   "set"     }, true,  cmd_set_theme),
-
-        ::sigil::platform::command_t({ "probe"              }, true,  cmd_probe),
-        ::sigil::platform::command_t({ "dedup"              }, true,  cmd_dedup),
-        ::sigil::platform::command_t({ "flush"              }, false, cmd_flush),
-        ::sigil::platform::command_t({ "interactive"        }, false, cmd_interactive),
-        ::sigil::platform::command_t({ "hash"               }, true,  cmd_hash_dir),
-        ::sigil::platform::command_t({                      }, false, cmd_help),
-        ::sigil::platform::command_t({ "help"               }, true,  cmd_help),
-        ::sigil::platform::command_t({ "unix-time"          }, false, cmd_unix_time),
-        ::sigil::platform::command_t({ "test"               }, true,  cmd_test),
-    };
-
-    st = ::sigil::platform::register_command(reg, cmds);
-
-    if (st.is_failure()) {
-        sigil::dcout << "Failed to register command vector: " << st.code << std::endl;
-        exit(-1);
+    // Hand the call to a resident daemon when one is running and free to take it
+    if (forwards_to_daemon(argc, argv) && !sigil::platform::env_get(app_context.proc_info, "SIGILVM_NO_DAEMON")) {
+        int exit_code = 0;
+        auto sock = sigil::platform::get_local_socket(app_context.app_info);
+        if (sigil::platform::daemon_forward(sock, argc, argv, envp, exit_code).is_ok())
+            return exit_code;
     }
 
-    st = sigil::platform::dispatch_command(reg, argc, argv);
-    if (st.is_failure()) {
-        std::cout << "Failed to run command" << std::endl;
-    }
-
-    return st.code;
+    sigil::platform::resolve_app_paths(app_context.app_info);
+    return run_command(argc, argv);
 }
 
 /**
@@ -146,7 +212,7 @@ int main(const int argc, const char **argv, const char **envp) {
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_dedup(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_dedup(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     sigil::util::timer_t timer;
     ::sigil::yield ret;
 
@@ -173,6 +239,86 @@ int main(const int argc, const char **argv, const char **envp) {
     return ret;
 }
 
+/**
+ * @brief
+ * Create a prefix under <compdata>/prefixes as a reflink clone of the runner's template
+ * @param args
+ * @return ::sigil::yield
+ */
+::sigil::yield cmd_prefix_new(const ::sigil::platform::cmd_handler_args_t &handler_args) {
+    ::sigil::yield ret;
+
+    if (handler_args.args.size() < 2) {
+        std::cout << "Usage: prefix new <runner> <name>" << std::endl;
+        return ret.set_state(sigil::yield_state::fail);
+    }
+
+    const std::filesystem::path runner = handler_args.args.at(0);
+    const std::string name(handler_args.args.at(1));
+
+    // First use pays for wineboot, time only the clone
+    std::filesystem::path tmpl;
+    ret = ::sigil::platform::ensure_prefix_template(app_context.app_info, runner, tmpl);
+    if (ret.is_failure()) {
+        std::cout << "Could not initialize template for " << runner << ": " << std::strerror(ret.code) << std::endl;
+        return ret;
+    }
+
+    sigil::util::timer_t timer;
+    ::sigil::fs::copy_stats_t stats;
+    std::filesystem::path prefix;
+
+    timer.start();
+    ret = ::sigil::platform::create_compat_prefix(app_context.app_info, runner, name, prefix, &stats);
+    timer.stop();
+
+    if (ret.is_failure()) {
+        std::cout << "Could not create prefix " << name << ": " << std::strerror(ret.code) << std::endl;
+        return ret;
+    }
+
+    std::cout << prefix.string() << " [" << timer.elapsed_milliseconds() << "ms]" << std::endl;
+    std::cout << "  cloned " << stats.files_cloned << " files, " << stats.bytes_cloned / 1024 << " KiB" << std::endl;
+    std::cout << "  copied " << stats.files_copied << " files, " << stats.bytes_copied / 1024 << " KiB" << std::endl;
+    return ret;
+}
+
+/**
+ * @brief
+ * Rescan the game library and list what could become a compat profile
+ * @param args
+ * @return ::sigil::yield
+ */
+::sigil::yield cmd_library_scan(const ::sigil::platform::cmd_handler_args_t &handler_args) {
+    SIGIL_UNUSED(handler_args);
+    sigil::util::timer_t timer;
+    ::sigil::platform::library_index_t index;
+    ::sigil::platform::library_scan_stats_t stats;
+
+    timer.start();
+    ::sigil::yield ret = ::sigil::platform::probe_game_library(app_context.app_info, index, &stats);
+    timer.stop();
+
+    if (ret.is_failure()) {
+        std::cout << "Library scan failed: " << std::strerror(ret.code) << std::endl;
+        return ret;
+    }
+
+    for (const auto &exe : index.executables) {
+        if (!::sigil::platform::library_exe_is_launchable(exe))
+            continue;
+        std::cout << exe.path;
+        if (!exe.info.product_name.empty())
+            std::cout << " (" << exe.info.product_name << ")";
+        std::cout << (exe.info.is_64bit() ? " x64" : " x86") << "\n";
+    }
+
+    std::cout << "Scanned in " << timer.elapsed_milliseconds() << "ms: "
+              << stats.dirs_listed << " dirs listed, " << stats.dirs_reused << " reused, "
+              << stats.exes_parsed << " executables parsed, " << stats.exes_reused << " reused" << std::endl;
+    return ret;
+}
+
 /**
  * @brief
  * Get Hash of entire directory.
@@ -180,7 +326,7 @@ int main(const int argc, const char **argv, const char **envp) {
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_hash_dir(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_hash_dir(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     if (handler_args.args.empty()) {
         std::cout << "[Error] Must provide a path to directory for hashing" << std::endl;
         return ::sigil::yield().set_state(::sigil::yield_state::fail);
@@ -202,7 +348,7 @@ int main(const int argc, const char **argv, const char **envp) {
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_flush(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_flush(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args.args);
     std::cout << "Flushing SigilVM" << std::endl;
     return {};
@@ -214,7 +360,7 @@ int main(const int argc, const char **argv, const char **envp) {
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_list_themes(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_list_themes(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     bool show_details = !handler_args.args.empty() && handler_args.args.at(0) == "detailed" ? true : false;
 
     SIGIL_UNUSED(show_details);
@@ -228,9 +374,9 @@ int main(const int argc, const char **argv, const char **envp) {
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_desktop_reload(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_desktop_reload(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
-    return sigil::desktop::reload_components();
+    return sigil::desktop::reload_components(app_context.app_info);
 }
 
 
@@ -242,7 +388,7 @@ int main(const int argc, const char **argv, const char **envp) {
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_probe(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_probe(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     ::sigil::yield ret;
 
     if (handler_args.args.empty()) {
@@ -254,11 +400,18 @@ int main(const int argc, const char **argv, const char **envp) {
     }
 
     if (!handler_args.args.empty() && handler_args.args.at(0) == "gpu") {
-        std::vector<sigil::platform::gpu_info_t> gpus;
-        ret = sigil::render::vk_probe_devices(gpus);
-        if (ret.is_failure()) {
-            std::cerr << "Failed to enumerate Vulkan devices. Status: " << ret.code << "\n";
-            return ret;
+        // Vulkan instance setup dominates this, a resident daemon keeps the first answer
+        static std::vector<sigil::platform::gpu_info_t> gpus;
+        static bool probed = false;
+
+        if (!probed || !app_context.resident) {
+            gpus.clear();
+            ret = sigil::render::vk_probe_devices(gpus);
+            if (ret.is_failure()) {
+                std::cerr << "Failed to enumerate Vulkan devices. Status: " << ret.code << "\n";
+                return ret;
+            }
+            probed = true;
         }
 
         for (const auto& g : gpus) {
@@ -276,21 +429,27 @@ int main(const int argc, const char **argv, const char **envp) {
 /**
  * @brief
  * Deploy a theme from ~/.local/share/sigilvm/themes.
- * Done by copying various files and directories into ~/.config
- * Backup by default, can take extra argument "no-backup", to just overwrite existing
+ * Components in ~/.config are linked to immutable generations of the theme,
+ * switched atomically, originals are kept the first time they are replaced.
+ * --in-place copies differing files into ~/.config instead.
  * @param args
  * @return ::sigil::yield
  */
 ::sigil::yield cmd_set_theme
-(const ::sigil::platform::cmd_handler_args_t handler_args) {
+(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     if (handler_args.args.empty()) {
         std::cout << "[Error] Missing name" << std::endl;
         return ::sigil::yield().set_state(sigil::yield_state::fail);
     }
 
+    ::sigil::desktop::theme_deploy_mode_t mode = ::sigil::desktop::THEME_DEPLOY_GENERATION;
+    for (auto s : handler_args.switches) {
+        if (s.name == "--in-place") mode = ::sigil::desktop::THEME_DEPLOY_IN_PLACE;
+    }
+
     std::string theme_name(handler_args.args.at(0));
-    //std::filesystem::path legacy_theme_dir = ::sigil::fs::get_home_path() / ".local" / "share" / "sigilvm" / "themes" / "legacy-themes";
-    std::filesystem::path legacy_theme_dir = ::sigil::platform::get_sigilvm_data_root(app_context.proc_info) / "themes" / "legacy-themes";
+    const std::filesystem::path themes_dir = ::sigil::platform::get_sigilvm_data_root(app_context.app_info) / "themes";
+    const std::filesystem::path legacy_theme_dir = themes_dir / "legacy-themes";
 
     std::cout << "Setting theme: " << theme_name << std::endl;
 
@@ -300,27 +459,182 @@ int main(const int argc, const char **argv, const char **envp) {
                         || theme_name == "dark-round"
                         || theme_name == "night");
 
-    if (is_legacy_theme ){
-        ::sigil::desktop::deploy_theme_from_path(app_context.app_info, legacy_theme_dir / theme_name);
+    if (is_legacy_theme && std::filesystem::exists(legacy_theme_dir / theme_name))
+        return ::sigil::desktop::deploy_theme_from_path(app_context.app_info, legacy_theme_dir / theme_name, mode);
+
+    // Rendered once per template set and pattern, usually already in the cache
+    ::sigil::desktop::theme_variant_t variant;
+    ::sigil::yield ret = ::sigil::desktop::get_theme_variant(app_context.app_info, theme_name, variant);
+    if (ret.is_failure())
+        return ret;
+
+    // Templates changed since the last prewarm (package upgrade), render the rest in the background
+    if (!variant.prewarmed) {
+        ::sigil::platform::proc_exec_unit_t peu;
+        peu.set_target("/proc/self/exe")
+           .push_argument("theme")
+           .push_argument("prewarm")
+           .export_var("SIGILVM_NO_DAEMON", "1")
+           .set_stdio_mode(::sigil::platform::STDIO_NULL, ::sigil::platform::STDIO_NULL, ::sigil::platform::STDIO_NULL)
+           .set_exec_mode(::sigil::platform::EXEC_DETACH);
+        ::sigil::platform::execute(peu);
+    }
+
+    return ret |= ::sigil::desktop::deploy_theme_from_path(app_context.app_info, variant.dir, mode);
+}
+
+/**
+ * @brief
+ * Render every pattern with the installed templates into the theme cache.
+ * Started detached by theme set when the templates changed.
+ * @param args
+ * @return ::sigil::yield
+ */
+::sigil::yield cmd_prewarm_themes(const ::sigil::platform::cmd_handler_args_t &handler_args) {
+    SIGIL_UNUSED(handler_args);
+
+    sigil::util::timer_t timer;
+    std::size_t built = 0;
+
+    timer.start();
+    ::sigil::yield ret = ::sigil::desktop::prewarm_theme_variants(app_context.app_info, built);
+    timer.stop();
+
+    std::cout << "Prewarmed " << built << " theme variant(s) in " << timer.elapsed_milliseconds() << "ms" << std::endl;
+    return ret;
+}
+
+/**
+ * @brief
+ * Point ~/.config back at the theme generation used before the last theme set.
+ * @param args
+ * @return ::sigil::yield
+ */
+::sigil::yield cmd_rollback_theme(const ::sigil::platform::cmd_handler_args_t &handler_args) {
+    SIGIL_UNUSED(handler_args);
+
+    std::vector<std::string> changed;
+    ::sigil::yield ret = ::sigil::desktop::rollback_theme_generation(app_context.app_info, changed);
+    if (ret.is_failure() || changed.empty())
+        return ret;
+
+    std::cout << "[DONE] Rolled back " << changed.size() << " component(s), reloading..." << std::endl;
+    return ret |= ::sigil::desktop::reload_components(app_context.app_info, changed);
+}
+
+/**
+ * @brief
+ * Rebuild theme_name whenever its templates or pattern change, until killed.
+ * Changed paths are mapped to components, only those get rebuilt.
+ */
+static ::sigil::yield watch_theme_sources(const std::string &theme_name) {
+    const std::filesystem::path assets = ::sigil::platform::get_theme_assets_root(app_context.app_info);
+    const std::filesystem::path common = assets / "common";
+    const std::filesystem::path pattern = assets / "patterns" / (theme_name + ".yaml");
+
+    ::sigil::fs::watcher_t watcher;
+    ::sigil::yield ret = watcher.start();
+    ret |= watcher.add(common);
+    ret |= watcher.add(assets / "patterns", false);
+    if (ret.is_failure()) {
+        std::cout << "[Error] Cannot watch " << assets << " (status " << ret.code << ")" << std::endl;
+        return ret;
+    }
+
+    std::cout << "Watching " << assets << " for changes, Ctrl+C to stop" << std::endl;
+
+    ::sigil::fs::watch_batch_t batch;
+    while (watcher.wait(batch)) {
+        std::vector<std::string> components;
+        bool rebuild_all = batch.overflow;
+
+        for (const auto &ev : batch.events) {
+            if (ev.path == pattern) {
+                rebuild_all = true;
+                continue;
+            }
+
+            std::filesystem::path rel = ev.path.lexically_relative(common);
+            if (rel.empty() || *rel.begin() == "..")
+                continue;
+
+            for (const auto &comp : ::sigil::desktop::theme_components()) {
+                if (*rel.begin() == comp.source
+                    && std::find(components.begin(), components.end(), comp.name) == components.end())
+                    components.push_back(comp.name);
+            }
+        }
+
+        if (!rebuild_all && components.empty())
+            continue;
+        if (rebuild_all)
+            components.clear();
+
+        sigil::util::timer_t timer;
+        timer.start();
+        ::sigil::yield st = ::sigil::desktop::build_theme(app_context.app_info, theme_name, components);
+        timer.stop();
+
+        std::cout << "[WATCH] " << (rebuild_all ? std::string("all components") : std::to_string(components.size()) + " component(s)")
+                  << " rebuilt in " << timer.elapsed_milliseconds() << "ms"
+                  << (st.is_failure() ? " with errors" : "") << std::endl;
     }
 
     return {};
 }
 
+// Names of every <theme assets>/patterns/*.yaml
+static ::sigil::yield list_theme_patterns(std::vector<std::string> &out) {
+    const std::filesystem::path patterns_dir = ::sigil::platform::get_theme_assets_root(app_context.app_info) / "patterns";
+
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(patterns_dir, ec)) {
+        if (entry.path().extension() == ".yaml")
+            out.push_back(entry.path().stem().string());
+    }
+
+    if (ec) {
+        std::cout << "[Error] Cannot list theme patterns in " << patterns_dir << std::endl;
+        return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(ec.value());
+    }
+
+    std::sort(out.begin(), out.end());
+    return {};
+}
+
 /**
  * @brief
  * Build one or more themes from templates in /usr/share/sigilvm/themes.
  * Resulting themes will land in ~/.local/share/sigilvm/themes
+ * --watch keeps running and rebuilds changed components of a single theme.
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_build_theme(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_build_theme(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     ::sigil::yield ret;
 
+    bool watch = false;
+
+    for (auto s : handler_args.switches) {
+        if (s.name == "--watch") watch = true;
+    }
+
     if (handler_args.args.empty()) {
         // Build all, except legacy templates
+        std::vector<std::string> patterns;
+        ret = list_theme_patterns(patterns);
+        if (ret.is_failure())
+            return ret;
 
         std::cout << "Building all themes" << std::endl;
+
+        sigil::util::timer_t timer;
+        timer.start();
+        for (const auto &name : patterns)
+            ret |= ::sigil::desktop::build_theme(app_context.app_info, name);
+        timer.stop();
+
+        std::cout << "Built " << patterns.size() << " theme(s) in " << timer.elapsed_milliseconds() << "ms" << std::endl;
         return ret;
     }
 
@@ -335,9 +649,14 @@ int main(const int argc, const char **argv, const char **envp) {
 
     else {
         // Pass build of single theme here
-        std::cout << "Building theme: " << handler_args.args.at(0) << std::endl;
+        const std::string theme_name(handler_args.args.at(0));
+        std::cout << "Building theme: " << theme_name << std::endl;
 
-        return ret;
+        ret = ::sigil::desktop::build_theme(app_context.app_info, theme_name);
+        if (ret.is_failure() || !watch)
+            return ret;
+
+        return watch_theme_sources(theme_name);
     }
 }
 
@@ -347,7 +666,7 @@ int main(const int argc, const char **argv, const char **envp) {
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_unix_time(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_unix_time(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
     std::cout << "Unix Time: " << sigil::util::unix_time() << std::endl;
     return {};
@@ -359,7 +678,7 @@ int main(const int argc, const char **argv, const char **envp) {
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_interactive(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_interactive(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     (void)handler_args; // not used yet
     return {};
 }
@@ -370,27 +689,158 @@ int main(const int argc, const char **argv, const char **envp) {
  * @param args
  * @return ::sigil::yield
  */
-::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t handler_args) {
+::sigil::yield cmd_help(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     SIGIL_UNUSED(handler_args);
     std::cout << build_help_message() << std::endl;
     return {};
 }
 
+static ::sigil::platform::daemon_server_t *resident_server = nullptr;
+
+static void stop_resident(int) {
+    if (resident_server) resident_server->stop();
+}
+
+/**
+ * @brief
+ * Serve forwarded calls until SIGTERM / SIGINT.
+ * Calls run one at a time in this process, with the caller's stdio, cwd and environment,
+ * app_context holds the caller's descriptors while a call runs.
+ * @param args
+ * @return ::sigil::yield
+ */
+::sigil::yield cmd_daemon(const ::sigil::platform::cmd_handler_args_t &handler_args) {
+    SIGIL_UNUSED(handler_args);
+
+    ::sigil::platform::daemon_server_t server;
+    const std::filesystem::path sock = ::sigil::platform::get_local_socket(app_context.app_info);
+
+    ::sigil::yield ret = server.listen(sock);
+    if (ret.is_failure()) {
+        std::cerr << "Cannot listen on " << sock.string() << ": " << std::strerror(ret.code) << std::endl;
+        return ret;
+    }
+
+    app_context.resident = true;
+    resident_server = &server;
+    std::signal(SIGTERM, stop_resident);
+    std::signal(SIGINT, stop_resident);
+
+    std::cout << "Serving on " << sock.string() << std::endl;
+
+    ret = server.run([](const ::sigil::platform::daemon_request_t &req) {
+        if (!forwards_to_daemon(req.argc, req.argv.data())) {
+            std::cerr << "Not served by the daemon, run it with SIGILVM_NO_DAEMON=1" << std::endl;
+            return 1;
+        }
+
+        // Handlers resolve paths through app_context, hand them the caller's descriptors for this call
+        ::sigil::platform::process_descriptor_t client_proc;
+        ::sigil::platform::app_descriptor_t client_app;
+        if (::sigil::platform::daemon_client_app(req, client_proc, client_app).is_failure()) {
+            std::cerr << "Cannot set up the caller's environment" << std::endl;
+            return 1;
+        }
+        client_app.log_info  = app_context.app_info.log_info;
+        client_app.log_warn  = app_context.app_info.log_warn;
+        client_app.log_error = app_context.app_info.log_error;
+        client_app.log_debug = app_context.app_info.log_debug;
+
+        std::swap(app_context.proc_info, client_proc);
+        std::swap(app_context.app_info, client_app);
+        const int exit_code = run_command(req.argc, req.argv.data());
+        std::swap(app_context.proc_info, client_proc);
+        std::swap(app_context.app_info, client_app);
+        return exit_code;
+    });
+
+    resident_server = nullptr;
+    app_context.resident = false;
+    server.close();
+    return ret;
+}
+
 static void fill_random(uint8_t* buf, size_t n) {
     for (size_t i = 0; i < n; ++i) {
         buf[i] = static_cast<uint8_t>(std::rand() & 0xFF);
     }
 }
 
-::sigil::yield cmd_test(const ::sigil::platform::cmd_handler_args_t handler_args) {
+// Line reader the pattern and profile loaders used before sigil::data, kept as the bench baseline
+static void bench_flatten_lines(const std::string &text, std::vector<std::pair<std::string, std::string>> &out) {
+    std::istringstream in(text);
+    std::vector<std::pair<std::size_t, std::string>> open;
+    std::string line;
+
+    while (std::getline(in, line)) {
+        const std::size_t indent = line.find_first_not_of(' ');
+        if (indent == std::string::npos || line[indent] == '#' || line[indent] == '-')
+            continue;
+
+        const std::size_t colon = line.find(':', indent);
+        if (colon == std::string::npos)
+            continue;
+
+        std::string key = line.substr(indent, colon - indent);
+        std::string rest = line.substr(colon + 1);
+        rest.erase(0, rest.find_first_not_of(" \t"));
+        rest.erase(rest.find_last_not_of(" \t\r") + 1);
+
+        while (!open.empty() && open.back().first >= indent)
+            open.pop_back();
+
+        std::string path = open.empty() ? key : open.back().second + "." + key;
+        if (rest.empty()) {
+            open.emplace_back(indent, std::move(path));
+            continue;
+        }
+
+        if (rest.front() == '"' || rest.front() == '\'')
+            rest = rest.substr(1, rest.find(rest.front(), 1) - 1);
+        out.emplace_back(std::move(path), std::move(rest));
+    }
+}
+
+// Same output as bench_flatten_lines, walked off a parsed document
+static void bench_flatten_tape(const ::sigil::data::value_t &map, const std::string &prefix,
+                               std::vector<std::pair<std::string, std::string>> &out) {
+    for (const ::sigil::data::value_t member : map) {
+        std::string path = prefix.empty() ? std::string(member.key()) : prefix + "." + std::string(member.key());
+        if (member.is_object())
+            bench_flatten_tape(member, path, out);
+        else if (!member.is_array() && member.kind() != ::sigil::data::NODE_NULL)
+            out.emplace_back(std::move(path), member.decode());
+    }
+}
+
+static std::string bench_read_file(const std::filesystem::path &file) {
+    std::ifstream in(file, std::ios::binary);
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+::sigil::yield cmd_test(const ::sigil::platform::cmd_handler_args_t &handler_args) {
     sigil::dcout << "[DEBUG] Running Test Command" << std::endl;
 
     bool xor_test = false;
     bool paths_test = false;
+    bool spawn_test = false;
+    bool dispatch_test = false;
+    bool theme_test = false;
+    bool parser_test = false;
+    bool library_test = false;
+    bool ledger_test = false;
 
     for (auto ar : handler_args.args) {
         if (ar == "xor_performance") xor_test = true;
         if (ar == "paths") paths_test = true;
+        if (ar == "spawn_latency") spawn_test = true;
+        if (ar == "dispatch_latency") dispatch_test = true;
+        if (ar == "theme_build") theme_test = true;
+        if (ar == "parser_performance") parser_test = true;
+        if (ar == "library_scan") library_test = true;
+        if (ar == "ledger_performance") ledger_test = true;
     }
 
     for (auto s : handler_args.switches) {
@@ -437,6 +887,333 @@ static void fill_random(uint8_t* buf, size_t n) {
         std::cout << "\n=== ENSURE (optional) ===\n";
     }
 
+    if (spawn_test) {
+        // Parent with ~1GB resident, roughly what the editor carries with Vulkan/ImGui up
+        constexpr size_t RSS_SIZE = 1ull << 30;
+        constexpr int RUNS = 200;
+
+        // Forked while still small, SPAWN_AUTO goes through it below
+        const bool zygote_up = ::sigil::platform::zygote_start().is_ok();
+
+        uint8_t* ballast = (uint8_t*)std::malloc(RSS_SIZE);
+        if (!ballast)
+            return ::sigil::yield().set_state(sigil::yield_state::fail);
+        std::memset(ballast, 0xA5, RSS_SIZE);
+
+        struct backend_run_t {
+            ::sigil::platform::spawn_backend_t backend;
+            const char* label;
+        };
+
+        const backend_run_t backends[] = {
+            { ::sigil::platform::SPAWN_POSIX, "posix_spawn" },
+            { ::sigil::platform::SPAWN_FORK,  "fork"        },
+            { ::sigil::platform::SPAWN_AUTO,  "zygote"      },
+        };
+
+        for (const auto& b : backends) {
+            if (b.backend == ::sigil::platform::SPAWN_AUTO && !zygote_up)
+                continue;
+
+            sigil::util::timer_t t;
+            double total_ms = 0.0;
+            double best_ms = 1e9;
+
+            for (int i = 0; i < RUNS; ++i) {
+                ::sigil::platform::proc_exec_unit_t peu;
+                peu.set_target("/bin/true")
+                   .set_spawn_backend(b.backend)
+                   .set_exec_mode(::sigil::platform::EXEC_WAIT);
+
+                t.start();
+                ::sigil::platform::execute(peu);
+                t.stop();
+
+                total_ms += t.elapsed_milliseconds();
+                best_ms = std::min(best_ms, t.elapsed_milliseconds());
+            }
+
+            std::cout
+                << "[ SPAWN PERF ] " << b.label
+                << " | RSS: 1GB"
+                << " | avg: " << total_ms / RUNS << " ms"
+                << " | best: " << best_ms << " ms"
+                << std::endl;
+        }
+
+        std::free(ballast);
+        ::sigil::platform::zygote_stop();
+    }
+
+    if (dispatch_test) {
+        // Typical waybar module call, through the compiled table and the runtime tree
+        constexpr int RUNS = 1000000;
+        static const char* bench_argv[] = { "sigilvm-tools", "theme", "set", "nord", "--dry-run" };
+        constexpr int bench_argc = sizeof(bench_argv) / sizeof(bench_argv[0]);
+
+        static constexpr auto noop = [](const ::sigil::platform::cmd_handler_args_t &a) -> ::sigil::yield {
+            return ::sigil::yield().set_info(a.args.size());
+        };
+
+        static constexpr auto compiled = ::sigil::platform::make_command_table<4>({{
+            { { "theme", "reload" }, false, +noop },
+            { { "theme", "set"    }, true,  +noop },
+            { { "help"            }, true,  +noop },
+            { {                   }, false, +noop },
+        }});
+
+        ::sigil::platform::command_registry_t runtime;
+        ::sigil::platform::register_command(runtime, {
+            ::sigil::platform::command_t({ "theme", "reload" }, false, +noop),
+            ::sigil::platform::command_t({ "theme", "set"    }, true,  +noop),
+            ::sigil::platform::command_t({ "help"            }, true,  +noop),
+            ::sigil::platform::command_t({                   }, false, +noop),
+        });
+
+        auto measure = [&](const char* label, auto&& dispatch) {
+            sigil::util::timer_t t;
+            uint64_t sink = 0;
+
+            t.start();
+            for (int i = 0; i < RUNS; ++i)
+                sink += dispatch().info;
+            t.stop();
+
+            std::cout
+                << "[ DISPATCH PERF ] " << label
+                << " | runs: " << RUNS
+                << " | avg: " << t.elapsed_milliseconds() * 1e6 / RUNS << " ns"
+                << " | args seen: " << sink / RUNS
+                << std::endl;
+        };
+
+        measure("compiled table", [&] { return ::sigil::platform::dispatch_command(compiled, bench_argc, bench_argv); });
+        measure("runtime tree  ", [&] { return ::sigil::platform::dispatch_command(runtime, bench_argc, bench_argv); });
+    }
+
+    if (theme_test) {
+        // Every pattern, first pass compiles the template plans, later ones only render
+        constexpr int RUNS = 50;
+
+        std::vector<std::string> patterns;
+        if (list_theme_patterns(patterns).is_failure() || patterns.empty())
+            return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(ENOENT);
+
+        auto build_all = [&] {
+            ::sigil::yield st;
+            for (const auto &name : patterns)
+                st |= ::sigil::desktop::build_theme(app_context.app_info, name);
+            return st;
+        };
+
+        sigil::util::timer_t t;
+        t.start();
+        ::sigil::yield st = build_all();
+        t.stop();
+        const double cold_ms = t.elapsed_milliseconds();
+
+        t.start();
+        for (int i = 0; i < RUNS; ++i)
+            st |= build_all();
+        t.stop();
+
+        std::cout
+            << "[ THEME PERF ] " << patterns.size() << " patterns"
+            << " | first: " << cold_ms << " ms"
+            << " | warm avg: " << t.elapsed_milliseconds() / RUNS << " ms"
+            << (st.is_failure() ? " | with errors" : "")
+            << std::endl;
+    }
+
+    if (parser_test) {
+        // Theme patterns and waybar configs blown up to about 1 MB each, so the
+        // numbers are throughput and not call overhead
+        constexpr std::size_t CORPUS_BYTES = 1 << 20;
+        constexpr int RUNS = 20;
+        const std::filesystem::path assets = ::sigil::platform::get_theme_assets_root(app_context.app_info);
+
+        std::vector<std::string> patterns;
+        if (list_theme_patterns(patterns).is_failure() || patterns.empty())
+            return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(ENOENT);
+
+        std::string yaml;
+        for (std::size_t copy = 0; yaml.size() < CORPUS_BYTES; ++copy) {
+            for (const auto &name : patterns) {
+                std::istringstream in(bench_read_file(assets / "patterns" / (name + ".yaml")));
+                yaml += "p" + std::to_string(copy) + "_" + name + ":\n";
+                for (std::string line; std::getline(in, line);)
+                    yaml += "  " + line + "\n";
+            }
+        }
+
+        std::vector<std::string> configs;
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(assets / "common", ec)) {
+            const auto ext = entry.path().extension();
+            if (ext == ".json" || ext == ".jsonc")
+                configs.push_back(bench_read_file(entry.path()));
+        }
+        if (configs.empty())
+            return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(ENOENT);
+
+        std::string jsonc = "[\n";
+        while (jsonc.size() < CORPUS_BYTES)
+            for (const auto &config : configs)
+                jsonc += config + ",\n";
+        jsonc += "]\n";
+
+        sigil::util::timer_t t;
+        ::sigil::data::document_t doc;
+        ::sigil::yield st;
+        std::size_t sink = 0;
+
+        auto report = [&](const char *label, std::size_t bytes) {
+            const double ms = t.elapsed_milliseconds() / RUNS;
+            std::cout
+                << "[ PARSER PERF ] " << label
+                << " | " << ms << " ms"
+                << " | " << (bytes / (1024.0 * 1024.0)) / (ms / 1000.0) << " MB/s"
+                << std::endl;
+        };
+
+        std::vector<uint32_t> structurals;
+        t.start();
+        for (int i = 0; i < RUNS; ++i) {
+            ::sigil::data::scan_structurals(jsonc, structurals);
+            sink += structurals.size();
+        }
+        t.stop();
+        report("structural scan       ", jsonc.size());
+
+        std::vector<std::pair<std::string, std::string>> flat;
+        t.start();
+        for (int i = 0; i < RUNS; ++i) {
+            flat.clear();
+            bench_flatten_lines(yaml, flat);
+            sink += flat.size();
+        }
+        t.stop();
+        report("yaml lines (previous) ", yaml.size());
+
+        t.start();
+        for (int i = 0; i < RUNS; ++i) {
+            flat.clear();
+            st |= doc.parse(yaml, ::sigil::data::FORMAT_YAML);
+            bench_flatten_tape(doc.root(), {}, flat);
+            sink += flat.size();
+        }
+        t.stop();
+        report("yaml tape + flatten   ", yaml.size());
+
+        t.start();
+        for (int i = 0; i < RUNS; ++i) {
+            st |= doc.parse(yaml, ::sigil::data::FORMAT_YAML);
+            sink += doc.tape.size();
+        }
+        t.stop();
+        report("yaml tape             ", yaml.size());
+
+        t.start();
+        for (int i = 0; i < RUNS; ++i) {
+            st |= doc.parse(jsonc, ::sigil::data::FORMAT_JSONC);
+            sink += doc.tape.size();
+        }
+        t.stop();
+        report("jsonc tape            ", jsonc.size());
+
+        std::cout
+            << "[ PARSER PERF ] yaml " << yaml.size() << " B, jsonc " << jsonc.size() << " B"
+            << " | " << doc.tape.size() << " jsonc nodes"
+            << (st.is_failure() ? " | with errors" : "")
+            << (sink ? "" : " ")
+            << std::endl;
+    }
+
+    if (library_test) {
+        // Synthetic library: GAMES titles with a few directories, data files and executables each.
+        // The executables are MZ stubs, rejected after their first bytes, so this measures the walk.
+        constexpr int GAMES = 3000;
+        const std::filesystem::path root = std::filesystem::temp_directory_path() / "sigilvm-library-bench";
+        std::filesystem::remove_all(root);
+
+        const std::string stub = "MZ" + std::string(4094, '\0');
+        for (int g = 0; g < GAMES; ++g) {
+            const std::filesystem::path game = root / ("Game " + std::to_string(g));
+            std::filesystem::create_directories(game / "bin" / "x64");
+            std::filesystem::create_directories(game / "data" / "paks");
+            std::ofstream(game / "bin" / "x64" / "game.exe", std::ios::binary) << stub;
+            std::ofstream(game / "launcher.exe", std::ios::binary) << stub;
+            for (int f = 0; f < 12; ++f)
+                std::ofstream(game / "data" / "paks" / ("pak" + std::to_string(f) + ".pak")) << f;
+        }
+
+        const std::vector<std::filesystem::path> roots = { root };
+        ::sigil::platform::library_index_t index;
+        ::sigil::platform::library_scan_stats_t stats;
+        sigil::util::timer_t t;
+        bool changed = false;
+
+        t.start();
+        ::sigil::yield st = ::sigil::platform::scan_game_library(roots, index, changed, &stats);
+        t.stop();
+        std::cout << "[ LIBRARY SCAN ] full    " << t.elapsed_milliseconds() << " ms | "
+                  << stats.dirs_listed << " dirs listed, " << stats.exes_parsed << " executables parsed" << std::endl;
+
+        t.start();
+        st |= ::sigil::platform::scan_game_library(roots, index, changed, &stats);
+        t.stop();
+        std::cout << "[ LIBRARY SCAN ] rescan  " << t.elapsed_milliseconds() << " ms | "
+                  << stats.dirs_reused << " dirs reused, " << stats.exes_reused << " executables reused"
+                  << (changed ? " | changed" : "") << std::endl;
+
+        t.start();
+        st |= ::sigil::platform::scan_game_library(roots, index, changed, &stats, 1);
+        t.stop();
+        std::cout << "[ LIBRARY SCAN ] rescan  " << t.elapsed_milliseconds() << " ms on one thread"
+                  << (st.is_failure() ? " | with errors" : "") << std::endl;
+
+        std::filesystem::remove_all(root);
+    }
+
+    if (ledger_test) {
+        // ROUNDS of COUNT creates then COUNT retires in shuffled order, with the
+        // alive set never empty so retire keeps swapping entities into gaps
+        constexpr std::size_t COUNT = 1000000;
+        constexpr int ROUNDS = 8;
+
+        sigil::ledger l;
+        sigil::reserve(l, COUNT + 1);
+        const sigil::entity keep = sigil::create(l);
+
+        std::vector<sigil::entity> batch(COUNT);
+
+        sigil::util::timer_t t;
+        double create_ms = 0, retire_ms = 0;
+        ::sigil::yield st;
+
+        for (int r = 0; r < ROUNDS; ++r) {
+            t.start();
+            sigil::create(l, batch);
+            t.stop();
+            create_ms += t.elapsed_milliseconds();
+
+            std::shuffle(batch.begin(), batch.end(), std::mt19937(r));
+
+            t.start();
+            st |= sigil::retire(l, batch);
+            t.stop();
+            retire_ms += t.elapsed_milliseconds();
+        }
+
+        const double total = static_cast<double>(COUNT) * ROUNDS;
+        std::cout << "[ LEDGER PERF ] create  " << total / create_ms / 1000.0 << " M/s" << std::endl;
+        std::cout << "[ LEDGER PERF ] retire  " << total / retire_ms / 1000.0 << " M/s" << std::endl;
+        std::cout << "[ LEDGER PERF ] " << l.slots.size() << " slots, capacity " << l.slots.capacity()
+                  << " / " << l.alive.capacity() << " after " << ROUNDS << " rounds"
+                  << (sigil::exists(l, keep) && l.size() == 1 ? "" : " | lost track")
+                  << (st.is_failure() ? " | with errors" : "") << std::endl;
+    }
+
     if (xor_test) {
         std::srand(static_cast<unsigned>(std::time(nullptr)));
 
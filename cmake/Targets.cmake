@@ -7,6 +7,7 @@ file(GLOB SRC_PLATFORM  ${CMAKE_SOURCE_DIR}/src/platform/*.cpp)
 file(GLOB SRC_NETWORK   ${CMAKE_SOURCE_DIR}/src/network/*.cpp)
 file(GLOB SRC_RENDER    ${CMAKE_SOURCE_DIR}/src/render/*.cpp)
 file(GLOB SRC_UTILS     ${CMAKE_SOURCE_DIR}/src/utils/*.cpp)
+file(GLOB SRC_DATA      ${CMAKE_SOURCE_DIR}/src/data/*.cpp)
 file(GLOB SRC_MEDIA     ${CMAKE_SOURCE_DIR}/src/media/*.cpp)
 file(GLOB SRC_GAME      ${CMAKE_SOURCE_DIR}/src/game/*.cpp)
 file(GLOB SRC_MATH      ${CMAKE_SOURCE_DIR}/src/math/*.cpp)
@@ -0,0 +1,117 @@
+#pragma once
+
+/**
+ * file: include/sigil/data/binary.h
+ *
+ * Helpers for the binary index files SigilVM keeps in its cache (compat
+ * profiles, game library). Values are stored in native byte order, these
+ * files never leave the machine and are simply rebuilt when they do not read
+ * back. Strings are a u32 length followed by the bytes.
+ */
+
+#include <sigil/platform/fs.h>
+#include <sigil/common.h>
+#include <type_traits>
+#include <filesystem>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <string>
+
+namespace sigil::data {
+
+struct binary_writer_t {
+    std::string out;
+
+    template <typename T>
+    void put(const T &v) {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "fields are written one by one");
+        out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    void put(std::string_view s) {
+        put(static_cast<uint32_t>(s.size()));
+        out.append(s);
+    }
+
+    void put(const std::string &s) { put(std::string_view(s)); }
+    void put(const std::filesystem::path &p) { put(std::string_view(p.native())); }
+
+    void put(const ::sigil::fs::file_key_t &k) {
+        put(k.dev);
+        put(k.ino);
+        put(k.size);
+        put(k.mtime_sec);
+        put(k.mtime_nsec);
+    }
+};
+
+/**
+ * @brief
+ * Bounds checked cursor over a loaded file,
+ * ok turns false on the first read past the end and stays false.
+ */
+struct binary_reader_t {
+    const char *p = nullptr;
+    const char *end = nullptr;
+    bool ok = true;
+
+    binary_reader_t(std::string_view data) : p(data.data()), end(data.data() + data.size()) {}
+
+    bool done() const noexcept { return ok && p == end; }
+
+    template <typename T>
+    void get(T &v) {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "fields are read one by one");
+        if (!ok || static_cast<std::size_t>(end - p) < sizeof(T)) { ok = false; return; }
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+    }
+
+    // Fixed size tag such as a magic number
+    void get(char *dst, std::size_t n) {
+        if (!ok || static_cast<std::size_t>(end - p) < n) { ok = false; return; }
+        std::memcpy(dst, p, n);
+        p += n;
+    }
+
+    void get(std::string &s) {
+        uint32_t n = 0;
+        get(n);
+        if (!ok || static_cast<std::size_t>(end - p) < n) { ok = false; return; }
+        s.assign(p, n);
+        p += n;
+    }
+
+    void get(std::filesystem::path &path) {
+        std::string s;
+        get(s);
+        path = std::move(s);
+    }
+
+    void get(::sigil::fs::file_key_t &k) {
+        get(k.dev);
+        get(k.ino);
+        get(k.size);
+        get(k.mtime_sec);
+        get(k.mtime_nsec);
+    }
+};
+
+/**
+ * @brief Whole file into out.
+ * @return ::sigil::yield
+ * errno when the file cannot be read
+ */
+::sigil::yield read_binary_file(const std::filesystem::path &file, std::string &out);
+
+/**
+ * @brief
+ * Replace file with data through a temporary file and rename,
+ * readers see the old or the new contents, never a mix. Parents are created.
+ * @return ::sigil::yield
+ */
+::sigil::yield write_binary_file(const std::filesystem::path &file, std::string_view data);
+
+} // namespace sigil::data
@@ -0,0 +1,162 @@
+#pragma once
+
+/**
+ * file: include/sigil/data/parser.h
+ *
+ * Reader for the configuration formats SigilVM deals with: the YAML subset used
+ * by theme patterns and compat profiles, JSON with comments (waybar modules,
+ * exported characters) and Valve's KeyValues text (Steam library and app
+ * manifests). One SIMD pass finds the structural characters, the second pass
+ * only visits those and records nodes on a flat tape of offsets into the text,
+ * which the document reads into a buffer of its own when loaded from a file.
+ * Nothing is allocated per node, a document reused for another parse of a file
+ * no larger allocates nothing at all.
+ *
+ * YAML support: block mappings and sequences by indentation, "- key: value"
+ * items, plain / single / double quoted scalars, # comments, one-line flow
+ * collections ([a, b], {a: b}). Anchors, tags and block scalars are not handled.
+ */
+
+#include <sigil/common.h>
+#include <filesystem>
+#include <string_view>
+#include <iterator>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sigil::data {
+
+enum doc_format_t : uint8_t {
+    FORMAT_AUTO = 0,    // by extension: .json / .jsonc JSONC, .vdf / .acf VDF, anything else YAML
+    FORMAT_YAML,
+    FORMAT_JSONC,
+    FORMAT_VDF,         // Valve KeyValues text, top level pairs under an implicit root object
+};
+
+enum node_kind_t : uint8_t {
+    NODE_NULL = 0,      // null, ~ or a YAML key without a value
+    NODE_SCALAR,        // unquoted: numbers, true / false / null, bare words
+    NODE_STRING,        // quoted, text is what is between the quotes, escapes untouched
+    NODE_OBJECT,
+    NODE_ARRAY,
+};
+
+// Containers deeper than this are rejected
+constexpr uint32_t max_document_depth = 64;
+
+/**
+ * @brief
+ * One tape entry. Children of a container follow it directly,
+ * next is the index just past the entry and all of its descendants.
+ */
+struct node_t {
+    node_kind_t kind = NODE_NULL;
+    bool escaped = false;       // NODE_STRING holding escape sequences
+    uint32_t key_offset = 0;    // member name inside an object, key_length 0 otherwise
+    uint32_t key_length = 0;
+    uint32_t offset = 0;        // scalar and string text
+    uint32_t length = 0;
+    uint32_t count = 0;         // direct children
+    uint32_t next = 0;
+};
+
+struct document_t;
+
+/**
+ * @brief
+ * Handle to a node. Invalid handles answer every query with an empty result,
+ * so lookups chain without checks: doc.root()["tags"]["color"].str()
+ */
+struct value_t {
+    const document_t *doc = nullptr;
+    uint32_t index = 0;
+
+    bool valid() const noexcept { return doc != nullptr; }
+    explicit operator bool() const noexcept { return valid(); }
+
+    node_kind_t kind() const noexcept;
+    bool is_object() const noexcept { return kind() == NODE_OBJECT; }
+    bool is_array() const noexcept { return kind() == NODE_ARRAY; }
+
+    std::string_view key() const noexcept;
+    std::string_view str() const noexcept;      // raw text, decode() resolves escapes
+    std::size_t size() const noexcept;          // direct children
+
+    value_t find(std::string_view key) const noexcept;
+    value_t operator[](std::string_view key) const noexcept { return find(key); }
+    value_t at(std::size_t i) const noexcept;
+
+    // "a.b.c", every segment an object member
+    value_t path(std::string_view dotted) const noexcept;
+
+    bool as_int(int64_t &out) const noexcept;
+    bool as_double(double &out) const noexcept;
+    bool as_bool(bool &out) const noexcept;     // true / false, yes / no
+
+    // Text with escapes resolved, the only call here that allocates
+    std::string decode() const;
+
+    struct iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = value_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_t;
+
+        const document_t *doc = nullptr;
+        uint32_t index = 0;
+
+        value_t operator*() const noexcept { return { doc, index }; }
+        iterator &operator++() noexcept;
+        iterator operator++(int) noexcept { iterator t = *this; ++*this; return t; }
+        bool operator==(const iterator &o) const noexcept { return index == o.index; }
+    };
+
+    // Children of a container, nothing for anything else
+    iterator begin() const noexcept;
+    iterator end() const noexcept;
+};
+
+struct document_t {
+    std::string_view text;
+    std::vector<node_t> tape;
+    std::vector<uint32_t> structurals;      // first pass output, kept for reuse
+
+    document_t() = default;
+    ~document_t();
+
+    document_t(const document_t&) = delete;
+    document_t& operator=(const document_t&) = delete;
+    document_t(document_t &&o) noexcept;
+    document_t& operator=(document_t &&o) noexcept;
+
+    /**
+     * @brief Read a file into the document's buffer and parse it.
+     * @return ::sigil::yield
+     * errno when the file cannot be read,
+     * EINVAL on a syntax error with the byte offset in info
+     */
+    ::sigil::yield load(const std::filesystem::path &path, doc_format_t format = FORMAT_AUTO);
+
+    // Parse text owned by the caller, it has to outlive every value_t taken from here
+    ::sigil::yield parse(std::string_view text, doc_format_t format);
+
+    // Top level node, invalid for an empty document
+    value_t root() const noexcept { return tape.empty() ? value_t{} : value_t{ this, 0 }; }
+
+private:
+    std::vector<char> buffer;               // text of load(), capacity kept for reuse
+
+    void release() noexcept;
+};
+
+/**
+ * @brief
+ * Offsets of every { } [ ] : , " ' \ / # and newline in text, in order.
+ * AVX2 when the build targets it, a table walk otherwise.
+ */
+void scan_structurals(std::string_view text, std::vector<uint32_t> &out);
+
+} // namespace sigil::data
@@ -75,4 +75,7 @@ struct xxh128_payload_t {
 
 ::sigil::yield xxh128_hash(xxh128_payload_t& payload) noexcept;
 
+// Same digest as xxh128_hash, for data already in memory
+void xxh128_hash_bytes(const void* data, std::size_t size, std::array<std::uint8_t, 16>& output) noexcept;
+
 } // namespace sigil::math
@@ -8,6 +8,7 @@
 
 #include <cstdio>
 #include <functional>
+#include <filesystem>
 #include <sigil/platform/process.h>
 #include <sigil/common.h>
 #include <cstring>
@@ -38,12 +39,25 @@ inline void default_log_debug(const std::string &msg) {
     sigil::dcout << msg << std::endl;
 }
     
+/**
+ * @brief
+ * Roots and app-scoped directories, filled once by resolve_app_paths (paths.h).
+ */
+struct app_paths_t {
+    std::filesystem::path config_root, cache_root, data_root, state_root, runtime_root;
+    std::filesystem::path sigilvm_config, sigilvm_cache, sigilvm_data, sigilvm_state, sigilvm_runtime;
+    std::filesystem::path local_config, local_cache, local_data, local_state, local_socket;
+    std::filesystem::path compdata, theme_assets, home;
+    bool resolved = false;
+};
+
 struct app_descriptor_t {
     const char *app_id;
     const char *app_name;
     const char *dbus_prefix;
     bool initialized = false;
     process_descriptor_t process;
+    app_paths_t paths;                  // see resolve_app_paths
     
     std::function<void(const std::string&)> log_info;
     std::function<void(const std::string&)> log_warn;
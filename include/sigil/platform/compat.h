@@ -8,8 +8,11 @@
  */
 
 #include "sigil/platform/app.h"
+#include <sigil/platform/fs.h>
 #include <sigil/common.h>
 #include <filesystem>
+#include <cstdint>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -35,7 +38,104 @@ struct compat_profile_t {
     bool is_valid();
 };
 
+enum compat_hash_state_t : uint8_t {
+    COMPAT_HASH_NONE = 0,       // profile has no sha256 key
+    COMPAT_HASH_MATCH,
+    COMPAT_HASH_MISMATCH,
+};
+
+/**
+ * @brief
+ * Parsed profiles of one profiles directory and the outcome of their
+ * sha256 checks, persisted between runs. A profile file is parsed again
+ * only when its own (dev, ino, size, mtime) changes, a target is hashed
+ * again only when its metadata differs from what was recorded at the check.
+ */
+struct compat_profile_index_t {
+    struct entry_t {
+        std::string name;                   // file name inside the profiles directory
+        ::sigil::fs::file_key_t profile;    // profile file when it was parsed
+        ::sigil::fs::file_key_t target;     // target when it was hashed
+        compat_hash_state_t hash = COMPAT_HASH_NONE;
+        compat_profile_t data;
+    };
+
+    std::filesystem::path dir;
+    std::vector<entry_t> entries;           // sorted by name
+
+    /**
+     * @brief Read an index written by save().
+     * @return ::sigil::yield
+     * errno when unreadable, EINVAL when corrupt or of another version,
+     * the index is left empty then and simply rebuilds
+     */
+    ::sigil::yield load(const std::filesystem::path &file);
+    ::sigil::yield save(const std::filesystem::path &file) const;
+};
+
+struct compat_index_stats_t {
+    std::size_t parsed = 0;         // profile files read
+    std::size_t reused = 0;         // served from the index
+    std::size_t hashed = 0;         // targets run through sha256sum
+    std::size_t hash_skipped = 0;   // targets trusted by metadata
+    std::size_t rejected = 0;       // unreadable, mismatched or invalid
+};
+
+/**
+ * @brief Bring index up to date with dir and list its valid profiles.
+ * Profiles gone from dir are dropped from the index.
+ * @param changed - set when the index differs from what it was, worth saving
+ * @return ::sigil::yield
+ */
+::sigil::yield refresh_compat_profiles(const std::filesystem::path &dir, compat_profile_index_t &index,
+                                       std::vector<compat_profile_t> &out, bool &changed,
+                                       compat_index_stats_t *stats = nullptr);
+
+/**
+ * @brief
+ * Pristine prefix of runner, <compdata>/templates/<runner name>-<hash of its path
+ * and version>, a runner upgraded in place gets a new template.
+ * Its record, <template>.yaml, sits next to it so clones do not carry it.
+ */
+std::filesystem::path get_prefix_template_path(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &runner);
+
+/**
+ * @brief Initialize the template of runner once, by running wineboot in a
+ * staging directory that is renamed into place when the prefix is complete.
+ * Built under an flock of <template>.lock, concurrent callers wait for it.
+ * @param out - template directory
+ * @return ::sigil::yield
+ * errno of the failing step, ECHILD when wineboot exits with an error
+ */
+::sigil::yield ensure_prefix_template(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &runner,
+                                      std::filesystem::path &out);
+
+/**
+ * @brief
+ * New prefix <compdata>/prefixes/<name>, cloned from the runner's template
+ * (initialized first if needed). Files share extents with the template through
+ * reflinks where the filesystem has them and are copied otherwise, and
+ * <prefix>/sigil-prefix.yaml records how many bytes are shared and how many are its own.
+ * @param stats - optional, what the clone did per file
+ * @return ::sigil::yield
+ * EEXIST when the prefix exists
+ */
+::sigil::yield create_compat_prefix(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &runner,
+                                    const std::string &name, std::filesystem::path &out,
+                                    ::sigil::fs::copy_stats_t *stats = nullptr);
+
+/**
+ * @brief
+ * Runners in <compdata>/runners, Steam's custom and installed Protons
+ * as found by probe_steam(), and wine when it is in PATH.
+ */
 ::sigil::yield probe_compat_tools(const ::sigil::platform::app_descriptor_t &app, std::vector<compat_tool_t> &out);
+
+/**
+ * @brief
+ * Profiles in <compdata>/profiles, through the index kept in
+ * <sigilvm cache>/compat/profiles.index.
+ */
 ::sigil::yield probe_compat_profiles(const ::sigil::platform::app_descriptor_t &app, std::vector<compat_profile_t> &out);
 ::sigil::yield load_compat_profile(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &src, compat_profile_t &out);
 ::sigil::yield save_compat_profile(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &out, compat_profile_t &src);
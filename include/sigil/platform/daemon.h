@@ -0,0 +1,107 @@
+#pragma once
+
+/**
+ * file: include/sigil/platform/daemon.h
+ *
+ * Resident mode for SigilVM command line tools.
+ * A daemon keeps its process warm (command tables, contexts, cached probes)
+ * and serves invocations forwarded by thin clients over a unix socket.
+ * The client's stdio descriptors travel with the request (SCM_RIGHTS), so
+ * output goes straight to the caller, only the exit code comes back.
+ */
+
+#include <sigil/platform/app.h>
+#include <sigil/common.h>
+#include <filesystem>
+#include <functional>
+#include <atomic>
+#include <array>
+#include <vector>
+
+namespace sigil::platform {
+
+/**
+ * @brief
+ * One forwarded invocation, pointers refer into payload.
+ */
+struct daemon_request_t {
+    int argc = 0;
+    std::vector<const char*> argv;      // nullptr terminated, argv[0] is the client binary
+    std::vector<const char*> envp;      // nullptr terminated
+    const char *cwd = "";
+    std::vector<char> payload;
+};
+
+/**
+ * @brief
+ * Runs on the serving thread with the client's stdio on fds 0-2,
+ * its working directory and its environ in place. Returns the exit code.
+ * environ only reaches getenv() and children, descriptors the handler
+ * resolves paths through come from daemon_client_app().
+ */
+using daemon_handler_t = std::function<int(const daemon_request_t&)>;
+
+/**
+ * @brief
+ * Listening side. Requests are served one at a time, in order,
+ * only from clients running as the same user. A request is run only after
+ * its client confirmed it still waits, see daemon_forward().
+ */
+struct daemon_server_t {
+    int listen_fd = -1;
+    int wake_fd = -1;
+    std::atomic<bool> stopping = false;
+    std::filesystem::path socket_path;
+
+    daemon_server_t() = default;
+    ~daemon_server_t();
+
+    daemon_server_t(const daemon_server_t&) = delete;
+    daemon_server_t& operator=(const daemon_server_t&) = delete;
+
+    /**
+     * @brief Bind the socket, creating its directory with mode 0700.
+     * A socket left behind by a dead daemon is replaced.
+     * @return ::sigil::yield
+     * Failure with EADDRINUSE while another daemon answers on path
+     */
+    ::sigil::yield listen(const std::filesystem::path &path);
+
+    // Serve requests until stop()
+    ::sigil::yield run(const daemon_handler_t &handler);
+
+    // Serve at most one request, waiting up to timeout_ms (-1: forever)
+    ::sigil::yield serve_one(const daemon_handler_t &handler, int timeout_ms = -1);
+
+    // Make run() return, safe from signal handlers and other threads
+    void stop() noexcept;
+
+    // Close and unlink the socket
+    void close();
+};
+
+/**
+ * @brief
+ * Process and app descriptors of the client behind req, built from its argv and
+ * envp and with paths resolved, so HOME, XDG_*_HOME and SIGILVM_* are the caller's.
+ * Both point into req, they are valid for as long as the handler runs.
+ */
+::sigil::yield daemon_client_app(const daemon_request_t &req, process_descriptor_t &proc, app_descriptor_t &app);
+
+/**
+ * @brief Run argv in the daemon listening on socket_path.
+ * @param stdio - descriptors the daemon reads and writes, usually 0, 1, 2
+ * @param exit_code - exit code of the forwarded command
+ * @param accept_timeout_ms - how long the daemon may take to pick the request up
+ * @return ::sigil::yield
+ * Failure only when the daemon did not take the request (ENOENT, ECONNREFUSED
+ * with no daemon running, ETIMEDOUT while it serves another call), the caller
+ * should dispatch locally then, the daemon will not run it.
+ * A daemon dying mid-request reports exit code 1 instead, never run twice.
+ */
+::sigil::yield daemon_forward(const std::filesystem::path &socket_path, int argc, const char **argv,
+                              const char **envp, int &exit_code,
+                              const std::array<int, 3> &stdio = { 0, 1, 2 },
+                              int accept_timeout_ms = 500);
+
+} // namespace sigil::platform
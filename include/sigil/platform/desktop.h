@@ -1,7 +1,11 @@
 #pragma once
 #include "sigil/platform/app.h"
+#include <sigil/platform/fs.h>
 #include <filesystem>
 #include <sigil/common.h>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -26,13 +30,27 @@ namespace sigil::desktop {
  */
 ::sigil::yield list_themes(std::vector<std::string> &out);
 
+/**
+ * @brief
+ * Desktop component of a theme, built from one directory of the templates.
+ */
+struct theme_component_t {
+    const char *name;       // directory in the built theme and in ~/.config
+    const char *source;     // directory under <theme assets>/common
+};
+
+const std::vector<theme_component_t> &theme_components();
+
 /**
  * @brief Arrange templates and a <name>.yaml theme config
  * into a theme located in ~/.local/share/sigilvm/themes/<name>
  * @param name
+ * @param components
+ * Component names to rebuild, empty rebuilds all of them
  * @return ::sigil::yield
  */
-::sigil::yield build_theme(std::string name);
+::sigil::yield build_theme(const ::sigil::platform::app_descriptor_t &app, const std::string &name,
+                           const std::vector<std::string> &components = {});
 
 /**
  * @brief Deploy a theme from ~/.local to ~/.config
@@ -44,32 +62,132 @@ namespace sigil::desktop {
 
 
 /**
- * @brief Deploy a theme from ~/.local to ~/.config
- *
- * @param name
+ * @brief
+ * Rendered theme in <sigilvm cache>/themes/<template digest>-<pattern digest>/<name>.
+ * The key covers every template and the pattern file, so a variant is only
+ * ever rendered once and stays valid until either side changes.
+ */
+struct theme_variant_t {
+    std::filesystem::path dir;      // deploy from here
+    bool built = false;             // rendered by this call
+    bool prewarmed = false;         // every pattern of the current templates has a variant
+};
+
+/**
+ * @brief Find the variant of pattern name for the installed templates, rendering it on a miss.
+ * @return ::sigil::yield
+ * ENOENT when there is no such pattern
+ */
+::sigil::yield get_theme_variant(const ::sigil::platform::app_descriptor_t &app, const std::string &name,
+                                 theme_variant_t &out);
+
+/**
+ * @brief
+ * Render the variant of every pattern that is not cached yet, then drop
+ * variants no current template set and pattern can ask for.
+ * Meant to run detached after the installed templates change.
+ * @param built
+ * Number of variants rendered
+ * @return ::sigil::yield
+ */
+::sigil::yield prewarm_theme_variants(const ::sigil::platform::app_descriptor_t &app, std::size_t &built);
+
+/**
+ * @brief
+ * Digest of one file, path is relative to the manifest root ('/' separated).
+ * key is the identity the file had when it was hashed,
+ * while it still matches the digest is reused without reading the file.
+ */
+struct theme_manifest_entry_t {
+    std::string path;
+    ::sigil::fs::file_digest_t digest{};
+    ::sigil::fs::file_key_t key;
+
+    bool operator==(const theme_manifest_entry_t&) const = default;
+};
+
+struct theme_manifest_t {
+    std::vector<theme_manifest_entry_t> entries;    // sorted by path
+
+    const theme_manifest_entry_t *find(std::string_view path) const;
+
+    // Missing or unreadable files leave an empty manifest and fail with errno
+    ::sigil::yield load(const std::filesystem::path &file);
+    ::sigil::yield save(const std::filesystem::path &file) const;
+};
+
+/**
+ * @brief
+ * Create or update <theme_dir>/.manifest with a digest of every file in the theme.
+ * Files whose key did not change since the last update are not read again.
+ * @param out
+ * Manifest as written to disk
+ * @return ::sigil::yield
+ * ENOENT if theme_dir does not exist
+ */
+::sigil::yield update_theme_manifest(const std::filesystem::path &theme_dir, theme_manifest_t &out);
+
+/**
+ * @brief
+ * Bring ~/.config in line with a built theme, touching only files that differ.
+ * What was deployed last is remembered in <sigilvm state>/themes/deployed.manifest,
+ * files edited since then are hashed again before being judged.
+ * @param changed
+ * Components whose files were written, removed or relinked
  * @return ::sigil::yield
  */
-::sigil::yield deploy_theme_from_path(const ::sigil::platform::app_descriptor_t &app, std::filesystem::path theme_dir);
+::sigil::yield deploy_theme_files(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &theme_dir,
+                                  std::vector<std::string> &changed);
 
+/**
+ * @brief
+ * Materialize every component of a built theme once, content-addressed, under
+ * <sigilvm data>/generations/<component>/<digest>, then point ~/.config/<component>
+ * at it. Each link is replaced by a single rename, so readers see the old or
+ * the new config, never a mix. A real directory found in the way is swapped
+ * out with RENAME_EXCHANGE and kept under <sigilvm state>/themes/original.
+ * Generations neither the new nor the previous set points into are removed.
+ * @param changed
+ * Components whose link moved
+ * @return ::sigil::yield
+ */
+::sigil::yield switch_theme_generation(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &theme_dir,
+                                       std::vector<std::string> &changed);
 
 /**
  * @brief
- * Create or update ~/.local/share/sigilvm/themes/manifest.yaml
- * with hash values generated during theme build step.
- * Used to detect if generated themes were modified by user.
+ * Point every component back at the generation it used before the last switch.
  * @return ::sigil::yield
- * VM_RESOURCE_MISSING if there are no themes found in the ~/.local
- * VM_OK on success
+ * ENOENT when there is no earlier generation
  */
-::sigil::yield update_theme_manifest();
+::sigil::yield rollback_theme_generation(const ::sigil::platform::app_descriptor_t &app, std::vector<std::string> &changed);
+
+enum theme_deploy_mode_t : uint32_t {
+    THEME_DEPLOY_GENERATION = 0,    // switch_theme_generation
+    THEME_DEPLOY_IN_PLACE,          // deploy_theme_files, for configs edited by hand
+};
 
+/**
+ * @brief Deploy a theme from ~/.local to ~/.config,
+ * then reload the components that changed.
+ * @param theme_dir
+ * @return ::sigil::yield
+ */
+::sigil::yield deploy_theme_from_path(const ::sigil::platform::app_descriptor_t &app, std::filesystem::path theme_dir,
+                                      theme_deploy_mode_t mode = THEME_DEPLOY_GENERATION);
 
 /**
  * @brief
- * Attempt to reset every desktop component
+ * Reload running desktop components (hypr, mako, waybar, Kvantum).
+ * Hyprland and hyprpaper are asked over their sockets, waybar gets SIGUSR2,
+ * the Kvantum selection is written directly. Without a Hyprland socket in
+ * the environment the control tools are spawned instead.
+ * @param components
+ * Only reload these, empty reloads every one of them
  * @return ::sigil::yield
  */
-::sigil::yield reload_components();
+::sigil::yield reload_components(const ::sigil::platform::app_descriptor_t &app,
+                                 const std::vector<std::string> &components = {});
 
 
 } // namespace sigil::desktop
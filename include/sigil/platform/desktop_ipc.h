@@ -0,0 +1,82 @@
+#pragma once
+
+/**
+ * file: include/sigil/platform/desktop_ipc.h
+ *
+ * Talking to running desktop components without spawning their control tools.
+ * Hyprland and hyprpaper answer one request per connection on unix sockets under
+ * $XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE, waybar reloads its config
+ * and style on SIGUSR2, Kvantum only reads its config file.
+ */
+
+#include <sigil/platform/process.h>
+#include <sigil/common.h>
+#include <filesystem>
+#include <string_view>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sigil::desktop {
+
+/**
+ * @brief
+ * Sockets of one Hyprland instance.
+ */
+struct hypr_instance_t {
+    std::filesystem::path dir;      // .../hypr/<instance signature>
+
+    std::filesystem::path control_socket() const { return dir / ".socket.sock"; }
+    std::filesystem::path hyprpaper_socket() const { return dir / ".hyprpaper.sock"; }
+};
+
+/**
+ * @brief
+ * Instance named by HYPRLAND_INSTANCE_SIGNATURE, under $XDG_RUNTIME_DIR/hypr
+ * or /tmp/hypr for Hyprland before 0.40.
+ * @return false when the variable is unset or no control socket exists
+ */
+bool find_hypr_instance(const ::sigil::platform::process_descriptor_t &p, hypr_instance_t &out);
+
+/**
+ * @brief Send one request and read the reply until the peer closes.
+ * @param timeout_ms - limit for the whole exchange
+ * @return ::sigil::yield
+ * errno of the failing call, ETIMEDOUT when the peer does not answer in time
+ */
+::sigil::yield hypr_request(const std::filesystem::path &socket, std::string_view request,
+                            std::string &reply, int timeout_ms = 1000);
+
+/**
+ * @brief hyprctl command over the control socket, "reload", "keyword ..." or "[[BATCH]]a;b".
+ * @return ::sigil::yield
+ * EPROTO when Hyprland answers with anything but "ok"
+ */
+::sigil::yield hypr_dispatch(const hypr_instance_t &hypr, std::string_view command);
+
+// Names of the enabled monitors, from j/monitors
+::sigil::yield hypr_monitors(const hypr_instance_t &hypr, std::vector<std::string> &out);
+
+/**
+ * @brief Show file on every enabled monitor through hyprpaper, "fill" mode.
+ * @return ::sigil::yield
+ * ENOENT when hyprpaper is not running
+ */
+::sigil::yield hyprpaper_wallpaper(const hypr_instance_t &hypr, const std::filesystem::path &file);
+
+/**
+ * @brief
+ * Send sig to every process of the current user whose comm is name.
+ * @return number of processes signalled
+ */
+std::size_t signal_processes(std::string_view name, int sig);
+
+/**
+ * @brief Select a Kvantum theme in <config>/Kvantum/kvantum.kvconfig,
+ * what `kvantummanager --set` does, other settings are kept.
+ * @param changed - false when the theme was already selected
+ * @return ::sigil::yield
+ */
+::sigil::yield kvantum_select_theme(const std::filesystem::path &config_root, std::string_view theme, bool &changed);
+
+} // namespace sigil::desktop
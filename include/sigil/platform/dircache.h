@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+ * file: include/sigil/platform/dircache.h
+ *
+ * Directory listing cache for UI code (editor File Explorer).
+ * Listing happens on a background thread, snapshots are kept fresh
+ * with inotify, and get() only swaps a shared_ptr, never touches disk.
+ */
+
+#include <sigil/common.h>
+#include <filesystem>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sigil::fs {
+
+struct dir_entry_t {
+    std::filesystem::path path;
+    std::string name;
+    std::string label;          // "[D] name" for directories, built once
+    bool is_directory = false;
+};
+
+struct dir_snapshot_t {
+    std::filesystem::path dir;
+    std::vector<dir_entry_t> entries;   // directories first, then by name
+    uint64_t generation = 0;            // bumps on every relist of this dir
+    int error = 0;                      // errno of the failed listing, 0 on success
+};
+
+/**
+ * @brief
+ * Background directory snapshot cache.
+ * The worker thread starts on the first get(), watches the most recently
+ * requested directory and relists it (debounced) when inotify reports changes.
+ * A few recently visited directories stay cached, so going back is instant.
+ */
+struct dir_cache_t {
+    dir_cache_t();
+    ~dir_cache_t();
+
+    dir_cache_t(const dir_cache_t&) = delete;
+    dir_cache_t& operator=(const dir_cache_t&) = delete;
+
+    /**
+     * @brief
+     * Latest snapshot of dir, possibly stale while a relist is pending.
+     * nullptr until the first listing of dir is done.
+     */
+    std::shared_ptr<const dir_snapshot_t> get(const std::filesystem::path &dir);
+
+    // Request a relist of the current directory
+    void refresh();
+
+    struct state_t;
+    std::unique_ptr<state_t> state;
+};
+
+} // namespace sigil::fs
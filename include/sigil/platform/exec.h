@@ -8,34 +8,108 @@
  */
 
 #include <unordered_map>
+#include <functional>
+#include <type_traits>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
 #include <sigil/common.h>
 #include <sys/types.h>
+#include <csignal>
 #include <unistd.h>
+#include <string_view>
 #include <optional>
 #include <cstdint>
+#include <memory>
+#include <array>
+#include <map>
 #include <string>
 #include <vector>
 
 
 namespace sigil::platform {
 
+// Capacity of the fixed argument lists, dispatch never touches the heap
+constexpr std::size_t max_command_args = 64;
+constexpr std::size_t max_command_switches = 16;
+constexpr std::size_t max_command_depth = 4;
+
+/**
+ * @brief
+ * Fixed-capacity list with the read side of std::vector.
+ * Used for dispatch results, so handlers see views without any allocation.
+ */
+template <typename T, std::size_t N>
+struct arg_list_t {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+
+    // Left uninitialized, dispatch would otherwise clear a few KiB per call
+    union { std::array<T, N> items; };
+    std::size_t count = 0;
+
+    arg_list_t() noexcept {}
+
+    // false once full
+    bool push_back(const T &v) noexcept {
+        if (count == N) return false;
+        std::construct_at(&items[count++], v);
+        return true;
+    }
+
+    // Drop the first n entries
+    void erase_front(std::size_t n) noexcept {
+        n = std::min(n, count);
+        std::memmove(static_cast<void*>(items.data()), items.data() + n, (count - n) * sizeof(T));
+        count -= n;
+    }
+
+    const T& at(std::size_t i) const {
+        if (i >= count) throw std::out_of_range("arg_list_t::at");
+        return items[i];
+    }
+
+    const T& operator[](std::size_t i) const noexcept { return items[i]; }
+    std::size_t size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+    const T* begin() const noexcept { return items.data(); }
+    const T* end() const noexcept { return items.data() + count; }
+};
+
+// Views point into argv, or into the string given to dispatch_command
 struct switch_arg_t {
-    std::string name;                    // e.g., "--verbose"
-    std::optional<std::string> value;    // std::nullopt if boolean switch
+    std::string_view name;                   // e.g., "--verbose"
+    std::optional<std::string_view> value;   // std::nullopt if boolean switch
 };
-    
+
+using cmd_tokens_t = arg_list_t<std::string_view, max_command_args>;
+
 struct cmd_handler_args_t {
-    std::vector<std::string> args;
-    std::vector<switch_arg_t> switches;
+    cmd_tokens_t args;
+    arg_list_t<switch_arg_t, max_command_switches> switches;
+
+    bool is_set(std::string_view option) const noexcept {
+        for (const auto &s : switches) {
+            if (s.name == option) return true;
+        }
+        return false;
+    }
 };
-    
-using command_handler_t = ::sigil::yield (*)(const cmd_handler_args_t);
+
+using command_handler_t = ::sigil::yield (*)(const cmd_handler_args_t&);
 
 // Exec modes for PEU
 enum exec_mode_t : uint32_t {
     EXEC_REPLACE = 0,   // execve / execvp, does not return on success
     EXEC_WAIT,          // fork + exec + waitpid
     EXEC_DETACH,        // fork + setsid + exec, no wait
+    EXEC_ASYNC,         // spawn + pidfd, exit reported through exec_supervisor_t
+};
+
+// Process creation backend for PEU
+enum spawn_backend_t : uint32_t {
+    SPAWN_AUTO = 0,     // zygote if started, else posix_spawn where available, fork otherwise
+    SPAWN_POSIX,        // posix_spawn, vfork-style, no page table copy of the parent
+    SPAWN_FORK,         // fork + exec, for setups posix_spawn cannot express
 };
 
 // STDIO redirection for interprocess
@@ -43,6 +117,30 @@ enum stdio_mode_t : uint32_t {
     STDIO_INHERIT = 0,  // inherit parent's stdio
     STDIO_NULL,         // redirect to /dev/null
     STDIO_CAPTURE,      // capture via memfd_create
+    STDIO_STREAM,       // non-blocking pipe, lines go to proc_exec_unit_t::on_line while the child runs
+};
+
+using line_handler_t = std::function<void(int stream, std::string_view line)>;
+
+/**
+ * @brief
+ * Splits a byte stream into lines, reading in 64 KiB blocks.
+ * Lines are views into the internal buffer, valid only during the callback.
+ * Lines longer than the buffer arrive in buffer-sized pieces.
+ */
+struct line_reader_t {
+    std::vector<char> buffer;
+    std::size_t used = 0;
+
+    /**
+     * @brief Read what fd has right now and emit every complete line.
+     * @return bool
+     * false once fd hit EOF or failed, true while more may come
+     */
+    bool pump(int fd, const std::function<void(std::string_view)>& on_line);
+
+    // Emit the unterminated tail, if any
+    void finish(const std::function<void(std::string_view)>& on_line);
 };
     
 
@@ -64,7 +162,7 @@ struct command_t {
     * Structure for creation of internal command tree
     */
 struct command_node_t {
-    std::unordered_map<std::string, command_node_t*> children;
+    std::map<std::string, std::unique_ptr<command_node_t>, std::less<>> children;
     command_handler_t handler;
     bool passthrough;
 
@@ -73,23 +171,140 @@ struct command_node_t {
 
 /*
     * @brief
-    * Core structure to register new commands
-    * or to dispatch existing ones
+    * Core structure to register new commands at runtime
+    * or to dispatch existing ones. Owns its tree, not copyable.
     */
 struct command_registry_t {
     command_node_t root;
+};
 
-    // switches discovered during dispatch
-    std::vector<switch_arg_t> switches;
+/**
+ * @brief
+ * Entry of a compiled command table.
+ * Same meaning as command_t, but literal so the table can be constexpr.
+ */
+struct command_spec_t {
+    std::array<std::string_view, max_command_depth> words = {};   // {"theme","set"}, unused slots empty
+    bool passthrough = false;
+    command_handler_t handler = nullptr;
+
+    constexpr std::size_t depth() const noexcept {
+        std::size_t n = 0;
+        while (n < words.size() && !words[n].empty()) ++n;
+        return n;
+    }
+};
 
-    // simple utility to query active switches
-    bool is_set(const std::string& option) const {
-        for (const auto& s : switches) {
-            if (s.name == option) return true;
+// FNV-1a over command words, 0x1f between words, seeded through the offset basis
+constexpr uint32_t command_hash_step(uint32_t h, std::string_view word) noexcept {
+    for (char c : word) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    h ^= 0x1fu;
+    h *= 16777619u;
+    return h;
+}
+
+constexpr uint32_t command_hash_seed(uint32_t seed) noexcept {
+    return 2166136261u ^ (seed * 0x9e3779b9u);
+}
+
+// FNV low bits only see low input bits, mix before masking into a slot
+constexpr uint32_t command_hash_mix(uint32_t h) noexcept {
+    h ^= h >> 16;
+    h *= 0x45d9f3bu;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief
+ * Type-erased view of a command_table_t, what dispatch actually walks.
+ */
+struct command_index_t {
+    const command_spec_t *entries = nullptr;
+    const int16_t *slots = nullptr;     // entry index per hash slot, -1 = empty
+    uint32_t mask = 0;
+    uint32_t seed = 0;
+    std::size_t max_depth = 0;
+};
+
+/**
+ * @brief
+ * Command table with a perfect hash over the word paths, built at compile time.
+ * Duplicate paths or more than max_command_depth words fail the build.
+ */
+template <std::size_t N>
+struct command_table_t {
+    static constexpr std::size_t slot_count = [] {
+        std::size_t n = 1;
+        while (n < 2 * N) n <<= 1;
+        return n;
+    }();
+
+    std::array<command_spec_t, N> entries = {};
+    std::array<int16_t, slot_count> slots = {};
+    uint32_t seed = 0;
+    std::size_t max_depth = 0;
+
+    constexpr explicit command_table_t(const std::array<command_spec_t, N> &specs) : entries(specs) {
+        static_assert(N > 0 && N < 0x7fff, "command table size out of range");
+
+        for (std::size_t i = 0; i < N; ++i) {
+            if (entries[i].handler == nullptr)
+                throw "command table: entry without handler";
+            const std::size_t d = entries[i].depth();
+            for (std::size_t w = d; w < max_command_depth; ++w) {
+                if (!entries[i].words[w].empty())
+                    throw "command table: gap in command words";
+            }
+            if (d > max_depth) max_depth = d;
+            for (std::size_t j = 0; j < i; ++j) {
+                if (entries[j].words == entries[i].words)
+                    throw "command table: duplicate command";
+            }
         }
-        return false;
+
+        for (uint32_t s = 1; s < 0x10000; ++s) {
+            if (try_seed(s)) {
+                seed = s;
+                return;
+            }
+        }
+        throw "command table: no perfect hash seed";
     }
-};    
+
+    constexpr uint32_t hash(const command_spec_t &e, uint32_t s) const noexcept {
+        uint32_t h = command_hash_seed(s);
+        for (std::size_t w = 0; w < e.depth(); ++w)
+            h = command_hash_step(h, e.words[w]);
+        return h;
+    }
+
+    constexpr bool try_seed(uint32_t s) {
+        for (auto &slot : slots) slot = -1;
+        for (std::size_t i = 0; i < N; ++i) {
+            const uint32_t at = command_hash_mix(hash(entries[i], s)) & (slot_count - 1);
+            if (slots[at] != -1) return false;
+            slots[at] = static_cast<int16_t>(i);
+        }
+        return true;
+    }
+
+    constexpr command_index_t index() const noexcept {
+        return { entries.data(), slots.data(), static_cast<uint32_t>(slot_count - 1), seed, max_depth };
+    }
+};
+
+/**
+ * @brief Build a command_table_t, meant for constexpr variables:
+ * static constexpr auto commands = make_command_table<2>({{ {{"help"}, true, cmd_help}, ... }});
+ */
+template <std::size_t N>
+constexpr command_table_t<N> make_command_table(const std::array<command_spec_t, N> &specs) {
+    return command_table_t<N>(specs);
+}
     
     
 
@@ -100,9 +315,13 @@ struct proc_exec_result_t {
     int   exit_code = -1;     // normalized exit code
     int   term_signal = 0;    // terminating signal, if any
 
-    // valid only if STDIO_CAPTURE
-    int   stdout_fd = -1;     // memfd
-    int   stderr_fd = -1;     // memfd
+    // valid only if STDIO_CAPTURE (memfd), or STDIO_STREAM until the child is reaped (pipe)
+    int   stdout_fd = -1;
+    int   stderr_fd = -1;
+
+    // valid only for EXEC_ASYNC
+    int   pidfd = -1;         // readable once the child exits, -1 if pidfd_open is unavailable
+    bool  timed_out = false;  // killed by the supervisor after its timeout
 };
 
 
@@ -117,6 +336,8 @@ struct proc_exec_unit_t {
     stdio_mode_t stderr_mode = STDIO_INHERIT;
     proc_exec_result_t result = {};
     bool use_path = true;               // execvp vs execve
+    spawn_backend_t spawn_backend = SPAWN_AUTO;
+    line_handler_t on_line = {};        // STDIO_STREAM output, stream is STDOUT_FILENO or STDERR_FILENO
 
 
     proc_exec_unit_t& set_target(const std::string& path) {
@@ -145,6 +366,16 @@ struct proc_exec_unit_t {
         return *this;
     }
 
+    proc_exec_unit_t& set_line_handler(line_handler_t handler) {
+        on_line = std::move(handler);
+        return *this;
+    }
+
+    proc_exec_unit_t& set_spawn_backend(spawn_backend_t b) {
+        spawn_backend = b;
+        return *this;
+    }
+
     proc_exec_unit_t& set_stdio_mode(stdio_mode_t in,
                                      stdio_mode_t out,
                                      stdio_mode_t err) {
@@ -172,6 +403,71 @@ struct proc_exec_unit_t {
  */
 ::sigil::yield execute(proc_exec_unit_t& peu);
 
+using exec_callback_t = std::function<void(const proc_exec_result_t&)>;
+
+/**
+ * @brief
+ * Runs many EXEC_ASYNC children from one thread without blocking on any of them.
+ * Exits (pidfd) and timeouts are multiplexed on a single epoll instance,
+ * callbacks run from poll() on the caller's thread. Not thread-safe.
+ */
+struct exec_supervisor_t {
+    exec_supervisor_t();
+    ~exec_supervisor_t();
+
+    exec_supervisor_t(const exec_supervisor_t&) = delete;
+    exec_supervisor_t& operator=(const exec_supervisor_t&) = delete;
+
+    /**
+     * @brief Start peu as EXEC_ASYNC and track it.
+     * @param on_exit - Called once with the final result, captured fds rewound
+     * @param timeout_ms - SIGTERM after this long, SIGKILL a second later, -1 = none
+     * @return status_t
+     * Handle id for cancel() in yield.info
+     */
+    ::sigil::yield launch(proc_exec_unit_t& peu, exec_callback_t on_exit = {}, int timeout_ms = -1);
+
+    // Signal a running child, via pidfd_send_signal where available
+    ::sigil::yield cancel(uint64_t id, int sig = SIGTERM);
+
+    /**
+     * @brief Reap finished children and enforce timeouts, waiting up to timeout_ms (-1 = until one exits).
+     * @return status_t
+     * Number of completions in yield.info
+     */
+    ::sigil::yield poll(int timeout_ms = 0);
+
+    // poll() until every launched child has finished
+    ::sigil::yield run();
+
+    std::size_t active() const noexcept;
+
+    // epoll fd, readable when poll() has work, for callers with their own event loop
+    int fd() const noexcept;
+
+    struct state_t;
+    std::unique_ptr<state_t> state;
+};
+
+/**
+ * @brief
+ * Fork the zygote, a helper that spawns children on behalf of this process.
+ * Call early in main(), while the process is small and has no threads yet.
+ * Afterwards execute() hands EXEC_WAIT / EXEC_DETACH units on SPAWN_AUTO to it,
+ * so spawn cost stays that of the small helper however large the caller grows.
+ * Captured output comes back as memfds over SCM_RIGHTS, results are unchanged.
+ * Starting, stopping and spawning through it are safe from any thread.
+ * @return status_t
+ * Failure with ENOSYS without pidfd support, execute() then spawns directly
+ */
+::sigil::yield zygote_start();
+
+// Close the channel and reap the zygote, children it started keep running
+void zygote_stop();
+
+// Pid of the running zygote, -1 if there is none
+pid_t zygote_pid() noexcept;
+
 
 /**
  * @brief Attaches new command to existing registry
@@ -198,33 +494,55 @@ struct proc_exec_unit_t {
  * @param argv - taken from main arguments
  * @return status_t
  */
-::sigil::yield dispatch_command(const command_registry_t& reg, const int argc, const char** argv);
+::sigil::yield dispatch_command(const command_registry_t& reg, const int argc, const char* const* argv);
 
 /**
  * @brief Dispatch a command in a string form
  * @param reg - Existing registry
- * @param input - Command in a string form
+ * @param input - Command in a string form, must outlive the handler call
+ * @return status_t
+ */
+::sigil::yield dispatch_command(const command_registry_t& reg, std::string_view input);
+
+/**
+ * @brief Dispatch shell arguments against a compiled table, no heap allocation.
+ * Picks the longest registered word path that prefixes the positional tokens.
  * @return status_t
  */
-::sigil::yield dispatch_command(const command_registry_t& reg, std::string input);
+::sigil::yield dispatch_command(const command_index_t& index, const int argc, const char* const* argv);
+::sigil::yield dispatch_command(const command_index_t& index, std::string_view input);
+
+template <std::size_t N>
+::sigil::yield dispatch_command(const command_table_t<N>& table, const int argc, const char* const* argv) {
+    return dispatch_command(table.index(), argc, argv);
+}
+
+template <std::size_t N>
+::sigil::yield dispatch_command(const command_table_t<N>& table, std::string_view input) {
+    return dispatch_command(table.index(), input);
+}
 
- 
  /**
   * @brief Walk tree and execute appropriate handler using leaf-first logic.
   * @param reg - Existing registry
-  * @param input - Command in a string form
+  * @param handler_args - Output of extract_switches, command words get removed from args
   * @return status_t
   */
-::sigil::yield execute_command(const command_registry_t& runtime_registry,const std::vector<std::string>& tokens);
+::sigil::yield execute_command(const command_registry_t& reg, cmd_handler_args_t& handler_args);
 
 /**
- * @brief Split a string into tokens
+ * @brief Split a string on whitespace into views over input
  * @param input - single string to be split
- * @return std::vector<std::string> of separate words
+ * @param out - receives the words
+ * @return status_t
+ * Failure with E2BIG past max_command_args words
  */
-std::vector<std::string> tokenize(std::string input);
+::sigil::yield tokenize(std::string_view input, cmd_tokens_t& out);
 
-// Remove switches from token stream, push to registry.switches.
-void extract_switches(std::vector<std::string>& tokens, command_registry_t& out_runtime);
+/**
+ * @brief Sort the token stream into out.switches and positional words in out.args.
+ * Failure with EINVAL for "--name=" without a value, E2BIG when lists overflow.
+ */
+::sigil::yield extract_switches(const cmd_tokens_t& tokens, cmd_handler_args_t& out);
 
 } // namespace sigil::platform
@@ -0,0 +1,63 @@
+#pragma once
+
+/**
+ * file: include/sigil/platform/exec_graph.h
+ *
+ * Dependency graph of Process Execution Units.
+ * Nodes whose dependencies are done run concurrently on an exec_supervisor_t,
+ * every node records when it started and finished so slow chains are visible.
+ */
+
+#include <sigil/platform/exec.h>
+#include <sigil/common.h>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sigil::platform {
+
+enum exec_node_state_t : uint32_t {
+    EXEC_NODE_PENDING = 0,
+    EXEC_NODE_RUNNING,
+    EXEC_NODE_DONE,         // ran, see result.exit_code
+    EXEC_NODE_SKIPPED,      // a required dependency did not exit with 0
+};
+
+struct exec_node_t {
+    std::string label;
+    proc_exec_unit_t peu;
+    std::vector<std::size_t> deps = {};
+    bool required = false;          // dependents only run if this exits with 0, or spawned when detached
+    int timeout_ms = -1;
+
+    // Filled by run(), milliseconds since run() started
+    exec_node_state_t state = EXEC_NODE_PENDING;
+    double start_ms = 0.0;
+    double end_ms = 0.0;
+};
+
+struct exec_graph_t {
+    std::vector<exec_node_t> nodes;
+
+    /**
+     * @brief Add a step, deps must be indices returned by earlier add() calls.
+     * EXEC_DETACH steps count as done, with exit code 0, once spawned,
+     * anything else runs as EXEC_ASYNC.
+     * @return std::size_t
+     * Index of the new node
+     */
+    std::size_t add(const std::string &label, const proc_exec_unit_t &peu,
+                    const std::vector<std::size_t> &deps = {}, bool required = false, int timeout_ms = -1);
+
+    // Run every node once, independent ones concurrently
+    ::sigil::yield run();
+
+    // Chain of nodes ending at the last finisher, each linked to its latest-finishing dependency
+    std::vector<std::size_t> critical_path() const;
+
+    // One line per node: offset, duration, exit code, critical path marked
+    std::string timings() const;
+};
+
+} // namespace sigil::platform
@@ -1,7 +1,10 @@
 #pragma once
 #include <sigil/common.h>
 #include <filesystem>
+#include <functional>
 #include <unistd.h>
+#include <cstdint>
+#include <array>
 
 namespace sigil::fs {
 
@@ -24,6 +27,19 @@ struct file_handler_t {
     ::sigil::yield save_to(const std::filesystem::path path);
 };
 
+/**
+ * @brief
+ * Resolve an executable name against $PATH through a process-wide index.
+ * Every PATH directory is listed once, the index is rebuilt when inotify
+ * reports changes in one of them (mtime checks if inotify is unavailable)
+ * or when $PATH itself changes. A miss also compares directory mtimes, so
+ * PATH entries created after the build are picked up.
+ * @param name - bare executable name, names containing '/' are only checked for X_OK
+ * @param out - absolute path of the first match in PATH order
+ * @return true if found
+ */
+bool resolve_in_path(const char* name, std::string &out);
+
 bool binary_exists_in_path(const char* name);
 
 
@@ -74,8 +90,111 @@ inline std::filesystem::path get_sigilvm_local_path() {
     return get_home_path() / ".local" / "share" / "sigilvm";
 }
 
-::sigil::yield copy_tree(std::filesystem::path &src, std::filesystem::path &dst);
+/**
+ * @brief
+ * Counters filled by copy_tree / clone_or_copy_file.
+ * Cloned files share extents with the source (FICLONE),
+ * copied files went through copy_file_range or a buffered copy,
+ * linked files are hardlinks made by clone_tree, skipped files already
+ * matched at the destination (size + mtime, or equal digests in the digest cache).
+ */
+struct copy_stats_t {
+    uint64_t files_copied  = 0;
+    uint64_t files_cloned  = 0;
+    uint64_t files_skipped = 0;
+    uint64_t files_linked  = 0;
+
+    uint64_t bytes_copied  = 0;
+    uint64_t bytes_cloned  = 0;
+    uint64_t bytes_skipped = 0;
+    uint64_t bytes_linked  = 0;
+
+    copy_stats_t& operator+=(const copy_stats_t &o) noexcept {
+        files_copied  += o.files_copied;
+        files_cloned  += o.files_cloned;
+        files_skipped += o.files_skipped;
+        files_linked  += o.files_linked;
+        bytes_copied  += o.bytes_copied;
+        bytes_cloned  += o.bytes_cloned;
+        bytes_skipped += o.bytes_skipped;
+        bytes_linked  += o.bytes_linked;
+        return *this;
+    }
+};
+
+/**
+ * @brief
+ * Copy a single regular file, trying FICLONE first, then copy_file_range,
+ * then a buffered read/write loop. Destination mode and mtime are set from
+ * the source, so a later call with skip_unchanged can skip it by metadata.
+ * @return ::sigil::yield
+ * fail with code = errno on I/O errors
+ */
+::sigil::yield clone_or_copy_file(
+    const std::filesystem::path &src,
+    const std::filesystem::path &dst,
+    copy_stats_t &stats,
+    bool skip_unchanged = true
+);
 
-bool files_are_identical(const std::filesystem::path &a, const std::filesystem::path &b);
+/**
+ * @brief
+ * Mirror src into dst. Directories are created once, up front,
+ * then files are copied by a small worker pool.
+ * Files whose size and mtime already match at dst are skipped.
+ * @return ::sigil::yield
+ */
+::sigil::yield copy_tree(const std::filesystem::path &src, const std::filesystem::path &dst, copy_stats_t &stats);
+::sigil::yield copy_tree(const std::filesystem::path &src, const std::filesystem::path &dst);
+
+/**
+ * @brief
+ * Make dst a copy-on-write instance of src, dst must not exist yet.
+ * Symlinks are recreated as they are, directories keep their modes and files
+ * are reflinked. Where the filesystem cannot reflink, files for which may_link
+ * returns true (given the path relative to src) are hardlinked instead of copied,
+ * only pass files nothing writes to in place.
+ * @return ::sigil::yield
+ * EEXIST when dst exists, errno of the first failing copy otherwise
+ */
+::sigil::yield clone_tree(const std::filesystem::path &src, const std::filesystem::path &dst, copy_stats_t &stats,
+                          const std::function<bool(const std::filesystem::path &)> &may_link = {});
+
+/**
+ * @brief
+ * Metadata identity of a file, used to key cached digests.
+ * Any change in size or mtime produces a different key.
+ */
+struct file_key_t {
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    uint64_t size = 0;
+    int64_t  mtime_sec = 0;
+    uint32_t mtime_nsec = 0;
+
+    bool operator==(const file_key_t&) const noexcept = default;
+};
+
+using file_digest_t = std::array<uint8_t, 16>; // xxh128, see sigil/math/hash.h
+
+bool get_file_key(const std::filesystem::path &p, file_key_t &out);
+
+/**
+ * @brief
+ * Process-wide digest cache. Whoever hashes a file (dedup, theme manifests)
+ * stores the result here, so later comparisons can skip reading contents.
+ */
+void digest_cache_store(const file_key_t &key, const file_digest_t &digest);
+bool digest_cache_lookup(const file_key_t &key, file_digest_t &out);
+
+/**
+ * @brief
+ * Byte-wise file comparison. Returns early for the same (dev, ino),
+ * for shared reflink extents and for known digests, otherwise compares
+ * pread chunks (1 MiB windows split across threads for very large files),
+ * a file truncated during the comparison reads as different.
+ * Pass trust_digests = false when the caller wants proof beyond a digest match.
+ */
+bool files_are_identical(const std::filesystem::path &a, const std::filesystem::path &b, bool trust_digests = true);
 
 } // namespace ::sigil::fs
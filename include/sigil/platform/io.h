@@ -0,0 +1,119 @@
+#pragma once
+
+/**
+ * file: include/sigil/platform/io.h
+ *
+ * Batched asynchronous file I/O for SigilVM.
+ * Backed by io_uring (raw syscalls, no liburing), with a blocking worker
+ * thread as fallback for kernels where io_uring is missing or disabled.
+ * Requests are plain structs owned by the caller, completions land in
+ * io_request_t::result as ::sigil::yield. Theme manifests read the files
+ * they have to hash through it, a batch of open / read / close at a time.
+ */
+
+#include <sigil/common.h>
+#include <sys/uio.h>
+#include <functional>
+#include <fcntl.h>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+namespace sigil::fs {
+
+enum io_op_t : uint32_t {
+    IO_NOP = 0,
+    IO_READ,        // pread(fd, buffer, length, offset)
+    IO_WRITE,       // pwrite(fd, buffer, length, offset)
+    IO_OPENAT,      // openat(dirfd, path, flags, mode), fd in result.info
+    IO_STATX,       // statx(dirfd, path, flags, mode as mask, (struct statx*)buffer)
+    IO_CLOSE,       // close(fd), not valid for fixed files
+    IO_FSYNC,       // fsync(fd), flags = IORING_FSYNC_DATASYNC for fdatasync
+};
+
+enum io_backend_t : uint32_t {
+    IO_BACKEND_NONE = 0,
+    IO_BACKEND_URING,
+    IO_BACKEND_THREAD,
+};
+
+/**
+ * @brief
+ * Single I/O operation. Must stay alive and unmoved until done is set.
+ * On completion: result.is_ok() with result.info = bytes / fd,
+ * or result fail with result.code = errno.
+ */
+struct io_request_t {
+    io_op_t op = IO_NOP;
+
+    int fd = -1;                    // target fd, or slot index when fixed_file
+    bool fixed_file = false;        // fd refers to register_files() slot
+    int buffer_index = -1;          // >= 0: buffer lies in register_buffers() slot
+
+    void *buffer = nullptr;         // data for READ/WRITE, struct statx* for STATX
+    uint32_t length = 0;
+    uint64_t offset = 0;
+
+    const char *path = nullptr;     // OPENAT / STATX
+    int dirfd = AT_FDCWD;
+    int flags = 0;                  // open flags, statx flags, fsync flags
+    uint32_t mode = 0;              // open mode, statx mask
+
+    std::function<void(io_request_t&)> on_complete = {};   // runs inside wait()
+
+    ::sigil::yield result = {};
+    int64_t res = 0;                // raw result, negative errno on failure
+    bool done = false;
+};
+
+struct io_config_t {
+    uint32_t entries = 64;          // submission queue depth
+    bool sqpoll = false;            // kernel thread polls the SQ, no enter() per submit
+    uint32_t sqpoll_idle_ms = 50;
+    bool force_fallback = false;    // skip io_uring, use the worker thread
+};
+
+/**
+ * @brief
+ * Shared async I/O primitive. One instance per thread that drives it,
+ * submit() and wait() are not meant to be called concurrently.
+ */
+struct io_service_t {
+    io_service_t();
+    ~io_service_t();
+
+    io_service_t(const io_service_t&) = delete;
+    io_service_t& operator=(const io_service_t&) = delete;
+
+    ::sigil::yield init(const io_config_t &cfg = {});
+    void shutdown();
+
+    io_backend_t backend() const noexcept;
+    unsigned in_flight() const noexcept;
+
+    // Pin buffers / files for *_FIXED operations. Replaces any earlier registration.
+    ::sigil::yield register_buffers(const struct iovec *iov, unsigned count);
+    ::sigil::yield register_files(const int *fds, unsigned count);
+
+    /**
+     * @brief
+     * Queue requests. Nothing blocks, requests beyond the ring size
+     * wait in a backlog and are pushed as completions free up space.
+     */
+    ::sigil::yield submit(io_request_t *reqs, std::size_t count);
+
+    /**
+     * @brief
+     * Block until at least min_complete requests finished (or nothing is left),
+     * run their callbacks. Number of reaped completions in yield.info.
+     */
+    ::sigil::yield wait(unsigned min_complete = 1);
+
+    // submit + wait for all of them, yield is the worst of the request results
+    ::sigil::yield run(io_request_t *reqs, std::size_t count);
+
+    struct state_t;
+    std::unique_ptr<state_t> state;
+};
+
+} // namespace sigil::fs
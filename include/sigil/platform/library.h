@@ -0,0 +1,147 @@
+#pragma once
+
+/**
+ * file: include/sigil/platform/library.h
+ *
+ * Game library scanner for the compat manager. Library roots are walked by a
+ * small pool of threads, of every .exe found only the pages holding its PE
+ * headers, version resource and icon directory are read. Results persist in an index
+ * keyed by file metadata: a rescan lists a directory again only when its mtime
+ * changed and parses an executable again only when its (dev, ino, size, mtime) did,
+ * so an unchanged library costs one stat per directory and per executable.
+ */
+
+#include <sigil/platform/app.h>
+#include <sigil/platform/fs.h>
+#include <sigil/common.h>
+#include <string_view>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sigil::platform {
+
+enum pe_machine_t : uint16_t {
+    PE_MACHINE_UNKNOWN = 0,
+    PE_MACHINE_I386    = 0x014c,
+    PE_MACHINE_AMD64   = 0x8664,
+    PE_MACHINE_ARM64   = 0xaa64,
+};
+
+enum pe_subsystem_t : uint16_t {
+    PE_SUBSYSTEM_UNKNOWN = 0,
+    PE_SUBSYSTEM_NATIVE  = 1,
+    PE_SUBSYSTEM_GUI     = 2,
+    PE_SUBSYSTEM_CUI     = 3,
+};
+
+/**
+ * @brief
+ * What the compat manager and the asset manager want to know about an executable.
+ * Versions are major, minor, build, revision from VS_FIXEDFILEINFO.
+ */
+struct pe_info_t {
+    uint16_t machine = PE_MACHINE_UNKNOWN;
+    uint16_t subsystem = PE_SUBSYSTEM_UNKNOWN;
+    uint16_t characteristics = 0;
+    uint32_t timestamp = 0;
+    uint16_t file_version[4] = {};
+    uint16_t product_version[4] = {};
+    std::string product_name;       // StringFileInfo, UTF-8
+    std::string description;        // FileDescription
+    uint32_t icon_offset = 0;       // file offset of the largest image of the first icon group, 0 without icons
+    uint32_t icon_size = 0;
+    uint16_t icon_width = 0;
+
+    bool is_dll() const noexcept { return (characteristics & 0x2000) != 0; }
+    bool is_64bit() const noexcept { return machine == PE_MACHINE_AMD64 || machine == PE_MACHINE_ARM64; }
+};
+
+/**
+ * @brief Read PE headers from the bytes of an image, a mapping of the whole file.
+ * @return ::sigil::yield
+ * ENOEXEC when image is not a PE file, resources that do not parse are left empty
+ */
+::sigil::yield parse_pe_image(std::string_view image, pe_info_t &out);
+
+// parse_pe_image over the pages of file it needs, errno when it cannot be opened.
+// A file shrinking underneath reads as cut off, not as a crash.
+::sigil::yield read_pe_info(const std::filesystem::path &file, pe_info_t &out);
+
+struct library_dir_t {
+    std::string path;
+    ::sigil::fs::file_key_t key;                // when it was listed
+    std::vector<std::string> subdirs;           // names
+    std::vector<std::string> executables;       // names
+};
+
+struct library_exe_t {
+    std::string path;
+    ::sigil::fs::file_key_t key;                // when it was parsed
+    bool is_pe = false;
+    pe_info_t info;
+
+    std::string_view name() const noexcept;     // file name part of path
+};
+
+struct library_index_t {
+    std::vector<std::filesystem::path> roots;
+    std::vector<library_dir_t> dirs;            // sorted by path
+    std::vector<library_exe_t> executables;     // sorted by path
+
+    const library_exe_t *find(std::string_view path) const noexcept;
+
+    /**
+     * @brief Read an index written by save().
+     * @return ::sigil::yield
+     * errno when unreadable, EINVAL when corrupt or of another version, the index is left empty
+     */
+    ::sigil::yield load(const std::filesystem::path &file);
+    ::sigil::yield save(const std::filesystem::path &file) const;
+};
+
+struct library_scan_stats_t {
+    std::size_t dirs_listed = 0;
+    std::size_t dirs_reused = 0;
+    std::size_t exes_parsed = 0;
+    std::size_t exes_reused = 0;
+    std::size_t not_pe = 0;
+};
+
+/**
+ * @brief
+ * Bring index up to date with roots. Directories and executables no longer
+ * reachable are dropped. Hidden directories, Steam's compatdata / shadercache
+ * and drive_c/windows inside prefixes are not descended into.
+ * @param changed - set when the index differs from what it was, worth saving
+ * @param threads - 0 picks from the hardware concurrency
+ * @return ::sigil::yield
+ */
+::sigil::yield scan_game_library(const std::vector<std::filesystem::path> &roots, library_index_t &index,
+                                 bool &changed, library_scan_stats_t *stats = nullptr, unsigned threads = 0);
+
+/**
+ * @brief
+ * Roots listed under "roots:" in <sigilvm config>/library.yaml, "~/" expands to
+ * the home directory. Without that file the library is <home>/Games.
+ */
+::sigil::yield load_library_roots(const ::sigil::platform::app_descriptor_t &app, std::vector<std::filesystem::path> &out);
+
+/**
+ * @brief
+ * Scan the configured roots and the install directories of Steam's games
+ * through the index kept in <sigilvm cache>/compat/library.index, saved back when it changed.
+ */
+::sigil::yield probe_game_library(const ::sigil::platform::app_descriptor_t &app, library_index_t &index,
+                                  library_scan_stats_t *stats = nullptr);
+
+/**
+ * @brief
+ * Executables worth offering as a profile target: x86 GUI or console programs,
+ * not DLLs, installers, uninstallers, redistributables or crash handlers.
+ */
+bool library_exe_is_launchable(const library_exe_t &exe);
+
+} // namespace sigil::platform
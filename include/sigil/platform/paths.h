@@ -29,6 +29,13 @@ struct env_kv_t {
 
 inline const char *env_get(process_descriptor_t const &proc, const char *key) {
     if (!proc.envp) return nullptr;
+
+    // Hashed lookup once process_initialize built the index, scan otherwise
+    if (!proc.env.slots.empty()) {
+        const env_index_t::slot_t *slot = proc.env.find(key);
+        return slot ? slot->value : nullptr;
+    }
+
     for (const char **e = proc.envp; *e; ++e) {
         const char *entry = *e;
         const char *eq = entry;
@@ -96,6 +103,12 @@ inline std::filesystem::path get_state_root(process_descriptor_t const &p) {
 #endif
 }
 
+// Sockets and other per-session files, cleared on logout
+inline std::filesystem::path get_runtime_root(process_descriptor_t const &p) {
+    if (auto v = env_get(p, "XDG_RUNTIME_DIR")) return v;
+    return "/tmp/sigilvm/run";
+}
+
 /* =========================
    SigilVM base namespaces
    ========================= */
@@ -104,15 +117,27 @@ inline std::filesystem::path get_sigilvm_config_root(process_descriptor_t const
 inline std::filesystem::path get_sigilvm_cache_root(process_descriptor_t const &p) { return get_cache_root(p) / "sigilvm"; }
 inline std::filesystem::path get_sigilvm_data_root(process_descriptor_t const &p) { return get_data_root(p) / "sigilvm"; }
 inline std::filesystem::path get_sigilvm_state_root(process_descriptor_t const &p) { return get_state_root(p) / "sigilvm"; }
+inline std::filesystem::path get_sigilvm_runtime_root(process_descriptor_t const &p) { return get_runtime_root(p) / "sigilvm"; }
 
 /* =========================
    App-scoped paths
    ========================= */
 
-inline std::filesystem::path get_local_config(app_descriptor_t const &app) { return get_sigilvm_config_root(app.process) / app.app_name; }
-inline std::filesystem::path get_local_cache(app_descriptor_t const &app) { return get_sigilvm_cache_root(app.process) / app.app_name; }
-inline std::filesystem::path get_local_data(app_descriptor_t const &app) { return get_sigilvm_data_root(app.process) / app.app_name; }
-inline std::filesystem::path get_local_state(app_descriptor_t const &app) { return get_sigilvm_state_root(app.process) / app.app_name; }
+inline std::filesystem::path get_local_config(app_descriptor_t const &app) {
+    return app.paths.resolved ? app.paths.local_config : get_sigilvm_config_root(app.process) / app.app_name;
+}
+inline std::filesystem::path get_local_cache(app_descriptor_t const &app) {
+    return app.paths.resolved ? app.paths.local_cache : get_sigilvm_cache_root(app.process) / app.app_name;
+}
+inline std::filesystem::path get_local_data(app_descriptor_t const &app) {
+    return app.paths.resolved ? app.paths.local_data : get_sigilvm_data_root(app.process) / app.app_name;
+}
+inline std::filesystem::path get_local_state(app_descriptor_t const &app) {
+    return app.paths.resolved ? app.paths.local_state : get_sigilvm_state_root(app.process) / app.app_name;
+}
+inline std::filesystem::path get_local_socket(app_descriptor_t const &app) {
+    return app.paths.resolved ? app.paths.local_socket : get_sigilvm_runtime_root(app.process) / (std::string(app.app_name) + ".sock");
+}
 
 /* =========================
    VM-global shared data
@@ -120,6 +145,16 @@ inline std::filesystem::path get_local_state(app_descriptor_t const &app) { retu
 
 inline std::filesystem::path get_compdata_root(process_descriptor_t const &p) { return get_sigilvm_data_root(p) / "wlx64"; }
 
+/* =========================
+   Installed assets
+   ========================= */
+
+// Theme templates (common/) and patterns (patterns/), SIGILVM_THEME_ROOT points at a repo checkout when prototyping
+inline std::filesystem::path get_theme_assets_root(process_descriptor_t const &p) {
+    if (auto v = env_get(p, "SIGILVM_THEME_ROOT")) return v;
+    return "/usr/share/sigilvm/themes";
+}
+
 /* =========================
    User-facing directories
    ========================= */
@@ -141,6 +176,51 @@ inline std::filesystem::path get_user_videos(process_descriptor_t const &p) { re
 inline std::filesystem::path get_user_music(process_descriptor_t const &p) { return get_home(p) / "Music"; }
 inline std::filesystem::path get_user_workspace(process_descriptor_t const &p) { return get_home(p) / "Workspace"; }
 
+/* =========================
+   Resolved path cache
+   ========================= */
+
+/* Resolve every root once, after app_initialize. app.paths is read-only
+   afterwards, so threads may share it; the getters above use it when set. */
+inline void resolve_app_paths(app_descriptor_t &app) {
+    app_paths_t &c = app.paths;
+    const process_descriptor_t &p = app.process;
+
+    c.config_root  = get_config_root(p);
+    c.cache_root   = get_cache_root(p);
+    c.data_root    = get_data_root(p);
+    c.state_root   = get_state_root(p);
+    c.runtime_root = get_runtime_root(p);
+
+    c.sigilvm_config  = c.config_root / "sigilvm";
+    c.sigilvm_cache   = c.cache_root / "sigilvm";
+    c.sigilvm_data    = c.data_root / "sigilvm";
+    c.sigilvm_state   = c.state_root / "sigilvm";
+    c.sigilvm_runtime = c.runtime_root / "sigilvm";
+
+    c.local_config = c.sigilvm_config / app.app_name;
+    c.local_cache  = c.sigilvm_cache / app.app_name;
+    c.local_data   = c.sigilvm_data / app.app_name;
+    c.local_state  = c.sigilvm_state / app.app_name;
+    c.local_socket = c.sigilvm_runtime / (std::string(app.app_name) + ".sock");
+
+    c.compdata     = get_compdata_root(p);
+    c.theme_assets = get_theme_assets_root(p);
+    c.home         = get_home(p);
+
+    c.resolved = true;
+}
+
+// Cached roots by app, resolved on the spot when resolve_app_paths() was not called
+inline std::filesystem::path get_sigilvm_config_root(app_descriptor_t const &app) { return app.paths.resolved ? app.paths.sigilvm_config : get_sigilvm_config_root(app.process); }
+inline std::filesystem::path get_sigilvm_cache_root(app_descriptor_t const &app) { return app.paths.resolved ? app.paths.sigilvm_cache : get_sigilvm_cache_root(app.process); }
+inline std::filesystem::path get_sigilvm_data_root(app_descriptor_t const &app) { return app.paths.resolved ? app.paths.sigilvm_data : get_sigilvm_data_root(app.process); }
+inline std::filesystem::path get_sigilvm_state_root(app_descriptor_t const &app) { return app.paths.resolved ? app.paths.sigilvm_state : get_sigilvm_state_root(app.process); }
+inline std::filesystem::path get_config_root(app_descriptor_t const &app) { return app.paths.resolved ? app.paths.config_root : get_config_root(app.process); }
+inline std::filesystem::path get_compdata_root(app_descriptor_t const &app) { return app.paths.resolved ? app.paths.compdata : get_compdata_root(app.process); }
+inline std::filesystem::path get_theme_assets_root(app_descriptor_t const &app) { return app.paths.resolved ? app.paths.theme_assets : get_theme_assets_root(app.process); }
+inline std::filesystem::path get_home(app_descriptor_t const &app) { return app.paths.resolved ? app.paths.home : get_home(app.process); }
+
 /* =========================
    Ensure helpers
    ========================= */
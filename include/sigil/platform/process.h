@@ -8,13 +8,76 @@
  */
  
 #include <sigil/common.h>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 namespace sigil::platform {
 
+/**
+ * @brief
+ * Hashed view of an environment block, KEY -> value.
+ * Keys and values point into the block, which must outlive the index.
+ * Like getenv, the first of duplicate keys wins.
+ */
+struct env_index_t {
+    struct slot_t {
+        std::string_view key;
+        const char *value = nullptr;    // NUL terminated, inside the block
+        uint32_t position = 0;          // index of the entry in the block
+    };
+
+    std::vector<slot_t> slots;          // open addressing, power of two, empty key = free
+
+    static uint64_t hash(std::string_view key) noexcept {
+        uint64_t h = 14695981039346656037ull;
+        for (char c : key) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    void build(const char *const *envp) {
+        std::size_t n = 0;
+        while (envp && envp[n]) ++n;
+
+        std::size_t cap = 16;
+        while (cap < 2 * n) cap <<= 1;
+        slots.assign(cap, {});
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const char *entry = envp[i];
+            const char *eq = std::strchr(entry, '=');
+            if (eq == nullptr || eq == entry) continue;
+
+            const std::string_view key(entry, static_cast<std::size_t>(eq - entry));
+            std::size_t at = hash(key) & (cap - 1);
+            while (!slots[at].key.empty() && slots[at].key != key)
+                at = (at + 1) & (cap - 1);
+
+            if (slots[at].key.empty())
+                slots[at] = { key, eq + 1, static_cast<uint32_t>(i) };
+        }
+    }
+
+    const slot_t *find(std::string_view key) const noexcept {
+        if (slots.empty() || key.empty()) return nullptr;
+
+        const std::size_t mask = slots.size() - 1;
+        for (std::size_t at = hash(key) & mask; !slots[at].key.empty(); at = (at + 1) & mask) {
+            if (slots[at].key == key) return &slots[at];
+        }
+        return nullptr;
+    }
+};
+
 struct process_descriptor_t {
     int    argc;
     const char **argv;
     const char **envp;
+    env_index_t env;                    // built by process_initialize
     
     pid_t pid = -1;
     bool initialized = false;
@@ -35,6 +98,7 @@ inline sigil::yield process_initialize(
     p.argc = argc;
     p.argv = argv;
     p.envp = envp;
+    p.env.build(envp);
     p.initialized = true;
 
     return st;
@@ -0,0 +1,106 @@
+#pragma once
+
+/**
+ * file: include/sigil/platform/steam.h
+ *
+ * What Steam has installed, read from its own files: steamapps/libraryfolders.vdf
+ * for the libraries, appmanifest_<id>.acf in each library for the apps, and
+ * compatibilitytools.d/<tool>/compatibilitytool.vdf for custom runners. Proton
+ * builds installed through Steam are apps carrying a proton script.
+ * Every file read is remembered with its (dev, ino, size, mtime), a refresh
+ * stats them and parses only what changed, a steamapps directory is listed
+ * again only when its own mtime moved.
+ */
+
+#include <sigil/platform/app.h>
+#include <sigil/platform/fs.h>
+#include <sigil/common.h>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sigil::platform {
+
+struct steam_app_t {
+    uint32_t appid = 0;
+    std::string name;
+    std::filesystem::path library;          // library root, holds steamapps/
+    std::filesystem::path install_dir;      // <library>/steamapps/common/<installdir>
+    uint64_t size_on_disk = 0;
+    uint32_t state_flags = 0;
+
+    bool installed() const noexcept { return (state_flags & 4) != 0; }     // StateFullyInstalled
+};
+
+struct steam_tool_t {
+    std::string name;                       // internal name from compatibilitytool.vdf, the app name for Steam's Protons
+    std::string display_name;
+    std::filesystem::path path;             // directory holding the proton script
+    std::filesystem::path manifest;         // compatibilitytool.vdf it came from, empty for Steam's Protons
+    uint32_t appid = 0;                     // 0 for compatibilitytools.d
+};
+
+struct steam_index_t {
+    // One Steam file as last read
+    struct source_t {
+        std::filesystem::path path;
+        ::sigil::fs::file_key_t key;
+    };
+
+    // One steamapps or compatibilitytools.d directory as last listed
+    struct listing_t {
+        std::filesystem::path path;
+        ::sigil::fs::file_key_t key;
+        std::vector<std::string> names;     // app manifests, tool directories
+    };
+
+    std::filesystem::path root;                     // Steam installation
+    std::vector<std::filesystem::path> libraries;   // from libraryfolders.vdf, root first
+    std::vector<steam_app_t> apps;                  // sorted by appid
+    std::vector<steam_tool_t> tools;                // compatibilitytools.d first, then Steam's Protons
+
+    ::sigil::fs::file_key_t libraryfolders;
+    std::vector<listing_t> listings;
+    std::vector<source_t> manifests;                // appmanifest_<id>.acf, sorted by path
+    std::vector<source_t> tool_manifests;           // compatibilitytool.vdf, sorted by path
+
+    const steam_app_t *find_app(uint32_t appid) const noexcept;
+};
+
+struct steam_index_stats_t {
+    std::size_t parsed = 0;         // vdf / acf files read
+    std::size_t reused = 0;         // unchanged since the last refresh
+    std::size_t listed = 0;         // directories listed
+};
+
+/**
+ * @brief
+ * Steam installation of the user: ~/.local/share/Steam, ~/.steam/steam
+ * or the Flatpak one, the first holding steamapps/.
+ * @return false when none exists
+ */
+bool find_steam_root(const ::sigil::platform::app_descriptor_t &app, std::filesystem::path &out);
+
+/**
+ * @brief Bring index up to date with the Steam installation at root.
+ * A different root starts the index over.
+ * @param changed - set when libraries, apps or tools differ from before
+ * @return ::sigil::yield
+ * ENOENT when root has no steamapps directory
+ */
+::sigil::yield refresh_steam_index(const std::filesystem::path &root, steam_index_t &index,
+                                   bool &changed, steam_index_stats_t *stats = nullptr);
+
+/**
+ * @brief
+ * Snapshot of the process wide index of the user's Steam installation, refreshed
+ * on every call. A snapshot never changes, callers on other threads keep theirs
+ * while a later call builds a new one, and only when something changed.
+ * @return nullptr when Steam is not installed
+ */
+std::shared_ptr<const steam_index_t> probe_steam(const ::sigil::platform::app_descriptor_t &app);
+
+} // namespace sigil::platform
@@ -0,0 +1,96 @@
+#pragma once
+
+/**
+ * file: include/sigil/platform/theme_template.h
+ *
+ * Theme templates: component files with {{ key }} slots, filled from a pattern.
+ * Each distinct template is compiled once into a plan of literal spans and
+ * slots, plans are cached process-wide by template digest, so rendering a
+ * pattern is only lookups and appends.
+ */
+
+#include <sigil/common.h>
+#include <filesystem>
+#include <string_view>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace sigil::desktop {
+
+/**
+ * @brief
+ * Values of assets/themes/patterns/<name>.yaml, flattened to dotted keys.
+ * Keys under the top level "tags" map are stored without that prefix,
+ * and a map with a "primary" entry also answers for its own key,
+ * so "color.accent" works whether accent is a value or a primary/secondary pair.
+ */
+struct theme_pattern_t {
+    std::string name;
+    std::map<std::string, std::string, std::less<>> values;
+
+    const std::string *find(std::string_view key) const;
+};
+
+/**
+ * @brief
+ * Read a pattern file through the sigil::data YAML reader,
+ * sequences and empty keys are skipped.
+ * @return ::sigil::yield
+ * errno when the file cannot be read, EINVAL on text the reader rejects
+ */
+::sigil::yield load_theme_pattern(const std::filesystem::path &file, theme_pattern_t &out);
+
+enum template_filter_t : uint8_t {
+    TEMPLATE_FILTER_NONE = 0,
+    TEMPLATE_FILTER_NOHASH,     // "#6AAEFF" -> "6AAEFF", hyprland rgb()/rgba()
+    TEMPLATE_FILTER_RGB,        // "#6AAEFF" -> "106, 174, 255", css rgba()
+};
+
+struct template_op_t {
+    uint32_t offset = 0;        // span of plan.source, literal text or the slot key
+    uint32_t length = 0;
+    bool slot = false;
+    template_filter_t filter = TEMPLATE_FILTER_NONE;
+};
+
+/**
+ * @brief
+ * Precompiled template, ops refer into source.
+ */
+struct template_plan_t {
+    std::string source;
+    std::vector<template_op_t> ops;
+    std::size_t literal_bytes = 0;
+
+    bool has_slots() const noexcept { return ops.size() > 1 || (!ops.empty() && ops.front().slot); }
+};
+
+/**
+ * @brief Split source into literal spans and {{ key | filter }} slots.
+ * @return ::sigil::yield
+ * EINVAL on an unterminated slot, an empty key or an unknown filter
+ */
+::sigil::yield compile_template(std::string source, template_plan_t &out);
+
+/**
+ * @brief Append the plan rendered with pattern values to out.
+ * @param missing
+ * Set to the first key the pattern does not have
+ * @return ::sigil::yield
+ * ENOENT on a missing key, out is left partially written
+ */
+::sigil::yield render_template(const template_plan_t &plan, const theme_pattern_t &pattern,
+                               std::string &out, std::string *missing = nullptr);
+
+/**
+ * @brief
+ * Plan of a template file, compiled on first use and then served from
+ * the plan cache while the file keeps its digest.
+ * @return ::sigil::yield
+ */
+::sigil::yield load_template_plan(const std::filesystem::path &file, std::shared_ptr<const template_plan_t> &out);
+
+} // namespace sigil::desktop
@@ -0,0 +1,87 @@
+#pragma once
+
+/**
+ * file: include/sigil/platform/watcher.h
+ *
+ * Filesystem change notifications for SigilVM.
+ * inotify based, one background thread per watcher. Raw events are
+ * coalesced per path and published as debounced batches through a
+ * lock-free single producer / single consumer queue.
+ */
+
+#include <sigil/common.h>
+#include <filesystem>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sigil::fs {
+
+enum watch_kind_t : uint32_t {
+    WATCH_CREATED  = 1u << 0,   // created, or moved into place (rename-over saves land here)
+    WATCH_MODIFIED = 1u << 1,   // written and closed
+    WATCH_REMOVED  = 1u << 2,   // deleted or moved away
+    WATCH_RESCAN   = 1u << 3,   // directory contents unknown after overflow, list it again
+};
+
+/**
+ * @brief
+ * All changes seen for one path within a batch, kinds OR'ed together.
+ * Kinds say what happened, not the final state: CREATED | REMOVED
+ * is a file that came and went, check the disk when it matters.
+ */
+struct watch_event_t {
+    std::filesystem::path path;
+    uint32_t kinds = 0;
+};
+
+struct watch_batch_t {
+    std::vector<watch_event_t> events;  // one entry per path, sorted by path
+    uint64_t sequence = 0;
+    bool overflow = false;              // kernel queue overflowed, events were recovered by rescan
+};
+
+struct watcher_config_t {
+    uint32_t debounce_ms = 15;          // quiet period before a batch is published
+    uint32_t max_latency_ms = 150;      // publish anyway when events keep coming
+    uint32_t queue_capacity = 64;       // batches waiting for the consumer, rounded up to a power of two
+};
+
+/**
+ * @brief
+ * Recursive directory watcher.
+ * add() / remove() may be called from any thread, poll() and wait()
+ * from a single consumer thread only.
+ */
+struct watcher_t {
+    watcher_t();
+    ~watcher_t();
+
+    watcher_t(const watcher_t&) = delete;
+    watcher_t& operator=(const watcher_t&) = delete;
+
+    ::sigil::yield start(const watcher_config_t &cfg = {});
+    void stop();
+
+    /**
+     * @brief
+     * Watch root, and with recursive every directory below it,
+     * including ones created later. Symlinks are not followed.
+     */
+    ::sigil::yield add(const std::filesystem::path &root, bool recursive = true);
+    void remove(const std::filesystem::path &root);
+
+    // Take the next batch if there is one, never blocks
+    bool poll(watch_batch_t &out);
+
+    // Block up to timeout_ms (-1: forever) for the next batch
+    bool wait(watch_batch_t &out, int timeout_ms = -1);
+
+    // Readable while batches are queued, for callers with their own poll loop
+    int ready_fd() const noexcept;
+
+    struct state_t;
+    std::unique_ptr<state_t> state;
+};
+
+} // namespace sigil::fs
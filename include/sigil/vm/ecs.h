@@ -1,19 +1,26 @@
 #pragma once
 
+#include <sigil/common.h>
 #include <cstdint>
-#include <vector>
+#include <cstddef>
 #include <utility>
-
-#include "yield.h"
+#include <vector>
+#include <span>
 
 namespace sigil {
 
+/**
+ * @brief
+ * Handle to a ledger slot. A slot's generation moves on every retire,
+ * so handles to what used to live there stop matching. Generation 0 is
+ * never handed out, a default constructed entity is the null handle.
+ */
 struct entity final {
-    std::uint64_t id         = 0;
-    std::uint64_t generation = 0;
+    std::uint32_t index      = 0;
+    std::uint32_t generation = 0;
 
     constexpr bool operator==(const entity& o) const noexcept {
-        return id == o.id && generation == o.generation;
+        return index == o.index && generation == o.generation;
     }
 
     constexpr bool operator!=(const entity& o) const noexcept {
@@ -21,39 +28,104 @@ struct entity final {
     }
 
     constexpr explicit operator bool() const noexcept {
-        return id != 0;
+        return generation != 0;
     }
 };
 
-
+/**
+ * @brief
+ * Generational slot map. Retired slots go on an intrusive free list and are
+ * handed out again, newest first, so churn keeps memory where it was.
+ * alive is dense and unordered, retire moves the last entity into the gap.
+ */
 struct ledger {
-    // opaque storage – implementation-defined
+    struct slot_t {
+        std::uint32_t generation = 1;   // of the entity living here, or of the next one
+        std::uint32_t link = 0;         // position in alive, next free slot when free
+    };
+
+    static constexpr std::uint32_t npos = UINT32_MAX;
+
+    std::vector<slot_t> slots;
     std::vector<entity> alive;
+    std::uint32_t free_head = npos;
+
+    std::size_t size() const noexcept { return alive.size(); }
+    bool empty() const noexcept { return alive.empty(); }
+
+    auto begin() const noexcept { return alive.begin(); }
+    auto end() const noexcept { return alive.end(); }
 };
 
-inline entity create(ledger& l) noexcept {
-    entity e;
-    e.id = l.alive.size() + 1;
-    e.generation = 1;
+inline void reserve(ledger& l, std::size_t n) {
+    l.slots.reserve(n);
+    l.alive.reserve(n);
+}
+
+inline entity create(ledger& l) {
+    std::uint32_t index = l.free_head;
+    if (index != ledger::npos) {
+        l.free_head = l.slots[index].link;
+    } else {
+        index = static_cast<std::uint32_t>(l.slots.size());
+        l.slots.emplace_back();
+    }
+
+    ledger::slot_t& s = l.slots[index];
+    s.link = static_cast<std::uint32_t>(l.alive.size());
+
+    const entity e{ index, s.generation };
     l.alive.push_back(e);
     return e;
 }
 
-inline yield retire(ledger& l, entity e) noexcept {
-    for (auto& x : l.alive) {
-        if (x == e) {
-            x.generation++; // invalidate
-            return {};
-        }
-    }
-    return yield(yield_state::fail).set_code(1); // entity not found
+// Fills out with new entities
+inline void create(ledger& l, std::span<entity> out) {
+    l.alive.reserve(l.alive.size() + out.size());
+    for (entity& e : out)
+        e = create(l);
 }
 
+// A free slot already carries its next generation, so the alive entry is checked too
 inline bool exists(const ledger& l, entity e) noexcept {
-    for (const auto& x : l.alive) {
-        if (x == e) return true;
+    if (e.index >= l.slots.size())
+        return false;
+    const ledger::slot_t& s = l.slots[e.index];
+    return s.generation == e.generation
+        && s.link < l.alive.size()
+        && l.alive[s.link] == e;
+}
+
+inline yield retire(ledger& l, entity e) noexcept {
+    if (!exists(l, e))
+        return yield(yield_state::fail).set_code(1); // entity not found
+
+    ledger::slot_t& s = l.slots[e.index];
+
+    // Swap the last alive entity into the gap
+    const entity last = l.alive.back();
+    l.alive[s.link] = last;
+    l.slots[last.index].link = s.link;
+    l.alive.pop_back();
+
+    // A slot whose generation would wrap is not reused, stale handles never match again
+    if (++s.generation == 0) {
+        s.link = ledger::npos;
+        return {};
     }
-    return false;
+
+    s.link = l.free_head;
+    l.free_head = e.index;
+    return {};
+}
+
+// Retires every entity in es, the result fails with code 1 if any of them was not alive
+inline yield retire(ledger& l, std::span<const entity> es) noexcept {
+    yield ret;
+    for (const entity e : es)
+        if (retire(l, e).is_failure())
+            ret.set_state(yield_state::fail).set_code(1);
+    return ret;
 }
 
 struct ownership_tree {
@@ -0,0 +1,85 @@
+#include <sigil/data/binary.h>
+#include <sigil/common.h>
+
+#include <string_view>
+#include <filesystem>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+namespace sigil::data {
+
+::sigil::yield read_binary_file(const std::filesystem::path &file, std::string &out) {
+    ::sigil::yield ret;
+    out.clear();
+
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    }
+
+    out.resize(static_cast<std::size_t>(st.st_size));
+    std::size_t done = 0;
+    while (done < out.size()) {
+        const ssize_t n = ::read(fd, out.data() + done, out.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            const int err = errno;
+            ::close(fd);
+            out.clear();
+            return ret.set_state(sigil::yield_state::fail).set_code(err);
+        }
+        if (n == 0)
+            break;  // shrank underneath us, the reader's bounds checks catch it
+        done += static_cast<std::size_t>(n);
+    }
+
+    out.resize(done);
+    ::close(fd);
+    return ret;
+}
+
+::sigil::yield write_binary_file(const std::filesystem::path &file, std::string_view data) {
+    ::sigil::yield ret;
+
+    std::error_code ec;
+    if (file.has_parent_path())
+        std::filesystem::create_directories(file.parent_path(), ec);
+
+    const std::filesystem::path tmp = file.string() + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    std::size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            const int err = errno;
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            return ret.set_state(sigil::yield_state::fail).set_code(err);
+        }
+        done += static_cast<std::size_t>(n);
+    }
+
+    if (::close(fd) != 0 || ::rename(tmp.c_str(), file.c_str()) != 0) {
+        const int err = errno;
+        ::unlink(tmp.c_str());
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    }
+
+    return ret;
+}
+
+} // namespace sigil::data
@@ -0,0 +1,1100 @@
+#include <sigil/platform/capabilities.h>
+#include <sigil/data/parser.h>
+#include <sigil/common.h>
+
+#include <string_view>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <array>
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace sigil::data {
+
+// Bytes the second pass stops at
+static constexpr std::string_view structural_chars = "{}[]:,\"'\\/#\n";
+
+static constexpr std::array<bool, 256> structural_table = [] {
+    std::array<bool, 256> t{};
+    for (const char c : structural_chars)
+        t[static_cast<unsigned char>(c)] = true;
+    return t;
+}();
+
+#ifdef __AVX2__
+static inline uint32_t structural_mask_avx2(const char *p) {
+    const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hit = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(structural_chars[0]));
+    for (std::size_t c = 1; c < structural_chars.size(); ++c)
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(in, _mm256_set1_epi8(structural_chars[c])));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+}
+
+// 64 bytes per iteration, returns where the scalar tail has to pick up
+static std::size_t scan_structurals_avx2(const char *p, std::size_t n, std::vector<uint32_t> &out, std::size_t &used) {
+    std::size_t i = 0;
+
+    for (; i + 64 <= n; i += 64) {
+        uint64_t mask = structural_mask_avx2(p + i) | (static_cast<uint64_t>(structural_mask_avx2(p + i + 32)) << 32);
+        if (!mask)
+            continue;
+
+        if (out.size() - used < 64)
+            out.resize(std::max(out.size() * 2, used + 64));
+
+        uint32_t *dst = out.data() + used;
+        used += static_cast<std::size_t>(__builtin_popcountll(mask));
+        while (mask) {
+            *dst++ = static_cast<uint32_t>(i + static_cast<std::size_t>(__builtin_ctzll(mask)));
+            mask &= mask - 1;
+        }
+    }
+
+    return i;
+}
+#endif
+
+void scan_structurals(std::string_view text, std::vector<uint32_t> &out) {
+    const char *p = text.data();
+    const std::size_t n = text.size();
+    std::size_t used = 0;
+    std::size_t i = 0;
+
+    // Configuration text runs around one structural byte in eight
+    out.resize(std::max<std::size_t>(out.capacity(), n / 8 + 64));
+
+#ifdef __AVX2__
+    if (platform::has_avx2())
+        i = scan_structurals_avx2(p, n, out, used);
+#endif
+
+    for (; i < n; ++i) {
+        if (!structural_table[static_cast<unsigned char>(p[i])])
+            continue;
+        if (used == out.size())
+            out.resize(out.size() * 2);
+        out[used++] = static_cast<uint32_t>(i);
+    }
+
+    out.resize(used);
+}
+
+static inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/**
+ * @brief
+ * Appends nodes and keeps the chain of open containers,
+ * both readers below write through it.
+ */
+struct tape_writer_t {
+    std::vector<node_t> &tape;
+    uint32_t open[max_document_depth] = {};
+    uint32_t depth = 0;
+
+    uint32_t add(node_kind_t kind, uint32_t key_offset, uint32_t key_length,
+                 uint32_t offset, uint32_t length, bool escaped = false) {
+        if (depth)
+            ++tape[open[depth - 1]].count;
+
+        const uint32_t at = static_cast<uint32_t>(tape.size());
+        tape.push_back({ kind, escaped, key_offset, key_length, offset, length, 0, at + 1 });
+        return at;
+    }
+
+    bool begin(node_kind_t kind, uint32_t key_offset, uint32_t key_length, uint32_t offset) {
+        if (depth == max_document_depth)
+            return false;
+        open[depth] = add(kind, key_offset, key_length, offset, 0);
+        ++depth;
+        return true;
+    }
+
+    void end() {
+        const uint32_t at = open[--depth];
+        tape[at].next = static_cast<uint32_t>(tape.size());
+    }
+
+    node_kind_t top() const {
+        return tape[open[depth - 1]].kind;
+    }
+};
+
+/**
+ * @brief
+ * JSON with // and block comments, trailing commas and bare words.
+ * Visits only the structural offsets, text between two of them is either
+ * whitespace or an unquoted scalar (numbers, true, false, null, bare words).
+ */
+struct jsonc_reader_t {
+    const char *text;
+    const std::vector<uint32_t> &idx;
+    tape_writer_t &w;
+
+    uint32_t base = 0;              // writer depth the top level value lands at
+    uint32_t root_key_offset = 0;   // and its member name, for flow values inside YAML
+    uint32_t root_key_length = 0;
+    bool flow = false;              // stop right after the top level value
+
+    bool has_key = false;
+    bool colon = false;
+    bool root_done = false;
+    uint32_t key_offset = 0;
+    uint32_t key_length = 0;
+    uint32_t error_at = 0;
+
+    bool fail(uint32_t at) {
+        error_at = at;
+        return false;
+    }
+
+    bool in_object() const {
+        return w.depth > base && w.top() == NODE_OBJECT;
+    }
+
+    // Member name of the next value, failing where no value may go
+    bool place(uint32_t at, uint32_t &ko, uint32_t &kl) {
+        if (w.depth == base) {
+            if (root_done)
+                return fail(at);
+            root_done = true;
+            ko = root_key_offset;
+            kl = root_key_length;
+            return true;
+        }
+
+        if (in_object()) {
+            if (!has_key || !colon)
+                return fail(at);
+            ko = key_offset;
+            kl = key_length;
+            has_key = colon = false;
+            return true;
+        }
+
+        ko = kl = 0;
+        return true;
+    }
+
+    bool value(node_kind_t kind, uint32_t offset, uint32_t length, bool escaped) {
+        uint32_t ko, kl;
+        if (!place(offset, ko, kl))
+            return false;
+        w.add(kind, ko, kl, offset, length, escaped);
+        return true;
+    }
+
+    // Unquoted text between two structurals, blank is fine
+    bool bare(uint32_t from, uint32_t to) {
+        while (from < to && is_blank(text[from])) ++from;
+        while (to > from && is_blank(text[to - 1])) --to;
+        if (from == to)
+            return true;
+
+        const std::string_view word(text + from, to - from);
+        const node_kind_t kind = word == "null" ? NODE_NULL : NODE_SCALAR;
+        return value(kind, from, to - from, false);
+    }
+
+    /**
+     * @brief Read [begin, end), k is the first structural at or past begin.
+     * @param stop - set to just past the top level value when flow is set
+     */
+    bool run(uint32_t begin, uint32_t end, std::size_t &k, uint32_t &stop) {
+        uint32_t last = begin;
+
+        while (k < idx.size() && idx[k] < end) {
+            const uint32_t p = idx[k];
+
+            switch (text[p]) {
+            case '"': {
+                bool escaped = false;
+                std::size_t q = k + 1;
+                for (; q < idx.size() && idx[q] < end; ++q) {
+                    const uint32_t at = idx[q];
+                    if (text[at] == '\\') {
+                        escaped = true;
+                        // The escaped byte is a structural only when it is " \ / or a quote
+                        if (q + 1 < idx.size() && idx[q + 1] == at + 1)
+                            ++q;
+                        continue;
+                    }
+                    if (text[at] == '"')
+                        break;
+                }
+                if (q >= idx.size() || idx[q] >= end)
+                    return fail(p);
+
+                const uint32_t close = idx[q];
+                for (uint32_t i = last; i < p; ++i)
+                    if (!is_blank(text[i]))
+                        return fail(i);
+
+                if (in_object() && !colon) {
+                    if (has_key)
+                        return fail(p);
+                    has_key = true;
+                    key_offset = p + 1;
+                    key_length = close - p - 1;
+                } else if (!value(NODE_STRING, p + 1, close - p - 1, escaped)) {
+                    return false;
+                }
+
+                k = q + 1;
+                last = close + 1;
+                continue;
+            }
+            case '/': {
+                const char after = p + 1 < end ? text[p + 1] : '\0';
+                uint32_t resume;
+
+                if (after == '/') {
+                    const void *nl = std::memchr(text + p, '\n', end - p);
+                    resume = nl ? static_cast<uint32_t>(static_cast<const char*>(nl) - text) : end;
+                } else if (after == '*') {
+                    const std::string_view rest(text + p + 2, end - p - 2);
+                    const std::size_t close = rest.find("*/");
+                    if (close == std::string_view::npos)
+                        return fail(p);
+                    resume = p + 2 + static_cast<uint32_t>(close) + 2;
+                } else {
+                    // Part of a bare word
+                    ++k;
+                    continue;
+                }
+
+                if (!bare(last, p))
+                    return false;
+                while (k < idx.size() && idx[k] < resume)
+                    ++k;
+                last = resume;
+                continue;
+            }
+            case ':': {
+                uint32_t from = last, to = p;
+                while (from < to && is_blank(text[from])) ++from;
+                while (to > from && is_blank(text[to - 1])) --to;
+
+                if (from != to) {
+                    if (has_key)
+                        return fail(from);
+                    has_key = true;
+                    key_offset = from;
+                    key_length = to - from;
+                }
+
+                if (!in_object() || !has_key || colon)
+                    return fail(p);
+                colon = true;
+                last = p + 1;
+                break;
+            }
+            case ',':
+                if (!bare(last, p))
+                    return false;
+                if (has_key)
+                    return fail(p);
+                last = p + 1;
+                break;
+            case '{':
+            case '[': {
+                for (uint32_t i = last; i < p; ++i)
+                    if (!is_blank(text[i]))
+                        return fail(i);
+
+                uint32_t ko, kl;
+                if (!place(p, ko, kl))
+                    return false;
+                if (!w.begin(text[p] == '{' ? NODE_OBJECT : NODE_ARRAY, ko, kl, p))
+                    return fail(p);
+                last = p + 1;
+                break;
+            }
+            case '}':
+            case ']':
+                if (!bare(last, p))
+                    return false;
+                if (w.depth == base || has_key || w.top() != (text[p] == '}' ? NODE_OBJECT : NODE_ARRAY))
+                    return fail(p);
+                w.end();
+                last = p + 1;
+
+                if (flow && w.depth == base) {
+                    ++k;
+                    stop = last;
+                    return true;
+                }
+                break;
+            default:
+                // newline, # and ' are plain text here
+                break;
+            }
+
+            ++k;
+        }
+
+        if (!bare(last, end))
+            return false;
+        if (w.depth != base || has_key)
+            return fail(end);
+
+        stop = end;
+        return true;
+    }
+};
+
+struct yaml_line_t {
+    uint32_t start = 0;     // first byte of the line
+    uint32_t begin = 0;     // first content byte
+    uint32_t end = 0;       // past the content, trailing blanks dropped
+    uint32_t indent = 0;
+    bool valid = false;
+};
+
+/**
+ * @brief
+ * Block YAML by indentation. Lines are cut at the newline offsets
+ * of the structural pass, everything else is decided per line.
+ */
+struct yaml_reader_t {
+    const char *text;
+    uint32_t size;
+    const std::vector<uint32_t> &idx;
+    tape_writer_t &w;
+
+    std::size_t cursor = 0;
+    uint32_t pos = 0;
+    yaml_line_t cur = {};
+    uint32_t error_at = 0;
+
+    bool fail(uint32_t at) {
+        error_at = at;
+        return false;
+    }
+
+    // Move cur to the next line with content
+    bool advance() {
+        while (pos < size) {
+            while (cursor < idx.size() && idx[cursor] < pos)
+                ++cursor;
+            while (cursor < idx.size() && text[idx[cursor]] != '\n')
+                ++cursor;
+
+            const uint32_t start = pos;
+            const uint32_t eol = cursor < idx.size() ? idx[cursor] : size;
+            pos = eol + 1;
+
+            uint32_t b = start;
+            while (b < eol && text[b] == ' ') ++b;
+            uint32_t e = eol;
+            while (e > b && is_blank(text[e - 1])) --e;
+
+            if (b == e || text[b] == '#')
+                continue;
+            if (text[b] == '\t')
+                return fail(b);
+
+            const std::string_view content(text + b, e - b);
+            if (b == start && (content == "---" || content.starts_with("--- ")))
+                continue;
+            if (b == start && content == "...") {
+                pos = size;
+                break;
+            }
+
+            cur = { start, b, e, b - start, true };
+            return true;
+        }
+
+        cur.valid = false;
+        return true;
+    }
+
+    bool seq_item(const yaml_line_t &l) const {
+        return text[l.begin] == '-' && (l.begin + 1 == l.end || text[l.begin + 1] == ' ');
+    }
+
+    // Closing quote of a quoted scalar opening at b, or end when unterminated
+    uint32_t closing_quote(uint32_t b, uint32_t e, bool &escaped) const {
+        const char quote = text[b];
+        for (uint32_t i = b + 1; i < e; ++i) {
+            if (quote == '"' && text[i] == '\\') {
+                escaped = true;
+                ++i;
+                continue;
+            }
+            if (text[i] == quote) {
+                if (quote == '\'' && i + 1 < e && text[i + 1] == '\'') {
+                    escaped = true;
+                    ++i;
+                    continue;
+                }
+                return i;
+            }
+        }
+        return e;
+    }
+
+    // Nothing but blanks or a comment in [b, e)
+    bool only_comment(uint32_t b, uint32_t e) const {
+        while (b < e && (text[b] == ' ' || text[b] == '\t')) ++b;
+        return b == e || text[b] == '#';
+    }
+
+    /**
+     * @brief Find "key:" in [b, e).
+     * @return false when the line is not a mapping entry
+     */
+    bool split_key(uint32_t b, uint32_t e, uint32_t &ko, uint32_t &kl, uint32_t &rest) const {
+        if (text[b] == '"' || text[b] == '\'') {
+            bool escaped = false;
+            const uint32_t close = closing_quote(b, e, escaped);
+            uint32_t c = close + 1;
+            while (c < e && text[c] == ' ') ++c;
+            if (close >= e || c >= e || text[c] != ':' || (c + 1 < e && text[c + 1] != ' ' && text[c + 1] != '\t'))
+                return false;
+            ko = b + 1;
+            kl = close - b - 1;
+            rest = c + 1;
+            return true;
+        }
+
+        if (text[b] == '[' || text[b] == '{' || text[b] == '#')
+            return false;
+
+        for (uint32_t c = b; c < e; ++c) {
+            if (text[c] == '#' && c > b && (text[c - 1] == ' ' || text[c - 1] == '\t'))
+                return false;
+            if (text[c] != ':' || (c + 1 < e && text[c + 1] != ' ' && text[c + 1] != '\t'))
+                continue;
+
+            uint32_t t = c;
+            while (t > b && (text[t - 1] == ' ' || text[t - 1] == '\t')) --t;
+            if (t == b)
+                return false;
+            ko = b;
+            kl = t - b;
+            rest = c + 1;
+            return true;
+        }
+        return false;
+    }
+
+    // Scalar or flow collection filling [b, e)
+    bool scalar(uint32_t b, uint32_t e, uint32_t ko, uint32_t kl) {
+        while (b < e && (text[b] == ' ' || text[b] == '\t')) ++b;
+
+        if (b == e || text[b] == '#') {
+            w.add(NODE_NULL, ko, kl, b, 0);
+            return true;
+        }
+
+        if (text[b] == '"' || text[b] == '\'') {
+            bool escaped = false;
+            const uint32_t close = closing_quote(b, e, escaped);
+            if (close >= e || !only_comment(close + 1, e))
+                return fail(b);
+            w.add(NODE_STRING, ko, kl, b + 1, close - b - 1, escaped);
+            return true;
+        }
+
+        if (text[b] == '[' || text[b] == '{') {
+            jsonc_reader_t flow{ text, idx, w };
+            flow.base = w.depth;
+            flow.root_key_offset = ko;
+            flow.root_key_length = kl;
+            flow.flow = true;
+
+            std::size_t k = static_cast<std::size_t>(std::lower_bound(idx.begin(), idx.end(), b) - idx.begin());
+            uint32_t stop = e;
+            if (!flow.run(b, e, k, stop))
+                return fail(flow.error_at);
+            if (!only_comment(stop, e))
+                return fail(stop);
+            return true;
+        }
+
+        // Plain scalar, a comment needs a blank before the #
+        uint32_t t = b;
+        for (; t < e; ++t)
+            if (text[t] == '#' && (text[t - 1] == ' ' || text[t - 1] == '\t'))
+                break;
+        while (t > b && (text[t - 1] == ' ' || text[t - 1] == '\t')) --t;
+
+        const std::string_view word(text + b, t - b);
+        const bool null = word == "~" || word == "null" || word == "Null" || word == "NULL";
+        w.add(null ? NODE_NULL : NODE_SCALAR, ko, kl, b, t - b);
+        return true;
+    }
+
+    bool block(uint32_t ko, uint32_t kl) {
+        uint32_t vk, vl, rest;
+        if (seq_item(cur))
+            return sequence(ko, kl);
+        if (split_key(cur.begin, cur.end, vk, vl, rest))
+            return mapping(ko, kl);
+
+        const yaml_line_t line = cur;
+        if (!advance())
+            return false;
+        return scalar(line.begin, line.end, ko, kl);
+    }
+
+    bool mapping(uint32_t ko, uint32_t kl) {
+        const uint32_t indent = cur.indent;
+        if (!w.begin(NODE_OBJECT, ko, kl, cur.begin))
+            return fail(cur.begin);
+
+        while (cur.valid && cur.indent == indent) {
+            uint32_t mk, ml, rest;
+            if (seq_item(cur) || !split_key(cur.begin, cur.end, mk, ml, rest))
+                return fail(cur.begin);
+
+            const yaml_line_t line = cur;
+            if (!advance())
+                return false;
+
+            if (!only_comment(rest, line.end)) {
+                if (!scalar(rest, line.end, mk, ml))
+                    return false;
+                continue;
+            }
+
+            // "key:" opens a nested block, a sequence may sit at the key's own indent
+            if (cur.valid && (cur.indent > indent || (cur.indent == indent && seq_item(cur)))) {
+                if (!block(mk, ml))
+                    return false;
+            } else {
+                w.add(NODE_NULL, mk, ml, rest, 0);
+            }
+        }
+
+        if (cur.valid && cur.indent > indent)
+            return fail(cur.begin);
+        w.end();
+        return true;
+    }
+
+    bool sequence(uint32_t ko, uint32_t kl) {
+        const uint32_t indent = cur.indent;
+        if (!w.begin(NODE_ARRAY, ko, kl, cur.begin))
+            return fail(cur.begin);
+
+        while (cur.valid && cur.indent == indent && seq_item(cur)) {
+            uint32_t c = cur.begin + 1;
+            while (c < cur.end && text[c] == ' ') ++c;
+
+            if (only_comment(c, cur.end)) {
+                if (!advance())
+                    return false;
+                if (cur.valid && cur.indent > indent) {
+                    if (!block(0, 0))
+                        return false;
+                } else {
+                    w.add(NODE_NULL, 0, 0, c, 0);
+                }
+                continue;
+            }
+
+            // "- key: value" and "- - x" start a block at the item's column
+            uint32_t mk, ml, rest;
+            yaml_line_t item = cur;
+            item.begin = c;
+            if (seq_item(item) || split_key(c, cur.end, mk, ml, rest)) {
+                cur.begin = c;
+                cur.indent = c - cur.start;
+                if (!block(0, 0))
+                    return false;
+                continue;
+            }
+
+            if (!advance())
+                return false;
+            if (!scalar(item.begin, item.end, 0, 0))
+                return false;
+        }
+
+        if (cur.valid && cur.indent > indent)
+            return fail(cur.begin);
+        w.end();
+        return true;
+    }
+
+    bool run() {
+        if (!advance())
+            return false;
+        if (!cur.valid)
+            return true;
+        if (!block(0, 0))
+            return false;
+        return cur.valid ? fail(cur.begin) : true;
+    }
+};
+
+/**
+ * @brief
+ * Valve KeyValues text (.vdf, .acf): "key" "value" and "key" { ... } pairs,
+ * // comments, unquoted tokens and [$PLATFORM] conditionals, which are dropped.
+ * The top level pairs become members of an implicit root object.
+ */
+struct vdf_reader_t {
+    const char *text;
+    uint32_t size;
+    const std::vector<uint32_t> &idx;
+    tape_writer_t &w;
+
+    bool has_key = false;
+    uint32_t key_offset = 0;
+    uint32_t key_length = 0;
+    uint32_t error_at = 0;
+
+    bool fail(uint32_t at) {
+        error_at = at;
+        return false;
+    }
+
+    bool token(node_kind_t kind, uint32_t offset, uint32_t length, bool escaped) {
+        if (!has_key) {
+            has_key = true;
+            key_offset = offset;
+            key_length = length;
+            return true;
+        }
+        w.add(kind, key_offset, key_length, offset, length, escaped);
+        has_key = false;
+        return true;
+    }
+
+    // Unquoted tokens between two structurals, split at blanks
+    bool bare(uint32_t from, uint32_t to) {
+        while (from < to) {
+            while (from < to && is_blank(text[from])) ++from;
+            uint32_t end = from;
+            while (end < to && !is_blank(text[end])) ++end;
+            if (end == from)
+                break;
+            // [$WIN32] and friends follow a value, they are not keys
+            if (!(text[from] == '[' && text[end - 1] == ']') && !token(NODE_SCALAR, from, end - from, false))
+                return false;
+            from = end;
+        }
+        return true;
+    }
+
+    bool run() {
+        w.begin(NODE_OBJECT, 0, 0, 0);
+        uint32_t last = 0;
+        std::size_t k = 0;
+
+        while (k < idx.size()) {
+            const uint32_t p = idx[k];
+
+            switch (text[p]) {
+            case '"': {
+                bool escaped = false;
+                std::size_t q = k + 1;
+                for (; q < idx.size(); ++q) {
+                    const uint32_t at = idx[q];
+                    if (text[at] == '\\') {
+                        escaped = true;
+                        if (q + 1 < idx.size() && idx[q + 1] == at + 1)
+                            ++q;
+                        continue;
+                    }
+                    if (text[at] == '"')
+                        break;
+                }
+                if (q >= idx.size())
+                    return fail(p);
+
+                const uint32_t close = idx[q];
+                if (!bare(last, p) || !token(NODE_STRING, p + 1, close - p - 1, escaped))
+                    return false;
+                k = q + 1;
+                last = close + 1;
+                continue;
+            }
+            case '/':
+                if (p + 1 < size && text[p + 1] == '/') {
+                    if (!bare(last, p))
+                        return false;
+                    const void *nl = std::memchr(text + p, '\n', size - p);
+                    last = nl ? static_cast<uint32_t>(static_cast<const char*>(nl) - text) : size;
+                    while (k < idx.size() && idx[k] < last)
+                        ++k;
+                    continue;
+                }
+                break;
+            case '{':
+                if (!bare(last, p))
+                    return false;
+                if (!has_key)
+                    return fail(p);
+                if (!w.begin(NODE_OBJECT, key_offset, key_length, p))
+                    return fail(p);
+                has_key = false;
+                last = p + 1;
+                break;
+            case '}':
+                if (!bare(last, p))
+                    return false;
+                if (has_key || w.depth == 1)
+                    return fail(p);
+                w.end();
+                last = p + 1;
+                break;
+            default:
+                // Newlines, colons, commas and the like are plain text here
+                break;
+            }
+            ++k;
+        }
+
+        if (!bare(last, size))
+            return false;
+        if (has_key || w.depth != 1)
+            return fail(size);
+        w.end();
+        return true;
+    }
+};
+
+document_t::~document_t() {
+    release();
+}
+
+document_t::document_t(document_t &&o) noexcept
+    : text(o.text), tape(std::move(o.tape)), structurals(std::move(o.structurals)),
+      buffer(std::move(o.buffer)) {
+    o.text = {};
+}
+
+document_t& document_t::operator=(document_t &&o) noexcept {
+    if (this == &o)
+        return *this;
+
+    release();
+    text = o.text;
+    tape = std::move(o.tape);
+    structurals = std::move(o.structurals);
+    buffer = std::move(o.buffer);
+
+    o.text = {};
+    return *this;
+}
+
+void document_t::release() noexcept {
+    buffer.clear();
+    text = {};
+    tape.clear();
+}
+
+::sigil::yield document_t::parse(std::string_view src, doc_format_t format) {
+    ::sigil::yield ret;
+
+    if (src.size() >= std::numeric_limits<uint32_t>::max())
+        return ret.set_state(sigil::yield_state::fail).set_code(EFBIG);
+
+    text = src;
+    tape.clear();
+    scan_structurals(src, structurals);
+
+    if (format == FORMAT_AUTO) {
+        const std::size_t first = src.find_first_not_of(" \t\r\n");
+        const bool braced = first != std::string_view::npos && (src[first] == '{' || src[first] == '[');
+        format = braced ? FORMAT_JSONC : FORMAT_YAML;
+    }
+
+    tape_writer_t w{ tape };
+    bool ok;
+    uint32_t error_at;
+
+    if (format == FORMAT_VDF) {
+        tape.reserve(structurals.size() / 4 + 1);
+        vdf_reader_t reader{ src.data(), static_cast<uint32_t>(src.size()), structurals, w };
+        ok = reader.run();
+        error_at = reader.error_at;
+    } else if (format == FORMAT_JSONC) {
+        tape.reserve(structurals.size() / 2 + 1);
+        jsonc_reader_t reader{ src.data(), structurals, w };
+        std::size_t k = 0;
+        uint32_t stop;
+        ok = reader.run(0, static_cast<uint32_t>(src.size()), k, stop);
+        error_at = reader.error_at;
+    } else {
+        yaml_reader_t reader{ src.data(), static_cast<uint32_t>(src.size()), structurals, w };
+        ok = reader.run();
+        error_at = reader.error_at;
+    }
+
+    if (!ok) {
+        tape.clear();
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL).set_info(error_at);
+    }
+
+    return ret;
+}
+
+::sigil::yield document_t::load(const std::filesystem::path &path, doc_format_t format) {
+    ::sigil::yield ret;
+    release();
+
+    if (format == FORMAT_AUTO) {
+        const std::filesystem::path ext = path.extension();
+        if (ext == ".json" || ext == ".jsonc")
+            format = FORMAT_JSONC;
+        else if (ext == ".vdf" || ext == ".acf")
+            format = FORMAT_VDF;
+    }
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    }
+
+    // Read, not mapped: Steam and editors rewrite these files while we run, a mapping
+    // of a file truncated under us raises SIGBUS. st_size is only a hint, read to EOF
+    std::size_t len = 0;
+    buffer.resize(static_cast<std::size_t>(st.st_size) + 1);
+    for (;;) {
+        if (len == buffer.size())
+            buffer.resize(buffer.size() * 2);
+
+        const ssize_t n = ::read(fd, buffer.data() + len, buffer.size() - len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            const int err = errno;
+            ::close(fd);
+            buffer.clear();
+            return ret.set_state(sigil::yield_state::fail).set_code(err);
+        }
+        if (n == 0)
+            break;
+        len += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+
+    return parse(std::string_view(buffer.data(), len), format);
+}
+
+node_kind_t value_t::kind() const noexcept {
+    return doc ? doc->tape[index].kind : NODE_NULL;
+}
+
+std::string_view value_t::key() const noexcept {
+    if (!doc)
+        return {};
+    const node_t &n = doc->tape[index];
+    return doc->text.substr(n.key_offset, n.key_length);
+}
+
+std::string_view value_t::str() const noexcept {
+    if (!doc)
+        return {};
+    const node_t &n = doc->tape[index];
+    return doc->text.substr(n.offset, n.length);
+}
+
+std::size_t value_t::size() const noexcept {
+    return doc ? doc->tape[index].count : 0;
+}
+
+value_t value_t::find(std::string_view name) const noexcept {
+    if (kind() != NODE_OBJECT)
+        return {};
+    for (value_t child : *this)
+        if (child.key() == name)
+            return child;
+    return {};
+}
+
+value_t value_t::at(std::size_t i) const noexcept {
+    if (i >= size())
+        return {};
+    iterator it = begin();
+    while (i--)
+        ++it;
+    return *it;
+}
+
+value_t value_t::path(std::string_view dotted) const noexcept {
+    value_t v = *this;
+    while (v) {
+        const std::size_t dot = dotted.find('.');
+        v = v.find(dotted.substr(0, dot));
+        if (dot == std::string_view::npos)
+            break;
+        dotted.remove_prefix(dot + 1);
+    }
+    return v;
+}
+
+bool value_t::as_int(int64_t &out) const noexcept {
+    std::string_view s = str();
+    if (!doc || s.empty())
+        return false;
+    if (s.front() == '+')
+        s.remove_prefix(1);
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && end == s.data() + s.size();
+}
+
+bool value_t::as_double(double &out) const noexcept {
+    std::string_view s = str();
+    if (!doc || s.empty())
+        return false;
+    if (s.front() == '+')
+        s.remove_prefix(1);
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && end == s.data() + s.size();
+}
+
+bool value_t::as_bool(bool &out) const noexcept {
+    const std::string_view s = str();
+    if (s == "true" || s == "True" || s == "TRUE" || s == "yes" || s == "Yes") {
+        out = true;
+        return true;
+    }
+    if (s == "false" || s == "False" || s == "FALSE" || s == "no" || s == "No") {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void append_utf8(std::string &out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Code point of the hex digits at s, -1 when they are not
+static int64_t read_hex(std::string_view s, std::size_t digits) {
+    if (s.size() < digits)
+        return -1;
+    int64_t v = 0;
+    for (std::size_t i = 0; i < digits; ++i) {
+        const int d = hex_value(s[i]);
+        if (d < 0)
+            return -1;
+        v = v * 16 + d;
+    }
+    return v;
+}
+
+std::string value_t::decode() const {
+    const std::string_view s = str();
+    if (!doc || !doc->tape[index].escaped)
+        return std::string(s);
+
+    std::string out;
+    out.reserve(s.size());
+
+    const node_t &n = doc->tape[index];
+    const char quote = n.offset > 0 ? doc->text[n.offset - 1] : '"';
+
+    if (quote == '\'') {
+        for (std::size_t i = 0; i < s.size(); ++i) {
+            out += s[i];
+            if (s[i] == '\'' && i + 1 < s.size() && s[i + 1] == '\'')
+                ++i;
+        }
+        return out;
+    }
+
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\' || i + 1 == s.size()) {
+            out += s[i];
+            continue;
+        }
+
+        const char e = s[++i];
+        switch (e) {
+        case 'n':  out += '\n'; break;
+        case 't':  out += '\t'; break;
+        case 'r':  out += '\r'; break;
+        case 'b':  out += '\b'; break;
+        case 'f':  out += '\f'; break;
+        case '0':  out += '\0'; break;
+        case 'e':  out += '\x1b'; break;
+        case 'x': {
+            const int64_t v = read_hex(s.substr(i + 1), 2);
+            if (v < 0) { out += e; break; }
+            append_utf8(out, static_cast<uint32_t>(v));
+            i += 2;
+            break;
+        }
+        case 'u': {
+            int64_t v = read_hex(s.substr(i + 1), 4);
+            if (v < 0) { out += e; break; }
+            i += 4;
+
+            // Surrogate pair written as two escapes
+            if (v >= 0xD800 && v < 0xDC00 && s.substr(i + 1, 2) == "\\u") {
+                const int64_t lo = read_hex(s.substr(i + 3), 4);
+                if (lo >= 0xDC00 && lo < 0xE000) {
+                    v = 0x10000 + ((v - 0xD800) << 10) + (lo - 0xDC00);
+                    i += 6;
+                }
+            }
+            append_utf8(out, static_cast<uint32_t>(v));
+            break;
+        }
+        default:   out += e; break;     // \" \\ \/ and anything unknown
+        }
+    }
+
+    return out;
+}
+
+value_t::iterator &value_t::iterator::operator++() noexcept {
+    index = doc->tape[index].next;
+    return *this;
+}
+
+value_t::iterator value_t::begin() const noexcept {
+    return doc ? iterator{ doc, index + 1 } : iterator{};
+}
+
+value_t::iterator value_t::end() const noexcept {
+    return doc ? iterator{ doc, doc->tape[index].next } : iterator{};
+}
+
+} // namespace sigil::data
@@ -80,4 +80,13 @@ namespace sigil::math {
     return ret;
 }
 
+void xxh128_hash_bytes(const void* data, std::size_t size, std::array<std::uint8_t, 16>& output) noexcept {
+    const XXH128_hash_t h = XXH3_128bits(data, size);
+
+    for (int i = 0; i < 8; ++i) {
+        output[i]     = static_cast<std::uint8_t>(h.low64 >> (i * 8));
+        output[i + 8] = static_cast<std::uint8_t>(h.high64 >> (i * 8));
+    }
+}
+
 } // namespace sigil::crypto
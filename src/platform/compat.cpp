@@ -1,14 +1,26 @@
 #include "sigil/platform/paths.h"
 #include <cstdio>
 #include <sigil/platform/compat.h>
+#include <sigil/platform/steam.h>
 #include <sigil/platform/exec.h>
 #include <sigil/platform/fs.h>
+#include <sigil/data/parser.h>
+#include <sigil/data/binary.h>
 #include <sigil/common.h>
+#include <string_view>
 #include <filesystem>
-#include <sys/stat.h>
+#include <algorithm>
 #include <iostream>
 #include <iterator>
+#include <fstream>
 #include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 static bool
 path_is_wine(const std::filesystem::path& runner){
@@ -79,7 +91,7 @@ namespace sigil::platform {
 ::sigil::yield probe_compat_tools(const ::sigil::platform::app_descriptor_t &app, std::vector<compat_tool_t> &out) {
     // Scan the SigilVM Compat directory
     //std::filesystem::path sigil_compat = ::sigil::fs::get_sigilvm_local_path() / "wlx64" / "runners";
-    std::filesystem::path sigil_compat = ::sigil::platform::get_compdata_root(app.process) / "runners";
+    std::filesystem::path sigil_compat = ::sigil::platform::get_compdata_root(app) / "runners";
 
     if (std::filesystem::exists(sigil_compat)) {
         for (auto& e : std::filesystem::directory_iterator(sigil_compat)) {
@@ -94,17 +106,12 @@ namespace sigil::platform {
         }
     }
 
-    // Scan the Steam Compat directory
-    std::filesystem::path steam_compat = ::sigil::fs::get_home_path() / ".local/share/Steam/compatibilitytools.d";
-
-    if (std::filesystem::exists(steam_compat)) {
-        for (auto& e : std::filesystem::directory_iterator(steam_compat)) {
-            if (!e.is_directory())
-                continue;
-
+    // Steam's compatibilitytools.d and the Protons it installed, from the Steam index
+    if (const auto steam = probe_steam(app)) {
+        for (const auto &tool : steam->tools) {
             sigil::platform::compat_tool_t t;
-            t.name   = e.path().filename().string();
-            t.path   = e.path().string();
+            t.name   = tool.display_name;
+            t.path   = tool.path;
             t.origin = COMPAT_STEAM;
             out.push_back(t);
         }
@@ -139,65 +146,50 @@ bool compat_profile_t::is_valid() {
     return true;
 }
 
-::sigil::yield load_compat_profile(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &src, compat_profile_t &out) {
+// Fields of a profile file, checking the sha256 value is left to the caller
+static ::sigil::yield parse_compat_profile(const std::filesystem::path &src, compat_profile_t &out, std::string &sha256) {
     ::sigil::yield ret;
+    sha256.clear();
 
-    FILE* f = fopen(src.c_str(), "r");
-    if (!f)
-        return ret.set_state(sigil::yield_state::fail);
+    ::sigil::data::document_t doc;
+    ret = doc.load(src, ::sigil::data::FORMAT_YAML);
+    if (ret.is_failure())
+        return ret;
         // return sigil::VM_RESOURCE_MISSING;
 
-    char line[512];
+    const ::sigil::data::value_t root = doc.root();
+    if (!root.is_object()) {
+        ::sigil::dcout << "[ERROR] Profile is not a key: value map" << std::endl;
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+    }
 
-    while (fgets(line, sizeof(line), f)) {
-        std::string line_str(line);
+    // assign values, absent keys keep what out already holds
+    if (const auto v = root["target"]) out.target = v.decode();
+    if (const auto v = root["runner"]) out.runner = v.decode();
+    if (const auto v = root["prefix"]) out.prefix = v.decode();
+    if (const auto v = root["extra"])  out.extra  = v.decode();
+    if (const auto v = root["sha256"]) sha256     = v.decode();
 
-        //sigil::dcout << line_str << std::endl;
+    return ret;
+}
 
-        // skip empty lines
-        if (line_str.empty())
-            continue;
+::sigil::yield load_compat_profile(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &src, compat_profile_t &out) {
+    ::sigil::yield ret;
 
-        // find the first colon
-        auto colon_pos = line_str.find(':');
-        if (colon_pos == std::string::npos)
-            continue; // no key-value separator
-
-        std::string key = line_str.substr(0, colon_pos);
-        std::string val = line_str.substr(colon_pos + 1);
-
-        // trim whitespace from key
-        key.erase(0, key.find_first_not_of(" \t\r\n"));
-        key.erase(key.find_last_not_of(" \t\r\n") + 1);
-
-        // trim whitespace from val
-        val.erase(0, val.find_first_not_of(" \t\r\n"));
-        val.erase(val.find_last_not_of(" \t\r\n") + 1);
-
-        //sigil::dcout << "Parsing key: " << key << " with value: " << val << std::endl;
-
-        // assign values
-        if (key == "target")
-            out.target = val;
-        else if (key == "runner")
-            out.runner = val;
-        else if (key == "prefix")
-            out.prefix = val;
-        else if (key == "extra")
-            out.extra = val;
-        else if (key == "sha256") {
-            if (!hash_is_matching(out.target, val)) {
-                sigil::dcout << "[ERROR] Hash mismatch when opening a profile" << std::endl;
-                return ret.set_state(sigil::yield_state::fail);
-                // return sigil::VM_INVALID_STATE;
-            } else {
-                out.file_sha256 = val;
-            }
+    std::string sha256;
+    ret = parse_compat_profile(src, out, sha256);
+    if (ret.is_failure())
+        return ret;
+
+    if (!sha256.empty()) {
+        if (!hash_is_matching(out.target, sha256)) {
+            sigil::dcout << "[ERROR] Hash mismatch when opening a profile" << std::endl;
+            return ret.set_state(sigil::yield_state::fail);
+            // return sigil::VM_INVALID_STATE;
         }
+        out.file_sha256 = sha256;
     }
 
-    fclose(f);
-
     if (!out.is_valid()) {
         ::sigil::dcout << "[ERROR] Loading invalid profile" << std::endl;
         ret.set_state(sigil::yield_state::fail);
@@ -206,6 +198,214 @@ bool compat_profile_t::is_valid() {
     return ret;
 }
 
+// Index file: magic, version, directory, entry count, then per entry the name,
+// both file keys, the hash state and the profile fields, see sigil/data/binary.h
+static constexpr char profile_index_magic[8] = { 'S', 'G', 'C', 'P', 'I', 'D', 'X', '\0' };
+static constexpr uint32_t profile_index_version = 1;
+
+::sigil::yield compat_profile_index_t::load(const std::filesystem::path &file) {
+    ::sigil::yield ret;
+    dir.clear();
+    entries.clear();
+
+    std::string raw;
+    ret = ::sigil::data::read_binary_file(file, raw);
+    if (ret.is_failure())
+        return ret;
+
+    ::sigil::data::binary_reader_t r(raw);
+    char magic[sizeof(profile_index_magic)];
+    uint32_t version = 0;
+    uint32_t count = 0;
+
+    r.get(magic, sizeof(magic));
+    r.get(version);
+    if (!r.ok || std::memcmp(magic, profile_index_magic, sizeof(magic)) != 0 || version != profile_index_version)
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+
+    r.get(dir);
+    r.get(count);
+
+    for (uint32_t i = 0; r.ok && i < count; ++i) {
+        entry_t e;
+        uint8_t hash = 0;
+        r.get(e.name);
+        r.get(e.profile);
+        r.get(e.target);
+        r.get(hash);
+        r.get(e.data.file_sha256);
+        r.get(e.data.target);
+        r.get(e.data.runner);
+        r.get(e.data.prefix);
+        r.get(e.data.extra);
+        if (hash > COMPAT_HASH_MISMATCH)
+            r.ok = false;
+        e.hash = static_cast<compat_hash_state_t>(hash);
+        entries.push_back(std::move(e));
+    }
+
+    if (!r.done()) {
+        dir.clear();
+        entries.clear();
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+    }
+
+    return ret;
+}
+
+::sigil::yield compat_profile_index_t::save(const std::filesystem::path &file) const {
+    ::sigil::data::binary_writer_t w;
+    w.out.append(profile_index_magic, sizeof(profile_index_magic));
+    w.put(profile_index_version);
+    w.put(dir);
+    w.put(static_cast<uint32_t>(entries.size()));
+
+    for (const auto &e : entries) {
+        w.put(e.name);
+        w.put(e.profile);
+        w.put(e.target);
+        w.put(static_cast<uint8_t>(e.hash));
+        w.put(e.data.file_sha256);
+        w.put(e.data.target);
+        w.put(e.data.runner);
+        w.put(e.data.prefix);
+        w.put(e.data.extra);
+    }
+
+    return ::sigil::data::write_binary_file(file, w.out);
+}
+
+// Hash state of e for the target as it is now, sha256sum runs only when the
+// target metadata differs from what was recorded at the last check
+static void verify_index_entry(compat_profile_index_t::entry_t &e, bool &changed, compat_index_stats_t *stats) {
+    if (e.data.file_sha256.empty()) {
+        if (e.hash != COMPAT_HASH_NONE)
+            changed = true;
+        e.hash = COMPAT_HASH_NONE;
+        return;
+    }
+
+    ::sigil::fs::file_key_t now{};
+    const bool have_key = ::sigil::fs::get_file_key(e.data.target, now);
+
+    if (have_key && e.hash != COMPAT_HASH_NONE && now == e.target) {
+        if (stats) ++stats->hash_skipped;
+        return;
+    }
+
+    const compat_hash_state_t hash = hash_is_matching(e.data.target, e.data.file_sha256)
+        ? COMPAT_HASH_MATCH : COMPAT_HASH_MISMATCH;
+    if (stats) ++stats->hashed;
+
+    // A target that cannot be stat'ed is hashed again next time
+    if (!have_key)
+        now = {};
+    if (hash != e.hash || !(now == e.target))
+        changed = true;
+    e.hash = hash;
+    e.target = now;
+}
+
+::sigil::yield refresh_compat_profiles(const std::filesystem::path &dir, compat_profile_index_t &index,
+                                       std::vector<compat_profile_t> &out, bool &changed,
+                                       compat_index_stats_t *stats) {
+    ::sigil::yield ret;
+    out.clear();
+    changed = false;
+
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec))
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOTDIR);
+
+    // An index of another directory shares nothing with this one
+    if (index.dir != dir) {
+        changed = changed || !index.entries.empty() || !index.dir.empty();
+        index.dir = dir;
+        index.entries.clear();
+    }
+
+    std::vector<std::string> names;
+    for (const auto &e : std::filesystem::directory_iterator(dir, ec)) {
+        std::error_code type_ec;
+        if (e.is_regular_file(type_ec))
+            names.push_back(e.path().filename().string());
+    }
+    if (ec)
+        return ret.set_state(sigil::yield_state::fail).set_code(ec.value());
+    std::sort(names.begin(), names.end());
+
+    // Both lists are sorted, walk them side by side
+    std::vector<compat_profile_index_t::entry_t> next;
+    next.reserve(names.size());
+    auto old = index.entries.begin();
+
+    for (const auto &name : names) {
+        while (old != index.entries.end() && old->name < name) {
+            ++old;
+            changed = true;     // profile removed
+        }
+
+        const std::filesystem::path file = dir / name;
+        ::sigil::fs::file_key_t key{};
+        if (!::sigil::fs::get_file_key(file, key))
+            continue;
+
+        compat_profile_index_t::entry_t e;
+        const bool known = old != index.entries.end() && old->name == name;
+
+        if (known && old->profile == key) {
+            e = std::move(*old);
+            if (stats) ++stats->reused;
+        } else {
+            e.name = name;
+            e.profile = key;
+            std::string sha256;
+            ::sigil::yield s = parse_compat_profile(file, e.data, sha256);
+            if (stats) ++stats->parsed;
+            changed = true;
+
+            if (s.is_failure()) {
+                // Kept empty so the broken file is not parsed again until it changes
+                sigil::dcout << "[DEBUG] Skipping unreadable profile " << name << std::endl;
+                if (stats) ++stats->rejected;
+                if (known) ++old;
+                e.data = {};
+                next.push_back(std::move(e));
+                continue;
+            }
+            e.data.file_sha256 = sha256;
+
+            // Editing other keys keeps the verdict for the same sha256 and target
+            if (known && old->data.file_sha256 == sha256 && old->data.target == e.data.target) {
+                e.hash = old->hash;
+                e.target = old->target;
+            }
+        }
+        if (known)
+            ++old;
+
+        verify_index_entry(e, changed, stats);
+
+        compat_profile_t profile = e.data;
+        if (e.hash == COMPAT_HASH_MISMATCH) {
+            sigil::dcout << "[ERROR] Hash mismatch when opening profile " << name << std::endl;
+            if (stats) ++stats->rejected;
+        } else if (!profile.is_valid()) {
+            sigil::dcout << "[DEBUG] Skipping invalid profile " << name << std::endl;
+            if (stats) ++stats->rejected;
+        } else {
+            out.push_back(std::move(profile));
+        }
+
+        next.push_back(std::move(e));
+    }
+
+    if (old != index.entries.end())
+        changed = true;
+    index.entries = std::move(next);
+    return ret;
+}
+
 
 ::sigil::yield
 run_compat_profile(const ::sigil::platform::app_descriptor_t &app, const compat_profile_t& profile) {
@@ -276,10 +476,8 @@ run_compat_profile(const ::sigil::platform::app_descriptor_t &app, const compat_
     out.clear();
     ::sigil::yield ret;
 
-    std::filesystem::path profiles_dir =
-        ::sigil::fs::get_sigilvm_local_path()
-        / "wlx64"
-        / "profiles";
+    const std::filesystem::path profiles_dir = ::sigil::platform::get_compdata_root(app) / "profiles";
+    const std::filesystem::path index_file = ::sigil::platform::get_sigilvm_cache_root(app) / "compat" / "profiles.index";
 
     if (!std::filesystem::exists(profiles_dir))
         return ret.set_state(sigil::yield_state::fail);
@@ -289,24 +487,260 @@ run_compat_profile(const ::sigil::platform::app_descriptor_t &app, const compat_
         return ret.set_state(sigil::yield_state::fail);
         // return sigil::VM_ARG_INVALID;
 
-    for (const auto &e : std::filesystem::directory_iterator(profiles_dir)) {
-        if (!e.is_regular_file())
-            continue;
+    // A missing or stale index only costs a full parse
+    compat_profile_index_t index;
+    index.load(index_file);
+
+    bool changed = false;
+    ret = refresh_compat_profiles(profiles_dir, index, out, changed);
+    if (ret.is_failure())
+        return ret;
+
+    if (changed) {
+        ::sigil::yield s = index.save(index_file);
+        if (s.is_failure())
+            sigil::dcout << "[DEBUG] Could not write " << index_file << std::endl;
+    }
+
+    return ret;
+}
+
+
+
+// FNV-1a, enough to tell runners with the same directory name apart
+static uint32_t runner_path_hash(const std::string &s) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char c : s) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Changes when the runner is upgraded in place: Proton's version file, or the wine binary itself
+static std::string runner_version_stamp(const std::filesystem::path &runner) {
+    std::filesystem::path file = runner;
+    if (path_is_proton(runner))
+        file = std::filesystem::exists(runner / "version") ? runner / "version" : runner / "proton";
+
+    struct stat st;
+    if (::stat(file.c_str(), &st) != 0)
+        return {};
+    return std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino) + ":" + std::to_string(st.st_size)
+         + ":" + std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec);
+}
 
-        compat_profile_t profile{};
-        ::sigil::yield s = load_compat_profile(app, e.path(), profile);
+std::filesystem::path get_prefix_template_path(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &runner) {
+    std::error_code ec;
+    std::filesystem::path abs = std::filesystem::absolute(runner, ec);
+    std::string resolved;
+    if (!runner.has_parent_path() && ::sigil::fs::resolve_in_path(runner.c_str(), resolved))
+        abs = resolved;
+    else if (ec)
+        abs = runner;
+    abs = abs.lexically_normal();
+
+    // /opt/wine/bin/wine is "bin" by its directory, name wine runners after the install
+    std::string name = path_is_wine(abs) ? abs.parent_path().parent_path().filename().string()
+                                         : abs.filename().string();
+    if (name.empty())
+        name = "wine";
+
+    char hash[16];
+    std::snprintf(hash, sizeof(hash), "%08x", runner_path_hash(abs.string() + '\n' + runner_version_stamp(abs)));
+    return ::sigil::platform::get_compdata_root(app) / "templates" / (name + "-" + hash);
+}
 
-        if (s.is_failure()) {
-            sigil::dcout << "[DEBUG] Skipping invalid profile" << std::endl;
-            continue; // skip invalid / unreadable profiles
+// wineserver of the runner's own install, or the one in PATH for a bare "wine"
+static std::filesystem::path runner_wineserver(const std::filesystem::path &runner) {
+    if (path_is_proton(runner)) {
+        for (const char *dist : { "files", "dist" }) {
+            const auto p = runner / dist / "bin" / "wineserver";
+            if (std::filesystem::exists(p))
+                return p;
         }
+        return {};
+    }
+
+    if (!runner.has_parent_path())
+        return "wineserver";
+
+    const auto p = runner.parent_path() / "wineserver";
+    return std::filesystem::exists(p) ? p : std::filesystem::path{};
+}
+
+// flock held while a template is built, released when the descriptor closes
+struct template_lock_t {
+    int fd = -1;
+
+    explicit template_lock_t(const std::filesystem::path &path) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd >= 0)
+            while (::flock(fd, LOCK_EX) != 0 && errno == EINTR) {}
+    }
+
+    ~template_lock_t() {
+        if (fd >= 0)
+            ::close(fd);
+    }
 
-        out.push_back(profile);
+    template_lock_t(const template_lock_t&) = delete;
+    template_lock_t& operator=(const template_lock_t&) = delete;
+};
+
+static ::sigil::yield run_prefix_step(proc_exec_unit_t &peu) {
+    ::sigil::yield ret;
+    peu.set_exec_mode(EXEC_WAIT);
+    peu.set_stdio_mode(STDIO_NULL, STDIO_NULL, STDIO_NULL);
+    // No Mono / Gecko install dialogs, games that need them get them per prefix
+    peu.export_var("WINEDLLOVERRIDES", "mscoree,mshtml=");
+    peu.export_var("WINEDEBUG", "-all");
+
+    ret = ::sigil::platform::execute(peu);
+    if (ret.is_ok() && peu.result.exit_code != 0)
+        ret.set_state(sigil::yield_state::fail).set_code(ECHILD).set_info(static_cast<uint64_t>(peu.result.exit_code));
+    return ret;
+}
+
+static ::sigil::yield init_prefix(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &runner,
+                                  const std::filesystem::path &dir) {
+    ::sigil::yield ret;
+    proc_exec_unit_t boot;
+    std::filesystem::path wineprefix = dir;
+
+    if (path_is_proton(runner)) {
+        // Proton builds <dir>/pfx from its default_pfx and runs wineboot in it
+        wineprefix = dir / "pfx";
+        boot.set_target(runner / "proton");
+        boot.export_var("STEAM_COMPAT_CLIENT_INSTALL_PATH", ::sigil::platform::get_home(app) / ".steam" / "steam");
+        boot.export_var("STEAM_COMPAT_DATA_PATH", dir);
+        boot.push_argument("run").push_argument("wineboot").push_argument("--init");
+    } else if (path_is_wine(runner)) {
+        boot.set_target(runner);
+        boot.export_var("WINEPREFIX", dir);
+        boot.push_argument("wineboot").push_argument("--init");
+    } else {
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+    }
+
+    ret = run_prefix_step(boot);
+    if (ret.is_failure())
+        return ret;
+
+    // The registry reaches the disk when wineserver exits, wait for it before cloning
+    const std::filesystem::path wineserver = runner_wineserver(runner);
+    if (!wineserver.empty()) {
+        proc_exec_unit_t wait;
+        wait.set_target(wineserver);
+        wait.export_var("WINEPREFIX", wineprefix);
+        wait.push_argument("-w");
+        ret = run_prefix_step(wait);
+    }
+
+    return ret;
+}
+
+::sigil::yield ensure_prefix_template(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &runner,
+                                      std::filesystem::path &out) {
+    ::sigil::yield ret;
+    out = get_prefix_template_path(app, runner);
+
+    std::error_code ec;
+    const std::filesystem::path record = out.string() + ".yaml";
+    if (std::filesystem::is_directory(out, ec) && std::filesystem::exists(record, ec))
+        return ret;
+
+    // Concurrent first uses wait for one wineboot instead of racing on the staging directory
+    std::filesystem::create_directories(out.parent_path(), ec);
+    template_lock_t lock(out.string() + ".lock");
+    if (lock.fd < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+    if (std::filesystem::is_directory(out, ec) && std::filesystem::exists(record, ec))
+        return ret;
+
+    const std::filesystem::path staging = out.string() + ".staging";
+    std::filesystem::remove_all(staging, ec);
+    std::filesystem::create_directories(staging, ec);
+    if (ec)
+        return ret.set_state(sigil::yield_state::fail).set_code(ec.value());
+
+    sigil::dcout << "[INFO] Initializing prefix template " << out << std::endl;
+    ret = init_prefix(app, runner, staging);
+    if (ret.is_failure()) {
+        std::filesystem::remove_all(staging, ec);
+        return ret;
+    }
+
+    std::filesystem::remove_all(out, ec);
+    if (::rename(staging.c_str(), out.c_str()) != 0) {
+        const int err = errno;
+        std::filesystem::remove_all(staging, ec);
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
     }
 
+    std::ofstream rec(record, std::ios::trunc);
+    rec << "runner: \"" << runner.string() << "\"\n"
+        << "created: " << std::time(nullptr) << "\n";
+    if (!rec.flush())
+        return ret.set_state(sigil::yield_state::fail).set_code(EIO);
+
     return ret;
 }
 
+::sigil::yield create_compat_prefix(const ::sigil::platform::app_descriptor_t &app, const std::filesystem::path &runner,
+                                    const std::string &name, std::filesystem::path &out,
+                                    ::sigil::fs::copy_stats_t *stats) {
+    ::sigil::yield ret;
+
+    if (name.empty() || name.find('/') != std::string::npos || name.front() == '.')
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+
+    out = ::sigil::platform::get_compdata_root(app) / "prefixes" / name;
+    std::error_code ec;
+    if (std::filesystem::exists(std::filesystem::symlink_status(out, ec)))
+        return ret.set_state(sigil::yield_state::fail).set_code(EEXIST);
+
+    std::filesystem::path tmpl;
+    ret = ensure_prefix_template(app, runner, tmpl);
+    if (ret.is_failure())
+        return ret;
+
+    // Cloned under a hidden name, the prefix list never shows a partial prefix
+    const std::filesystem::path staging = out.parent_path() / ("." + name + ".staging");
+    std::filesystem::remove_all(staging, ec);
+
+    ::sigil::fs::copy_stats_t local;
+    ::sigil::fs::copy_stats_t &st = stats ? *stats : local;
+    // Reflinks or plain copies, never hardlinks: Wine chmods and rewrites system DLLs in place
+    ret = ::sigil::fs::clone_tree(tmpl, staging, st);
+    if (ret.is_failure()) {
+        std::filesystem::remove_all(staging, ec);
+        return ret;
+    }
+
+    {
+        std::ofstream manifest(staging / "sigil-prefix.yaml", std::ios::trunc);
+        manifest << "template: \"" << tmpl.string() << "\"\n"
+                 << "runner: \"" << runner.string() << "\"\n"
+                 << "files_cloned: " << st.files_cloned << "\n"
+                 << "files_linked: " << st.files_linked << "\n"
+                 << "files_copied: " << st.files_copied << "\n"
+                 << "shared_bytes: " << st.bytes_cloned + st.bytes_linked << "\n"
+                 << "own_bytes: " << st.bytes_copied << "\n";
+        if (!manifest.flush()) {
+            std::filesystem::remove_all(staging, ec);
+            return ret.set_state(sigil::yield_state::fail).set_code(EIO);
+        }
+    }
+
+    if (::rename(staging.c_str(), out.c_str()) != 0) {
+        const int err = errno;
+        std::filesystem::remove_all(staging, ec);
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    }
+
+    return ret;
+}
 
 
 /*::sigil::yieldsave_profile(const std::filesystem::path &out, compat_profile_t &src) {
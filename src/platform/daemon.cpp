@@ -0,0 +1,458 @@
+#include <sigil/platform/daemon.h>
+#include <sigil/platform/paths.h>
+#include <sigil/common.h>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <cerrno>
+
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+extern "C" {
+    extern char **environ;
+}
+
+namespace sigil::platform {
+
+namespace {
+
+constexpr uint32_t wire_magic = 0x53564d44;     // "SVMD"
+constexpr uint32_t wire_accept = 0x53564d41;    // "SVMA", the daemon takes the call, the client lets it
+constexpr uint32_t wire_version = 2;
+constexpr std::size_t max_request = 256 * 1024;
+
+struct wire_request_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t argc;
+    uint32_t envc;
+    uint32_t payload_size;
+};
+
+struct wire_reply_t {
+    uint32_t magic;
+    int32_t exit_code;
+};
+
+::sigil::yield fail_errno(int err = errno) {
+    return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(err);
+}
+
+bool make_address(const std::filesystem::path &path, sockaddr_un &addr) {
+    const std::string &s = path.native();
+    if (s.size() >= sizeof(addr.sun_path))
+        return false;
+
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, s.c_str(), s.size() + 1);
+    return true;
+}
+
+int connect_to(const std::filesystem::path &path) {
+    sockaddr_un addr;
+    if (!make_address(path, addr)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        return -1;
+    }
+
+    return fd;
+}
+
+// Handlers reset on exec, unlike SIG_IGN, so children still get default SIGPIPE
+void ignore_sigpipe(int) {}
+
+void append_strings(std::string &payload, const char **list, uint32_t &count) {
+    for (; list && *list; ++list, ++count) {
+        payload.append(*list);
+        payload.push_back('\0');
+    }
+}
+
+// Split the payload back into argv / envp / cwd, false on malformed input
+bool parse_payload(const wire_request_t &hdr, daemon_request_t &req) {
+    const char *p = req.payload.data();
+    const char *end = p + req.payload.size();
+
+    auto next = [&](const char *&out) {
+        const void *nul = std::memchr(p, '\0', static_cast<std::size_t>(end - p));
+        if (nul == nullptr) return false;
+        out = p;
+        p = static_cast<const char*>(nul) + 1;
+        return true;
+    };
+
+    req.argc = static_cast<int>(hdr.argc);
+    req.argv.resize(hdr.argc + 1, nullptr);
+    req.envp.resize(hdr.envc + 1, nullptr);
+
+    for (uint32_t i = 0; i < hdr.argc; ++i)
+        if (!next(req.argv[i])) return false;
+    for (uint32_t i = 0; i < hdr.envc; ++i)
+        if (!next(req.envp[i])) return false;
+
+    return next(req.cwd) && p == end;
+}
+
+void flush_stdio() {
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+}
+
+// Runs the handler with the client's stdio, cwd and environment swapped in
+int run_in_client_context(const daemon_handler_t &handler, const daemon_request_t &req, const int (&fds)[3]) {
+    int saved[3];
+    for (int i = 0; i < 3; ++i)
+        saved[i] = fcntl(i, F_DUPFD_CLOEXEC, 10);
+
+    int saved_cwd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    flush_stdio();
+    for (int i = 0; i < 3; ++i)
+        dup2(fds[i], i);
+
+    int exit_code = 1;
+    if (chdir(req.cwd) != 0) {
+        std::cerr << "sigilvm daemon: cannot enter " << req.cwd << ": " << std::strerror(errno) << std::endl;
+    } else {
+        char **saved_env = environ;
+        environ = const_cast<char**>(req.envp.data());
+        exit_code = handler(req);
+        environ = saved_env;
+    }
+
+    flush_stdio();
+    std::cout.clear();
+    std::cerr.clear();
+
+    for (int i = 0; i < 3; ++i) {
+        if (saved[i] >= 0) {
+            dup2(saved[i], i);
+            ::close(saved[i]);
+        }
+    }
+
+    if (saved_cwd >= 0) {
+        if (fchdir(saved_cwd) != 0)
+            sigil::dcout << "[daemon] failed to restore cwd" << std::endl;
+        ::close(saved_cwd);
+    }
+
+    return exit_code;
+}
+
+} // namespace
+
+
+daemon_server_t::~daemon_server_t() {
+    close();
+}
+
+::sigil::yield daemon_server_t::listen(const std::filesystem::path &path) {
+    sockaddr_un addr;
+    if (!make_address(path, addr))
+        return fail_errno(ENAMETOOLONG);
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    chmod(path.parent_path().c_str(), 0700);
+
+    // Replace a leftover socket, but never steal one a live daemon answers on
+    int probe = connect_to(path);
+    if (probe >= 0) {
+        ::close(probe);
+        return fail_errno(EADDRINUSE);
+    }
+    if (errno == ECONNREFUSED)
+        unlink(path.c_str());
+
+    listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        return fail_errno();
+
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0
+        || ::listen(listen_fd, 64) < 0) {
+        int err = errno;
+        ::close(listen_fd);
+        listen_fd = -1;
+        return fail_errno(err);
+    }
+
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd < 0) {
+        int err = errno;
+        close();
+        return fail_errno(err);
+    }
+
+    struct sigaction sa = {};
+    if (sigaction(SIGPIPE, nullptr, &sa) == 0 && sa.sa_handler == SIG_DFL) {
+        sa.sa_handler = ignore_sigpipe;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGPIPE, &sa, nullptr);
+    }
+
+    socket_path = path;
+    stopping = false;
+    return {};
+}
+
+::sigil::yield daemon_server_t::serve_one(const daemon_handler_t &handler, int timeout_ms) {
+    ::sigil::yield ret;
+
+    if (listen_fd < 0)
+        return fail_errno(EBADF);
+
+    pollfd pfd[2] = {
+        { listen_fd, POLLIN, 0 },
+        { wake_fd,   POLLIN, 0 },
+    };
+
+    int n = poll(pfd, 2, timeout_ms);
+    if (n < 0)
+        return errno == EINTR ? ret : fail_errno();
+    if (n == 0 || stopping || (pfd[1].revents & POLLIN))
+        return ret;
+
+    int conn = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (conn < 0)
+        return (errno == EINTR || errno == ECONNABORTED) ? ret : fail_errno();
+
+    // Same user only, the request runs with our privileges
+    ucred cred = {};
+    socklen_t cred_len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0 || cred.uid != getuid()) {
+        ::close(conn);
+        return ret;
+    }
+
+    // A client that connects and stalls must not hold up the queue
+    timeval tv = { 2, 0 };
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // Seqpacket keeps the request whole, peek its size before reading it
+    char peek;
+    ssize_t len = recv(conn, &peek, 1, MSG_PEEK | MSG_TRUNC);
+    if (len < static_cast<ssize_t>(sizeof(wire_request_t))
+        || len > static_cast<ssize_t>(sizeof(wire_request_t) + max_request)) {
+        ::close(conn);
+        return ret;
+    }
+
+    wire_request_t hdr = {};
+    daemon_request_t req;
+    req.payload.resize(static_cast<std::size_t>(len) - sizeof(hdr));
+
+    iovec iov[2] = {
+        { &hdr, sizeof(hdr) },
+        { req.payload.data(), req.payload.size() },
+    };
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * 3)];
+    msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t got = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+
+    int fds[3] = { -1, -1, -1 };
+    int nfds = 0;
+    for (cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+            nfds = static_cast<int>((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            std::memcpy(fds, CMSG_DATA(c), sizeof(int) * std::min(nfds, 3));
+        }
+    }
+
+    bool valid = got >= static_cast<ssize_t>(sizeof(hdr))
+        && !(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+        && hdr.magic == wire_magic && hdr.version == wire_version
+        && hdr.payload_size == static_cast<std::size_t>(got) - sizeof(hdr)
+        && nfds == 3;
+
+    wire_reply_t reply = { wire_magic, 1 };
+
+    if (valid)
+        valid = parse_payload(hdr, req);
+
+    // The client waits for us only briefly, a call it gave up on was run locally, never run it here too
+    bool claimed = false;
+    if (valid) {
+        wire_reply_t accept = { wire_accept, 0 };
+        wire_reply_t go = {};
+        claimed = send(conn, &accept, sizeof(accept), MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(accept))
+            && recv(conn, &go, sizeof(go), 0) == static_cast<ssize_t>(sizeof(go))
+            && go.magic == wire_accept;
+    }
+
+    // A bad request is the client's problem, the daemon keeps serving
+    if (claimed)
+        reply.exit_code = run_in_client_context(handler, req, fds);
+    else if (!valid)
+        sigil::dcout << "[daemon] rejected malformed request" << std::endl;
+
+    for (int i = 0; i < std::min(nfds, 3); ++i)
+        ::close(fds[i]);
+
+    send(conn, &reply, sizeof(reply), MSG_NOSIGNAL);
+    ::close(conn);
+
+    return ret;
+}
+
+::sigil::yield daemon_client_app(const daemon_request_t &req, process_descriptor_t &proc, app_descriptor_t &app) {
+    ::sigil::yield ret = process_initialize(proc, req.argc, const_cast<const char**>(req.argv.data()),
+                                            const_cast<const char**>(req.envp.data()));
+    if (ret.is_failure())
+        return ret;
+
+    ret = app_initialize(app, proc);
+    if (ret.is_failure())
+        return ret;
+
+    resolve_app_paths(app);
+    return ret;
+}
+
+::sigil::yield daemon_server_t::run(const daemon_handler_t &handler) {
+    while (!stopping) {
+        ::sigil::yield st = serve_one(handler, -1);
+        if (st.is_failure())
+            return st;
+    }
+    return {};
+}
+
+void daemon_server_t::stop() noexcept {
+    stopping = true;
+    if (wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t r = write(wake_fd, &one, sizeof(one));
+        (void)r;
+    }
+}
+
+void daemon_server_t::close() {
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+        unlink(socket_path.c_str());
+    }
+    if (wake_fd >= 0) {
+        ::close(wake_fd);
+        wake_fd = -1;
+    }
+}
+
+
+::sigil::yield daemon_forward(const std::filesystem::path &socket_path, int argc, const char **argv,
+                              const char **envp, int &exit_code, const std::array<int, 3> &stdio,
+                              int accept_timeout_ms) {
+    wire_request_t hdr = { wire_magic, wire_version, 0, 0, 0 };
+    std::string payload;
+
+    for (int i = 0; i < argc; ++i, ++hdr.argc) {
+        payload.append(argv[i] ? argv[i] : "");
+        payload.push_back('\0');
+    }
+    append_strings(payload, envp, hdr.envc);
+
+    std::error_code ec;
+    payload.append(std::filesystem::current_path(ec).native());
+    payload.push_back('\0');
+
+    if (payload.size() > max_request)
+        return fail_errno(E2BIG);
+    hdr.payload_size = static_cast<uint32_t>(payload.size());
+
+    int fd = connect_to(socket_path);
+    if (fd < 0)
+        return fail_errno();
+
+    iovec iov[2] = {
+        { &hdr, sizeof(hdr) },
+        { payload.data(), payload.size() },
+    };
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * 3)] = {};
+    msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int) * 3);
+    std::memcpy(CMSG_DATA(c), stdio.data(), sizeof(int) * 3);
+
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+        int err = errno;
+        ::close(fd);
+        return fail_errno(err);
+    }
+
+    // A daemon still busy with another call leaves this one queued, run it locally instead
+    pollfd pfd = { fd, POLLIN, 0 };
+    int ready;
+    do {
+        ready = poll(&pfd, 1, accept_timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+
+    wire_reply_t accept = {};
+    if (ready <= 0
+        || recv(fd, &accept, sizeof(accept), 0) != static_cast<ssize_t>(sizeof(accept))
+        || accept.magic != wire_accept) {
+        ::close(fd);
+        return fail_errno(ready == 0 ? ETIMEDOUT : ECONNRESET);
+    }
+
+    // Once the daemon has this, it runs the call and we never fall back
+    if (send(fd, &accept, sizeof(accept), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(accept))) {
+        ::close(fd);
+        return fail_errno(ECONNRESET);
+    }
+
+    wire_reply_t reply = {};
+    ssize_t got;
+    do {
+        got = recv(fd, &reply, sizeof(reply), 0);
+    } while (got < 0 && errno == EINTR);
+    ::close(fd);
+
+    if (got != static_cast<ssize_t>(sizeof(reply)) || reply.magic != wire_magic) {
+        std::cerr << "sigilvm daemon: connection lost" << std::endl;
+        exit_code = 1;
+        return {};
+    }
+
+    exit_code = reply.exit_code;
+    return {};
+}
+
+} // namespace sigil::platform
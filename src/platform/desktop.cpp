@@ -1,15 +1,35 @@
 #include "sigil/platform/app.h"
 #include "sigil/platform/paths.h"
+#include <sigil/platform/desktop_ipc.h>
 #include <sigil/platform/desktop.h>
+#include <sigil/platform/theme_template.h>
+#include <sigil/platform/exec_graph.h>
 #include <sigil/platform/exec.h>
 #include <sigil/platform/fs.h>
+#include <sigil/platform/io.h>
+#include <sigil/math/hash.h>
 #include <sigil/common.h>
 
+#include <string_view>
 #include <filesystem>
-#include <string>
+#include <algorithm>
+#include <charconv>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <ctime>
+
+#include <sys/stat.h>
+#include <sys/file.h>
 #include <unistd.h>
+#include <signal.h>
 #include <fcntl.h>
+#include <cerrno>
 
 namespace fs = std::filesystem;
 
@@ -32,165 +52,1454 @@ namespace sigil::desktop {
     return ::sigil::yield();
 }
 
-// Jank of shell invocations!
-::sigil::yield reload_components() {
+const std::vector<theme_component_t> &theme_components() {
+    static const std::vector<theme_component_t> components = {
+        { "alacritty", "alacritty"    },
+        { "hypr",      "hypr"         },
+        { "mako",      "mako"         },
+        { "shell",     "shell"        },
+        { "waybar",    "waybar-round" },
+        { "wofi",      "wofi"         },
+    };
+    return components;
+}
+
+// Drop files from dst that no longer exist in src, returns how many entries went away
+static std::size_t prune_component(const ::fs::path &src, const ::fs::path &dst) {
+    std::error_code ec;
+    std::vector<::fs::path> stale;
+
+    for (::fs::recursive_directory_iterator it(dst, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!::fs::exists(src / it->path().lexically_relative(dst), ec)) {
+            stale.push_back(it->path());
+            it.disable_recursion_pending();
+        }
+    }
+
+    for (const auto &p : stale)
+        ::fs::remove_all(p, ec);
+
+    return stale.size();
+}
+
+// Write content to dst unless it already holds exactly that, replaced by rename so watchers never see half a file
+static ::sigil::yield write_if_changed(const ::fs::path &dst, const std::string &content, ::fs::perms mode, bool &written) {
+    ::sigil::yield ret;
+    written = false;
+
+    std::error_code ec;
+    if (::fs::file_size(dst, ec) == content.size() && !ec) {
+        std::ifstream in(dst, std::ios::binary);
+        std::string current(content.size(), '\0');
+        if (in.read(current.data(), static_cast<std::streamsize>(current.size())) && current == content)
+            return ret;
+    }
+
+    ::fs::path tmp = dst;
+    tmp += ".tmp-" + std::to_string(getpid());
+
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        out.flush();
+        if (!out) {
+            ::fs::remove(tmp, ec);
+            return ret.set_state(sigil::yield_state::fail).set_code(EIO);
+        }
+    }
+
+    ::fs::permissions(tmp, mode, ec);
+    ::fs::rename(tmp, dst, ec);
+    if (ec) {
+        ::fs::remove(tmp, ec);
+        return ret.set_state(sigil::yield_state::fail).set_code(ec.value());
+    }
+
+    written = true;
+    return ret;
+}
+
+struct render_job_t {
+    const char *component;
+    ::fs::path src;
+    ::fs::path dst;
+};
+
+// Render templates under assets with the pattern into theme_dir, then refresh its manifest
+static ::sigil::yield render_theme(const ::fs::path &assets, const ::fs::path &pattern_file, const ::fs::path &theme_dir,
+                                   const std::vector<std::string> &components) {
+    ::sigil::yield ret;
+
+    theme_pattern_t pattern;
+    ret = load_theme_pattern(pattern_file, pattern);
+    if (ret.is_failure()) {
+        if (ret.code == ENOENT)
+            std::cerr << "[ERROR] Theme pattern not found: " << pattern_file << std::endl;
+        else
+            std::cerr << "[ERROR] Cannot read theme pattern: " << pattern_file << std::endl;
+        return ret;
+    }
+
+    // Walk the templates once, directories are created here, files rendered below
+    std::vector<render_job_t> jobs;
+
+    for (const auto &comp : theme_components()) {
+        if (!components.empty()
+            && std::find(components.begin(), components.end(), comp.name) == components.end())
+            continue;
+
+        const ::fs::path src = assets / "common" / comp.source;
+        const ::fs::path dst = theme_dir / comp.name;
+
+        if (!::fs::exists(src)) continue;
+
+        ::sigil::contain(ret, [&] {
+            ::fs::create_directories(dst);
+            for (const auto &entry : ::fs::recursive_directory_iterator(src)) {
+                const ::fs::path target = dst / entry.path().lexically_relative(src);
+                if (entry.is_directory())
+                    ::fs::create_directory(target);
+                else if (entry.is_regular_file())
+                    jobs.push_back({ comp.name, entry.path(), target });
+            }
+        });
+
+        prune_component(src, dst);
+    }
+
+    if (ret.is_failure())
+        return ret;
+
+    // Files are independent, components end up rendered side by side
+    std::atomic<std::size_t> next = 0;
+    std::atomic<std::size_t> rendered = 0, unchanged = 0;
+    std::mutex errors_lock;
+
+    auto fail = [&](const render_job_t &job, const ::sigil::yield &res, const std::string &what) {
+        std::lock_guard<std::mutex> guard(errors_lock);
+        std::cerr << "[ERROR] " << job.component << ": " << job.src.filename().string() << what
+                  << " (status " << res.code << ")\n";
+        ret |= res;
+    };
+
+    auto worker = [&] {
+        std::string out;
+        for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < jobs.size();) {
+            const render_job_t &job = jobs[i];
+
+            std::shared_ptr<const template_plan_t> plan;
+            ::sigil::yield res = load_template_plan(job.src, plan);
+            if (res.is_failure()) {
+                fail(job, res, res.code == EINVAL ? ": malformed {{ }} slot" : "");
+                continue;
+            }
+
+            // Nothing to substitute, keep cloning instead of rewriting
+            if (!plan->has_slots()) {
+                ::sigil::fs::copy_stats_t stats;
+                res = ::sigil::fs::clone_or_copy_file(job.src, job.dst, stats);
+                if (res.is_failure())
+                    fail(job, res, "");
+                else
+                    (stats.files_skipped ? unchanged : rendered).fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            std::string missing;
+            out.clear();
+            res = render_template(*plan, pattern, out, &missing);
+            if (res.is_failure()) {
+                fail(job, res, ": no usable value for '" + missing + "'");
+                continue;
+            }
+
+            std::error_code ec;
+            const ::fs::perms mode = ::fs::status(job.src, ec).permissions();
+
+            bool written = false;
+            res = write_if_changed(job.dst, out, mode, written);
+            if (res.is_failure())
+                fail(job, res, "");
+            else
+                (written ? rendered : unchanged).fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned workers = static_cast<unsigned>(std::min<std::size_t>(hw, jobs.size()));
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < workers; ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool)
+        t.join();
+
+    sigil::dcout << "[DEBUG] " << theme_dir.filename().string() << ": " << rendered.load() << " written, "
+                 << unchanged.load() << " unchanged" << std::endl;
+
+    // Hash what changed now, deploys only compare digests
+    theme_manifest_t manifest;
+    ret |= update_theme_manifest(theme_dir, manifest);
+    return ret;
+}
+
+::sigil::yield build_theme(const ::sigil::platform::app_descriptor_t &app, const std::string &name,
+                           const std::vector<std::string> &components) {
+    const ::fs::path assets = ::sigil::platform::get_theme_assets_root(app);
+    return render_theme(assets, assets / "patterns" / (name + ".yaml"),
+                        ::sigil::platform::get_sigilvm_data_root(app) / "themes" / name, components);
+}
+
+/*
+ * Manifests
+ *
+ * One line per file, sorted by path:
+ *   <xxh128 hex> <dev> <ino> <size> <mtime sec> <mtime nsec> <path>
+ * The path comes last so it may contain spaces.
+ */
+
+static constexpr std::string_view manifest_header = "# sigilvm theme manifest v1";
+static constexpr const char *manifest_name = ".manifest";
+
+static std::string digest_to_hex(const ::sigil::fs::file_digest_t &d) {
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string out(d.size() * 2, '0');
+    for (std::size_t i = 0; i < d.size(); ++i) {
+        out[i * 2]     = digits[d[i] >> 4];
+        out[i * 2 + 1] = digits[d[i] & 0xf];
+    }
+    return out;
+}
+
+static bool digest_from_hex(std::string_view hex, ::sigil::fs::file_digest_t &out) {
+    if (hex.size() != out.size() * 2)
+        return false;
+
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        const int hi = nibble(hex[i * 2]);
+        const int lo = nibble(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        out[i] = static_cast<uint8_t>(hi << 4 | lo);
+    }
+    return true;
+}
+
+// Digest of a regular file, from the digest cache when this key was hashed before
+static bool digest_file(const ::fs::path &p, const ::sigil::fs::file_key_t &key, ::sigil::fs::file_digest_t &out) {
+    if (::sigil::fs::digest_cache_lookup(key, out))
+        return true;
+
+    ::sigil::math::xxh128_payload_t hp;
+    hp.path = p;
+    if (::sigil::math::xxh128_hash(hp).is_failure())
+        return false;
+
+    out = hp.output;
+    ::sigil::fs::digest_cache_store(key, out);
+    return true;
+}
+
+static constexpr std::size_t digest_batch = 64;
+static constexpr uint64_t digest_batch_max_size = 256u << 10;   // larger files stream through digest_file
+
+// Digests of entries[pending], opened, read whole and closed a batch at a time through one io_service_t,
+// hashed in memory. Whatever the batch cannot take (too large, read short because it changed meanwhile,
+// no io_uring and no worker) goes through digest_file. Indices that could not be hashed land in failed
+static void digest_entries(const ::fs::path &root, std::vector<theme_manifest_entry_t> &entries,
+                           const std::vector<std::size_t> &pending, std::vector<std::size_t> &failed) {
+    ::sigil::fs::io_service_t io;
+    const bool batched = !pending.empty() && io.init().is_ok();
+
+    std::vector<std::size_t> single;
+    std::vector<std::size_t> batch;
+    std::vector<::fs::path> paths;
+    std::vector<std::string> buffers(digest_batch);
+    std::vector<::sigil::fs::io_request_t> reqs;
+
+    for (std::size_t first = 0; first < pending.size(); first += digest_batch) {
+        const std::size_t last = std::min(pending.size(), first + digest_batch);
+
+        batch.clear();
+        paths.clear();
+        for (std::size_t k = first; k < last; ++k) {
+            const std::size_t i = pending[k];
+            if (batched && entries[i].key.size <= digest_batch_max_size) {
+                batch.push_back(i);
+                paths.push_back(root / entries[i].path);
+            } else {
+                single.push_back(i);
+            }
+        }
+        if (batch.empty())
+            continue;
+
+        // Requests stay where they are until run() returns
+        reqs.assign(batch.size(), {});
+        for (std::size_t b = 0; b < batch.size(); ++b) {
+            reqs[b].op = ::sigil::fs::IO_OPENAT;
+            reqs[b].path = paths[b].c_str();
+            reqs[b].flags = O_RDONLY | O_CLOEXEC;
+        }
+        io.run(reqs.data(), reqs.size());
+
+        std::vector<int> fds(batch.size(), -1);
+        for (std::size_t b = 0; b < batch.size(); ++b)
+            fds[b] = reqs[b].result.is_ok() ? static_cast<int>(reqs[b].res) : -1;
+
+        // One byte past the recorded size, a file that grew reads long and is hashed again on its own
+        reqs.assign(batch.size(), {});
+        for (std::size_t b = 0; b < batch.size(); ++b) {
+            buffers[b].resize(entries[batch[b]].key.size + 1);
+            reqs[b].op = fds[b] >= 0 ? ::sigil::fs::IO_READ : ::sigil::fs::IO_NOP;
+            reqs[b].fd = fds[b];
+            reqs[b].buffer = buffers[b].data();
+            reqs[b].length = static_cast<uint32_t>(buffers[b].size());
+        }
+        io.run(reqs.data(), reqs.size());
+
+        for (std::size_t b = 0; b < batch.size(); ++b) {
+            const theme_manifest_entry_t &e = entries[batch[b]];
+            if (fds[b] < 0 || !reqs[b].result.is_ok() || static_cast<uint64_t>(reqs[b].res) != e.key.size) {
+                single.push_back(batch[b]);
+                continue;
+            }
+
+            ::sigil::math::xxh128_hash_bytes(buffers[b].data(), e.key.size, entries[batch[b]].digest);
+            ::sigil::fs::digest_cache_store(e.key, e.digest);
+        }
+
+        reqs.assign(batch.size(), {});
+        for (std::size_t b = 0; b < batch.size(); ++b) {
+            reqs[b].op = fds[b] >= 0 ? ::sigil::fs::IO_CLOSE : ::sigil::fs::IO_NOP;
+            reqs[b].fd = fds[b];
+        }
+        io.run(reqs.data(), reqs.size());
+    }
+
+    for (const std::size_t i : single) {
+        if (!digest_file(root / entries[i].path, entries[i].key, entries[i].digest))
+            failed.push_back(i);
+    }
+}
+
+static bool entry_less(const theme_manifest_entry_t &a, const theme_manifest_entry_t &b) {
+    return a.path < b.path;
+}
+
+const theme_manifest_entry_t *theme_manifest_t::find(std::string_view path) const {
+    auto it = std::lower_bound(entries.begin(), entries.end(), path,
+        [](const theme_manifest_entry_t &e, std::string_view p) { return e.path < p; });
+    if (it == entries.end() || it->path != path)
+        return nullptr;
+    return &*it;
+}
+
+::sigil::yield theme_manifest_t::load(const ::fs::path &file) {
+    ::sigil::yield ret;
+    entries.clear();
+
+    std::ifstream in(file);
+    if (!in)
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOENT);
+
+    std::string line;
+    if (!std::getline(in, line) || line != manifest_header)
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+
+    while (std::getline(in, line)) {
+        if (line.empty())
+            continue;
+
+        theme_manifest_entry_t e;
+        std::istringstream fields(line);
+        std::string hex;
+
+        fields >> hex >> e.key.dev >> e.key.ino >> e.key.size >> e.key.mtime_sec >> e.key.mtime_nsec;
+        fields.get();
+        std::getline(fields, e.path);
+
+        if (!fields || e.path.empty() || !digest_from_hex(hex, e.digest)) {
+            entries.clear();
+            return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+        }
+
+        entries.push_back(std::move(e));
+    }
+
+    if (!std::is_sorted(entries.begin(), entries.end(), entry_less))
+        std::sort(entries.begin(), entries.end(), entry_less);
+
+    return ret;
+}
+
+::sigil::yield theme_manifest_t::save(const ::fs::path &file) const {
+    ::sigil::yield ret;
+
+    std::error_code ec;
+    if (file.has_parent_path())
+        ::fs::create_directories(file.parent_path(), ec);
+
+    // Written aside and renamed over, a reader never sees half a manifest
+    ::fs::path tmp = file;
+    tmp += ".tmp";
+
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out)
+            return ret.set_state(sigil::yield_state::fail).set_code(errno ? errno : EIO);
+
+        out << manifest_header << '\n';
+        for (const auto &e : entries) {
+            out << digest_to_hex(e.digest) << ' '
+                << e.key.dev << ' ' << e.key.ino << ' ' << e.key.size << ' '
+                << e.key.mtime_sec << ' ' << e.key.mtime_nsec << ' '
+                << e.path << '\n';
+        }
+
+        out.flush();
+        if (!out) {
+            ::fs::remove(tmp, ec);
+            return ret.set_state(sigil::yield_state::fail).set_code(EIO);
+        }
+    }
+
+    ::fs::rename(tmp, file, ec);
+    if (ec) {
+        ::fs::remove(tmp, ec);
+        return ret.set_state(sigil::yield_state::fail).set_code(ec.value());
+    }
+
+    return ret;
+}
+
+// Manifest of every regular file under root, digests reused from previous while keys match
+static ::sigil::yield scan_manifest(const ::fs::path &root, const theme_manifest_t &previous, theme_manifest_t &out) {
+    ::sigil::yield ret;
+    out.entries.clear();
+
+    // Entries no digest is known for, hashed together once the walk is done
+    std::vector<std::size_t> pending;
+
+    std::error_code ec;
+    for (::fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code type_ec;
+        if (it->is_symlink(type_ec) || !it->is_regular_file(type_ec))
+            continue;
+
+        theme_manifest_entry_t e;
+        e.path = it->path().lexically_relative(root).generic_string();
+        if (e.path == manifest_name || !::sigil::fs::get_file_key(it->path(), e.key))
+            continue;
+
+        const theme_manifest_entry_t *old = previous.find(e.path);
+        if (old && old->key == e.key) {
+            e.digest = old->digest;
+            ::sigil::fs::digest_cache_store(e.key, e.digest);
+        } else if (!::sigil::fs::digest_cache_lookup(e.key, e.digest)) {
+            pending.push_back(out.entries.size());
+        }
+
+        out.entries.push_back(std::move(e));
+    }
+
+    if (ec) {
+        out.entries.clear();
+        return ret.set_state(sigil::yield_state::fail).set_code(ec.value());
+    }
+
+    std::vector<std::size_t> failed;
+    digest_entries(root, out.entries, pending, failed);
+    if (!failed.empty()) {
+        for (const std::size_t i : failed)
+            std::cerr << "[ERROR] Cannot hash " << (root / out.entries[i].path) << std::endl;
+        ret.set_state(sigil::yield_state::fail).set_code(EIO);
+
+        // Erased from the back, earlier indices stay valid
+        std::sort(failed.begin(), failed.end());
+        for (auto it = failed.rbegin(); it != failed.rend(); ++it)
+            out.entries.erase(out.entries.begin() + static_cast<std::ptrdiff_t>(*it));
+    }
+
+    std::sort(out.entries.begin(), out.entries.end(), entry_less);
+    return ret;
+}
+
+::sigil::yield update_theme_manifest(const ::fs::path &theme_dir, theme_manifest_t &out) {
+    ::sigil::yield ret;
+    out.entries.clear();
+
+    std::error_code ec;
+    if (!::fs::is_directory(theme_dir, ec))
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOENT);
+
+    const ::fs::path manifest_file = theme_dir / manifest_name;
+
+    // No manifest yet just means every file gets hashed
+    theme_manifest_t previous;
+    previous.load(manifest_file);
+
+    ret = scan_manifest(theme_dir, previous, out);
+    if (ret.is_failure() && out.entries.empty())
+        return ret;
+
+    if (out.entries != previous.entries)
+        ret |= out.save(manifest_file);
+
+    return ret;
+}
+
+// Fallback for sessions where the Hyprland socket cannot be found (no HYPRLAND_INSTANCE_SIGNATURE
+// in the environment, Hyprland older than the socket layout): spawn the reload tools instead,
+// independent ones side by side, only waybar waits for pkill
+static ::sigil::yield reload_components_spawned(bool hypr, bool mako, bool waybar) {
+    ::sigil::platform::exec_graph_t graph;
     ::sigil::platform::proc_exec_unit_t peu;
-    ::sigil::yield st;
 
-    // PEU setup to redirect outputs + wait for process to return
+    // PEU setup to redirect outputs, every step is awaited unless detached
     peu.set_stdio_mode(platform::STDIO_NULL, platform::STDIO_NULL, platform::STDIO_NULL);
     peu.set_exec_mode(platform::EXEC_WAIT);
 
     // First, check if Hyprland is currently active, and skip if not
     peu.set_target("pgrep").push_argument("-x").push_argument("Hyprland");
-    platform::execute(peu);
+    const std::size_t hyprland = graph.add("pgrep Hyprland", peu, {}, true);
+
+    if (mako) {
+        peu.clean();
+        peu.set_target("makoctl").push_argument("reload");
+        graph.add("makoctl reload", peu, { hyprland });
+    }
+
+    if (hypr) {
+        peu.clean();
+        peu.set_target("hyprctl").push_argument("reload");
+        graph.add("hyprctl reload", peu, { hyprland });
+
+        peu.clean();
+        peu.set_target("/usr/share/sigilvm/scripts/wallpaperctl.sh");
+        peu.push_argument("default");
+        graph.add("wallpaperctl", peu, { hyprland });
+    }
+
+    if (waybar) {
+        peu.clean();
+        peu.set_target("pkill").push_argument("waybar");
+        const std::size_t kill_waybar = graph.add("pkill waybar", peu, { hyprland });
+
+        peu.clean();
+        peu.set_target("waybar").set_exec_mode(platform::EXEC_DETACH);
+        graph.add("waybar", peu, { kill_waybar });
+    }
 
-    if (peu.result.exit_code != 0) {
+    ::sigil::yield st = graph.run();
+
+    if (graph.nodes[hyprland].peu.result.exit_code != 0) {
         std::cout << "[INFO] Hyprland not detected, skipping reload." << std::endl;
         return st;
     }
 
-    peu.clean();
-    peu.set_target("makoctl").push_argument("reload");
-    platform::execute(peu);
+    sigil::dcout << "[DEBUG] Reload timings (* critical path):\n" << graph.timings() << std::flush;
+    return st;
+}
 
-    peu.clean();
-    peu.set_target("hyprctl").push_argument("reload");
-    platform::execute(peu);
+::sigil::yield reload_components(const ::sigil::platform::app_descriptor_t &app, const std::vector<std::string> &components) {
+    auto wanted = [&](const char *name) {
+        return components.empty() || std::find(components.begin(), components.end(), name) != components.end();
+    };
 
-    peu.clean();
-    peu.set_target("kvantummanager").push_argument("--set").push_argument("sigilvm");
-    platform::execute(peu);
+    const bool hypr = wanted("hypr");
+    const bool mako = wanted("mako");
+    const bool waybar = wanted("waybar");
+    const bool kvantum = wanted("Kvantum");
 
-    peu.clean();
-    peu.set_target("pkill").push_argument("waybar");
-    platform::execute(peu);
+    // alacritty, wofi and the shell pick their files up on their own
+    if (!hypr && !mako && !waybar && !kvantum)
+        return {};
 
-    peu.clean();
-    peu.set_target("/usr/share/sigilvm/scripts/wallpaperctl.sh");
-    peu.push_argument("default");
-    platform::execute(peu);
+    ::sigil::yield ret;
+    const ::fs::path config_dir = ::sigil::platform::get_config_root(app);
 
-    peu.clean();
-    peu.set_target("waybar").set_exec_mode(platform::EXEC_DETACH);
-    platform::execute(peu);
+    // Kvantum has nothing running to notify, Qt apps read the selection on start
+    if (kvantum) {
+        bool selected = false;
+        ret |= kvantum_select_theme(config_dir, "sigilvm", selected);
+    }
 
-    return st;
+    hypr_instance_t instance;
+    if (!find_hypr_instance(app.process, instance))
+        return ret |= reload_components_spawned(hypr, mako, waybar);
+
+    if (hypr) {
+        ::sigil::yield st = hypr_dispatch(instance, "reload");
+        if (st.code == ECONNREFUSED) {
+            std::cout << "[INFO] Hyprland not detected, skipping reload." << std::endl;
+            return ret;
+        }
+        ret |= st;
+
+        // What wallpaperctl.sh default did, minus the shell and the hyprctl calls
+        const ::fs::path wallpaper = config_dir / "hypr" / "default.jpg";
+        std::error_code ec;
+        if (::fs::exists(wallpaper, ec)) {
+            st = hyprpaper_wallpaper(instance, wallpaper);
+            if (st.is_failure())
+                sigil::dcout << "[DEBUG] Wallpaper not set, hyprpaper error " << st.code << std::endl;
+        }
+    }
+
+    // SIGUSR2 makes waybar re-read config and style in place, start it only when none runs
+    if (waybar && signal_processes("waybar", SIGUSR2) == 0) {
+        ::sigil::platform::proc_exec_unit_t peu;
+        peu.set_stdio_mode(platform::STDIO_NULL, platform::STDIO_NULL, platform::STDIO_NULL);
+        peu.set_target("waybar").set_exec_mode(platform::EXEC_DETACH);
+        ret |= ::sigil::platform::execute(peu);
+    }
+
+    // mako only takes reload requests over D-Bus, makoctl is the one spawn left
+    if (mako) {
+        ::sigil::platform::proc_exec_unit_t peu;
+        peu.set_stdio_mode(platform::STDIO_NULL, platform::STDIO_NULL, platform::STDIO_NULL);
+        peu.set_exec_mode(platform::EXEC_WAIT);
+        peu.set_target("makoctl").push_argument("reload");
+        ret |= ::sigil::platform::execute(peu);
+    }
+
+    return ret;
+}
+
+/*
+ * Generations
+ *
+ * Components are copied once per distinct content into
+ * <sigilvm data>/generations/<component>/<digest>, made read-only,
+ * and ~/.config only holds symlinks to them. <sigilvm state>/themes/generation
+ * lists the links currently in place, generation.prev the set before that.
+ * A switch prunes every generation neither of them points into.
+ */
+
+struct generation_link_t {
+    std::string component;      // as passed to reload_components
+    std::string link;           // path under ~/.config
+    ::fs::path target;
+};
+
+static constexpr std::string_view generation_header = "# sigilvm theme generation v1";
+
+static bool load_generation(const ::fs::path &file, std::vector<generation_link_t> &out) {
+    out.clear();
+
+    std::ifstream in(file);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != generation_header)
+        return false;
+
+    while (std::getline(in, line)) {
+        if (line.empty())
+            continue;
+
+        generation_link_t l;
+        std::istringstream fields(line);
+        std::string target;
+        fields >> l.component >> l.link;
+        fields.get();
+        std::getline(fields, target);
+
+        if (!fields || target.empty()) {
+            out.clear();
+            return false;
+        }
+
+        l.target = target;
+        out.push_back(std::move(l));
+    }
+
+    return !out.empty();
 }
 
-::sigil::yield deploy_theme_from_path(const ::sigil::platform::app_descriptor_t &app, std::filesystem::path theme_dir) {
+static ::sigil::yield save_generation(const ::fs::path &file, const std::vector<generation_link_t> &links) {
     ::sigil::yield ret;
 
-    if (!::fs::exists(theme_dir)) {
-        std::cerr << "[ERROR] Theme not found: " << theme_dir << std::endl;
-        return ret.set_state(sigil::yield_state::fail);
-        // return sigil::VM_RESOURCE_MISSING;
+    std::error_code ec;
+    ::fs::create_directories(file.parent_path(), ec);
+
+    ::fs::path tmp = file;
+    tmp += ".tmp";
+
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << generation_header << '\n';
+        for (const auto &l : links)
+            out << l.component << ' ' << l.link << ' ' << l.target.string() << '\n';
+
+        out.flush();
+        if (!out) {
+            ::fs::remove(tmp, ec);
+            return ret.set_state(sigil::yield_state::fail).set_code(EIO);
+        }
     }
 
-    //::fs::path user_config_dir = ::sigil::fs::get_home_path() / ".config";
-    ::fs::path user_config_dir = ::sigil::platform::get_config_root(app.process);
+    ::fs::rename(tmp, file, ec);
+    if (ec)
+        return ret.set_state(sigil::yield_state::fail).set_code(ec.value());
 
-    ::std::vector<::std::string> sigil_desktop_components = {
-        "alacritty",
-        "hypr",
-        "mako",
-        "waybar",
-        "wofi",
+    return ret;
+}
+
+// Digest over salt and every (path, file digest) under comp/, or under the root when comp is empty.
+// Names generations and theme variants.
+static std::string manifest_digest(const theme_manifest_t &manifest, std::string_view comp, std::string_view salt = {}) {
+    uint64_t lo = 0xcbf29ce484222325ULL;
+    uint64_t hi = 0x84222325cbf29ce4ULL;
+
+    auto step = [&](uint8_t b) {
+        lo = (lo ^ b) * 0x100000001b3ULL;
+        hi = (hi ^ b) * 0x100000001b3ULL + 0x9e3779b97f4a7c15ULL;
     };
 
-    bool keep_backup = false;
-    std::cout << "[THEME] Applying: " << theme_dir.c_str() << std::endl;
+    for (char c : salt) step(static_cast<uint8_t>(c));
 
-    for (const auto& comp : sigil_desktop_components) {
-        ::fs::path src = theme_dir / comp;
-        ::fs::path dst = user_config_dir / comp;
+    for (const auto &e : manifest.entries) {
+        std::string_view path = e.path;
+        if (!comp.empty()) {
+            if (path.size() <= comp.size() || !path.starts_with(comp) || path[comp.size()] != '/')
+                continue;
+            path.remove_prefix(comp.size() + 1);
+        }
 
-        if (!::fs::exists(src)) continue;
+        for (char c : path) step(static_cast<uint8_t>(c));
+        step(0);
+        for (uint8_t b : e.digest) step(b);
+    }
 
-        if (::fs::exists(dst)) {
-            if (keep_backup) {
-                auto timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+    ::sigil::fs::file_digest_t d;
+    for (int i = 0; i < 8; ++i) {
+        d[i]     = static_cast<uint8_t>(lo >> (i * 8));
+        d[i + 8] = static_cast<uint8_t>(hi >> (i * 8));
+    }
+    return digest_to_hex(d);
+}
+
+// Copy src to gen once, published by renaming a finished staging directory
+static ::sigil::yield materialize_generation(const ::fs::path &src, const ::fs::path &gen) {
+    ::sigil::yield ret;
+
+    std::error_code ec;
+    if (::fs::is_directory(gen, ec))
+        return ret;
+
+    ::fs::path staging = gen;
+    staging += ".tmp-" + std::to_string(getpid());
+    ::fs::remove_all(staging, ec);
+
+    ::sigil::fs::copy_stats_t stats;
+    ret = ::sigil::fs::copy_tree(src, staging, stats);
+    if (ret.is_failure()) {
+        ::fs::remove_all(staging, ec);
+        return ret;
+    }
+
+    // Edits belong in the templates or an --in-place deploy, not in a shared generation
+    for (::fs::recursive_directory_iterator it(staging, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code type_ec;
+        if (it->is_regular_file(type_ec))
+            ::fs::permissions(it->path(), ::fs::perms::owner_write | ::fs::perms::group_write | ::fs::perms::others_write,
+                              ::fs::perm_options::remove, type_ec);
+    }
+
+    if (::rename(staging.c_str(), gen.c_str()) != 0) {
+        const int err = errno;
+        ::fs::remove_all(staging, ec);
+        // Someone else published the same content first
+        if (::fs::is_directory(gen, ec))
+            return ret;
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    }
+
+    sigil::dcout << "[DEBUG] New generation " << gen << ": "
+                 << stats.files_cloned << " cloned, " << stats.files_copied << " copied" << std::endl;
+    return ret;
+}
+
+// Move something that was in the way to backup_dir, next to it when that is another filesystem
+static ::fs::path stash_original(const ::fs::path &from, const ::fs::path &link, const ::fs::path &backup_dir) {
+    std::error_code ec;
+    ::fs::create_directories(backup_dir, ec);
+
+    ::fs::path backup = backup_dir / link.filename();
+    if (::fs::exists(::fs::symlink_status(backup, ec)))
+        backup += "-" + std::to_string(std::time(nullptr));
+
+    if (::rename(from.c_str(), backup.c_str()) != 0) {
+        backup = link;
+        backup += ".orig-" + std::to_string(std::time(nullptr));
+        if (::rename(from.c_str(), backup.c_str()) != 0)
+            return {};
+    }
+
+    return backup;
+}
+
+// Point link at target with one rename, readers never see it missing or half-written
+static ::sigil::yield flip_link(const ::fs::path &link, const ::fs::path &target, const ::fs::path &backup_dir, bool &flipped) {
+    ::sigil::yield ret;
+    flipped = false;
+
+    std::error_code ec;
+    const ::fs::path current = ::fs::read_symlink(link, ec);
+    if (!ec && current == target)
+        return ret;
+
+    ::fs::create_directories(link.parent_path(), ec);
+
+    ::fs::path tmp = link;
+    tmp += ".sigil-" + std::to_string(getpid());
+    ::unlink(tmp.c_str());
+
+    if (::symlink(target.c_str(), tmp.c_str()) != 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    struct stat st{};
+    const bool occupied = ::lstat(link.c_str(), &st) == 0;
+
+    if (!occupied || S_ISLNK(st.st_mode)) {
+        // Renaming over a symlink replaces it atomically
+        if (::rename(tmp.c_str(), link.c_str()) != 0) {
+            const int err = errno;
+            ::unlink(tmp.c_str());
+            return ret.set_state(sigil::yield_state::fail).set_code(err);
+        }
+        flipped = true;
+        return ret;
+    }
+
+    // A real directory or file, swap it with the link and keep it
+    ::fs::path backup;
+    if (::renameat2(AT_FDCWD, tmp.c_str(), AT_FDCWD, link.c_str(), RENAME_EXCHANGE) == 0) {
+        backup = stash_original(tmp, link, backup_dir);
+        if (backup.empty())
+            backup = tmp;
+    } else {
+        // No exchange on this filesystem, a short gap instead of a mixed state
+        backup = stash_original(link, link, backup_dir);
+        if (backup.empty() || ::rename(tmp.c_str(), link.c_str()) != 0) {
+            const int err = errno;
+            ::unlink(tmp.c_str());
+            return ret.set_state(sigil::yield_state::fail).set_code(err);
+        }
+    }
+
+    std::cout << "[BACKUP] " << link << " → " << backup << std::endl;
+    flipped = true;
+    return ret;
+}
+
+// ~/.config/Kvantum/sigilvm points at the theme's Kvantum theme, link stays empty when there is none
+static ::sigil::yield kvantum_link(const ::fs::path &theme_dir, generation_link_t &out) {
+    std::error_code ec;
+    const ::fs::path src = theme_dir / "Kvantum";
+    if (!::fs::exists(src, ec))
+        return {};
+
+    const ::fs::path target = src / ("sigil-" + theme_dir.filename().string());
+    if (!::fs::exists(target, ec)) {
+        std::cerr << "[WARN] Kvantum source theme missing: " << target << std::endl;
+        return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(ENOENT);
+    }
+
+    out = { "Kvantum", "Kvantum/sigilvm", target };
+    return {};
+}
+
+// Components mirrored from a built theme into ~/.config
+static const char *const deployed_components[] = {
+    "alacritty",
+    "hypr",
+    "mako",
+    "waybar",
+    "wofi",
+};
+
+// Path under ~/.config a theme file goes to, empty when it is not deployed
+static std::string deploy_target(std::string_view path) {
+    if (path == "shell/starship.toml")
+        return "starship.toml";
+
+    for (std::string_view comp : deployed_components) {
+        if (path.size() > comp.size() && path.starts_with(comp) && path[comp.size()] == '/')
+            return std::string(path);
+    }
+    return {};
+}
+
+::sigil::yield deploy_theme_files(const ::sigil::platform::app_descriptor_t &app, const ::fs::path &theme_dir,
+                                  std::vector<std::string> &changed) {
+    ::sigil::yield ret;
+    changed.clear();
+
+    auto mark = [&](std::string_view comp) {
+        if (std::find(changed.begin(), changed.end(), comp) == changed.end())
+            changed.emplace_back(comp);
+    };
+
+    theme_manifest_t theme;
+    ret = update_theme_manifest(theme_dir, theme);
+    if (ret.is_failure()) {
+        std::cerr << "[ERROR] Cannot index theme " << theme_dir << " (status " << ret.code << ")\n";
+        return ret;
+    }
+
+    const ::fs::path config_dir = ::sigil::platform::get_config_root(app);
+    const ::fs::path state_file = ::sigil::platform::get_sigilvm_state_root(app) / "themes" / "deployed.manifest";
+
+    // Whatever the last deploy wrote, a missing state only costs a few extra reads
+    theme_manifest_t deployed, next;
+    deployed.load(state_file);
+
+    std::error_code ec;
+    std::size_t written = 0, removed = 0;
+
+    for (std::string_view comp : deployed_components) {
+        const ::fs::path src = theme_dir / comp;
+        const ::fs::path dst = config_dir / comp;
+
+        if (!::fs::is_directory(src, ec))
+            continue;
+
+        // A linked config directory is replaced, as a full redeploy used to do
+        if (::fs::is_symlink(dst, ec)) {
+            ::fs::remove(dst, ec);
+            mark(comp);
+        }
+
+        if (::fs::exists(dst, ec)) {
+            const std::size_t n = prune_component(src, dst);
+            if (n > 0) {
+                removed += n;
+                mark(comp);
+            }
+        }
+    }
+
+    for (const auto &e : theme.entries) {
+        const std::string target = deploy_target(e.path);
+        if (target.empty())
+            continue;
+
+        const std::string_view comp = std::string_view(e.path).substr(0, e.path.find('/'));
+        const ::fs::path src = theme_dir / e.path;
+        const ::fs::path dst = config_dir / target;
+
+        // A link into a generation goes, writing through it would alter the generation
+        if (target.find('/') == std::string::npos && ::fs::is_symlink(dst, ec))
+            ::fs::remove(dst, ec);
+
+        theme_manifest_entry_t d;
+        d.path = target;
+
+        // Files untouched since the last deploy are judged by the state manifest,
+        // anything else present at dst is hashed once
+        const theme_manifest_entry_t *last = deployed.find(target);
+        const bool present = ::sigil::fs::get_file_key(dst, d.key);
+        const bool ours = present && last && last->key == d.key;
+        bool current = false;
+
+        if (ours)
+            current = last->digest == e.digest;
+        else if (present)
+            current = digest_file(dst, d.key, d.digest) && d.digest == e.digest;
+
+        if (!current) {
+            if (present && !ours && target == "starship.toml") {
                 ::fs::path backup = dst;
-                backup += ".bak-" + std::to_string(timestamp);
-                ::fs::rename(dst, backup);
+                backup += ".bak";
+                ::fs::copy_file(dst, backup, ::fs::copy_options::overwrite_existing, ec);
                 std::cout << "[BACKUP] " << dst << " → " << backup << std::endl;
-            } else {
-                std::cout << "[REMOVE] " << dst << std::endl;
-                ::fs::remove_all(dst);
             }
+
+            ::fs::create_directories(dst.parent_path(), ec);
+
+            ::sigil::fs::copy_stats_t stats;
+            ::sigil::yield res = ::sigil::fs::clone_or_copy_file(src, dst, stats, false);
+            if (res.is_failure()) {
+                std::cerr << "[ERROR] Failed to write " << dst << " (status " << res.code << ")\n";
+                ret |= res;
+                continue;
+            }
+
+            if (::sigil::fs::get_file_key(dst, d.key))
+                ::sigil::fs::digest_cache_store(d.key, e.digest);
+
+            sigil::dcout << "[DEBUG] wrote " << target << std::endl;
+            written++;
+            mark(comp);
         }
 
-        ::sigil::yield res = ::sigil::fs::copy_tree(src, dst);
+        d.digest = e.digest;
+        next.entries.push_back(std::move(d));
+    }
+
+    std::sort(next.entries.begin(), next.entries.end(), entry_less);
+    if (next.entries != deployed.entries)
+        ret |= next.save(state_file);
+
+    generation_link_t kvantum;
+    ::sigil::yield kv = kvantum_link(theme_dir, kvantum);
+    if (kv.is_failure())
+        return ret |= kv;
+
+    if (!kvantum.link.empty()) {
+        bool flipped = false;
+        kv = flip_link(config_dir / kvantum.link, kvantum.target,
+                       ::sigil::platform::get_sigilvm_state_root(app) / "themes" / "original", flipped);
+        if (kv.is_failure())
+            return ret |= kv;
+        if (flipped)
+            mark(kvantum.component);
+    }
+
+    std::cout << "[OK] " << written << " written, " << removed << " removed, "
+              << next.entries.size() - written << " unchanged\n";
+    return ret;
+}
+
+// Flip links to the given set, components that moved are added to changed
+static ::sigil::yield apply_generation(const ::sigil::platform::app_descriptor_t &app,
+                                       const std::vector<generation_link_t> &links, std::vector<std::string> &changed) {
+    ::sigil::yield ret;
+
+    const ::fs::path config_dir = ::sigil::platform::get_config_root(app);
+    const ::fs::path backup_dir = ::sigil::platform::get_sigilvm_state_root(app) / "themes" / "original";
+
+    for (const auto &l : links) {
+        bool flipped = false;
+        ::sigil::yield res = flip_link(config_dir / l.link, l.target, backup_dir, flipped);
         if (res.is_failure()) {
-            std::cerr << "[ERROR] Failed to copy " << comp << " (status " << res.code << ")\n";
-            return res;
+            std::cerr << "[ERROR] Cannot link " << config_dir / l.link << " (status " << res.code << ")\n";
+            ret |= res;
+            continue;
         }
 
-        std::cout << "[OK] " << comp << " applied.\n";
+        if (flipped && std::find(changed.begin(), changed.end(), l.component) == changed.end())
+            changed.push_back(l.component);
     }
 
-    // Handle starship.toml
-    ::fs::path new_starship = theme_dir / "shell" / "starship.toml";
-    ::fs::path user_starship = user_config_dir / "starship.toml";
-    if (::fs::exists(new_starship)) {
-        if (::fs::exists(user_starship)) {
-            if (!sigil::fs::files_are_identical(new_starship, user_starship)) {
-                ::fs::path backup = user_starship;
-                backup += ".bak";
-                ::fs::copy_file(user_starship, backup, ::fs::copy_options::overwrite_existing);
-                ::fs::copy_file(new_starship, user_starship, ::fs::copy_options::overwrite_existing);
-                std::cout << "[UPDATE] starship.toml replaced, backup → " << backup << std::endl;
-            } else {
-                std::cout << "[INFO] starship.toml already matches.\n";
-            }
-        } else {
-            ::fs::copy_file(new_starship, user_starship);
-            std::cout << "[CREATE] starship.toml created from theme.\n";
+    return ret;
+}
+
+// Held across staging, flipping and pruning, so a concurrent switch never prunes what another one staged
+struct generation_lock_t {
+    int fd = -1;
+
+    explicit generation_lock_t(const ::fs::path &generations) {
+        std::error_code ec;
+        ::fs::create_directories(generations, ec);
+        fd = ::open((generations / ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd >= 0)
+            while (::flock(fd, LOCK_EX) != 0 && errno == EINTR) {}
+    }
+
+    ~generation_lock_t() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    generation_lock_t(const generation_lock_t&) = delete;
+    generation_lock_t& operator=(const generation_lock_t&) = delete;
+};
+
+// <generations>/<component>/<digest> a link points into, empty for targets outside generations
+static ::fs::path generation_dir_of(const ::fs::path &generations, const ::fs::path &target) {
+    const ::fs::path rel = target.lexically_relative(generations);
+    auto it = rel.begin();
+    if (rel.empty() || it == rel.end() || *it == "..")
+        return {};
+    const ::fs::path comp = *it++;
+    if (it == rel.end())
+        return {};
+    return generations / comp / *it;
+}
+
+// Only the current and the previous record can be linked again, every other generation goes
+static std::size_t prune_generations(const ::fs::path &generations, const std::vector<generation_link_t> &current,
+                                     const std::vector<generation_link_t> &previous) {
+    std::vector<::fs::path> keep;
+    for (const auto *set : { &current, &previous })
+        for (const auto &l : *set)
+            if (::fs::path d = generation_dir_of(generations, l.target); !d.empty())
+                keep.push_back(std::move(d));
+
+    std::size_t removed = 0;
+    std::error_code ec;
+    for (const auto &comp : ::fs::directory_iterator(generations, ec)) {
+        if (!comp.is_directory(ec))
+            continue;
+
+        for (const auto &gen : ::fs::directory_iterator(comp.path(), ec)) {
+            if (std::find(keep.begin(), keep.end(), gen.path()) != keep.end())
+                continue;
+
+            // Staging leftovers included, the lock rules out one being filled right now
+            std::error_code rm_ec;
+            ::fs::remove_all(gen.path(), rm_ec);
+            if (!rm_ec)
+                removed++;
         }
     }
+    return removed;
+}
 
-    // Kvantum linking (best-effort)
-    ::fs::path kvantum_theme_src = theme_dir / "Kvantum";
-    ::fs::path kvantum_config_dir = user_config_dir / "Kvantum";
-    ::std::string kvantum_link_name = "sigilvm";
-    ::fs::path kvantum_link_path = kvantum_config_dir / kvantum_link_name;
+::sigil::yield switch_theme_generation(const ::sigil::platform::app_descriptor_t &app, const ::fs::path &theme_dir,
+                                       std::vector<std::string> &changed) {
+    ::sigil::yield ret;
+    changed.clear();
 
-    if (::fs::exists(kvantum_theme_src)) {
-        std::error_code ec;
-        ::fs::create_directories(kvantum_config_dir, ec);
-        if (ec) {
-            std::cerr << "[ERROR] Cannot create Kvantum config dir: " << kvantum_config_dir << std::endl;
-            return ret.set_state(sigil::yield_state::fail);
-            // return sigil::VM_IO_ERROR;
+    theme_manifest_t theme;
+    ret = update_theme_manifest(theme_dir, theme);
+    if (ret.is_failure()) {
+        std::cerr << "[ERROR] Cannot index theme " << theme_dir << " (status " << ret.code << ")\n";
+        return ret;
+    }
+
+    const ::fs::path generations = ::sigil::platform::get_sigilvm_data_root(app) / "generations";
+    const ::fs::path state_dir = ::sigil::platform::get_sigilvm_state_root(app) / "themes";
+    const generation_lock_t lock(generations);
+
+    // Stage everything before the first link moves
+    std::vector<generation_link_t> links;
+    std::error_code ec;
+
+    auto stage = [&](std::string_view comp) -> ::sigil::yield {
+        const ::fs::path src = theme_dir / comp;
+        if (!::fs::is_directory(src, ec))
+            return {};
+
+        const ::fs::path gen = generations / comp / manifest_digest(theme, comp);
+        ::sigil::yield res = materialize_generation(src, gen);
+        if (res.is_failure()) {
+            std::cerr << "[ERROR] Cannot stage " << gen << " (status " << res.code << ")\n";
+            return res;
+        }
+
+        if (comp != "shell")
+            links.push_back({ std::string(comp), std::string(comp), gen });
+        else if (::fs::exists(gen / "starship.toml", ec))
+            links.push_back({ "shell", "starship.toml", gen / "starship.toml" });
+        return {};
+    };
+
+    for (std::string_view comp : deployed_components) {
+        ret |= stage(comp);
+    }
+    ret |= stage("shell");
+
+    generation_link_t kvantum;
+    ret |= kvantum_link(theme_dir, kvantum);
+    if (ret.is_failure())
+        return ret;
+    if (!kvantum.link.empty())
+        links.push_back(kvantum);
+
+    ret |= apply_generation(app, links, changed);
+
+    // Links this theme does not provide stay where they are, keep them in the record
+    std::vector<generation_link_t> previous;
+    const bool had_previous = load_generation(state_dir / "generation", previous);
+
+    std::vector<generation_link_t> current = links;
+    for (const auto &p : previous) {
+        if (std::none_of(links.begin(), links.end(), [&](const generation_link_t &l) { return l.link == p.link; }))
+            current.push_back(p);
+    }
+
+    if (!changed.empty()) {
+        if (had_previous)
+            ret |= save_generation(state_dir / "generation.prev", previous);
+        ret |= save_generation(state_dir / "generation", current);
+    }
+
+    // Records on disk match the links now, anything older than generation.prev is unreachable
+    if (ret.is_ok()) {
+        std::vector<generation_link_t> kept;
+        load_generation(state_dir / "generation.prev", kept);
+        const std::size_t pruned = prune_generations(generations, current, kept);
+        if (pruned > 0)
+            sigil::dcout << "[DEBUG] Pruned " << pruned << " unused generation(s)" << std::endl;
+    }
+
+    std::cout << "[OK] " << changed.size() << " of " << links.size() << " component(s) switched\n";
+    return ret;
+}
+
+::sigil::yield rollback_theme_generation(const ::sigil::platform::app_descriptor_t &app, std::vector<std::string> &changed) {
+    ::sigil::yield ret;
+    changed.clear();
+
+    const ::fs::path state_dir = ::sigil::platform::get_sigilvm_state_root(app) / "themes";
+    const generation_lock_t lock(::sigil::platform::get_sigilvm_data_root(app) / "generations");
+
+    std::vector<generation_link_t> previous, current;
+    if (!load_generation(state_dir / "generation.prev", previous)) {
+        std::cerr << "[ERROR] No earlier theme generation to roll back to" << std::endl;
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOENT);
+    }
+    load_generation(state_dir / "generation", current);
+
+    // Switches keep both recorded sets, a missing generation was removed by hand
+    std::error_code ec;
+    for (const auto &l : previous) {
+        if (!::fs::exists(l.target, ec)) {
+            std::cerr << "[ERROR] Generation missing: " << l.target << std::endl;
+            return ret.set_state(sigil::yield_state::fail).set_code(ENOENT);
         }
+    }
+
+    ret |= apply_generation(app, previous, changed);
+    ret |= save_generation(state_dir / "generation", previous);
+    if (!current.empty())
+        ret |= save_generation(state_dir / "generation.prev", current);
+
+    return ret;
+}
+
+/*
+ * Variants
+ *
+ * <sigilvm cache>/themes/templates.manifest indexes the installed templates
+ * by file key, so the template digest costs one stat per template once warm.
+ * templates.digest records the template digest the last prewarm covered.
+ */
+
+// Bump when rendering changes in a way the digests cannot see
+static constexpr std::string_view theme_variant_version = "1";
+
+static ::fs::path variant_cache_root(const ::sigil::platform::app_descriptor_t &app) {
+    return ::sigil::platform::get_sigilvm_cache_root(app) / "themes";
+}
+
+// Digest of the installed templates, together with how components map onto them
+static ::sigil::yield template_set_digest(const ::sigil::platform::app_descriptor_t &app, std::string &out) {
+    const ::fs::path common = ::sigil::platform::get_theme_assets_root(app) / "common";
+    const ::fs::path index = variant_cache_root(app) / "templates.manifest";
+
+    theme_manifest_t previous, current;
+    previous.load(index);
+
+    ::sigil::yield ret = scan_manifest(common, previous, current);
+    if (ret.is_failure())
+        return ret;
+
+    if (current.entries != previous.entries)
+        current.save(index);
+
+    std::string salt(theme_variant_version);
+    for (const auto &comp : theme_components()) {
+        salt += ';';
+        salt += comp.name;
+        salt += '=';
+        salt += comp.source;
+    }
+
+    out = manifest_digest(current, {}, salt).substr(0, 16);
+    return ret;
+}
+
+static std::string read_stamp(const ::fs::path &file) {
+    std::ifstream in(file);
+    std::string stamp;
+    std::getline(in, stamp);
+    return stamp;
+}
 
-        if (::fs::exists(kvantum_link_path) || ::fs::is_symlink(kvantum_link_path))
-            ::fs::remove_all(kvantum_link_path, ec);
+// Render pattern_file into <root>/<variant>/<name> unless it is there already
+static ::sigil::yield ensure_variant(const ::sigil::platform::app_descriptor_t &app, const ::fs::path &pattern_file,
+                                     const std::string &variant, const std::string &name, bool &built) {
+    ::sigil::yield ret;
+    built = false;
+
+    const ::fs::path variant_dir = variant_cache_root(app) / variant;
+
+    std::error_code ec;
+    if (::fs::is_directory(variant_dir / name, ec))
+        return ret;
+
+    // Rendered aside and published with one rename, a variant is complete or absent.
+    // Patterns with the same contents share variant_dir, so only <name> moves.
+    ::fs::path staging = variant_dir;
+    staging += ".tmp-" + std::to_string(getpid());
+    ::fs::remove_all(staging, ec);
+
+    ret = render_theme(::sigil::platform::get_theme_assets_root(app), pattern_file, staging / name, {});
+    if (ret.is_failure()) {
+        ::fs::remove_all(staging, ec);
+        return ret;
+    }
+
+    ::fs::create_directories(variant_dir, ec);
+    const int moved = ::rename((staging / name).c_str(), (variant_dir / name).c_str());
+    const int err = errno;
+    ::fs::remove_all(staging, ec);
+
+    if (moved != 0) {
+        // Someone else published the same variant first
+        if (!::fs::is_directory(variant_dir / name, ec))
+            return ret.set_state(sigil::yield_state::fail).set_code(err);
+        return ret;
+    }
+
+    built = true;
+    return ret;
+}
+
+static ::sigil::yield pattern_digest(const ::fs::path &pattern_file, std::string &out) {
+    ::sigil::fs::file_key_t key;
+    ::sigil::fs::file_digest_t digest;
+    if (!::sigil::fs::get_file_key(pattern_file, key))
+        return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(ENOENT);
+    if (!digest_file(pattern_file, key, digest))
+        return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(EIO);
+
+    out = digest_to_hex(digest).substr(0, 16);
+    return {};
+}
+
+::sigil::yield get_theme_variant(const ::sigil::platform::app_descriptor_t &app, const std::string &name,
+                                 theme_variant_t &out) {
+    ::sigil::yield ret;
+    out = {};
+
+    const ::fs::path pattern_file = ::sigil::platform::get_theme_assets_root(app) / "patterns" / (name + ".yaml");
+
+    std::string tdigest, pdigest;
+    ret = pattern_digest(pattern_file, pdigest);
+    if (ret.is_failure()) {
+        std::cerr << "[ERROR] Theme pattern not found: " << pattern_file << std::endl;
+        return ret;
+    }
+
+    ret = template_set_digest(app, tdigest);
+    if (ret.is_failure()) {
+        std::cerr << "[ERROR] Cannot index theme templates (status " << ret.code << ")\n";
+        return ret;
+    }
+
+    const std::string variant = tdigest + "-" + pdigest;
+    ret = ensure_variant(app, pattern_file, variant, name, out.built);
+    if (ret.is_failure())
+        return ret;
+
+    out.dir = variant_cache_root(app) / variant / name;
+    out.prewarmed = read_stamp(variant_cache_root(app) / "templates.digest") == tdigest;
+    return ret;
+}
+
+::sigil::yield prewarm_theme_variants(const ::sigil::platform::app_descriptor_t &app, std::size_t &built) {
+    ::sigil::yield ret;
+    built = 0;
+
+    const ::fs::path patterns_dir = ::sigil::platform::get_theme_assets_root(app) / "patterns";
+    const ::fs::path root = variant_cache_root(app);
+
+    std::string tdigest;
+    ret = template_set_digest(app, tdigest);
+    if (ret.is_failure())
+        return ret;
+
+    std::vector<std::string> wanted;
+    std::error_code ec;
 
+    for (const auto &entry : ::fs::directory_iterator(patterns_dir, ec)) {
+        if (entry.path().extension() != ".yaml")
+            continue;
 
-        std::string kvantum_theme_name = "sigil-" + std::filesystem::path(theme_dir).filename().string();
-;
-        ::fs::path kvantum_target = kvantum_theme_src / kvantum_theme_name;
+        std::string pdigest;
+        if (pattern_digest(entry.path(), pdigest).is_failure())
+            continue;
 
-        if (!::fs::exists(kvantum_target)) {
-            std::cerr << "[WARN] Kvantum source theme missing: " << kvantum_target << std::endl;
-            return ret.set_state(sigil::yield_state::fail);
-            // return sigil::VM_RESOURCE_MISSING;
+        const std::string variant = tdigest + "-" + pdigest;
+        bool fresh = false;
+        ::sigil::yield res = ensure_variant(app, entry.path(), variant, entry.path().stem().string(), fresh);
+        if (res.is_failure()) {
+            std::cerr << "[ERROR] Cannot prewarm " << entry.path().stem() << " (status " << res.code << ")\n";
+            ret |= res;
+            continue;
         }
 
-        ::fs::create_directory_symlink(kvantum_target, kvantum_link_path, ec);
-        if (ec) {
-            std::cerr << "[ERROR] Failed to create Kvantum symlink: " << kvantum_link_path << std::endl;
-            return ret.set_state(sigil::yield_state::fail);
-            // return sigil::VM_IO_ERROR;
+        built += fresh ? 1 : 0;
+        wanted.push_back(variant);
+    }
+
+    if (ec)
+        return ret.set_state(sigil::yield_state::fail).set_code(ec.value());
+
+    // Everything named like a variant that nothing maps to anymore, and staging
+    // leftovers of processes that are gone. A live one may be a theme set rendering.
+    std::vector<::fs::path> stale;
+    for (const auto &entry : ::fs::directory_iterator(root, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() < 33 || name[16] != '-' || !entry.is_directory(ec))
+            continue;
+
+        if (name.size() > 33) {
+            int pid = 0;
+            if (name.compare(33, 5, ".tmp-") != 0
+                || std::from_chars(name.data() + 38, name.data() + name.size(), pid).ec != std::errc()
+                || (pid > 0 && (::kill(pid, 0) == 0 || errno == EPERM)))
+                continue;
+            stale.push_back(entry.path());
+            continue;
         }
 
-        std::string cmd = "kvantummanager --set " + kvantum_link_name + " >/dev/null 2>&1";
-        std::system(cmd.c_str());
+        if (std::find(wanted.begin(), wanted.end(), name) == wanted.end())
+            stale.push_back(entry.path());
+    }
+
+    for (const auto &p : stale)
+        ::fs::remove_all(p, ec);
+
+    if (ret.is_ok()) {
+        std::ofstream stamp(root / "templates.digest", std::ios::trunc);
+        stamp << tdigest << '\n';
+    }
+
+    sigil::dcout << "[DEBUG] Prewarm: " << built << " rendered, " << wanted.size() - built << " cached, "
+                 << stale.size() << " dropped" << std::endl;
+    return ret;
+}
+
+::sigil::yield deploy_theme_from_path(const ::sigil::platform::app_descriptor_t &app, std::filesystem::path theme_dir,
+                                      theme_deploy_mode_t mode) {
+    ::sigil::yield ret;
+
+    if (!::fs::exists(theme_dir)) {
+        std::cerr << "[ERROR] Theme not found: " << theme_dir << std::endl;
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOENT);
+    }
+
+    std::cout << "[THEME] Applying: " << theme_dir.c_str() << std::endl;
+
+    std::vector<std::string> changed;
+    if (mode == THEME_DEPLOY_IN_PLACE)
+        ret = deploy_theme_files(app, theme_dir, changed);
+    else
+        ret = switch_theme_generation(app, theme_dir, changed);
+
+    if (ret.is_failure())
+        return ret;
+
+    if (changed.empty()) {
+        std::cout << "[DONE] Theme '" << theme_dir.string() << "' already applied.\n";
+        return ret;
     }
 
     std::cout << "[DONE] Theme '" << theme_dir.string() << "' applied successfully, reloading...\n";
-    ret |= ::sigil::desktop::reload_components();
+    ret |= ::sigil::desktop::reload_components(app, changed);
     return ret;
 }
 
@@ -0,0 +1,297 @@
+#include <sigil/platform/desktop_ipc.h>
+#include <sigil/platform/paths.h>
+#include <sigil/data/parser.h>
+#include <sigil/common.h>
+
+#include <string_view>
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <cstdio>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+
+namespace fs = std::filesystem;
+
+namespace sigil::desktop {
+
+bool find_hypr_instance(const ::sigil::platform::process_descriptor_t &p, hypr_instance_t &out) {
+    const char *signature = ::sigil::platform::env_get(p, "HYPRLAND_INSTANCE_SIGNATURE");
+    if (!signature || !*signature)
+        return false;
+
+    std::error_code ec;
+    if (const char *runtime = ::sigil::platform::env_get(p, "XDG_RUNTIME_DIR")) {
+        out.dir = fs::path(runtime) / "hypr" / signature;
+        if (fs::exists(out.control_socket(), ec))
+            return true;
+    }
+
+    out.dir = fs::path("/tmp/hypr") / signature;
+    return fs::exists(out.control_socket(), ec);
+}
+
+::sigil::yield hypr_request(const fs::path &socket, std::string_view request, std::string &reply, int timeout_ms) {
+    ::sigil::yield ret;
+    reply.clear();
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socket.native().size() >= sizeof(addr.sun_path))
+        return ret.set_state(sigil::yield_state::fail).set_code(ENAMETOOLONG);
+    std::memcpy(addr.sun_path, socket.c_str(), socket.native().size());
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    auto fail = [&](int err) -> ::sigil::yield {
+        ::close(fd);
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    };
+
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+        return fail(errno);
+
+    // Hyprland reads the request in one go, it is well below the socket buffer
+    std::size_t sent = 0;
+    while (sent < request.size()) {
+        const ssize_t n = ::send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return fail(errno);
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    char buf[4096];
+
+    for (;;) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0)
+            return fail(ETIMEDOUT);
+
+        pollfd pfd{ fd, POLLIN, 0 };
+        const int ready = ::poll(&pfd, 1, static_cast<int>(left));
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return fail(errno);
+        }
+        if (ready == 0)
+            return fail(ETIMEDOUT);
+
+        const ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return fail(errno);
+        }
+        if (n == 0)
+            break;
+        reply.append(buf, static_cast<std::size_t>(n));
+    }
+
+    ::close(fd);
+    return ret;
+}
+
+::sigil::yield hypr_dispatch(const hypr_instance_t &hypr, std::string_view command) {
+    std::string reply;
+    ::sigil::yield ret = hypr_request(hypr.control_socket(), command, reply);
+    if (ret.is_failure())
+        return ret;
+
+    // A batch answers once per command, every one of them has to be "ok"
+    std::istringstream words(reply);
+    std::size_t oks = 0;
+    for (std::string word; words >> word; ++oks) {
+        if (word != "ok") {
+            std::cerr << "[WARN] Hyprland refused '" << command << "': " << reply << std::endl;
+            return ret.set_state(sigil::yield_state::fail).set_code(EPROTO);
+        }
+    }
+
+    if (oks == 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(EPROTO);
+    return ret;
+}
+
+::sigil::yield hypr_monitors(const hypr_instance_t &hypr, std::vector<std::string> &out) {
+    out.clear();
+
+    std::string reply;
+    ::sigil::yield ret = hypr_request(hypr.control_socket(), "j/monitors", reply);
+    if (ret.is_failure())
+        return ret;
+
+    ::sigil::data::document_t doc;
+    ret = doc.parse(reply, ::sigil::data::FORMAT_JSONC);
+    if (ret.is_failure() || !doc.root().is_array())
+        return ret.set_state(sigil::yield_state::fail).set_code(EPROTO);
+
+    for (const ::sigil::data::value_t monitor : doc.root()) {
+        bool disabled = false;
+        monitor["disabled"].as_bool(disabled);
+        if (!disabled && monitor["name"])
+            out.push_back(monitor["name"].decode());
+    }
+
+    return ret;
+}
+
+::sigil::yield hyprpaper_wallpaper(const hypr_instance_t &hypr, const fs::path &file) {
+    ::sigil::yield ret;
+
+    std::error_code ec;
+    if (!fs::exists(hypr.hyprpaper_socket(), ec))
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOENT);
+
+    std::vector<std::string> monitors;
+    ret = hypr_monitors(hypr, monitors);
+    if (ret.is_failure())
+        return ret;
+
+    std::string reply;
+    for (const auto &monitor : monitors) {
+        const std::string request = "wallpaper " + monitor + "," + file.string() + ",fill";
+        ::sigil::yield st = hypr_request(hypr.hyprpaper_socket(), request, reply);
+        if (st.is_ok() && reply.rfind("ok", 0) != 0)
+            st.set_state(sigil::yield_state::fail).set_code(EPROTO);
+        if (st.is_failure())
+            sigil::dcout << "[DEBUG] hyprpaper: " << request << " -> " << reply << std::endl;
+        ret |= st;
+    }
+
+    return ret;
+}
+
+std::size_t signal_processes(std::string_view name, int sig) {
+    DIR *proc = ::opendir("/proc");
+    if (!proc)
+        return 0;
+
+    // comm is cut to 15 bytes by the kernel
+    const std::string_view comm_name = name.substr(0, 15);
+    const uid_t uid = ::getuid();
+    const pid_t self = ::getpid();
+    std::size_t signalled = 0;
+
+    while (const dirent *e = ::readdir(proc)) {
+        if (e->d_name[0] < '1' || e->d_name[0] > '9')
+            continue;
+
+        char path[sizeof(e->d_name) + 16];
+        std::snprintf(path, sizeof(path), "/proc/%s/comm", e->d_name);
+
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        char comm[32];
+        const ssize_t n = ::read(fd, comm, sizeof(comm));
+        ::close(fd);
+        if (n <= 0)
+            continue;
+
+        std::string_view got(comm, static_cast<std::size_t>(n));
+        if (!got.empty() && got.back() == '\n')
+            got.remove_suffix(1);
+        if (got != comm_name)
+            continue;
+
+        struct stat st;
+        std::snprintf(path, sizeof(path), "/proc/%s", e->d_name);
+        if (::stat(path, &st) != 0 || st.st_uid != uid)
+            continue;
+
+        const pid_t pid = static_cast<pid_t>(std::strtol(e->d_name, nullptr, 10));
+        if (pid != self && ::kill(pid, sig) == 0)
+            ++signalled;
+    }
+
+    ::closedir(proc);
+    return signalled;
+}
+
+::sigil::yield kvantum_select_theme(const fs::path &config_root, std::string_view theme, bool &changed) {
+    ::sigil::yield ret;
+    changed = false;
+
+    const fs::path file = config_root / "Kvantum" / "kvantum.kvconfig";
+    std::string before;
+    {
+        std::ifstream in(file, std::ios::binary);
+        std::ostringstream buf;
+        buf << in.rdbuf();
+        before = buf.str();
+    }
+
+    const std::string setting = "theme=" + std::string(theme);
+    std::istringstream in(before);
+    std::string after;
+    std::string line;
+    bool in_general = false;
+    bool seen_general = false;
+    bool written = false;
+
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.front() == '[') {
+            // Leaving [General] without a theme line, add it at the end of the section
+            if (in_general && !written) {
+                after += setting + "\n";
+                written = true;
+            }
+            in_general = line.rfind("[General]", 0) == 0;
+            seen_general |= in_general;
+        } else if (in_general && line.rfind("theme=", 0) == 0) {
+            if (!written)
+                after += setting + "\n";
+            written = true;
+            continue;
+        }
+        after += line + "\n";
+    }
+
+    if (in_general && !written)
+        after += setting + "\n";
+    if (!seen_general)
+        after = "[General]\n" + setting + "\n" + after;
+
+    if (after == before)
+        return ret;
+
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+
+    const fs::path tmp = file.string() + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out << after;
+        if (!out.flush())
+            return ret.set_state(sigil::yield_state::fail).set_code(EIO);
+    }
+
+    if (::rename(tmp.c_str(), file.c_str()) != 0) {
+        const int err = errno;
+        ::unlink(tmp.c_str());
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    }
+
+    changed = true;
+    return ret;
+}
+
+} // namespace sigil::desktop
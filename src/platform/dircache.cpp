@@ -0,0 +1,224 @@
+#include <sigil/platform/dircache.h>
+#include <sigil/common.h>
+
+#include <unordered_map>
+#include <system_error>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <poll.h>
+#include <cerrno>
+
+namespace sigil::fs {
+
+static constexpr std::size_t max_cached_dirs = 16;
+static constexpr int relist_debounce_ms = 30;
+
+static constexpr uint32_t dir_watch_mask =
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+    IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+struct dir_cache_t::state_t {
+    std::mutex lock;
+    std::unordered_map<std::string, std::shared_ptr<const dir_snapshot_t>> snapshots;
+    std::string requested;
+    bool force_relist = false;
+    uint64_t generation = 0;
+
+    std::thread worker;
+    std::atomic<bool> stop{false};
+    int wake_fd = -1;
+    int inotify_fd = -1;
+};
+
+static std::shared_ptr<const dir_snapshot_t> list_dir(const std::string &dir, uint64_t generation) {
+    auto snap = std::make_shared<dir_snapshot_t>();
+    snap->dir = dir;
+    snap->generation = generation;
+
+    std::error_code ec;
+    std::filesystem::directory_iterator it(dir, std::filesystem::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        snap->error = ec.value();
+        return snap;
+    }
+
+    for (; it != std::filesystem::directory_iterator(); it.increment(ec)) {
+        if (ec)
+            break;
+
+        dir_entry_t e;
+        e.path = it->path();
+        e.name = e.path.filename().string();
+        e.is_directory = it->is_directory(ec);
+        e.label = e.is_directory ? "[D] " + e.name : e.name;
+        snap->entries.push_back(std::move(e));
+    }
+
+    std::sort(snap->entries.begin(), snap->entries.end(), [](const dir_entry_t &a, const dir_entry_t &b) {
+        if (a.is_directory != b.is_directory)
+            return a.is_directory;
+        return a.name < b.name;
+    });
+
+    return snap;
+}
+
+static void publish(dir_cache_t::state_t &st, std::shared_ptr<const dir_snapshot_t> snap) {
+    std::lock_guard<std::mutex> guard(st.lock);
+
+    if (st.snapshots.size() >= max_cached_dirs && !st.snapshots.count(snap->dir.string())) {
+        // Evict the oldest listing that is not the current directory
+        auto oldest = st.snapshots.end();
+        for (auto it = st.snapshots.begin(); it != st.snapshots.end(); ++it) {
+            if (it->first == st.requested)
+                continue;
+            if (oldest == st.snapshots.end() || it->second->generation < oldest->second->generation)
+                oldest = it;
+        }
+        if (oldest != st.snapshots.end())
+            st.snapshots.erase(oldest);
+    }
+
+    st.snapshots[snap->dir.string()] = std::move(snap);
+}
+
+static void worker_loop(dir_cache_t::state_t &st) {
+    std::string watched;
+    int wd = -1;
+    bool dirty = false;
+    auto deadline = std::chrono::steady_clock::now();
+
+    while (!st.stop.load(std::memory_order_acquire)) {
+        int timeout = -1;
+        if (dirty) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            timeout = static_cast<int>(std::max<long long>(0, left));
+        }
+
+        struct pollfd fds[2] = {
+            { st.wake_fd, POLLIN, 0 },
+            { st.inotify_fd, POLLIN, 0 },
+        };
+
+        int n = poll(fds, st.inotify_fd >= 0 ? 2 : 1, timeout);
+        if (n < 0 && errno != EINTR)
+            break;
+
+        if (fds[1].revents & POLLIN) {
+            alignas(struct inotify_event) char buf[4096];
+            while (read(st.inotify_fd, buf, sizeof(buf)) > 0) {}
+
+            // Coalesce bursts (unpacking an archive) into one relist
+            if (!dirty)
+                deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(relist_debounce_ms);
+            dirty = true;
+        }
+
+        std::string requested;
+        bool forced = false;
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t v;
+            [[maybe_unused]] ssize_t r = read(st.wake_fd, &v, sizeof(v));
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(st.lock);
+            requested = st.requested;
+            forced = st.force_relist;
+            st.force_relist = false;
+        }
+
+        const bool switched = requested != watched;
+        const bool due = dirty && std::chrono::steady_clock::now() >= deadline;
+
+        if (switched) {
+            if (wd >= 0 && st.inotify_fd >= 0)
+                inotify_rm_watch(st.inotify_fd, wd);
+            wd = (st.inotify_fd >= 0) ? inotify_add_watch(st.inotify_fd, requested.c_str(), dir_watch_mask) : -1;
+            watched = requested;
+        }
+
+        if (switched || forced || due) {
+            dirty = false;
+            if (!watched.empty()) {
+                uint64_t gen;
+                {
+                    std::lock_guard<std::mutex> guard(st.lock);
+                    gen = ++st.generation;
+                }
+                publish(st, list_dir(watched, gen));
+            }
+        }
+    }
+}
+
+dir_cache_t::dir_cache_t() : state(std::make_unique<state_t>()) {}
+
+dir_cache_t::~dir_cache_t() {
+    if (state->worker.joinable()) {
+        state->stop.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t w = write(state->wake_fd, &one, sizeof(one));
+        state->worker.join();
+    }
+
+    if (state->wake_fd >= 0) close(state->wake_fd);
+    if (state->inotify_fd >= 0) close(state->inotify_fd);
+}
+
+std::shared_ptr<const dir_snapshot_t> dir_cache_t::get(const std::filesystem::path &dir) {
+    const std::string key = dir.string();
+    bool wake = false;
+    std::shared_ptr<const dir_snapshot_t> snap;
+
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+
+        if (!state->worker.joinable()) {
+            state->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            state->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (state->wake_fd < 0)
+                return nullptr;
+            state->worker = std::thread(worker_loop, std::ref(*state));
+        }
+
+        if (state->requested != key) {
+            state->requested = key;
+            wake = true;
+        }
+
+        auto it = state->snapshots.find(key);
+        if (it != state->snapshots.end())
+            snap = it->second;
+    }
+
+    if (wake) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t w = write(state->wake_fd, &one, sizeof(one));
+    }
+
+    return snap;
+}
+
+void dir_cache_t::refresh() {
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        if (!state->worker.joinable())
+            return;
+        state->force_relist = true;
+    }
+
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t w = write(state->wake_fd, &one, sizeof(one));
+}
+
+} // namespace sigil::fs
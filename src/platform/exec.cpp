@@ -1,11 +1,32 @@
 #include <sigil/platform/exec.h>
+#include <sigil/platform/process.h>
+#include <sigil/platform/fs.h>
 #include <sigil/common.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
 #include <sys/wait.h>
+#include <poll.h>
 #include <unistd.h>
-#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <mutex>
 #include <fcntl.h>
+#include <spawn.h>
+#include <csignal>
+#include <cerrno>
+
+// addchdir_np and POSIX_SPAWN_SETSID, glibc 2.29+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#   define SIGIL_HAS_POSIX_SPAWN 1
+#else
+#   define SIGIL_HAS_POSIX_SPAWN 0
+#endif
 
 extern "C" {
     extern char **environ;
@@ -33,6 +54,16 @@ static int create_memfd(const char* name) {
 #   endif
 }
 
+static int open_pidfd(pid_t pid) {
+#   if defined(SYS_pidfd_open)
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#   else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#   endif
+}
+
 static void normalize_wait_status(int status, proc_exec_result_t& out) {
     if (WIFEXITED(status)) {
         out.exit_code  = WEXITSTATUS(status);
@@ -46,57 +77,94 @@ static void normalize_wait_status(int status, proc_exec_result_t& out) {
     }
 }
 
+static constexpr std::size_t line_block_size = 64 * 1024;
+
+bool line_reader_t::pump(int fd, const std::function<void(std::string_view)>& on_line) {
+    if (buffer.size() < line_block_size)
+        buffer.resize(line_block_size);
+
+    // Bounded, so one chatty child cannot starve the others on the same loop
+    for (int round = 0; round < 16; ++round) {
+        ssize_t n = read(fd, buffer.data() + used, buffer.size() - used);
+        if (n == 0)
+            return false;
+        if (n < 0)
+            return errno == EAGAIN || errno == EINTR;
+
+        used += static_cast<std::size_t>(n);
+
+        const char* base = buffer.data();
+        std::size_t start = 0;
+        while (start < used) {
+            const char* nl = static_cast<const char*>(std::memchr(base + start, '\n', used - start));
+            if (!nl)
+                break;
+            const std::size_t end = static_cast<std::size_t>(nl - base);
+            on_line(std::string_view(base + start, end - start));
+            start = end + 1;
+        }
 
-::sigil::yield execute(proc_exec_unit_t& peu) {
-    if (peu.target.empty()) {
-        return ::sigil::yield().set_state(sigil::yield_state::fail);
+        if (start == 0 && used == buffer.size()) {
+            // No newline in a full block, hand it out as is
+            on_line(std::string_view(base, used));
+            used = 0;
+        } else if (start > 0) {
+            std::memmove(buffer.data(), base + start, used - start);
+            used -= start;
+        }
     }
 
-    std::vector<char*> argv;
-    argv.reserve(peu.args.size() + 2);
+    return true;
+}
 
-    argv.push_back(const_cast<char*>(peu.target.c_str()));
-    for (auto& a : peu.args) {
-        argv.push_back(const_cast<char*>(a.c_str()));
-    }
-    argv.push_back(nullptr);
+void line_reader_t::finish(const std::function<void(std::string_view)>& on_line) {
+    if (used > 0)
+        on_line(std::string_view(buffer.data(), used));
+    used = 0;
+}
 
-    std::vector<char*> envp;
-    if (!peu.exports.empty()) {
-        for (char** e = environ; *e; ++e) {
-            envp.push_back(*e);
-        }
-        for (auto& e : peu.exports) {
-            envp.push_back(const_cast<char*>(e.c_str()));
-        }
-        envp.push_back(nullptr);
-    }
+// Parent keeps the non-blocking read end, the child gets the write end
+static bool create_stream_pipe(int& read_end, int& write_end) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+        return false;
+
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    read_end = fds[0];
+    write_end = fds[1];
+    return true;
+}
 
+// Everything execute() resolved up front, shared by both backends
+struct exec_plan_t {
+    const char *path = nullptr;
+    char *const *argv = nullptr;
+    char *const *envp = nullptr;
+    bool use_path = true;
     int stdout_fd = -1;
     int stderr_fd = -1;
-
-    const bool want_capture =
-        (peu.exec_mode == EXEC_WAIT) &&
-        (peu.stdout_mode == STDIO_CAPTURE ||
-         peu.stderr_mode == STDIO_CAPTURE);
-
-    if (want_capture) {
-        if (peu.stdout_mode == STDIO_CAPTURE) {
-            stdout_fd = create_memfd("sigil-exec-stdout");
-            if (stdout_fd < 0)
-                return ::sigil::yield().set_state(sigil::yield_state::fail);
-        }
-        if (peu.stderr_mode == STDIO_CAPTURE) {
-            stderr_fd = create_memfd("sigil-exec-stderr");
-            if (stderr_fd < 0)
-                return ::sigil::yield().set_state(sigil::yield_state::fail);
-        }
+};
+
+// Errors meaning "the program could not be started", reported like exec failing in a child
+static bool is_exec_error(int err) {
+    switch (err) {
+        case ENOENT: case EACCES: case ENOEXEC: case ENOTDIR:
+        case ELOOP: case ENAMETOOLONG: case EISDIR: case ETXTBSY: case EPERM:
+            return true;
+        default:
+            return false;
     }
+}
 
+/**
+ * @brief
+ * Classic backend. Child only calls async-signal-safe functions
+ * between fork and exec. Returns 0 or errno of fork.
+ */
+static int spawn_fork(const proc_exec_unit_t& peu, const exec_plan_t& plan, pid_t& out_pid) {
     pid_t pid = fork();
-    if (pid < 0) {
-        return ::sigil::yield().set_state(sigil::yield_state::fail);
-    }
+    if (pid < 0)
+        return errno;
 
     if (pid == 0) {
         if (peu.exec_mode == EXEC_DETACH) {
@@ -104,7 +172,6 @@ static void normalize_wait_status(int status, proc_exec_result_t& out) {
         }
 
         if (!peu.workdir.empty()) {
-            std::cout << "Changing Work dir to: " << peu.workdir.c_str() << std::endl;
             if (chdir(peu.workdir.c_str()) != 0) {
                 _exit(127);
             }
@@ -124,8 +191,8 @@ static void normalize_wait_status(int status, proc_exec_result_t& out) {
                 dup2(dn, STDOUT_FILENO);
                 close(dn);
             }
-        } else if (peu.stdout_mode == STDIO_CAPTURE) {
-            dup2(stdout_fd, STDOUT_FILENO);
+        } else if (plan.stdout_fd >= 0) {
+            dup2(plan.stdout_fd, STDOUT_FILENO);
         }
 
         if (peu.stderr_mode == STDIO_NULL) {
@@ -134,29 +201,848 @@ static void normalize_wait_status(int status, proc_exec_result_t& out) {
                 dup2(dn, STDERR_FILENO);
                 close(dn);
             }
-        } else if (peu.stderr_mode == STDIO_CAPTURE) {
-            dup2(stderr_fd, STDERR_FILENO);
+        } else if (plan.stderr_fd >= 0) {
+            dup2(plan.stderr_fd, STDERR_FILENO);
         }
 
-        if (!peu.exports.empty()) {
-            if (peu.use_path) {
-                execvpe(peu.target.c_str(), argv.data(), envp.data());
-            } else {
-                execve(peu.target.c_str(), argv.data(), envp.data());
-            }
+        if (plan.use_path) {
+            execvpe(plan.path, plan.argv, plan.envp);
         } else {
-            if (peu.use_path) {
-                execvp(peu.target.c_str(), argv.data());
+            execve(plan.path, plan.argv, plan.envp);
+        }
+
+        _exit(127);
+    }
+
+    out_pid = pid;
+    return 0;
+}
+
+#if SIGIL_HAS_POSIX_SPAWN
+/**
+ * @brief
+ * posix_spawn backend. glibc runs the child on a CLONE_VM | CLONE_VFORK
+ * stack, so cost does not grow with the parent's mappings, and exec
+ * failures come back as the return value instead of a 127 exit.
+ * Returns 0 or errno.
+ */
+static int spawn_posix(const proc_exec_unit_t& peu, const exec_plan_t& plan, pid_t& out_pid) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    int err = 0;
+
+    if ((err = posix_spawn_file_actions_init(&actions)) != 0)
+        return err;
+
+    if ((err = posix_spawnattr_init(&attr)) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return err;
+    }
+
+    // chdir first, like the fork backend, relative paths below are not affected
+    if (!peu.workdir.empty())
+        err = err ? err : posix_spawn_file_actions_addchdir_np(&actions, peu.workdir.c_str());
+
+    if (peu.stdin_mode == STDIO_NULL)
+        err = err ? err : posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+    if (peu.stdout_mode == STDIO_NULL)
+        err = err ? err : posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    else if (plan.stdout_fd >= 0)
+        err = err ? err : posix_spawn_file_actions_adddup2(&actions, plan.stdout_fd, STDOUT_FILENO);
+
+    if (peu.stderr_mode == STDIO_NULL)
+        err = err ? err : posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    else if (plan.stderr_fd >= 0)
+        err = err ? err : posix_spawn_file_actions_adddup2(&actions, plan.stderr_fd, STDERR_FILENO);
+
+    if (!err && peu.exec_mode == EXEC_DETACH)
+        err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+
+    if (!err) {
+        pid_t pid = -1;
+        err = plan.use_path
+            ? posix_spawnp(&pid, plan.path, &actions, &attr, plan.argv, plan.envp)
+            : posix_spawn(&pid, plan.path, &actions, &attr, plan.argv, plan.envp);
+        if (!err)
+            out_pid = pid;
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return err;
+}
+#endif
+
+// EXEC_WAIT with STDIO_STREAM: feed on_line until both pipes close
+static void drain_streams(const proc_exec_unit_t& peu, int out_fd, int err_fd) {
+    line_reader_t out_reader;
+    line_reader_t err_reader;
+
+    auto emit = [&](int stream) {
+        return [&peu, stream](std::string_view line) {
+            if (peu.on_line) peu.on_line(stream, line);
+        };
+    };
+
+    const auto emit_out = emit(STDOUT_FILENO);
+    const auto emit_err = emit(STDERR_FILENO);
+
+    struct pollfd fds[2] = {
+        { out_fd, POLLIN, 0 },
+        { err_fd, POLLIN, 0 },
+    };
+
+    while (fds[0].fd >= 0 || fds[1].fd >= 0) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (fds[0].fd >= 0 && fds[0].revents && !out_reader.pump(fds[0].fd, emit_out)) {
+            out_reader.finish(emit_out);
+            fds[0].fd = -1;
+        }
+        if (fds[1].fd >= 0 && fds[1].revents && !err_reader.pump(fds[1].fd, emit_err)) {
+            err_reader.finish(emit_err);
+            fds[1].fd = -1;
+        }
+    }
+}
+
+/**
+ * @brief
+ * environ copied once per thread, with a key index. Exports replace the
+ * entry of their key (or are appended) in place and are undone after the
+ * spawn, so execute() does not rebuild the whole block on every call.
+ */
+struct env_block_t {
+    char **source = nullptr;                            // environ the copy was taken from
+    std::size_t base_size = 0;
+    std::vector<char*> entries;                         // nullptr terminated
+    env_index_t index;
+    std::vector<std::pair<uint32_t, char*>> patched;    // position, original entry
+
+    // Take a new copy when environ moved or one of its entries changed (setenv)
+    void sync() {
+        std::size_t n = 0;
+        while (environ[n]) ++n;
+
+        if (source == environ && n == base_size && std::equal(environ, environ + n, entries.begin()))
+            return;
+
+        source = environ;
+        base_size = n;
+        patched.clear();
+        entries.assign(environ, environ + n + 1);
+        index.build(entries.data());
+    }
+
+    char *const *patch(const std::vector<std::string> &exports) {
+        sync();
+
+        for (const auto &e : exports) {
+            char *entry = const_cast<char*>(e.c_str());
+            const std::size_t eq = e.find('=');
+            const env_index_t::slot_t *slot =
+                eq == std::string::npos ? nullptr : index.find(std::string_view(e).substr(0, eq));
+
+            if (slot != nullptr) {
+                patched.emplace_back(slot->position, entries[slot->position]);
+                entries[slot->position] = entry;
             } else {
-                execv(peu.target.c_str(), argv.data());
+                entries.back() = entry;
+                entries.push_back(nullptr);
             }
         }
 
+        return entries.data();
+    }
+
+    void restore() {
+        for (auto it = patched.rbegin(); it != patched.rend(); ++it)
+            entries[it->first] = it->second;
+        patched.clear();
+
+        entries.resize(base_size + 1);
+        entries.back() = nullptr;
+    }
+};
+
+static thread_local env_block_t thread_env_block;
+
+/* =========================
+   Zygote
+   ========================= */
+
+static constexpr uint32_t zygote_magic = 0x5a59474f;    // "ZYGO"
+static constexpr std::size_t zygote_max_request = 256 * 1024;
+
+static constexpr uint32_t ZYGOTE_USE_PATH = 1u << 0;
+static constexpr uint32_t ZYGOTE_DETACH   = 1u << 1;
+static constexpr uint32_t ZYGOTE_WORKDIR  = 1u << 2;
+
+// Request fds, in SCM_RIGHTS order
+enum zygote_fd_t : int {
+    ZYGOTE_FD_REPLY = 0,    // per-request socket, started / exited replies go here
+    ZYGOTE_FD_CWD,          // caller's working directory
+    ZYGOTE_FD_STDIN,
+    ZYGOTE_FD_STDOUT,       // caller's stdout, or the write end of a stream pipe
+    ZYGOTE_FD_STDERR,
+    ZYGOTE_FD_COUNT,
+};
+
+// payload: path, argv[argc], envp[envc], workdir, all NUL terminated
+struct zygote_request_t {
+    uint32_t magic;
+    uint32_t flags;
+    uint32_t stdio_modes[3];
+    uint32_t argc;
+    uint32_t envc;
+    uint32_t payload_size;
+};
+
+// Followed by capture memfds (stdout, then stderr) when those were asked for
+struct zygote_started_t {
+    int32_t pid;
+    int32_t err;
+};
+
+struct zygote_exited_t {
+    int32_t status;
+};
+
+// ctl is only used, closed or replaced under lock, pid may be read without it as a hint
+static struct zygote_state_t {
+    std::mutex lock;
+    int ctl = -1;
+    std::atomic<pid_t> pid = -1;
+} zygote;
+
+static void send_with_fds(int sock, const void* data, std::size_t size, const int* fds, int nfds) {
+    iovec iov = { const_cast<void*>(data), size };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * ZYGOTE_FD_COUNT)] = {};
+
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (nfds > 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+        cmsghdr* c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        std::memcpy(CMSG_DATA(c), fds, sizeof(int) * nfds);
+    }
+
+    while (sendmsg(sock, &msg, MSG_NOSIGNAL) < 0 && errno == EINTR) {}
+}
+
+// Returns bytes read, received fds land in fds (CLOEXEC), -1 on error, 0 on EOF
+static ssize_t recv_with_fds(int sock, void* data, std::size_t size, int* fds, int max_fds, int& nfds) {
+    iovec iov = { data, size };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * ZYGOTE_FD_COUNT)];
+
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t got;
+    do {
+        got = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (got < 0 && errno == EINTR);
+
+    nfds = 0;
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); got >= 0 && c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+            continue;
+        const int n = static_cast<int>((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        const int* in = reinterpret_cast<const int*>(CMSG_DATA(c));
+        for (int i = 0; i < n; ++i) {
+            if (nfds < max_fds) fds[nfds++] = in[i];
+            else close(in[i]);
+        }
+    }
+
+    if (got >= 0 && (msg.msg_flags & MSG_TRUNC))
+        got = -1;
+
+    return got;
+}
+
+// Child side of a zygote spawn, runs between fork and exec
+[[noreturn]] static void zygote_exec_child(const zygote_request_t& req, const int* fds, const int* capture,
+                                           const char* path, char* const* argv, char* const* envp,
+                                           const char* workdir) {
+    if (req.flags & ZYGOTE_DETACH)
+        setsid();
+
+    if (fchdir(fds[ZYGOTE_FD_CWD]) != 0)
         _exit(127);
+    if ((req.flags & ZYGOTE_WORKDIR) && chdir(workdir) != 0)
+        _exit(127);
+
+    for (int stream = 0; stream < 3; ++stream) {
+        int src = fds[ZYGOTE_FD_STDIN + stream];
+        int dn = -1;
+
+        if (req.stdio_modes[stream] == STDIO_NULL)
+            src = dn = open_devnull(stream == 0 ? O_RDONLY : O_WRONLY);
+        else if (req.stdio_modes[stream] == STDIO_CAPTURE && stream > 0)
+            src = capture[stream - 1];
+
+        if (src >= 0)
+            dup2(src, stream);
+        if (dn >= 0)
+            close(dn);
+    }
+
+    if (req.flags & ZYGOTE_USE_PATH)
+        execvpe(path, argv, envp);
+    else
+        execve(path, argv, envp);
+
+    _exit(127);
+}
+
+struct zygote_child_t {
+    pid_t pid;
+    int reply;      // -1 for detached children, only reaped
+};
+
+// Handle one request, false once the parent is gone
+static bool zygote_serve(int ctl, std::vector<pollfd>& polls, std::vector<zygote_child_t>& children) {
+    char peek;
+    ssize_t len;
+    do {
+        len = recv(ctl, &peek, 1, MSG_PEEK | MSG_TRUNC);
+    } while (len < 0 && errno == EINTR);
+
+    if (len <= 0)
+        return false;
+
+    std::vector<char> buffer(static_cast<std::size_t>(len));
+    int fds[ZYGOTE_FD_COUNT];
+    int nfds = 0;
+
+    ssize_t got = recv_with_fds(ctl, buffer.data(), buffer.size(), fds, ZYGOTE_FD_COUNT, nfds);
+    if (got <= 0)
+        return got == 0 ? false : true;
+
+    zygote_request_t req = {};
+    bool valid = nfds == ZYGOTE_FD_COUNT && static_cast<std::size_t>(got) >= sizeof(req);
+    if (valid) {
+        std::memcpy(&req, buffer.data(), sizeof(req));
+        valid = req.magic == zygote_magic && req.payload_size == static_cast<std::size_t>(got) - sizeof(req);
+    }
+
+    // Unpack path / argv / envp / workdir in place
+    std::vector<char*> argv;
+    std::vector<char*> envp;
+    const char* path = nullptr;
+    const char* workdir = "";
+
+    if (valid) {
+        char* p = buffer.data() + sizeof(req);
+        char* end = buffer.data() + got;
+
+        auto next = [&]() -> char* {
+            char* nul = static_cast<char*>(std::memchr(p, '\0', static_cast<std::size_t>(end - p)));
+            if (nul == nullptr) return nullptr;
+            char* s = p;
+            p = nul + 1;
+            return s;
+        };
+
+        path = next();
+        for (uint32_t i = 0; valid && i < req.argc; ++i)
+            valid = argv.emplace_back(next()) != nullptr;
+        for (uint32_t i = 0; valid && i < req.envc; ++i)
+            valid = envp.emplace_back(next()) != nullptr;
+        if (valid) {
+            const char* w = next();
+            valid = path != nullptr && w != nullptr && p == end;
+            workdir = w ? w : "";
+        }
+        argv.push_back(nullptr);
+        envp.push_back(nullptr);
+    }
+
+    if (!valid) {
+        for (int i = 0; i < nfds; ++i) close(fds[i]);
+        return true;
+    }
+
+    zygote_started_t started = { -1, 0 };
+    int capture[2] = { -1, -1 };
+    int ncapture = 0;
+
+    for (int i = 0; i < 2 && started.err == 0; ++i) {
+        if (req.stdio_modes[i + 1] != STDIO_CAPTURE || (req.flags & ZYGOTE_DETACH))
+            continue;
+        capture[i] = create_memfd(i == 0 ? "sigil-exec-stdout" : "sigil-exec-stderr");
+        if (capture[i] < 0)
+            started.err = errno;
+    }
+
+    pid_t pid = started.err ? -1 : fork();
+    if (pid == 0)
+        zygote_exec_child(req, fds, capture, path, argv.data(), envp.data(), workdir);
+
+    if (pid < 0 && started.err == 0)
+        started.err = errno;
+
+    int pidfd = pid > 0 ? open_pidfd(pid) : -1;
+    started.pid = pid;
+
+    int sent[2];
+    for (int i = 0; i < 2; ++i) {
+        if (capture[i] >= 0) sent[ncapture++] = capture[i];
+    }
+    send_with_fds(fds[ZYGOTE_FD_REPLY], &started, sizeof(started), sent, started.err ? 0 : ncapture);
+
+    for (int i = 0; i < 2; ++i) {
+        if (capture[i] >= 0) close(capture[i]);
+    }
+    for (int i = ZYGOTE_FD_CWD; i < ZYGOTE_FD_COUNT; ++i)
+        close(fds[i]);
+
+    int reply = fds[ZYGOTE_FD_REPLY];
+    if (pid < 0 || (req.flags & ZYGOTE_DETACH)) {
+        close(reply);
+        reply = -1;
+    }
+
+    if (pid > 0) {
+        if (pidfd >= 0) {
+            polls.push_back({ pidfd, POLLIN, 0 });
+            children.push_back({ pid, reply });
+        } else {
+            // Cannot watch it, wait right here
+            int status = 0;
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+            zygote_exited_t exited = { status };
+            if (reply >= 0) {
+                send_with_fds(reply, &exited, sizeof(exited), nullptr, 0);
+                close(reply);
+            }
+        }
+    }
+
+    return true;
+}
+
+[[noreturn]] static void zygote_main(int ctl) {
+    // Nothing of the parent is needed here, keep only the channel and stdio
+    if (ctl != 3) {
+        dup3(ctl, 3, O_CLOEXEC);
+        ctl = 3;
+    }
+#   if defined(SYS_close_range)
+    syscall(SYS_close_range, 4u, ~0u, 0u);
+#   endif
+
+    std::vector<pollfd> polls = { { ctl, POLLIN, 0 } };
+    std::vector<zygote_child_t> children;
+
+    for (;;) {
+        if (::poll(polls.data(), polls.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (std::size_t i = polls.size() - 1; i > 0; --i) {
+            if (!polls[i].revents)
+                continue;
+
+            const zygote_child_t child = children[i - 1];
+            int status = 0;
+            while (waitpid(child.pid, &status, 0) < 0 && errno == EINTR) {}
+
+            if (child.reply >= 0) {
+                zygote_exited_t exited = { status };
+                send_with_fds(child.reply, &exited, sizeof(exited), nullptr, 0);
+                close(child.reply);
+            }
+            close(polls[i].fd);
+
+            polls.erase(polls.begin() + static_cast<std::ptrdiff_t>(i));
+            children.erase(children.begin() + static_cast<std::ptrdiff_t>(i - 1));
+        }
+
+        if (polls[0].revents && !zygote_serve(ctl, polls, children))
+            break;
+    }
+
+    _exit(0);
+}
+
+::sigil::yield zygote_start() {
+    ::sigil::yield ret;
+    std::lock_guard<std::mutex> guard(zygote.lock);
+
+    if (zygote.pid > 0)
+        return ret;
+
+    int probe = open_pidfd(getpid());
+    if (probe < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOSYS);
+    close(probe);
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        int err = errno;
+        close(sv[0]);
+        close(sv[1]);
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    }
+
+    if (pid == 0) {
+        close(sv[0]);
+        zygote_main(sv[1]);
+    }
+
+    close(sv[1]);
+    zygote.ctl = sv[0];
+    zygote.pid = pid;
+    return ret.set_info(static_cast<uint64_t>(pid));
+}
+
+static void zygote_stop_locked() {
+    if (zygote.pid <= 0)
+        return;
+
+    close(zygote.ctl);
+    while (waitpid(zygote.pid, nullptr, 0) < 0 && errno == EINTR) {}
+
+    zygote.ctl = -1;
+    zygote.pid = -1;
+}
+
+void zygote_stop() {
+    std::lock_guard<std::mutex> guard(zygote.lock);
+    zygote_stop_locked();
+}
+
+// Drop the zygote a spawn found dead, unless another thread already stopped or replaced it
+static void zygote_forget(pid_t helper) {
+    std::lock_guard<std::mutex> guard(zygote.lock);
+    if (helper > 0 && zygote.pid == helper)
+        zygote_stop_locked();
+}
+
+pid_t zygote_pid() noexcept {
+    return zygote.pid;
+}
+
+static bool zygote_eligible(const proc_exec_unit_t& peu) {
+    return zygote.pid > 0
+        && peu.spawn_backend == SPAWN_AUTO
+        && (peu.exec_mode == EXEC_WAIT || peu.exec_mode == EXEC_DETACH);
+}
+
+/**
+ * @brief
+ * Hand a spawn to the zygote. On success reply is the socket the exit
+ * status arrives on (EXEC_WAIT), capture memfds land in stdout_fd / stderr_fd.
+ * Returns 0, or errno, EPIPE meaning the zygote is gone, helper is the one it was.
+ */
+static int spawn_zygote(const proc_exec_unit_t& peu, const exec_plan_t& plan,
+                        pid_t& out_pid, int& stdout_fd, int& stderr_fd, int& reply, pid_t& helper) {
+    zygote_request_t req = {};
+    req.magic = zygote_magic;
+    req.flags = (plan.use_path ? ZYGOTE_USE_PATH : 0)
+              | (peu.exec_mode == EXEC_DETACH ? ZYGOTE_DETACH : 0)
+              | (peu.workdir.empty() ? 0 : ZYGOTE_WORKDIR);
+    req.stdio_modes[0] = peu.stdin_mode;
+    req.stdio_modes[1] = peu.stdout_mode;
+    req.stdio_modes[2] = peu.stderr_mode;
+
+    std::string payload(reinterpret_cast<const char*>(&req), sizeof(req));
+    payload.append(plan.path).push_back('\0');
+    for (char* const* a = plan.argv; *a; ++a, ++req.argc)
+        payload.append(*a).push_back('\0');
+    for (char* const* e = plan.envp; e && *e; ++e, ++req.envc)
+        payload.append(*e).push_back('\0');
+    payload.append(peu.workdir).push_back('\0');
+
+    if (payload.size() > zygote_max_request)
+        return E2BIG;
+
+    req.payload_size = static_cast<uint32_t>(payload.size() - sizeof(req));
+    std::memcpy(payload.data(), &req, sizeof(req));
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0)
+        return errno;
+
+    int cwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+    int fds[ZYGOTE_FD_COUNT] = {
+        sv[1], cwd, STDIN_FILENO,
+        stdout_fd >= 0 ? stdout_fd : STDOUT_FILENO,
+        stderr_fd >= 0 ? stderr_fd : STDERR_FILENO,
+    };
+
+    iovec iov = { payload.data(), payload.size() };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+    // Held while ctl is in use, a thread dropping the zygote cannot close it under us
+    ssize_t sent = -1;
+    int err = 0;
+    if (cwd < 0) {
+        err = errno;
+    } else {
+        std::lock_guard<std::mutex> guard(zygote.lock);
+        helper = zygote.pid;
+        if (helper <= 0) {
+            err = EPIPE;
+        } else {
+            do {
+                sent = sendmsg(zygote.ctl, &msg, MSG_NOSIGNAL);
+            } while (sent < 0 && errno == EINTR);
+            err = sent >= 0 ? 0 : errno;
+        }
+    }
+    if (cwd >= 0) close(cwd);
+    close(sv[1]);
+
+    if (err != 0) {
+        close(sv[0]);
+        return (err == ECONNREFUSED || err == ECONNRESET) ? EPIPE : err;
+    }
+
+    zygote_started_t started = {};
+    int got_fds[2];
+    int nfds = 0;
+
+    ssize_t got = recv_with_fds(sv[0], &started, sizeof(started), got_fds, 2, nfds);
+    if (got != static_cast<ssize_t>(sizeof(started))) {
+        for (int i = 0; i < nfds; ++i) close(got_fds[i]);
+        close(sv[0]);
+        return EPIPE;
+    }
+
+    if (started.err != 0) {
+        close(sv[0]);
+        return started.err;
+    }
+
+    int next = 0;
+    if (peu.stdout_mode == STDIO_CAPTURE && next < nfds) stdout_fd = got_fds[next++];
+    if (peu.stderr_mode == STDIO_CAPTURE && next < nfds) stderr_fd = got_fds[next++];
+
+    out_pid = started.pid;
+
+    if (peu.exec_mode == EXEC_DETACH) {
+        close(sv[0]);
+        reply = -1;
+    } else {
+        reply = sv[0];
+    }
+
+    return 0;
+}
+
+// Exit status of a zygote child, as waitpid would report it
+static bool zygote_wait(int reply, int& status) {
+    zygote_exited_t exited = {};
+    int nfds = 0;
+    ssize_t got = recv_with_fds(reply, &exited, sizeof(exited), nullptr, 0, nfds);
+    close(reply);
+
+    if (got != static_cast<ssize_t>(sizeof(exited)))
+        return false;
+
+    status = exited.status;
+    return true;
+}
+
+::sigil::yield execute(proc_exec_unit_t& peu) {
+    if (peu.target.empty()) {
+        return ::sigil::yield().set_state(sigil::yield_state::fail);
+    }
+
+    std::vector<char*> argv;
+    argv.reserve(peu.args.size() + 2);
+
+    argv.push_back(const_cast<char*>(peu.target.c_str()));
+    for (auto& a : peu.args) {
+        argv.push_back(const_cast<char*>(a.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    // Exports patched into this thread's copy of environ, undone when leaving
+    env_block_t &env_block = thread_env_block;
+    struct env_restore_t {
+        env_block_t *block = nullptr;
+        ~env_restore_t() { if (block) block->restore(); }
+    } env_restore;
+
+    char *const *envp = environ;
+    if (!peu.exports.empty()) {
+        envp = env_block.patch(peu.exports);
+        env_restore.block = &env_block;
+    }
+
+    // Resolve through the PATH index now, the child then skips execvp's PATH walk
+    // (unless the child gets its own PATH through exports)
+    bool child_path_exported = false;
+    for (const auto& e : peu.exports) {
+        if (starts_with(e, "PATH="))
+            child_path_exported = true;
+    }
+
+    std::string resolved;
+    bool use_path = peu.use_path;
+    if (use_path && !child_path_exported && ::sigil::fs::resolve_in_path(peu.target.c_str(), resolved))
+        use_path = false;
+
+    const char *exec_path = resolved.empty() ? peu.target.c_str() : resolved.c_str();
+    const bool via_zygote = zygote_eligible(peu);
+
+    int stdout_fd = -1;
+    int stderr_fd = -1;
+
+    const bool want_capture =
+        (peu.exec_mode == EXEC_WAIT || peu.exec_mode == EXEC_ASYNC) &&
+        (peu.stdout_mode == STDIO_CAPTURE ||
+         peu.stderr_mode == STDIO_CAPTURE);
+
+    // The zygote creates capture memfds itself and sends them back
+    if (want_capture && !via_zygote) {
+        if (peu.stdout_mode == STDIO_CAPTURE) {
+            stdout_fd = create_memfd("sigil-exec-stdout");
+            if (stdout_fd < 0)
+                return ::sigil::yield().set_state(sigil::yield_state::fail);
+        }
+        if (peu.stderr_mode == STDIO_CAPTURE) {
+            stderr_fd = create_memfd("sigil-exec-stderr");
+            if (stderr_fd < 0)
+                return ::sigil::yield().set_state(sigil::yield_state::fail);
+        }
+    }
+
+    // Streams: stdout_fd / stderr_fd become the child's write ends, read ends stay here
+    int stdout_read = -1;
+    int stderr_read = -1;
+
+    const bool want_stream =
+        (peu.exec_mode == EXEC_WAIT || peu.exec_mode == EXEC_ASYNC);
+
+    if (want_stream) {
+        bool ok = true;
+        if (peu.stdout_mode == STDIO_STREAM)
+            ok = ok && create_stream_pipe(stdout_read, stdout_fd);
+        if (peu.stderr_mode == STDIO_STREAM)
+            ok = ok && create_stream_pipe(stderr_read, stderr_fd);
+
+        if (!ok) {
+            for (int fd : { stdout_read, stdout_fd, stderr_read, stderr_fd }) {
+                if (fd >= 0) close(fd);
+            }
+            return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(errno);
+        }
+    }
+
+    exec_plan_t plan;
+    plan.path = exec_path;
+    plan.argv = argv.data();
+    plan.envp = envp;
+    plan.use_path = use_path;
+    plan.stdout_fd = stdout_fd;
+    plan.stderr_fd = stderr_fd;
+
+    pid_t pid = -1;
+    int err = 0;
+    int zygote_reply = -1;
+
+    if (via_zygote) {
+        pid_t helper = -1;
+        err = spawn_zygote(peu, plan, pid, stdout_fd, stderr_fd, zygote_reply, helper);
+        if (err == EPIPE) {
+            // Zygote is gone, forget it and spawn from here
+            zygote_forget(helper);
+            for (int fd : { stdout_read, stdout_fd, stderr_read, stderr_fd }) {
+                if (fd >= 0) close(fd);
+            }
+            if (env_restore.block) {
+                env_block.restore();
+                env_restore.block = nullptr;
+            }
+            return execute(peu);
+        }
+    }
+#   if SIGIL_HAS_POSIX_SPAWN
+    else if (peu.spawn_backend != SPAWN_FORK)
+        err = spawn_posix(peu, plan, pid);
+    else
+        err = spawn_fork(peu, plan, pid);
+#   else
+    else
+        err = spawn_fork(peu, plan, pid);
+#   endif
+
+    // Only the child writes into pipes, EOF arrives when it (and its children) are gone
+    if (stdout_read >= 0) {
+        close(stdout_fd);
+        stdout_fd = stdout_read;
+    }
+    if (stderr_read >= 0) {
+        close(stderr_fd);
+        stderr_fd = stderr_read;
+    }
+
+    if (err != 0) {
+        if (!is_exec_error(err)) {
+            if (stdout_fd >= 0) close(stdout_fd);
+            if (stderr_fd >= 0) close(stderr_fd);
+            return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(err);
+        }
+
+        // Nobody will ever write into these
+        if (stdout_read >= 0) { close(stdout_fd); stdout_fd = -1; }
+        if (stderr_read >= 0) { close(stderr_fd); stderr_fd = -1; }
+
+        // Same outcome as a forked child failing exec: a process that exited with 127
+        peu.result.pid = -1;
+        peu.result.exit_code = 127;
+        peu.result.term_signal = 0;
+
+        if (stdout_fd >= 0) peu.result.stdout_fd = stdout_fd;
+        if (stderr_fd >= 0) peu.result.stderr_fd = stderr_fd;
+        return ::sigil::yield();
     }
 
     peu.result.pid = pid;
 
+    if (peu.exec_mode == EXEC_ASYNC) {
+        // Child writes into memfds / pipes while running, the supervisor takes it from here
+        peu.result.pidfd = open_pidfd(pid);
+        peu.result.stdout_fd = stdout_fd;
+        peu.result.stderr_fd = stderr_fd;
+        return ::sigil::yield();
+    }
+
     if (peu.exec_mode == EXEC_REPLACE) {
         return ::sigil::yield();
     }
@@ -165,8 +1051,19 @@ static void normalize_wait_status(int status, proc_exec_result_t& out) {
         return ::sigil::yield();
     }
 
+    if (stdout_read >= 0 || stderr_read >= 0) {
+        drain_streams(peu, stdout_read, stderr_read);
+        if (stdout_read >= 0) close(stdout_read);
+        if (stderr_read >= 0) close(stderr_read);
+        stdout_fd = (stdout_read >= 0) ? -1 : stdout_fd;
+        stderr_fd = (stderr_read >= 0) ? -1 : stderr_fd;
+    }
+
     int status = 0;
-    if (waitpid(pid, &status, 0) < 0) {
+    if (zygote_reply >= 0) {
+        if (!zygote_wait(zygote_reply, status))
+            return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(EPIPE);
+    } else if (waitpid(pid, &status, 0) < 0) {
         return ::sigil::yield().set_state(sigil::yield_state::fail);
     }
 
@@ -186,6 +1083,340 @@ static void normalize_wait_status(int status, proc_exec_result_t& out) {
 }
 
 
+/* =========================
+   Async supervision
+   ========================= */
+
+static constexpr int supervisor_kill_grace_ms = 1000;
+
+struct supervised_child_t {
+    pid_t pid = -1;
+    int pidfd = -1;
+    proc_exec_result_t result = {};
+    exec_callback_t on_exit = {};
+    line_handler_t on_line = {};
+    int stream_fd[2] = { -1, -1 };      // STDIO_STREAM read ends, stdout / stderr
+    line_reader_t readers[2];
+    std::chrono::steady_clock::time_point deadline = {};
+    bool has_deadline = false;
+    bool term_sent = false;
+};
+
+struct exec_supervisor_t::state_t {
+    int epoll_fd = -1;
+    int timer_fd = -1;
+    uint64_t next_id = 1;
+    std::unordered_map<uint64_t, supervised_child_t> children;
+    std::vector<uint64_t> finished;     // ids done without an exit event (failed to start)
+    bool need_scan = false;             // some child has no pidfd, reap with WNOHANG
+};
+
+// epoll data: child id << 2 | channel, ids start at 1 so 0 is free for the timer
+static constexpr uint64_t supervisor_timer_tag = 0;
+static constexpr uint64_t supervisor_channel_exit = 0;
+
+static uint64_t supervisor_tag(uint64_t id, uint64_t channel) {
+    return (id << 2) | channel;
+}
+
+// Feed one stream of a child to its line handler, closes the pipe at EOF (or when final)
+static void pump_stream(exec_supervisor_t::state_t& st, supervised_child_t& c, int idx, bool final) {
+    int& fd = c.stream_fd[idx];
+    if (fd < 0)
+        return;
+
+    const int stream = idx == 0 ? STDOUT_FILENO : STDERR_FILENO;
+    auto emit = [&c, stream](std::string_view line) {
+        if (c.on_line) c.on_line(stream, line);
+    };
+
+    if (!c.readers[idx].pump(fd, emit) || final) {
+        c.readers[idx].finish(emit);
+        epoll_ctl(st.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        fd = -1;
+    }
+}
+
+static int pidfd_signal(const supervised_child_t& c, int sig) {
+#   if defined(SYS_pidfd_send_signal)
+    if (c.pidfd >= 0)
+        return static_cast<int>(syscall(SYS_pidfd_send_signal, c.pidfd, sig, nullptr, 0));
+#   endif
+    return kill(c.pid, sig);
+}
+
+// Re-arm the timerfd for the nearest deadline, disarm when there is none
+static void arm_supervisor_timer(exec_supervisor_t::state_t& st) {
+    using namespace std::chrono;
+
+    bool any = false;
+    steady_clock::time_point nearest = {};
+    for (const auto& [id, c] : st.children) {
+        if (c.has_deadline && (!any || c.deadline < nearest)) {
+            nearest = c.deadline;
+            any = true;
+        }
+    }
+
+    // No-pidfd children are polled on a short tick instead
+    if (st.need_scan) {
+        auto tick = steady_clock::now() + milliseconds(10);
+        if (!any || tick < nearest) nearest = tick;
+        any = true;
+    }
+
+    struct itimerspec its = {};
+    if (any) {
+        auto ns = duration_cast<nanoseconds>(nearest - steady_clock::now()).count();
+        if (ns < 1) ns = 1;
+        its.it_value.tv_sec = ns / 1'000'000'000;
+        its.it_value.tv_nsec = ns % 1'000'000'000;
+    }
+    timerfd_settime(st.timer_fd, 0, &its, nullptr);
+}
+
+exec_supervisor_t::exec_supervisor_t() : state(std::make_unique<state_t>()) {
+    state->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    state->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (state->epoll_fd >= 0 && state->timer_fd >= 0) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = supervisor_timer_tag;
+        epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, state->timer_fd, &ev);
+    }
+}
+
+exec_supervisor_t::~exec_supervisor_t() {
+    // Children keep running, only our handles go away
+    for (auto& [id, c] : state->children) {
+        if (c.pidfd >= 0) close(c.pidfd);
+        for (int fd : c.stream_fd) {
+            if (fd >= 0) close(fd);
+        }
+        if (c.result.stdout_fd >= 0) close(c.result.stdout_fd);
+        if (c.result.stderr_fd >= 0) close(c.result.stderr_fd);
+    }
+
+    if (state->timer_fd >= 0) close(state->timer_fd);
+    if (state->epoll_fd >= 0) close(state->epoll_fd);
+}
+
+::sigil::yield exec_supervisor_t::launch(proc_exec_unit_t& peu, exec_callback_t on_exit, int timeout_ms) {
+    ::sigil::yield ret;
+
+    if (state->epoll_fd < 0 || state->timer_fd < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOSYS);
+
+    peu.exec_mode = EXEC_ASYNC;
+    peu.result = {};
+
+    ret = execute(peu);
+    if (ret.is_failure())
+        return ret;
+
+    const uint64_t id = state->next_id++;
+    supervised_child_t& c = state->children[id];
+    c.pid = peu.result.pid;
+    c.pidfd = peu.result.pidfd;
+    c.result = peu.result;
+    c.on_exit = std::move(on_exit);
+    c.on_line = peu.on_line;
+
+    // Pipes are ours to drain, only memfds are handed to on_exit
+    if (peu.stdout_mode == STDIO_STREAM) {
+        c.stream_fd[0] = c.result.stdout_fd;
+        c.result.stdout_fd = -1;
+    }
+    if (peu.stderr_mode == STDIO_STREAM) {
+        c.stream_fd[1] = c.result.stderr_fd;
+        c.result.stderr_fd = -1;
+    }
+
+    // Never started, report on the next poll()
+    if (c.pid < 0) {
+        state->finished.push_back(id);
+        return ret.set_info(id);
+    }
+
+    if (timeout_ms >= 0) {
+        c.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        c.has_deadline = true;
+    }
+
+    if (c.pidfd >= 0) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = supervisor_tag(id, supervisor_channel_exit);
+        epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, c.pidfd, &ev);
+    } else {
+        state->need_scan = true;
+    }
+
+    for (int idx = 0; idx < 2; ++idx) {
+        if (c.stream_fd[idx] < 0)
+            continue;
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = supervisor_tag(id, static_cast<uint64_t>(idx + 1));
+        epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, c.stream_fd[idx], &ev);
+    }
+
+    arm_supervisor_timer(*state);
+    return ret.set_info(id);
+}
+
+::sigil::yield exec_supervisor_t::cancel(uint64_t id, int sig) {
+    ::sigil::yield ret;
+
+    auto it = state->children.find(id);
+    if (it == state->children.end() || it->second.pid < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(ESRCH);
+
+    if (pidfd_signal(it->second, sig) != 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    return ret;
+}
+
+// Collect the exit status if the child is gone, false while it still runs
+static bool try_reap(supervised_child_t& c) {
+    int status = 0;
+    pid_t r = waitpid(c.pid, &status, WNOHANG);
+    if (r == 0)
+        return false;
+
+    if (r == c.pid) {
+        normalize_wait_status(status, c.result);
+    } else {
+        // Reaped elsewhere (or never ours), nothing more to learn
+        c.result.exit_code = -1;
+    }
+
+    return true;
+}
+
+::sigil::yield exec_supervisor_t::poll(int timeout_ms) {
+    ::sigil::yield ret;
+    std::vector<uint64_t> done;
+    done.swap(state->finished);
+
+    if (!done.empty())
+        timeout_ms = 0;
+
+    struct epoll_event events[32];
+    int n = epoll_wait(state->epoll_fd, events, 32, timeout_ms);
+    if (n < 0 && errno != EINTR)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    bool timer_fired = false;
+    for (int i = 0; i < n; ++i) {
+        const uint64_t tag = events[i].data.u64;
+
+        if (tag == supervisor_timer_tag) {
+            uint64_t expirations;
+            (void)!read(state->timer_fd, &expirations, sizeof(expirations));
+            timer_fired = true;
+            continue;
+        }
+
+        const uint64_t id = tag >> 2;
+        const uint64_t channel = tag & 3;
+
+        auto it = state->children.find(id);
+        if (it == state->children.end())
+            continue;
+
+        if (channel != supervisor_channel_exit)
+            pump_stream(*state, it->second, static_cast<int>(channel - 1), false);
+        else if (try_reap(it->second))
+            done.push_back(id);
+    }
+
+    if (timer_fired || state->need_scan) {
+        const auto now = std::chrono::steady_clock::now();
+        bool still_scanning = false;
+
+        for (auto& [id, c] : state->children) {
+            if (c.pid < 0 || std::find(done.begin(), done.end(), id) != done.end())
+                continue;
+
+            if (c.pidfd < 0) {
+                if (try_reap(c)) {
+                    done.push_back(id);
+                    continue;
+                }
+                still_scanning = true;
+            }
+
+            if (c.has_deadline && now >= c.deadline) {
+                c.result.timed_out = true;
+                pidfd_signal(c, c.term_sent ? SIGKILL : SIGTERM);
+                c.deadline = now + std::chrono::milliseconds(supervisor_kill_grace_ms);
+                c.has_deadline = !c.term_sent;
+                c.term_sent = true;
+            }
+        }
+
+        state->need_scan = still_scanning;
+    }
+
+    for (uint64_t id : done) {
+        auto it = state->children.find(id);
+        if (it == state->children.end())
+            continue;
+
+        supervised_child_t c = std::move(it->second);
+        state->children.erase(it);
+
+        if (c.pidfd >= 0) {
+            epoll_ctl(state->epoll_fd, EPOLL_CTL_DEL, c.pidfd, nullptr);
+            close(c.pidfd);
+        }
+
+        // Whatever the child wrote before exiting, a lingering grandchild does not hold us up
+        pump_stream(*state, c, 0, true);
+        pump_stream(*state, c, 1, true);
+
+        c.result.pidfd = -1;
+        if (c.result.stdout_fd >= 0) lseek(c.result.stdout_fd, 0, SEEK_SET);
+        if (c.result.stderr_fd >= 0) lseek(c.result.stderr_fd, 0, SEEK_SET);
+
+        // Callback owns the captured fds from here on
+        if (c.on_exit) {
+            c.on_exit(c.result);
+        } else {
+            if (c.result.stdout_fd >= 0) close(c.result.stdout_fd);
+            if (c.result.stderr_fd >= 0) close(c.result.stderr_fd);
+        }
+    }
+
+    arm_supervisor_timer(*state);
+    return ret.set_info(done.size());
+}
+
+::sigil::yield exec_supervisor_t::run() {
+    ::sigil::yield ret;
+
+    while (!state->children.empty()) {
+        ret = poll(-1);
+        if (ret.is_failure())
+            return ret;
+    }
+
+    return ret;
+}
+
+std::size_t exec_supervisor_t::active() const noexcept {
+    return state->children.size();
+}
+
+int exec_supervisor_t::fd() const noexcept {
+    return state->epoll_fd;
+}
+
+
 ::sigil::yield
 register_command(command_registry_t& reg, const command_t& cmd) {
 
@@ -196,12 +1427,9 @@ register_command(command_registry_t& reg, const command_t& cmd) {
         for (const auto& w : cmd.words) {
             auto it = node->children.find(w);
             if (it == node->children.end()) {
-                command_node_t* child = new command_node_t;
-                node->children.emplace(w, child);
-                node = child;
-            } else {
-                node = it->second;
+                it = node->children.emplace(w, std::make_unique<command_node_t>()).first;
             }
+            node = it->second.get();
         }
     }
 
@@ -231,142 +1459,161 @@ register_command(command_registry_t& reg, const std::vector<command_t>& cmds) {
     return accum;
 }
 
-std::vector<std::string> tokenize(std::string input) {
-    std::vector<std::string> out;
-    std::istringstream ss(input);
-    std::string tok;
-    while (ss >> tok) {
-        out.push_back(std::move(tok));
+::sigil::yield tokenize(std::string_view input, cmd_tokens_t& out) {
+    ::sigil::yield ret;
+    constexpr std::string_view ws = " \t\n\r\f\v";
+
+    std::size_t pos = input.find_first_not_of(ws);
+    while (pos != std::string_view::npos) {
+        std::size_t end = input.find_first_of(ws, pos);
+        if (end == std::string_view::npos) end = input.size();
+
+        if (!out.push_back(input.substr(pos, end - pos)))
+            return ret.set_state(sigil::yield_state::fail).set_code(E2BIG);
+
+        pos = input.find_first_not_of(ws, end);
     }
-    return out;
+
+    return ret;
 }
 
-void extract_switches(std::vector<std::string>& tokens, command_registry_t& out_runtime) {
-    std::vector<std::string> filtered;
-    filtered.reserve(tokens.size());
+::sigil::yield extract_switches(const cmd_tokens_t& tokens, cmd_handler_args_t& out) {
+    ::sigil::yield ret;
 
-    for (auto& tok : tokens) {
-        if (starts_with(tok, "--")) {
-            switch_arg_t sw;
+    for (std::string_view tok : tokens) {
+        if (!tok.starts_with("--")) {
+            if (!out.args.push_back(tok))
+                return ret.set_state(sigil::yield_state::fail).set_code(E2BIG);
+            continue;
+        }
 
-            auto eq_pos = tok.find('=');
-            if (eq_pos != std::string::npos) {
-                sw.name = tok.substr(0, eq_pos);
-                std::string val = tok.substr(eq_pos + 1);
+        switch_arg_t sw;
+        const std::size_t eq_pos = tok.find('=');
 
-                if (val.empty()) {
-                    throw std::runtime_error("Switch '" + sw.name + "' requires a value after '='");
-                }
+        if (eq_pos != std::string_view::npos) {
+            sw.name = tok.substr(0, eq_pos);
+            sw.value = tok.substr(eq_pos + 1);
 
-                sw.value = val;
-            } else {
-                sw.name = tok;
-                sw.value = std::nullopt;
+            if (sw.value->empty()) {
+                std::cerr << "Switch '" << sw.name << "' requires a value after '='" << std::endl;
+                return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
             }
-
-            out_runtime.switches.push_back(std::move(sw));
         } else {
-            filtered.push_back(tok);
+            sw.name = tok;
         }
+
+        if (!out.switches.push_back(sw))
+            return ret.set_state(sigil::yield_state::fail).set_code(E2BIG);
     }
 
-    tokens.swap(filtered);
+    return ret;
 }
 
+// Hand leftover words to a matched handler, if it takes them
+static ::sigil::yield run_handler(command_handler_t handler, bool passthrough,
+                                  std::size_t consumed, cmd_handler_args_t& handler_args) {
+    if (handler == nullptr)
+        return ::sigil::yield().set_state(sigil::yield_state::fail);
 
-::sigil::yield execute_command
-(const command_registry_t& runtime_registry, const std::vector<std::string>& tokens) {
-    ::sigil::yield ret;
+    if (consumed < handler_args.args.size() && !passthrough)
+        return ::sigil::yield().set_state(sigil::yield_state::fail);
 
-    command_node_t* node =
-        const_cast<command_node_t*>(&runtime_registry.root);
+    handler_args.args.erase_front(consumed);
+    return handler(handler_args);
+}
 
+::sigil::yield execute_command(const command_registry_t& reg, cmd_handler_args_t& handler_args) {
+    const cmd_tokens_t &tokens = handler_args.args;
+    const command_node_t* node = &reg.root;
     std::size_t idx = 0;
-    const std::size_t n = tokens.size();
 
-    // Special case: no positional tokens
-    if (tokens.empty()) {
-        if (node->handler != nullptr) {
-            ::sigil::platform::cmd_handler_args_t args;
-            args.switches = runtime_registry.switches;
-            return node->handler(args);
-        }
-        return ret.set_state(sigil::yield_state::fail);
-    }
-
-    while (idx < n) {
+    while (idx < tokens.size()) {
         auto it = node->children.find(tokens[idx]);
         if (it == node->children.end())
             break;
-        node = it->second;
+        node = it->second.get();
         ++idx;
     }
 
-    const std::size_t leftover_count = n - idx;
+    return run_handler(node->handler, node->passthrough, idx, handler_args);
+}
 
-    if (node->handler != nullptr) {
+// Longest word path of the table that prefixes the positional words
+static ::sigil::yield execute_command(const command_index_t& index, cmd_handler_args_t& handler_args) {
+    const cmd_tokens_t &tokens = handler_args.args;
+    const std::size_t limit = std::min(index.max_depth, tokens.size());
 
-        ::sigil::platform::cmd_handler_args_t handler_args;
-        handler_args.switches = runtime_registry.switches;
+    std::array<uint32_t, max_command_depth + 1> prefix_hash;
+    prefix_hash[0] = command_hash_seed(index.seed);
+    for (std::size_t d = 0; d < limit; ++d)
+        prefix_hash[d + 1] = command_hash_step(prefix_hash[d], tokens[d]);
 
-        if (leftover_count == 0) {
-            return node->handler(handler_args);
-        }
+    for (std::size_t d = limit + 1; d-- > 0;) {
+        const int16_t slot = index.slots[command_hash_mix(prefix_hash[d]) & index.mask];
+        if (slot < 0)
+            continue;
 
-        if (node->passthrough) {
-            handler_args.args.reserve(leftover_count);
-            for (std::size_t i = idx; i < n; ++i)
-                handler_args.args.push_back(tokens[i]);
+        const command_spec_t &entry = index.entries[slot];
+        if (entry.depth() != d)
+            continue;
 
-            return node->handler(handler_args);
-        }
+        bool match = true;
+        for (std::size_t w = 0; w < d && match; ++w)
+            match = entry.words[w] == tokens[w];
 
-        return ret.set_state(sigil::yield_state::fail);
+        if (match)
+            return run_handler(entry.handler, entry.passthrough, d, handler_args);
     }
 
-    // No handler at this node
-    if (!node->children.empty()) {
-        return ret.set_state(sigil::yield_state::fail);
-    }
-
-    return ret.set_state(sigil::yield_state::fail);
+    return ::sigil::yield().set_state(sigil::yield_state::fail);
 }
 
-
-::sigil::yield dispatch_command
-(const command_registry_t& reg, const int argc, const char** argv) {
-    ::sigil::yield st;
-    // if (argc <= 1) {
-    //     return st.set_state(sigil::yield_state::fail);
-    // }
-
-    // build tokens skipping argv[0] (program name)
-    std::vector<std::string> tokens;
-    tokens.reserve(static_cast<std::size_t>(argc - 1));
+// argv without the program name, as views
+static ::sigil::yield argv_tokens(const int argc, const char* const* argv, cmd_tokens_t& out) {
     for (int i = 1; i < argc; ++i) {
-        if (argv[i] != nullptr) tokens.emplace_back(argv[i]);
+        if (argv[i] != nullptr && !out.push_back(argv[i]))
+            return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(E2BIG);
     }
+    return {};
+}
 
-    // make runtime registry copy (shares tree pointers)
-    command_registry_t runtime = reg;
+template <typename registry_t>
+static ::sigil::yield dispatch_tokens(const registry_t& reg, const cmd_tokens_t& tokens) {
+    cmd_handler_args_t handler_args;
 
-    // extract switches into runtime.switches, tokens filtered
-    extract_switches(tokens, runtime);
+    ::sigil::yield st = extract_switches(tokens, handler_args);
+    if (st.is_failure())
+        return st;
 
-    // execute
-    return execute_command(runtime, tokens);
+    return execute_command(reg, handler_args);
 }
 
-::sigil::yield
-dispatch_command(const command_registry_t& reg, std::string input) {
-    auto tokens = tokenize(input);
+::sigil::yield dispatch_command
+(const command_registry_t& reg, const int argc, const char* const* argv) {
+    cmd_tokens_t tokens;
+    ::sigil::yield st = argv_tokens(argc, argv, tokens);
+    return st.is_failure() ? st : dispatch_tokens(reg, tokens);
+}
 
-    // make runtime registry copy
-    command_registry_t runtime = reg;
+::sigil::yield
+dispatch_command(const command_registry_t& reg, std::string_view input) {
+    cmd_tokens_t tokens;
+    ::sigil::yield st = tokenize(input, tokens);
+    return st.is_failure() ? st : dispatch_tokens(reg, tokens);
+}
 
-    extract_switches(tokens, runtime);
+::sigil::yield dispatch_command
+(const command_index_t& index, const int argc, const char* const* argv) {
+    cmd_tokens_t tokens;
+    ::sigil::yield st = argv_tokens(argc, argv, tokens);
+    return st.is_failure() ? st : dispatch_tokens(index, tokens);
+}
 
-    return execute_command(runtime, tokens);
+::sigil::yield
+dispatch_command(const command_index_t& index, std::string_view input) {
+    cmd_tokens_t tokens;
+    ::sigil::yield st = tokenize(input, tokens);
+    return st.is_failure() ? st : dispatch_tokens(index, tokens);
 }
 
 
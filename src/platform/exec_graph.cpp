@@ -0,0 +1,179 @@
+#include <sigil/platform/exec_graph.h>
+#include <sigil/platform/exec.h>
+#include <sigil/common.h>
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+
+#include <unistd.h>
+
+namespace sigil::platform {
+
+std::size_t exec_graph_t::add(const std::string &label, const proc_exec_unit_t &peu,
+                              const std::vector<std::size_t> &deps, bool required, int timeout_ms) {
+    exec_node_t node;
+    node.label = label;
+    node.peu = peu;
+    node.deps = deps;
+    node.required = required;
+    node.timeout_ms = timeout_ms;
+
+    nodes.push_back(std::move(node));
+    return nodes.size() - 1;
+}
+
+::sigil::yield exec_graph_t::run() {
+    ::sigil::yield ret;
+
+    const std::size_t n = nodes.size();
+    std::vector<std::vector<std::size_t>> dependents(n);
+    std::vector<std::size_t> waiting(n, 0);
+    std::vector<std::size_t> ready;
+
+    for (std::size_t i = 0; i < n; ++i) {
+        nodes[i].state = EXEC_NODE_PENDING;
+        for (std::size_t d : nodes[i].deps) {
+            if (d >= i)
+                return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+            dependents[d].push_back(i);
+        }
+        waiting[i] = nodes[i].deps.size();
+        if (waiting[i] == 0)
+            ready.push_back(i);
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    auto now_ms = [&] {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    };
+
+    exec_supervisor_t sup;
+
+    auto finish = [&](std::size_t i) {
+        nodes[i].end_ms = now_ms();
+        for (std::size_t d : dependents[i]) {
+            if (--waiting[d] == 0)
+                ready.push_back(d);
+        }
+    };
+
+    while (!ready.empty() || sup.active() > 0) {
+        // finish() may queue more while we go, hence the index loop
+        for (std::size_t r = 0; r < ready.size(); ++r) {
+            const std::size_t i = ready[r];
+            exec_node_t &node = nodes[i];
+
+            const bool blocked = std::any_of(node.deps.begin(), node.deps.end(), [&](std::size_t d) {
+                const exec_node_t &dep = nodes[d];
+                return dep.state == EXEC_NODE_SKIPPED
+                    || (dep.required && dep.peu.result.exit_code != 0);
+            });
+
+            node.start_ms = now_ms();
+
+            if (blocked) {
+                node.state = EXEC_NODE_SKIPPED;
+                finish(i);
+                continue;
+            }
+
+            node.state = EXEC_NODE_RUNNING;
+
+            // Nothing waits for a detached step, spawning it is its success
+            if (node.peu.exec_mode == EXEC_DETACH) {
+                ::sigil::yield st = execute(node.peu);
+                node.peu.result.exit_code = st.is_ok() ? 0 : -1;
+                ret |= st;
+                node.state = EXEC_NODE_DONE;
+                finish(i);
+                continue;
+            }
+
+            ::sigil::yield st = sup.launch(node.peu, [&, i](const proc_exec_result_t &res) {
+                nodes[i].peu.result = res;
+                nodes[i].peu.result.stdout_fd = -1;
+                nodes[i].peu.result.stderr_fd = -1;
+                if (res.stdout_fd >= 0) close(res.stdout_fd);
+                if (res.stderr_fd >= 0) close(res.stderr_fd);
+                nodes[i].state = EXEC_NODE_DONE;
+                finish(i);
+            }, node.timeout_ms);
+
+            if (st.is_failure()) {
+                ret |= st;
+                node.peu.result.exit_code = -1;
+                node.state = EXEC_NODE_DONE;
+                finish(i);
+            }
+        }
+        ready.clear();
+
+        if (sup.active() > 0) {
+            ::sigil::yield st = sup.poll(-1);
+            if (st.is_failure())
+                return ret |= st;
+        }
+    }
+
+    return ret;
+}
+
+std::vector<std::size_t> exec_graph_t::critical_path() const {
+    std::vector<std::size_t> path;
+    if (nodes.empty())
+        return path;
+
+    auto latest = [&](const std::vector<std::size_t> &candidates) {
+        std::size_t best = candidates.front();
+        for (std::size_t c : candidates) {
+            if (nodes[c].end_ms > nodes[best].end_ms) best = c;
+        }
+        return best;
+    };
+
+    std::vector<std::size_t> all(nodes.size());
+    for (std::size_t i = 0; i < all.size(); ++i) all[i] = i;
+
+    std::size_t cur = latest(all);
+    path.push_back(cur);
+    while (!nodes[cur].deps.empty()) {
+        cur = latest(nodes[cur].deps);
+        path.push_back(cur);
+    }
+
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+std::string exec_graph_t::timings() const {
+    const std::vector<std::size_t> critical = critical_path();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        const exec_node_t &node = nodes[i];
+        const bool on_path = std::find(critical.begin(), critical.end(), i) != critical.end();
+
+        out << (on_path ? "* " : "  ")
+            << std::left << std::setw(24) << node.label << std::right
+            << " +" << std::setw(7) << node.start_ms << "ms "
+            << std::setw(8) << (node.end_ms - node.start_ms) << "ms";
+
+        if (node.state == EXEC_NODE_SKIPPED)
+            out << "  skipped";
+        else if (node.peu.exec_mode == EXEC_DETACH)
+            out << "  detached";
+        else if (node.peu.result.timed_out)
+            out << "  timed out";
+        else
+            out << "  exit " << node.peu.result.exit_code;
+
+        out << "\n";
+    }
+
+    return out.str();
+}
+
+} // namespace sigil::platform
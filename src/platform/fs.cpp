@@ -1,17 +1,36 @@
+#include <sigil/platform/capabilities.h>
 #include <sigil/platform/fs.h>
 #include <sigil/utils/time.h>
 #include <sigil/common.h>
 
 #include <system_error>
 #include <filesystem>
+#include <unordered_map>
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <cstddef>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
 #include <cstdio>
 #include <string>
 
+#include <linux/fiemap.h>
+#include <sys/sysmacros.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cerrno>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 namespace sigil::fs {
 
 file_handler_t::file_handler_t(const std::filesystem::path path) {
@@ -88,106 +107,603 @@ file_handler_t::~file_handler_t() {
     return ret;
 }
 
-bool binary_exists_in_path(const char* name) {
-    const char* path = getenv("PATH");
-    if (!path)
+struct file_key_hash_t {
+    std::size_t operator()(const file_key_t &k) const noexcept {
+        uint64_t h = k.ino * 0x9E3779B97F4A7C15ULL;
+        h ^= k.dev + 0x517CC1B727220A95ULL + (h << 6) + (h >> 2);
+        h ^= k.size + 0x517CC1B727220A95ULL + (h << 6) + (h >> 2);
+        h ^= static_cast<uint64_t>(k.mtime_sec) * 1000000007ULL + k.mtime_nsec;
+        return static_cast<std::size_t>(h);
+    }
+};
+
+static struct {
+    std::mutex lock;
+    std::unordered_map<file_key_t, file_digest_t, file_key_hash_t> entries;
+} digest_cache;
+
+static constexpr unsigned identity_mask =
+    STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO;
+
+static void key_from_statx(const struct statx &st, file_key_t &out) {
+    out.dev        = makedev(st.stx_dev_major, st.stx_dev_minor);
+    out.ino        = st.stx_ino;
+    out.size       = st.stx_size;
+    out.mtime_sec  = st.stx_mtime.tv_sec;
+    out.mtime_nsec = st.stx_mtime.tv_nsec;
+}
+
+bool get_file_key(const std::filesystem::path &p, file_key_t &out) {
+    struct statx st{};
+    if (statx(AT_FDCWD, p.c_str(), AT_STATX_SYNC_AS_STAT, identity_mask, &st) != 0)
+        return false;
+    key_from_statx(st, out);
+    return true;
+}
+
+void digest_cache_store(const file_key_t &key, const file_digest_t &digest) {
+    std::lock_guard<std::mutex> guard(digest_cache.lock);
+    digest_cache.entries[key] = digest;
+}
+
+bool digest_cache_lookup(const file_key_t &key, file_digest_t &out) {
+    std::lock_guard<std::mutex> guard(digest_cache.lock);
+    auto it = digest_cache.entries.find(key);
+    if (it == digest_cache.entries.end())
         return false;
+    out = it->second;
+    return true;
+}
+
+static bool statx_path(const char *path, struct statx &out) {
+    return statx(AT_FDCWD, path, AT_STATX_SYNC_AS_STAT,
+                 identity_mask | STATX_ATIME, &out) == 0;
+}
+
+static bool same_mtime(const struct statx &a, const struct statx &b) {
+    return a.stx_mtime.tv_sec == b.stx_mtime.tv_sec
+        && a.stx_mtime.tv_nsec == b.stx_mtime.tv_nsec;
+}
+
+// Both sides hashed earlier (dedup, manifests) and the digests agree
+static bool same_cached_digest(const struct statx &a, const struct statx &b) {
+    file_key_t ka, kb;
+    file_digest_t da, db;
+    key_from_statx(a, ka);
+    key_from_statx(b, kb);
+    return digest_cache_lookup(ka, da) && digest_cache_lookup(kb, db) && da == db;
+}
+
+static bool write_all(int fd, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        ssize_t w = ::write(fd, buf, len);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buf += w;
+        len -= static_cast<size_t>(w);
+    }
+    return true;
+}
 
-    std::string p(path);
-    size_t pos = 0;
+// Returns bytes moved by copy_file_range, or -1 if the kernel / filesystem
+// refused it before anything was written (caller falls back to buffered copy).
+static int64_t copy_range(int sfd, int dfd, uint64_t size) {
+    uint64_t done = 0;
+
+    while (done < size) {
+        ssize_t n = copy_file_range(sfd, nullptr, dfd, nullptr, size - done, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (done == 0 && (errno == EXDEV || errno == ENOSYS ||
+                              errno == EOPNOTSUPP || errno == EINVAL))
+                return -1;
+            return -2;
+        }
+        if (n == 0) break; // source shrank underneath us
+        done += static_cast<uint64_t>(n);
+    }
+
+    return static_cast<int64_t>(done);
+}
+
+static bool copy_buffered(int sfd, int dfd) {
+    constexpr size_t buffer_size = 256 * 1024;
+    thread_local std::vector<uint8_t> buffer(buffer_size);
+
+    if (lseek(sfd, 0, SEEK_SET) < 0 || lseek(dfd, 0, SEEK_SET) < 0)
+        return false;
+    if (ftruncate(dfd, 0) != 0)
+        return false;
 
     while (true) {
-        size_t next = p.find(':', pos);
-        std::string dir = p.substr(pos, next - pos);
-        std::filesystem::path test = std::filesystem::path(dir) / name;
-        if (std::filesystem::exists(test))
-            return true;
-        if (next == std::string::npos)
-            break;
-        pos = next + 1;
+        ssize_t r = ::read(sfd, buffer.data(), buffer.size());
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (r == 0) break;
+        if (!write_all(dfd, buffer.data(), static_cast<size_t>(r)))
+            return false;
     }
-    return false;
+
+    return true;
 }
 
-::sigil::yield
-copy_tree(std::filesystem::path &src, std::filesystem::path &dst) {
+static ::sigil::yield copy_file_impl(
+    const char *src,
+    const char *dst,
+    const struct statx &sst,
+    copy_stats_t &stats,
+    bool skip_unchanged
+) {
     ::sigil::yield ret;
 
-    ::sigil::contain(ret, [&] {
-        if (!std::filesystem::exists(src))
-            throw std::runtime_error("source path does not exist");
+    if (skip_unchanged) {
+        struct statx dst_st{};
+        if (statx_path(dst, dst_st)
+            && S_ISREG(dst_st.stx_mode)
+            && dst_st.stx_size == sst.stx_size
+            && (same_mtime(dst_st, sst) || same_cached_digest(dst_st, sst))) {
+            stats.files_skipped++;
+            stats.bytes_skipped += sst.stx_size;
+            return ret;
+        }
+    }
 
-        if (std::filesystem::is_regular_file(src)) {
-            std::filesystem::create_directories(dst.parent_path());
-            std::filesystem::copy_file(
-                src,
-                dst,
-                std::filesystem::copy_options::overwrite_existing
-            );
-            return;
+    int sfd = ::open(src, O_RDONLY | O_CLOEXEC);
+    if (sfd < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    const mode_t mode = sst.stx_mode & 07777;
+    int dfd = ::open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (dfd < 0) {
+        int err = errno;
+        ::close(sfd);
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    }
+
+    bool ok = true;
+
+    if (ioctl(dfd, FICLONE, sfd) == 0) {
+        stats.files_cloned++;
+        stats.bytes_cloned += sst.stx_size;
+    } else {
+        int64_t moved = copy_range(sfd, dfd, sst.stx_size);
+        if (moved == -1)
+            ok = copy_buffered(sfd, dfd);
+        else if (moved < 0)
+            ok = false;
+
+        if (ok) {
+            stats.files_copied++;
+            stats.bytes_copied += sst.stx_size;
         }
+    }
+
+    int err = ok ? 0 : errno;
+
+    if (ok) {
+        // Carry over mode and mtime, the latter is what skip_unchanged keys on
+        const struct timespec times[2] = {
+            { static_cast<time_t>(sst.stx_atime.tv_sec), static_cast<long>(sst.stx_atime.tv_nsec) },
+            { static_cast<time_t>(sst.stx_mtime.tv_sec), static_cast<long>(sst.stx_mtime.tv_nsec) },
+        };
+        fchmod(dfd, mode);
+        futimens(dfd, times);
+    }
+
+    ::close(sfd);
+    if (::close(dfd) != 0 && ok) {
+        ok = false;
+        err = errno;
+    }
+
+    if (!ok)
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+
+    return ret;
+}
+
+::sigil::yield clone_or_copy_file(
+    const std::filesystem::path &src,
+    const std::filesystem::path &dst,
+    copy_stats_t &stats,
+    bool skip_unchanged
+) {
+    struct statx sst{};
+    if (!statx_path(src.c_str(), sst))
+        return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(errno);
+
+    if (!S_ISREG(sst.stx_mode))
+        return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(EINVAL);
+
+    return copy_file_impl(src.c_str(), dst.c_str(), sst, stats, skip_unchanged);
+}
+
+struct copy_job_t {
+    std::filesystem::path src;
+    std::filesystem::path dst;
+    bool link = false;      // hardlink instead of copying, see clone_tree
+};
+
+// link(2) refusals that leave a copy as the way out
+static bool link_refused(int err) {
+    return err == EXDEV || err == EPERM || err == EMLINK || err == ENOTSUP || err == EOPNOTSUPP;
+}
+
+static ::sigil::yield run_copy_job(const copy_job_t &job, copy_stats_t &stats, bool skip_unchanged) {
+    struct statx sst{};
+    if (!statx_path(job.src.c_str(), sst))
+        return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(errno);
+
+    if (job.link) {
+        if (::link(job.src.c_str(), job.dst.c_str()) == 0) {
+            stats.files_linked++;
+            stats.bytes_linked += sst.stx_size;
+            return ::sigil::yield();
+        }
+        if (!link_refused(errno))
+            return ::sigil::yield().set_state(sigil::yield_state::fail).set_code(errno);
+    }
+
+    return copy_file_impl(job.src.c_str(), job.dst.c_str(), sst, stats, skip_unchanged);
+}
+
+// Files are independent once their directories exist, split them over a small pool
+static ::sigil::yield run_copy_jobs(const std::vector<copy_job_t> &jobs, std::size_t first,
+                                    copy_stats_t &stats, bool skip_unchanged) {
+    ::sigil::yield ret;
+    if (first >= jobs.size())
+        return ret;
+
+    constexpr std::size_t files_per_worker = 8;
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned workers = static_cast<unsigned>(
+        std::min<std::size_t>(hw, (jobs.size() - first + files_per_worker - 1) / files_per_worker));
+
+    std::vector<copy_stats_t> worker_stats(workers);
+    std::vector<::sigil::yield> worker_ret(workers);
+    std::atomic<std::size_t> index{first};
+
+    auto worker = [&](unsigned w) {
+        while (true) {
+            std::size_t i = index.fetch_add(1, std::memory_order_relaxed);
+            if (i >= jobs.size())
+                break;
+
+            worker_ret[w] |= run_copy_job(jobs[i], worker_stats[w], skip_unchanged);
+        }
+    };
+
+    if (workers <= 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> pool;
+        pool.reserve(workers);
+        for (unsigned w = 0; w < workers; ++w)
+            pool.emplace_back(worker, w);
+        for (auto& t : pool)
+            t.join();
+    }
+
+    for (unsigned w = 0; w < workers; ++w) {
+        stats += worker_stats[w];
+        ret |= worker_ret[w];
+    }
+
+    return ret;
+}
 
+::sigil::yield
+copy_tree(const std::filesystem::path &src, const std::filesystem::path &dst, copy_stats_t &stats) {
+    ::sigil::yield ret;
+
+    struct statx root{};
+    if (!statx_path(src.c_str(), root))
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOENT);
+
+    if (S_ISREG(root.stx_mode)) {
+        ::sigil::contain(ret, [&] {
+            if (dst.has_parent_path())
+                std::filesystem::create_directories(dst.parent_path());
+        });
+        if (!ret.is_ok())
+            return ret;
+
+        return copy_file_impl(src.c_str(), dst.c_str(), root, stats, true);
+    }
+
+    // Phase 1: walk once, create each directory once, collect file jobs
+    std::vector<copy_job_t> jobs;
+
+    ::sigil::contain(ret, [&] {
         std::filesystem::create_directories(dst);
 
         for (const auto& entry : std::filesystem::recursive_directory_iterator(src)) {
-            const auto relative = std::filesystem::relative(entry.path(), src);
-            const auto target   = dst / relative;
+            const auto target = dst / entry.path().lexically_relative(src);
 
             if (entry.is_directory()) {
-                std::filesystem::create_directories(target);
+                std::filesystem::create_directory(target);
             } else if (entry.is_regular_file()) {
-                std::filesystem::create_directories(target.parent_path());
-                std::filesystem::copy_file(
-                    entry.path(),
-                    target,
-                    std::filesystem::copy_options::overwrite_existing
-                );
+                jobs.push_back({ entry.path(), target });
             }
         }
     });
 
-    return ret;
+    if (!ret.is_ok() || jobs.empty())
+        return ret;
+
+    // Phase 2: copy files
+    return run_copy_jobs(jobs, 0, stats, true);
+}
+
+::sigil::yield
+clone_tree(const std::filesystem::path &src, const std::filesystem::path &dst, copy_stats_t &stats,
+           const std::function<bool(const std::filesystem::path &)> &may_link) {
+    ::sigil::yield ret;
+
+    std::error_code ec;
+    if (!std::filesystem::is_directory(src, ec))
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOTDIR);
+    if (std::filesystem::exists(std::filesystem::symlink_status(dst, ec)))
+        return ret.set_state(sigil::yield_state::fail).set_code(EEXIST);
+
+    // Phase 1: directories keep their modes, symlinks are recreated, not followed
+    std::vector<copy_job_t> jobs;
+
+    ::sigil::contain(ret, [&] {
+        if (dst.has_parent_path())
+            std::filesystem::create_directories(dst.parent_path());
+        std::filesystem::create_directory(dst, src);
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(src)) {
+            const auto rel = entry.path().lexically_relative(src);
+            const auto target = dst / rel;
+
+            if (entry.is_symlink()) {
+                std::filesystem::copy_symlink(entry.path(), target);
+            } else if (entry.is_directory()) {
+                std::filesystem::create_directory(target, entry.path());
+            } else if (entry.is_regular_file()) {
+                jobs.push_back({ entry.path(), target, false });
+                if (may_link && may_link(rel))
+                    jobs.back().link = true;
+            }
+        }
+    });
+
+    if (!ret.is_ok() || jobs.empty())
+        return ret;
+
+    // Phase 2: the first file tells whether this filesystem reflinks, hardlinks
+    // are only worth their sharing of one inode when it does not
+    copy_job_t probe = jobs.front();
+    probe.link = false;
+    const uint64_t cloned_before = stats.files_cloned;
+    ret |= run_copy_job(probe, stats, false);
+    if (!ret.is_ok())
+        return ret;
+
+    if (stats.files_cloned != cloned_before) {
+        for (auto &job : jobs)
+            job.link = false;
+    }
+
+    return run_copy_jobs(jobs, 1, stats, false);
 }
 
+::sigil::yield
+copy_tree(const std::filesystem::path &src, const std::filesystem::path &dst) {
+    copy_stats_t stats;
+    return copy_tree(src, dst, stats);
+}
+
+
+#ifdef __AVX2__
+static bool bytes_equal_avx2(const uint8_t *a, const uint8_t *b, size_t n) {
+    size_t i = 0;
+
+    // 128 bytes per iteration, OR the differences and test once
+    for (; i + 128 <= n; i += 128) {
+        __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i +  0)),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i +  0)));
+        __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32)),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32)));
+        __m256i x2 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 64)),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 64)));
+        __m256i x3 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 96)),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 96)));
+
+        __m256i any = _mm256_or_si256(_mm256_or_si256(x0, x1), _mm256_or_si256(x2, x3));
+        if (!_mm256_testz_si256(any, any))
+            return false;
+    }
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        if (!_mm256_testz_si256(x, x))
+            return false;
+    }
 
-bool files_are_identical(const std::filesystem::path &a, const std::filesystem::path &b){
-    if (!std::filesystem::exists(a) ||
-        !std::filesystem::exists(b))
+    return std::memcmp(a + i, b + i, n - i) == 0;
+}
+#endif
+
+static bool bytes_equal(const uint8_t *a, const uint8_t *b, size_t n) {
+#ifdef __AVX2__
+    if (platform::has_avx2())
+        return bytes_equal_avx2(a, b, n);
+#endif
+    return std::memcmp(a, b, n) == 0;
+}
+
+// Same device and every extent at the same physical offset: a reflink (or a
+// clone of one). Anything ambiguous (inline, delalloc, encoded) falls through.
+static bool extents_are_shared(int fa, int fb) {
+    constexpr uint32_t max_extents = 64;
+    constexpr uint32_t untrusted =
+        FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_ENCODED |
+        FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_NOT_ALIGNED | FIEMAP_EXTENT_UNWRITTEN;
+
+    struct fiemap_buffer_t {
+        alignas(struct fiemap) uint8_t raw[sizeof(struct fiemap) + max_extents * sizeof(struct fiemap_extent)];
+        struct fiemap* map() { return reinterpret_cast<struct fiemap*>(raw); }
+    };
+
+    auto query = [&](int fd, fiemap_buffer_t &buf) {
+        std::memset(buf.raw, 0, sizeof(buf.raw));
+        buf.map()->fm_start = 0;
+        buf.map()->fm_length = FIEMAP_MAX_OFFSET;
+        buf.map()->fm_flags = FIEMAP_FLAG_SYNC;
+        buf.map()->fm_extent_count = max_extents;
+        return ioctl(fd, FS_IOC_FIEMAP, buf.map()) == 0;
+    };
+
+    fiemap_buffer_t ba, bb;
+    if (!query(fa, ba) || !query(fb, bb))
         return false;
 
-    if (!std::filesystem::is_regular_file(a) ||
-        !std::filesystem::is_regular_file(b))
+    const struct fiemap *ea = ba.map();
+    const struct fiemap *eb = bb.map();
+
+    const uint32_t n = ea->fm_mapped_extents;
+    if (n == 0 || n != eb->fm_mapped_extents || n >= max_extents)
         return false;
 
-    if (std::filesystem::file_size(a) !=
-        std::filesystem::file_size(b))
+    if (!(ea->fm_extents[n - 1].fe_flags & FIEMAP_EXTENT_LAST))
         return false;
 
-    std::ifstream fa(a, std::ios::binary);
-    std::ifstream fb(b, std::ios::binary);
+    for (uint32_t i = 0; i < n; ++i) {
+        const auto &x = ea->fm_extents[i];
+        const auto &y = eb->fm_extents[i];
+        if ((x.fe_flags | y.fe_flags) & untrusted)
+            return false;
+        if (!(x.fe_flags & FIEMAP_EXTENT_SHARED))
+            return false;
+        if (x.fe_logical != y.fe_logical || x.fe_physical != y.fe_physical || x.fe_length != y.fe_length)
+            return false;
+    }
+
+    return true;
+}
 
-    if (!fa || !fb)
+// [off, end) of both files, a short read (a file truncated under us) counts as a mismatch
+static bool compare_range(int fa, int fb, uint64_t off, uint64_t end,
+                          std::vector<uint8_t> &ba, std::vector<uint8_t> &bb) {
+    while (off < end) {
+        const size_t want = static_cast<size_t>(std::min<uint64_t>(ba.size(), end - off));
+        ssize_t ra = pread(fa, ba.data(), want, static_cast<off_t>(off));
+        ssize_t rb = pread(fb, bb.data(), want, static_cast<off_t>(off));
+        if (ra <= 0 || ra != rb)
+            return false;
+        if (!bytes_equal(ba.data(), bb.data(), static_cast<size_t>(ra)))
+            return false;
+        off += static_cast<uint64_t>(ra);
+    }
+
+    return true;
+}
+
+// pread, never mmap: a file shrinking under a mapping raises SIGBUS
+static bool compare_by_read(int fa, int fb, uint64_t size) {
+    constexpr size_t buffer_size = 256 * 1024;
+    constexpr uint64_t window = 1ull << 20;         // 1 MiB
+    constexpr uint64_t parallel_threshold = 64ull << 20;
+
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+
+    if (size < parallel_threshold || hw == 1) {
+        std::vector<uint8_t> ba(buffer_size);
+        std::vector<uint8_t> bb(buffer_size);
+        return compare_range(fa, fb, 0, size, ba, bb);
+    }
+
+    const uint64_t windows = (size + window - 1) / window;
+    std::atomic<uint64_t> next{0};
+    std::atomic<bool> mismatch{false};
+
+    auto worker = [&]() {
+        std::vector<uint8_t> ba(window);
+        std::vector<uint8_t> bb(window);
+        while (!mismatch.load(std::memory_order_relaxed)) {
+            uint64_t w = next.fetch_add(1, std::memory_order_relaxed);
+            if (w >= windows)
+                break;
+            if (!compare_range(fa, fb, w * window, std::min(size, (w + 1) * window), ba, bb))
+                mismatch.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    const unsigned workers = static_cast<unsigned>(std::min<uint64_t>(hw, windows));
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+    for (unsigned t = 0; t < workers; ++t)
+        pool.emplace_back(worker);
+    for (auto& t : pool)
+        t.join();
+
+    return !mismatch.load();
+}
+
+bool files_are_identical(const std::filesystem::path &a, const std::filesystem::path &b, bool trust_digests) {
+    struct statx sa{}, sb{};
+
+    if (statx(AT_FDCWD, a.c_str(), AT_STATX_SYNC_AS_STAT, identity_mask, &sa) != 0 ||
+        statx(AT_FDCWD, b.c_str(), AT_STATX_SYNC_AS_STAT, identity_mask, &sb) != 0)
         return false;
 
-    constexpr std::size_t block_size = 4096;
-    char ba[block_size];
-    char bb[block_size];
+    if (!S_ISREG(sa.stx_mode) || !S_ISREG(sb.stx_mode))
+        return false;
 
-    while (fa && fb) {
-        fa.read(ba, block_size);
-        fb.read(bb, block_size);
+    if (sa.stx_dev_major == sb.stx_dev_major &&
+        sa.stx_dev_minor == sb.stx_dev_minor &&
+        sa.stx_ino == sb.stx_ino)
+        return true;
 
-        const std::streamsize ra = fa.gcount();
-        const std::streamsize rb = fb.gcount();
+    if (sa.stx_size != sb.stx_size)
+        return false;
 
-        if (ra != rb)
-            return false;
+    const uint64_t size = sa.stx_size;
+    if (size == 0)
+        return true;
 
-        if (std::memcmp(ba, bb, static_cast<std::size_t>(ra)) != 0)
+    file_key_t ka, kb;
+    file_digest_t da, db;
+    key_from_statx(sa, ka);
+    key_from_statx(sb, kb);
+    if (digest_cache_lookup(ka, da) && digest_cache_lookup(kb, db)) {
+        if (da != db)
             return false;
+        if (trust_digests)
+            return true;
     }
 
-    return true;
+    int fa = ::open(a.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fa < 0)
+        return false;
+
+    int fb = ::open(b.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fb < 0) {
+        ::close(fa);
+        return false;
+    }
+
+    bool same = false;
+
+    if (size >= (1ull << 20) && ka.dev == kb.dev && extents_are_shared(fa, fb)) {
+        same = true;
+    } else {
+        posix_fadvise(fa, 0, 0, POSIX_FADV_SEQUENTIAL);
+        posix_fadvise(fb, 0, 0, POSIX_FADV_SEQUENTIAL);
+        same = compare_by_read(fa, fb, size);
+    }
+
+    ::close(fa);
+    ::close(fb);
+    return same;
 }
 
 
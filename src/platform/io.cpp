@@ -0,0 +1,581 @@
+#include <sigil/platform/io.h>
+#include <sigil/common.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+
+namespace sigil::fs {
+
+struct io_service_t::state_t {
+    io_backend_t backend = IO_BACKEND_NONE;
+    io_config_t cfg = {};
+
+    std::deque<io_request_t*> backlog;      // accepted, not yet in the ring / worker
+    unsigned in_flight = 0;
+
+    // io_uring
+    int ring_fd = -1;
+    void *sq_ring = MAP_FAILED;
+    void *cq_ring = MAP_FAILED;
+    std::size_t sq_ring_size = 0;
+    std::size_t cq_ring_size = 0;
+    struct io_uring_sqe *sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    std::size_t sqes_size = 0;
+
+    unsigned *sq_head = nullptr;
+    unsigned *sq_tail = nullptr;
+    unsigned *sq_mask = nullptr;
+    unsigned *sq_flags = nullptr;
+    unsigned *sq_array = nullptr;
+    unsigned sq_entries = 0;
+    unsigned unsubmitted = 0;
+
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned *cq_mask = nullptr;
+    struct io_uring_cqe *cqes = nullptr;
+    unsigned cq_entries = 0;
+
+    // worker thread fallback
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    std::deque<io_request_t*> work;
+    std::vector<io_request_t*> completed;
+    std::vector<int> fixed_files;
+    bool stop = false;
+};
+
+static int sys_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int sys_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+static int sys_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+static void complete_request(io_request_t &req, int64_t res) {
+    req.res = res;
+
+    if (res < 0) {
+        req.result = ::sigil::yield()
+            .set_state(::sigil::yield_state::fail)
+            .set_code(static_cast<uint32_t>(-res));
+    } else {
+        req.result = ::sigil::yield().set_info(static_cast<uint64_t>(res));
+    }
+}
+
+/* =========================
+   io_uring backend
+   ========================= */
+
+static void uring_teardown(io_service_t::state_t &st) {
+    if (st.sqes != MAP_FAILED) munmap(st.sqes, st.sqes_size);
+    if (st.cq_ring != MAP_FAILED && st.cq_ring != st.sq_ring) munmap(st.cq_ring, st.cq_ring_size);
+    if (st.sq_ring != MAP_FAILED) munmap(st.sq_ring, st.sq_ring_size);
+    if (st.ring_fd >= 0) close(st.ring_fd);
+
+    st.sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    st.cq_ring = MAP_FAILED;
+    st.sq_ring = MAP_FAILED;
+    st.ring_fd = -1;
+}
+
+static bool uring_supports_ops(int ring_fd) {
+    constexpr unsigned probe_ops = 256;
+    std::vector<uint8_t> raw(sizeof(struct io_uring_probe) + probe_ops * sizeof(struct io_uring_probe_op), 0);
+    auto *probe = reinterpret_cast<struct io_uring_probe*>(raw.data());
+
+    if (sys_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, probe_ops) < 0)
+        return false;
+
+    for (unsigned op : { IORING_OP_READ, IORING_OP_WRITE, IORING_OP_OPENAT,
+                         IORING_OP_STATX, IORING_OP_CLOSE, IORING_OP_FSYNC }) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+            return false;
+    }
+
+    return true;
+}
+
+static bool uring_setup(io_service_t::state_t &st) {
+    struct io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CLAMP;
+
+    if (st.cfg.sqpoll) {
+        p.flags |= IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = st.cfg.sqpoll_idle_ms;
+    }
+
+    st.ring_fd = sys_uring_setup(st.cfg.entries, &p);
+
+    // SQPOLL may need privileges on older kernels, plain ring is still worth it
+    if (st.ring_fd < 0 && st.cfg.sqpoll) {
+        std::memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CLAMP;
+        st.cfg.sqpoll = false;
+        st.ring_fd = sys_uring_setup(st.cfg.entries, &p);
+    }
+
+    if (st.ring_fd < 0)
+        return false;
+
+    st.sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    st.cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    const bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+        st.sq_ring_size = st.cq_ring_size = std::max(st.sq_ring_size, st.cq_ring_size);
+
+    st.sq_ring = mmap(nullptr, st.sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, st.ring_fd, IORING_OFF_SQ_RING);
+    if (st.sq_ring == MAP_FAILED) {
+        uring_teardown(st);
+        return false;
+    }
+
+    st.cq_ring = single_mmap ? st.sq_ring
+               : mmap(nullptr, st.cq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, st.ring_fd, IORING_OFF_CQ_RING);
+    if (st.cq_ring == MAP_FAILED) {
+        uring_teardown(st);
+        return false;
+    }
+
+    st.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    st.sqes = static_cast<struct io_uring_sqe*>(
+        mmap(nullptr, st.sqes_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, st.ring_fd, IORING_OFF_SQES));
+    if (st.sqes == MAP_FAILED) {
+        uring_teardown(st);
+        return false;
+    }
+
+    auto *sq = static_cast<uint8_t*>(st.sq_ring);
+    auto *cq = static_cast<uint8_t*>(st.cq_ring);
+
+    st.sq_head  = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    st.sq_tail  = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    st.sq_mask  = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    st.sq_flags = reinterpret_cast<unsigned*>(sq + p.sq_off.flags);
+    st.sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    st.sq_entries = p.sq_entries;
+
+    st.cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    st.cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    st.cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    st.cqes    = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+    st.cq_entries = p.cq_entries;
+
+    if (!uring_supports_ops(st.ring_fd)) {
+        uring_teardown(st);
+        return false;
+    }
+
+    return true;
+}
+
+static void uring_prep(struct io_uring_sqe &sqe, io_request_t &req) {
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.user_data = reinterpret_cast<uint64_t>(&req);
+    sqe.fd = req.fd;
+
+    switch (req.op) {
+        case IO_READ:
+        case IO_WRITE:
+            if (req.buffer_index >= 0) {
+                sqe.opcode = (req.op == IO_READ) ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+                sqe.buf_index = static_cast<uint16_t>(req.buffer_index);
+            } else {
+                sqe.opcode = (req.op == IO_READ) ? IORING_OP_READ : IORING_OP_WRITE;
+            }
+            sqe.addr = reinterpret_cast<uint64_t>(req.buffer);
+            sqe.len = req.length;
+            sqe.off = req.offset;
+            break;
+
+        case IO_OPENAT:
+            sqe.opcode = IORING_OP_OPENAT;
+            sqe.fd = req.dirfd;
+            sqe.addr = reinterpret_cast<uint64_t>(req.path);
+            sqe.len = req.mode;
+            sqe.open_flags = static_cast<uint32_t>(req.flags);
+            break;
+
+        case IO_STATX:
+            sqe.opcode = IORING_OP_STATX;
+            sqe.fd = req.dirfd;
+            sqe.addr = reinterpret_cast<uint64_t>(req.path);
+            sqe.len = req.mode;
+            sqe.off = reinterpret_cast<uint64_t>(req.buffer);
+            sqe.statx_flags = static_cast<uint32_t>(req.flags);
+            break;
+
+        case IO_CLOSE:
+            sqe.opcode = IORING_OP_CLOSE;
+            break;
+
+        case IO_FSYNC:
+            sqe.opcode = IORING_OP_FSYNC;
+            sqe.fsync_flags = static_cast<uint32_t>(req.flags);
+            break;
+
+        default:
+            sqe.opcode = IORING_OP_NOP;
+            break;
+    }
+
+    if (req.fixed_file && (req.op == IO_READ || req.op == IO_WRITE || req.op == IO_FSYNC))
+        sqe.flags |= IOSQE_FIXED_FILE;
+}
+
+// Move backlog into free SQ slots, never more than the CQ can hold
+static void uring_flush(io_service_t::state_t &st) {
+    const unsigned head = __atomic_load_n(st.sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *st.sq_tail;
+    const unsigned mask = *st.sq_mask;
+
+    while (!st.backlog.empty()
+           && (tail - head) < st.sq_entries
+           && st.in_flight < st.cq_entries) {
+        io_request_t *req = st.backlog.front();
+        st.backlog.pop_front();
+
+        const unsigned idx = tail & mask;
+        uring_prep(st.sqes[idx], *req);
+        st.sq_array[idx] = idx;
+
+        ++tail;
+        ++st.unsubmitted;
+        ++st.in_flight;
+    }
+
+    __atomic_store_n(st.sq_tail, tail, __ATOMIC_RELEASE);
+}
+
+static int uring_enter(io_service_t::state_t &st, unsigned min_complete) {
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    unsigned to_submit = st.unsubmitted;
+
+    if (st.cfg.sqpoll) {
+        // Kernel thread consumes the SQ, only wake it when it went idle
+        if (__atomic_load_n(st.sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP)
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        st.unsubmitted = 0;
+        to_submit = 0;
+        if (flags == 0)
+            return 0;
+    } else if (to_submit == 0 && min_complete == 0) {
+        return 0;
+    }
+
+    while (true) {
+        int r = sys_uring_enter(st.ring_fd, to_submit, min_complete, flags);
+        if (r >= 0) {
+            if (!st.cfg.sqpoll)
+                st.unsubmitted -= std::min<unsigned>(st.unsubmitted, static_cast<unsigned>(r));
+            return r;
+        }
+        if (errno == EINTR)
+            continue;
+        return -errno;
+    }
+}
+
+static void uring_reap(io_service_t::state_t &st, std::vector<io_request_t*> &out) {
+    unsigned head = *st.cq_head;
+    const unsigned tail = __atomic_load_n(st.cq_tail, __ATOMIC_ACQUIRE);
+    const unsigned mask = *st.cq_mask;
+
+    while (head != tail) {
+        const struct io_uring_cqe &cqe = st.cqes[head & mask];
+        auto *req = reinterpret_cast<io_request_t*>(cqe.user_data);
+        complete_request(*req, cqe.res);
+        out.push_back(req);
+        ++head;
+        --st.in_flight;
+    }
+
+    __atomic_store_n(st.cq_head, head, __ATOMIC_RELEASE);
+}
+
+/* =========================
+   Blocking worker fallback
+   ========================= */
+
+static int64_t run_blocking(io_service_t::state_t &st, io_request_t &req) {
+    int fd = req.fd;
+    if (req.fixed_file) {
+        if (fd < 0 || static_cast<std::size_t>(fd) >= st.fixed_files.size())
+            return -EBADF;
+        fd = st.fixed_files[static_cast<std::size_t>(fd)];
+    }
+
+    int64_t r = 0;
+
+    switch (req.op) {
+        case IO_READ:
+            r = pread(fd, req.buffer, req.length, static_cast<off_t>(req.offset));
+            break;
+        case IO_WRITE:
+            r = pwrite(fd, req.buffer, req.length, static_cast<off_t>(req.offset));
+            break;
+        case IO_OPENAT:
+            r = openat(req.dirfd, req.path, req.flags, static_cast<mode_t>(req.mode));
+            break;
+        case IO_STATX:
+            r = statx(req.dirfd, req.path, req.flags, req.mode, static_cast<struct statx*>(req.buffer));
+            break;
+        case IO_CLOSE:
+            r = close(fd);
+            break;
+        case IO_FSYNC:
+            r = (req.flags & IORING_FSYNC_DATASYNC) ? fdatasync(fd) : fsync(fd);
+            break;
+        default:
+            break;
+    }
+
+    return r < 0 ? -errno : r;
+}
+
+static void worker_loop(io_service_t::state_t &st) {
+    std::unique_lock<std::mutex> guard(st.lock);
+
+    while (true) {
+        st.work_cv.wait(guard, [&] { return st.stop || !st.work.empty(); });
+        if (st.work.empty() && st.stop)
+            break;
+
+        io_request_t *req = st.work.front();
+        st.work.pop_front();
+
+        guard.unlock();
+        int64_t res = run_blocking(st, *req);
+        guard.lock();
+
+        complete_request(*req, res);
+        st.completed.push_back(req);
+        st.done_cv.notify_one();
+    }
+}
+
+/* =========================
+   io_service_t
+   ========================= */
+
+io_service_t::io_service_t() : state(std::make_unique<state_t>()) {}
+
+io_service_t::~io_service_t() {
+    shutdown();
+}
+
+::sigil::yield io_service_t::init(const io_config_t &cfg) {
+    ::sigil::yield ret;
+
+    if (state->backend != IO_BACKEND_NONE)
+        return ret.set_state(::sigil::yield_state::fail).set_code(EBUSY);
+
+    state->cfg = cfg;
+    if (state->cfg.entries == 0)
+        state->cfg.entries = 64;
+
+    if (!cfg.force_fallback && uring_setup(*state)) {
+        state->backend = IO_BACKEND_URING;
+        return ret;
+    }
+
+    state->stop = false;
+    state->worker = std::thread(worker_loop, std::ref(*state));
+    state->backend = IO_BACKEND_THREAD;
+
+    return ret;
+}
+
+void io_service_t::shutdown() {
+    if (state->backend == IO_BACKEND_NONE)
+        return;
+
+    // Requests point into caller memory, drain before tearing down
+    while (state->in_flight > 0 || !state->backlog.empty()) {
+        if (wait(1).is_failure())
+            break;
+    }
+
+    if (state->backend == IO_BACKEND_URING) {
+        uring_teardown(*state);
+    } else {
+        {
+            std::lock_guard<std::mutex> guard(state->lock);
+            state->stop = true;
+        }
+        state->work_cv.notify_all();
+        if (state->worker.joinable())
+            state->worker.join();
+    }
+
+    state->backend = IO_BACKEND_NONE;
+}
+
+io_backend_t io_service_t::backend() const noexcept {
+    return state->backend;
+}
+
+unsigned io_service_t::in_flight() const noexcept {
+    return state->in_flight + static_cast<unsigned>(state->backlog.size());
+}
+
+::sigil::yield io_service_t::register_buffers(const struct iovec *iov, unsigned count) {
+    ::sigil::yield ret;
+
+    if (state->backend == IO_BACKEND_URING) {
+        sys_uring_register(state->ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        if (count > 0 && sys_uring_register(state->ring_fd, IORING_REGISTER_BUFFERS, iov, count) < 0)
+            return ret.set_state(::sigil::yield_state::fail).set_code(errno);
+        return ret;
+    }
+
+    // Worker thread reads straight into the request buffer, nothing to pin
+    if (state->backend == IO_BACKEND_THREAD)
+        return ret;
+
+    return ret.set_state(::sigil::yield_state::fail).set_code(ENODEV);
+}
+
+::sigil::yield io_service_t::register_files(const int *fds, unsigned count) {
+    ::sigil::yield ret;
+
+    if (state->backend == IO_BACKEND_URING) {
+        sys_uring_register(state->ring_fd, IORING_UNREGISTER_FILES, nullptr, 0);
+        if (count > 0 && sys_uring_register(state->ring_fd, IORING_REGISTER_FILES, fds, count) < 0)
+            return ret.set_state(::sigil::yield_state::fail).set_code(errno);
+        return ret;
+    }
+
+    if (state->backend == IO_BACKEND_THREAD) {
+        std::lock_guard<std::mutex> guard(state->lock);
+        state->fixed_files.assign(fds, fds + count);
+        return ret;
+    }
+
+    return ret.set_state(::sigil::yield_state::fail).set_code(ENODEV);
+}
+
+::sigil::yield io_service_t::submit(io_request_t *reqs, std::size_t count) {
+    ::sigil::yield ret;
+
+    if (state->backend == IO_BACKEND_NONE)
+        return ret.set_state(::sigil::yield_state::fail).set_code(ENODEV);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        reqs[i].done = false;
+        reqs[i].res = 0;
+        reqs[i].result = {};
+    }
+
+    if (state->backend == IO_BACKEND_URING) {
+        for (std::size_t i = 0; i < count; ++i)
+            state->backlog.push_back(&reqs[i]);
+
+        uring_flush(*state);
+        int r = uring_enter(*state, 0);
+        if (r < 0 && r != -EAGAIN && r != -EBUSY)
+            return ret.set_state(::sigil::yield_state::fail).set_code(static_cast<uint32_t>(-r));
+        return ret;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        for (std::size_t i = 0; i < count; ++i)
+            state->work.push_back(&reqs[i]);
+        state->in_flight += static_cast<unsigned>(count);
+    }
+    state->work_cv.notify_one();
+
+    return ret;
+}
+
+::sigil::yield io_service_t::wait(unsigned min_complete) {
+    ::sigil::yield ret;
+    std::vector<io_request_t*> done;
+
+    if (state->backend == IO_BACKEND_URING) {
+        while (true) {
+            uring_flush(*state);
+            uring_reap(*state, done);
+
+            const unsigned pending = state->in_flight + static_cast<unsigned>(state->backlog.size());
+            if (done.size() >= min_complete || pending == 0)
+                break;
+
+            const unsigned want = std::min<unsigned>(min_complete - static_cast<unsigned>(done.size()),
+                                                     std::max(1u, state->in_flight));
+            int r = uring_enter(*state, want);
+            if (r < 0 && r != -EAGAIN && r != -EBUSY) {
+                ret.set_state(::sigil::yield_state::fail).set_code(static_cast<uint32_t>(-r));
+                break;
+            }
+        }
+    } else if (state->backend == IO_BACKEND_THREAD) {
+        std::unique_lock<std::mutex> guard(state->lock);
+        const unsigned target = std::min(min_complete, state->in_flight);
+        state->done_cv.wait(guard, [&] { return state->completed.size() >= target; });
+        done.swap(state->completed);
+        state->in_flight -= static_cast<unsigned>(done.size());
+    } else {
+        return ret.set_state(::sigil::yield_state::fail).set_code(ENODEV);
+    }
+
+    // done flips on the caller's thread only, callbacks may submit follow-up work
+    for (io_request_t *req : done) {
+        req->done = true;
+        if (req->on_complete)
+            req->on_complete(*req);
+    }
+
+    return ret.set_info(done.size());
+}
+
+::sigil::yield io_service_t::run(io_request_t *reqs, std::size_t count) {
+    ::sigil::yield ret = submit(reqs, count);
+    if (ret.is_failure())
+        return ret;
+
+    auto all_done = [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!reqs[i].done) return false;
+        }
+        return true;
+    };
+
+    while (!all_done()) {
+        ::sigil::yield w = wait(1);
+        if (w.is_failure())
+            return w;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+        ret |= reqs[i].result;
+
+    return ret;
+}
+
+} // namespace sigil::fs
@@ -0,0 +1,870 @@
+#include <sigil/platform/library.h>
+#include <sigil/platform/steam.h>
+#include <sigil/platform/paths.h>
+#include <sigil/data/parser.h>
+#include <sigil/data/binary.h>
+#include <sigil/common.h>
+
+#include <condition_variable>
+#include <unordered_map>
+#include <string_view>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <thread>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <deque>
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+namespace sigil::platform {
+
+/* =========================
+   PE image
+   ========================= */
+
+static constexpr uint32_t rt_icon = 3;
+static constexpr uint32_t rt_group_icon = 14;
+static constexpr uint32_t rt_version = 16;
+static constexpr uint32_t max_pe_sections = 96;
+static constexpr uint32_t max_resource_entries = 4096;
+
+static constexpr uint64_t pe_page_size = 4096;
+static constexpr std::size_t max_pe_pages = 4096;      // 16 MiB read from one file at most
+
+/**
+ * Bounds checked little endian reads, out of range reads give 0 and clear ok.
+ * Over an image in memory, or over a file whose pages are read with pread the
+ * first time they are touched: a file that shrinks while it is parsed (a game
+ * being updated) gives short reads, where a mapping would raise SIGBUS.
+ */
+struct pe_view_t {
+    std::string_view img;
+    bool ok = true;
+
+    int fd = -1;                    // file mode when >= 0
+    uint64_t file_size = 0;
+    std::unordered_map<uint64_t, std::string> pages;
+    uint64_t last_index = UINT64_MAX;
+    const std::string *last = nullptr;
+
+    uint64_t size() const noexcept { return fd >= 0 ? file_size : img.size(); }
+    bool has(uint64_t off, uint64_t n) const noexcept { return off <= size() && n <= size() - off; }
+
+    // Page holding off, nullptr when it cannot be read
+    const std::string *page(uint64_t off) {
+        const uint64_t index = off / pe_page_size;
+        if (index == last_index)
+            return last;
+
+        auto it = pages.find(index);
+        if (it == pages.end()) {
+            if (pages.size() >= max_pe_pages)
+                return nullptr;
+
+            std::string p(pe_page_size, '\0');
+            ssize_t n;
+            do {
+                n = ::pread(fd, p.data(), p.size(), static_cast<off_t>(index * pe_page_size));
+            } while (n < 0 && errno == EINTR);
+            p.resize(n > 0 ? static_cast<std::size_t>(n) : 0);
+            it = pages.emplace(index, std::move(p)).first;
+        }
+
+        last_index = index;
+        last = &it->second;
+        return last;
+    }
+
+    uint8_t u8(uint64_t off) {
+        if (!has(off, 1)) { ok = false; return 0; }
+        if (fd < 0)
+            return static_cast<uint8_t>(img[off]);
+
+        const std::string *p = page(off);
+        const uint64_t at = off % pe_page_size;
+        if (!p || at >= p->size()) { ok = false; return 0; }
+        return static_cast<uint8_t>((*p)[at]);
+    }
+
+    uint16_t u16(uint64_t off) {
+        if (!has(off, 2)) { ok = false; return 0; }
+        return static_cast<uint16_t>(u8(off) | (u8(off + 1) << 8));
+    }
+
+    uint32_t u32(uint64_t off) {
+        if (!has(off, 4)) { ok = false; return 0; }
+        return static_cast<uint32_t>(u16(off)) | (static_cast<uint32_t>(u16(off + 2)) << 16);
+    }
+};
+
+struct pe_section_t {
+    uint32_t va, vsize, raw_ptr, raw_size;
+};
+
+struct pe_reader_t {
+    pe_view_t v;
+    std::vector<pe_section_t> sections;
+    uint32_t res_rva = 0;
+
+    // File offset of rva, false when no section holds it on disk
+    bool offset_of(uint32_t rva, uint32_t &off) const noexcept {
+        for (const auto &s : sections) {
+            const uint32_t span = std::max(s.vsize, s.raw_size);
+            if (rva >= s.va && rva - s.va < span) {
+                const uint32_t delta = rva - s.va;
+                if (delta >= s.raw_size)
+                    return false;
+                off = s.raw_ptr + delta;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * One step down the resource tree: the entry of the directory at dir
+     * (offset inside the resource section) whose id is id, the first one for -1.
+     */
+    bool resource_child(uint32_t dir, int64_t id, uint32_t &child, bool &is_dir) {
+        uint32_t off;
+        if (!offset_of(res_rva + dir, off))
+            return false;
+
+        const uint32_t count = static_cast<uint32_t>(v.u16(off + 12)) + v.u16(off + 14);
+        if (!v.ok || count > max_resource_entries)
+            return false;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t entry = off + 16 + i * 8;
+            const uint32_t name = v.u32(entry);
+            const uint32_t data = v.u32(entry + 4);
+            if (!v.ok)
+                return false;
+            // Named entries carry the high bit, ids are what types and icons use
+            if (id >= 0 && ((name & 0x80000000u) || name != static_cast<uint32_t>(id)))
+                continue;
+            child = data & 0x7fffffffu;
+            is_dir = (data & 0x80000000u) != 0;
+            return true;
+        }
+        return false;
+    }
+
+    // Data of resource type/id (-1 for the first), first language
+    bool resource(uint32_t type, int64_t id, uint32_t &off, uint32_t &size) {
+        if (res_rva == 0)
+            return false;
+
+        uint32_t node = 0;
+        bool is_dir = true;
+        const int64_t path[3] = { type, id, -1 };
+        for (int level = 0; level < 3; ++level) {
+            if (!is_dir || !resource_child(node, path[level], node, is_dir))
+                return false;
+        }
+        if (is_dir)
+            return false;
+
+        uint32_t leaf;
+        if (!offset_of(res_rva + node, leaf))
+            return false;
+        const uint32_t rva = v.u32(leaf);
+        size = v.u32(leaf + 4);
+        return v.ok && offset_of(rva, off) && v.has(off, size);
+    }
+};
+
+static void utf16_to_utf8(pe_view_t &v, uint64_t off, uint64_t end, std::string &out) {
+    out.clear();
+    while (off + 2 <= end) {
+        uint32_t c = v.u16(off);
+        off += 2;
+        if (c == 0 || !v.ok)
+            break;
+        if (c >= 0xD800 && c < 0xDC00 && off + 2 <= end) {
+            const uint32_t lo = v.u16(off);
+            if (lo >= 0xDC00 && lo < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+                off += 2;
+            }
+        }
+        if (c < 0x80) {
+            out += static_cast<char>(c);
+        } else if (c < 0x800) {
+            out += static_cast<char>(0xC0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += static_cast<char>(0xE0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (c >> 18));
+            out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+}
+
+// One node of a VS_VERSIONINFO tree, offsets are absolute file offsets
+struct version_block_t {
+    uint64_t start, end;            // whole block
+    uint64_t value, value_end;
+    uint64_t children;
+    uint16_t type;
+    std::string key;
+};
+
+static bool read_version_block(pe_view_t &v, uint64_t base, uint64_t pos, uint64_t limit, version_block_t &b) {
+    const uint16_t length = v.u16(pos);
+    const uint16_t value_length = v.u16(pos + 2);
+    b.type = v.u16(pos + 4);
+    if (!v.ok || length < 6 || pos + length > limit)
+        return false;
+
+    b.start = pos;
+    b.end = pos + length;
+
+    // Key is NUL terminated UTF-16, the value starts on the next 32 bit boundary of the resource
+    uint64_t k = pos + 6;
+    while (k + 2 <= b.end && v.u16(k) != 0)
+        k += 2;
+    utf16_to_utf8(v, pos + 6, k, b.key);
+    auto align4 = [base](uint64_t o) { return base + ((o - base + 3) & ~uint64_t(3)); };
+
+    b.value = align4(k + 2);
+    const uint64_t value_bytes = b.type == 1 ? uint64_t(value_length) * 2 : value_length;
+    b.value_end = std::min(b.end, b.value + value_bytes);
+    b.children = align4(b.value_end);
+    return v.ok && b.value <= b.end;
+}
+
+static void parse_version_resource(pe_view_t &v, uint32_t off, uint32_t size, pe_info_t &out) {
+    const uint64_t end = uint64_t(off) + size;
+    version_block_t root;
+    if (!read_version_block(v, off, off, end, root) || root.key != "VS_VERSION_INFO")
+        return;
+
+    // VS_FIXEDFILEINFO
+    if (root.value_end - root.value >= 52 && v.u32(root.value) == 0xFEEF04BDu) {
+        const uint32_t fms = v.u32(root.value + 8), fls = v.u32(root.value + 12);
+        const uint32_t pms = v.u32(root.value + 16), pls = v.u32(root.value + 20);
+        const uint16_t file[4] = { uint16_t(fms >> 16), uint16_t(fms), uint16_t(fls >> 16), uint16_t(fls) };
+        const uint16_t product[4] = { uint16_t(pms >> 16), uint16_t(pms), uint16_t(pls >> 16), uint16_t(pls) };
+        std::copy(file, file + 4, out.file_version);
+        std::copy(product, product + 4, out.product_version);
+    }
+
+    // StringFileInfo -> string tables -> strings, the first table with a value wins
+    for (uint64_t pos = root.children; pos + 6 <= root.end;) {
+        version_block_t info;
+        if (!read_version_block(v, off, pos, root.end, info))
+            return;
+        pos = off + ((info.end - off + 3) & ~uint64_t(3));
+        if (info.key != "StringFileInfo")
+            continue;
+
+        for (uint64_t t = info.children; t + 6 <= info.end;) {
+            version_block_t table;
+            if (!read_version_block(v, off, t, info.end, table))
+                break;
+            t = off + ((table.end - off + 3) & ~uint64_t(3));
+
+            for (uint64_t s = table.children; s + 6 <= table.end;) {
+                version_block_t str;
+                if (!read_version_block(v, off, s, table.end, str))
+                    break;
+                s = off + ((str.end - off + 3) & ~uint64_t(3));
+
+                // Some linkers count value_length in bytes, read to the NUL within the block
+                std::string *field = str.key == "ProductName" ? &out.product_name
+                                   : str.key == "FileDescription" ? &out.description : nullptr;
+                if (field && field->empty())
+                    utf16_to_utf8(v, str.value, str.end, *field);
+            }
+        }
+    }
+}
+
+static void parse_icon_group(pe_reader_t &pe, uint32_t off, uint32_t size, pe_info_t &out) {
+    pe_view_t &v = pe.v;
+    const uint16_t count = v.u16(off + 4);
+    if (!v.ok || v.u16(off + 2) != 1 || 6 + uint64_t(count) * 14 > size)
+        return;
+
+    int best = -1;
+    uint32_t best_width = 0, best_bits = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        const uint32_t e = off + 6 + i * 14;
+        const uint32_t width = v.u8(e) == 0 ? 256 : v.u8(e);
+        const uint32_t bits = v.u16(e + 6);
+        if (width > best_width || (width == best_width && bits > best_bits)) {
+            best = i;
+            best_width = width;
+            best_bits = bits;
+        }
+    }
+    if (best < 0 || !v.ok)
+        return;
+
+    const uint16_t id = v.u16(off + 6 + best * 14 + 12);
+    uint32_t icon_off, icon_size;
+    if (pe.resource(rt_icon, id, icon_off, icon_size)) {
+        out.icon_offset = icon_off;
+        out.icon_size = icon_size;
+        out.icon_width = static_cast<uint16_t>(best_width);
+    }
+}
+
+static ::sigil::yield parse_pe(pe_reader_t &pe, pe_info_t &out) {
+    ::sigil::yield ret;
+    out = {};
+
+    pe_view_t &v = pe.v;
+
+    if (v.u16(0) != 0x5A4D)     // MZ
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOEXEC);
+
+    const uint32_t nt = v.u32(0x3C);
+    if (!v.ok || v.u32(nt) != 0x00004550)      // PE\0\0
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOEXEC);
+
+    const uint32_t coff = nt + 4;
+    out.machine = v.u16(coff);
+    const uint16_t nsections = v.u16(coff + 2);
+    out.timestamp = v.u32(coff + 4);
+    const uint16_t opt_size = v.u16(coff + 16);
+    out.characteristics = v.u16(coff + 18);
+
+    const uint32_t opt = coff + 20;
+    const uint16_t magic = v.u16(opt);
+    if (!v.ok || (magic != 0x10b && magic != 0x20b) || opt_size < 70)
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOEXEC);
+
+    out.subsystem = v.u16(opt + 68);
+
+    // Data directories follow the fixed part, PE32+ has wider image base and stack fields
+    const uint32_t rva_count_at = magic == 0x10b ? 92 : 108;
+    const uint32_t directories = rva_count_at + 4;
+    const uint32_t rva_count = opt_size >= directories ? v.u32(opt + rva_count_at) : 0;
+    if (rva_count > 2 && opt_size >= directories + 3 * 8)
+        pe.res_rva = v.u32(opt + directories + 2 * 8);
+
+    const uint32_t section_table = opt + opt_size;
+    for (uint32_t i = 0; i < std::min<uint32_t>(nsections, max_pe_sections); ++i) {
+        const uint32_t s = section_table + i * 40;
+        pe.sections.push_back({ v.u32(s + 12), v.u32(s + 8), v.u32(s + 20), v.u32(s + 16) });
+    }
+    if (!v.ok)
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOEXEC);
+
+    // Resources are optional, a broken tree leaves the fields empty
+    uint32_t off, size;
+    if (pe.resource(rt_version, -1, off, size))
+        parse_version_resource(v, off, size, out);
+    v.ok = true;
+    if (pe.resource(rt_group_icon, -1, off, size))
+        parse_icon_group(pe, off, size, out);
+
+    return ret;
+}
+
+::sigil::yield parse_pe_image(std::string_view image, pe_info_t &out) {
+    pe_reader_t pe;
+    pe.v.img = image;
+    return parse_pe(pe, out);
+}
+
+::sigil::yield read_pe_info(const std::filesystem::path &file, pe_info_t &out) {
+    ::sigil::yield ret;
+    out = {};
+
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        return ret.set_state(sigil::yield_state::fail).set_code(err);
+    }
+
+    if (st.st_size < 64) {
+        ::close(fd);
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOEXEC);
+    }
+
+    // Headers and resources are a few pages of a file that can be gigabytes, only those are read
+    pe_reader_t pe;
+    pe.v.fd = fd;
+    pe.v.file_size = static_cast<uint64_t>(st.st_size);
+    ret = parse_pe(pe, out);
+    ::close(fd);
+    return ret;
+}
+
+/* =========================
+   Index
+   ========================= */
+
+std::string_view library_exe_t::name() const noexcept {
+    const std::string_view p = path;
+    const std::size_t slash = p.rfind('/');
+    return slash == std::string_view::npos ? p : p.substr(slash + 1);
+}
+
+const library_exe_t *library_index_t::find(std::string_view path) const noexcept {
+    auto it = std::lower_bound(executables.begin(), executables.end(), path,
+                               [](const library_exe_t &e, std::string_view p) { return e.path < p; });
+    return it != executables.end() && it->path == path ? &*it : nullptr;
+}
+
+static constexpr char library_index_magic[8] = { 'S', 'G', 'L', 'I', 'B', 'I', 'X', '\0' };
+static constexpr uint32_t library_index_version = 1;
+
+::sigil::yield library_index_t::load(const std::filesystem::path &file) {
+    ::sigil::yield ret;
+    roots.clear();
+    dirs.clear();
+    executables.clear();
+
+    std::string raw;
+    ret = ::sigil::data::read_binary_file(file, raw);
+    if (ret.is_failure())
+        return ret;
+
+    ::sigil::data::binary_reader_t r(raw);
+    char magic[sizeof(library_index_magic)];
+    uint32_t version = 0, count = 0;
+
+    r.get(magic, sizeof(magic));
+    r.get(version);
+    if (!r.ok || std::memcmp(magic, library_index_magic, sizeof(magic)) != 0 || version != library_index_version)
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+
+    r.get(count);
+    for (uint32_t i = 0; r.ok && i < count; ++i)
+        r.get(roots.emplace_back());
+
+    r.get(count);
+    for (uint32_t i = 0; r.ok && i < count; ++i) {
+        library_dir_t &d = dirs.emplace_back();
+        uint32_t n = 0;
+        r.get(d.path);
+        r.get(d.key);
+        r.get(n);
+        for (uint32_t j = 0; r.ok && j < n; ++j)
+            r.get(d.subdirs.emplace_back());
+        r.get(n);
+        for (uint32_t j = 0; r.ok && j < n; ++j)
+            r.get(d.executables.emplace_back());
+    }
+
+    r.get(count);
+    for (uint32_t i = 0; r.ok && i < count; ++i) {
+        library_exe_t &e = executables.emplace_back();
+        uint8_t is_pe = 0;
+        r.get(e.path);
+        r.get(e.key);
+        r.get(is_pe);
+        e.is_pe = is_pe != 0;
+        r.get(e.info.machine);
+        r.get(e.info.subsystem);
+        r.get(e.info.characteristics);
+        r.get(e.info.timestamp);
+        for (auto &f : e.info.file_version) r.get(f);
+        for (auto &f : e.info.product_version) r.get(f);
+        r.get(e.info.product_name);
+        r.get(e.info.description);
+        r.get(e.info.icon_offset);
+        r.get(e.info.icon_size);
+        r.get(e.info.icon_width);
+    }
+
+    if (!r.done()) {
+        roots.clear();
+        dirs.clear();
+        executables.clear();
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+    }
+
+    return ret;
+}
+
+::sigil::yield library_index_t::save(const std::filesystem::path &file) const {
+    ::sigil::data::binary_writer_t w;
+    w.out.append(library_index_magic, sizeof(library_index_magic));
+    w.put(library_index_version);
+
+    w.put(static_cast<uint32_t>(roots.size()));
+    for (const auto &root : roots)
+        w.put(root);
+
+    w.put(static_cast<uint32_t>(dirs.size()));
+    for (const auto &d : dirs) {
+        w.put(d.path);
+        w.put(d.key);
+        w.put(static_cast<uint32_t>(d.subdirs.size()));
+        for (const auto &s : d.subdirs) w.put(s);
+        w.put(static_cast<uint32_t>(d.executables.size()));
+        for (const auto &s : d.executables) w.put(s);
+    }
+
+    w.put(static_cast<uint32_t>(executables.size()));
+    for (const auto &e : executables) {
+        w.put(e.path);
+        w.put(e.key);
+        w.put(static_cast<uint8_t>(e.is_pe));
+        w.put(e.info.machine);
+        w.put(e.info.subsystem);
+        w.put(e.info.characteristics);
+        w.put(e.info.timestamp);
+        for (const auto f : e.info.file_version) w.put(f);
+        for (const auto f : e.info.product_version) w.put(f);
+        w.put(e.info.product_name);
+        w.put(e.info.description);
+        w.put(e.info.icon_offset);
+        w.put(e.info.icon_size);
+        w.put(e.info.icon_width);
+    }
+
+    return ::sigil::data::write_binary_file(file, w.out);
+}
+
+/* =========================
+   Scanner
+   ========================= */
+
+static void key_from_stat(const struct stat &st, ::sigil::fs::file_key_t &out) {
+    out.dev = st.st_dev;
+    out.ino = st.st_ino;
+    out.size = static_cast<uint64_t>(st.st_size);
+    out.mtime_sec = st.st_mtim.tv_sec;
+    out.mtime_nsec = static_cast<uint32_t>(st.st_mtim.tv_nsec);
+}
+
+static bool name_is_exe(std::string_view name) {
+    if (name.size() < 5)
+        return false;
+    const std::string_view ext = name.substr(name.size() - 4);
+    return ext[0] == '.' && (ext[1] | 0x20) == 'e' && (ext[2] | 0x20) == 'x' && (ext[3] | 0x20) == 'e';
+}
+
+// Subtrees full of executables nobody launches directly
+static bool dir_is_skipped(std::string_view parent, std::string_view name) {
+    if (name.empty() || name.front() == '.')
+        return true;
+    if (name == "compatdata" || name == "shadercache")
+        return true;
+    const std::size_t slash = parent.rfind('/');
+    const std::string_view parent_name = slash == std::string_view::npos ? parent : parent.substr(slash + 1);
+    return parent_name == "drive_c" && (name == "windows" || name == "Windows");
+}
+
+struct library_scan_t {
+    std::unordered_map<std::string_view, const library_dir_t*> old_dirs;
+    std::unordered_map<std::string_view, const library_exe_t*> old_exes;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<std::string> queue;
+    std::size_t busy = 0;           // workers holding a directory
+
+    std::vector<library_dir_t> dirs;
+    std::vector<library_exe_t> exes;
+    library_scan_stats_t stats;
+
+    void push(std::string dir) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            queue.push_back(std::move(dir));
+        }
+        wake.notify_one();
+    }
+
+    bool pop(std::string &dir) {
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [&] { return !queue.empty() || busy == 0; });
+        if (queue.empty())
+            return false;
+        dir = std::move(queue.front());
+        queue.pop_front();
+        ++busy;
+        return true;
+    }
+
+    void finish(std::vector<library_dir_t> &d, std::vector<library_exe_t> &e, const library_scan_stats_t &s) {
+        std::lock_guard<std::mutex> guard(lock);
+        --busy;
+        for (auto &x : d) dirs.push_back(std::move(x));
+        for (auto &x : e) exes.push_back(std::move(x));
+        stats.dirs_listed += s.dirs_listed;
+        stats.dirs_reused += s.dirs_reused;
+        stats.exes_parsed += s.exes_parsed;
+        stats.exes_reused += s.exes_reused;
+        stats.not_pe += s.not_pe;
+        d.clear();
+        e.clear();
+        if (busy == 0 && queue.empty())
+            wake.notify_all();
+    }
+};
+
+// List dir into d, names of subdirectories and executables, sorted
+static bool list_library_dir(const std::string &path, library_dir_t &d) {
+    DIR *dir = ::opendir(path.c_str());
+    if (!dir)
+        return false;
+    const int dfd = ::dirfd(dir);
+
+    while (const dirent *e = ::readdir(dir)) {
+        const std::string_view name = e->d_name;
+        if (name == "." || name == "..")
+            continue;
+
+        unsigned char type = e->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (::fstatat(dfd, e->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                continue;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+
+        // Symlinks are not followed, library trees link back into themselves often enough
+        if (type == DT_DIR) {
+            if (!dir_is_skipped(path, name))
+                d.subdirs.emplace_back(name);
+        } else if (type == DT_REG && name_is_exe(name)) {
+            d.executables.emplace_back(name);
+        }
+    }
+
+    ::closedir(dir);
+    std::sort(d.subdirs.begin(), d.subdirs.end());
+    std::sort(d.executables.begin(), d.executables.end());
+    return true;
+}
+
+static void library_worker(library_scan_t &scan) {
+    std::vector<library_dir_t> dirs;
+    std::vector<library_exe_t> exes;
+    library_scan_stats_t stats;
+    std::string path;
+
+    while (scan.pop(path)) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            scan.finish(dirs, exes, stats);
+            stats = {};
+            continue;
+        }
+
+        library_dir_t d;
+        d.path = path;
+        key_from_stat(st, d.key);
+
+        // Same directory mtime, same names: no readdir
+        auto old = scan.old_dirs.find(d.path);
+        if (old != scan.old_dirs.end() && old->second->key == d.key) {
+            d.subdirs = old->second->subdirs;
+            d.executables = old->second->executables;
+            ++stats.dirs_reused;
+        } else {
+            if (!list_library_dir(path, d)) {
+                scan.finish(dirs, exes, stats);
+                stats = {};
+                continue;
+            }
+            ++stats.dirs_listed;
+        }
+
+        for (const auto &sub : d.subdirs)
+            scan.push(path + "/" + sub);
+
+        for (const auto &name : d.executables) {
+            library_exe_t e;
+            e.path = path + "/" + name;
+            if (::stat(e.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+                continue;
+            key_from_stat(st, e.key);
+
+            auto known = scan.old_exes.find(e.path);
+            if (known != scan.old_exes.end() && known->second->key == e.key) {
+                e = *known->second;
+                ++stats.exes_reused;
+            } else {
+                e.is_pe = read_pe_info(e.path, e.info).is_ok();
+                ++stats.exes_parsed;
+            }
+            if (!e.is_pe)
+                ++stats.not_pe;
+            exes.push_back(std::move(e));
+        }
+
+        dirs.push_back(std::move(d));
+        scan.finish(dirs, exes, stats);
+        stats = {};
+    }
+}
+
+::sigil::yield scan_game_library(const std::vector<std::filesystem::path> &roots, library_index_t &index,
+                                 bool &changed, library_scan_stats_t *stats, unsigned threads) {
+    ::sigil::yield ret;
+    changed = false;
+
+    library_scan_t scan;
+    for (const auto &d : index.dirs)
+        scan.old_dirs.emplace(d.path, &d);
+    for (const auto &e : index.executables)
+        scan.old_exes.emplace(e.path, &e);
+
+    std::vector<std::string> starts;
+    for (const auto &root : roots) {
+        std::string p = root.lexically_normal().string();
+        while (p.size() > 1 && p.back() == '/')
+            p.pop_back();
+        starts.push_back(std::move(p));
+    }
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+    for (auto &p : starts)
+        scan.queue.push_back(p);
+
+    // Directory walking waits on the disk more than on the CPU, oversubscribe a little
+    if (threads == 0)
+        threads = std::clamp(2 * std::thread::hardware_concurrency(), 2u, 16u);
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        pool.emplace_back(library_worker, std::ref(scan));
+    for (auto &t : pool)
+        t.join();
+
+    auto by_path = [](const auto &a, const auto &b) { return a.path < b.path; };
+    std::sort(scan.dirs.begin(), scan.dirs.end(), by_path);
+    std::sort(scan.exes.begin(), scan.exes.end(), by_path);
+
+    // Nested roots reach some directories twice
+    auto same_path = [](const auto &a, const auto &b) { return a.path == b.path; };
+    scan.dirs.erase(std::unique(scan.dirs.begin(), scan.dirs.end(), same_path), scan.dirs.end());
+    scan.exes.erase(std::unique(scan.exes.begin(), scan.exes.end(), same_path), scan.exes.end());
+
+    std::vector<std::filesystem::path> new_roots(starts.begin(), starts.end());
+    changed = scan.stats.dirs_listed != 0 || scan.stats.exes_parsed != 0
+           || scan.dirs.size() != index.dirs.size() || scan.exes.size() != index.executables.size()
+           || new_roots != index.roots;
+
+    // Unchanged counts can still hide one path swapped for another
+    for (std::size_t i = 0; !changed && i < scan.dirs.size(); ++i)
+        changed = scan.dirs[i].path != index.dirs[i].path;
+    for (std::size_t i = 0; !changed && i < scan.exes.size(); ++i)
+        changed = scan.exes[i].path != index.executables[i].path || !(scan.exes[i].key == index.executables[i].key);
+
+    index.roots = std::move(new_roots);
+    index.dirs = std::move(scan.dirs);
+    index.executables = std::move(scan.exes);
+
+    if (stats)
+        *stats = scan.stats;
+    return ret;
+}
+
+::sigil::yield load_library_roots(const ::sigil::platform::app_descriptor_t &app, std::vector<std::filesystem::path> &out) {
+    ::sigil::yield ret;
+    out.clear();
+
+    const std::filesystem::path home = ::sigil::platform::get_home(app);
+    const std::filesystem::path config = ::sigil::platform::get_sigilvm_config_root(app) / "library.yaml";
+
+    ::sigil::data::document_t doc;
+    ::sigil::yield st = doc.load(config, ::sigil::data::FORMAT_YAML);
+    if (st.is_failure()) {
+        if (st.code != ENOENT)
+            return st;
+        out.push_back(home / "Games");
+        return ret;
+    }
+
+    for (const ::sigil::data::value_t root : doc.root()["roots"]) {
+        std::string p = root.decode();
+        if (p.empty())
+            continue;
+        if (p == "~" || p.rfind("~/", 0) == 0)
+            out.push_back(home / p.substr(std::min<std::size_t>(p.size(), 2)));
+        else
+            out.push_back(p);
+    }
+
+    return ret;
+}
+
+::sigil::yield probe_game_library(const ::sigil::platform::app_descriptor_t &app, library_index_t &index,
+                                  library_scan_stats_t *stats) {
+    std::vector<std::filesystem::path> roots;
+    ::sigil::yield ret = load_library_roots(app, roots);
+    if (ret.is_failure())
+        return ret;
+
+    // Games Steam installed, Steam's own Protons are runners not games
+    if (const auto steam = probe_steam(app)) {
+        for (const auto &a : steam->apps) {
+            const bool is_tool = std::any_of(steam->tools.begin(), steam->tools.end(),
+                                             [&](const steam_tool_t &t) { return t.appid == a.appid; });
+            if (a.installed() && !is_tool)
+                roots.push_back(a.install_dir);
+        }
+    }
+
+    // A missing or stale index only costs a full scan
+    const std::filesystem::path index_file = ::sigil::platform::get_sigilvm_cache_root(app) / "compat" / "library.index";
+    index.load(index_file);
+
+    bool changed = false;
+    ret = scan_game_library(roots, index, changed, stats);
+    if (ret.is_failure() || !changed)
+        return ret;
+
+    ::sigil::yield s = index.save(index_file);
+    if (s.is_failure())
+        sigil::dcout << "[DEBUG] Could not write " << index_file << std::endl;
+    return ret;
+}
+
+bool library_exe_is_launchable(const library_exe_t &exe) {
+    if (!exe.is_pe || exe.info.is_dll())
+        return false;
+    if (exe.info.machine != PE_MACHINE_I386 && exe.info.machine != PE_MACHINE_AMD64)
+        return false;
+    if (exe.info.subsystem != PE_SUBSYSTEM_GUI && exe.info.subsystem != PE_SUBSYSTEM_CUI)
+        return false;
+
+    std::string name(exe.name());
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    static constexpr std::string_view helpers[] = {
+        "unins", "setup", "install", "vcredist", "vc_redist", "dxsetup", "dotnet",
+        "crashhandler", "crashreport", "crashpad", "ue4prereq", "easyanticheat_setup",
+    };
+    for (const auto h : helpers)
+        if (name.find(h) != std::string::npos)
+            return false;
+
+    // Whole redistributable folders shipped next to the game
+    std::string path = exe.path;
+    std::transform(path.begin(), path.end(), path.begin(), [](unsigned char c) { return std::tolower(c); });
+    return path.find("/_commonredist/") == std::string::npos && path.find("/redist/") == std::string::npos;
+}
+
+} // namespace sigil::platform
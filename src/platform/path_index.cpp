@@ -0,0 +1,208 @@
+#include <sigil/platform/fs.h>
+#include <sigil/common.h>
+
+#include <unordered_map>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+namespace sigil::fs {
+
+struct path_dir_t {
+    std::string dir;
+    int64_t  mtime_sec = 0;
+    uint32_t mtime_nsec = 0;
+};
+
+// Process-wide, guarded by lock. Lookups are a hash probe plus one
+// non-blocking read() on the inotify fd to learn about changes.
+static struct {
+    std::mutex lock;
+    std::string path_env;                               // $PATH the index was built from
+    std::vector<path_dir_t> dirs;                       // PATH order, duplicates dropped
+    std::unordered_map<std::string, uint32_t> names;    // name -> first dir containing it
+    int inotify_fd = -1;
+    bool built = false;
+} path_index;
+
+static constexpr uint32_t watch_mask =
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |
+    IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+static bool dir_mtime(const char *dir, int64_t &sec, uint32_t &nsec) {
+    struct statx st{};
+    if (statx(AT_FDCWD, dir, AT_STATX_SYNC_AS_STAT, STATX_MTIME, &st) != 0)
+        return false;
+    sec = st.stx_mtime.tv_sec;
+    nsec = st.stx_mtime.tv_nsec;
+    return true;
+}
+
+static void scan_dir(uint32_t dir_idx) {
+    const std::string &dir = path_index.dirs[dir_idx].dir;
+
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    alignas(struct dirent64) char buf[32 * 1024];
+
+    while (true) {
+        ssize_t n = getdents64(fd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+
+        for (ssize_t off = 0; off < n;) {
+            const auto *d = reinterpret_cast<const struct dirent64*>(buf + off);
+            off += d->d_reclen;
+
+            if (d->d_type == DT_DIR)
+                continue;
+            if (d->d_name[0] == '.' && (d->d_name[1] == '\0' || (d->d_name[1] == '.' && d->d_name[2] == '\0')))
+                continue;
+
+            // try_emplace keeps the earlier PATH entry, same as execvp
+            path_index.names.try_emplace(d->d_name, dir_idx);
+        }
+    }
+
+    ::close(fd);
+}
+
+static void rebuild(const char *path_env) {
+    path_index.path_env = path_env;
+    path_index.dirs.clear();
+    path_index.names.clear();
+
+    if (path_index.inotify_fd >= 0)
+        ::close(path_index.inotify_fd);
+    path_index.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    const char *p = path_env;
+    while (true) {
+        const char *end = std::strchr(p, ':');
+        std::string dir = end ? std::string(p, end - p) : std::string(p);
+
+        // Empty element means cwd, which would make the index cwd-dependent
+        if (!dir.empty()) {
+            bool seen = false;
+            for (const auto &d : path_index.dirs) {
+                if (d.dir == dir) { seen = true; break; }
+            }
+
+            if (!seen) {
+                path_dir_t entry;
+                entry.dir = std::move(dir);
+                dir_mtime(entry.dir.c_str(), entry.mtime_sec, entry.mtime_nsec);
+                if (path_index.inotify_fd >= 0)
+                    inotify_add_watch(path_index.inotify_fd, entry.dir.c_str(), watch_mask);
+                path_index.dirs.push_back(std::move(entry));
+            }
+        }
+
+        if (!end)
+            break;
+        p = end + 1;
+    }
+
+    for (uint32_t i = 0; i < path_index.dirs.size(); ++i)
+        scan_dir(i);
+
+    path_index.built = true;
+}
+
+// Also catches what inotify cannot: directories missing at build time, watches refused
+static bool mtimes_changed() {
+    for (const auto &d : path_index.dirs) {
+        int64_t sec = 0;
+        uint32_t nsec = 0;
+        dir_mtime(d.dir.c_str(), sec, nsec);
+        if (sec != d.mtime_sec || nsec != d.mtime_nsec)
+            return true;
+    }
+
+    return false;
+}
+
+static bool is_stale() {
+    if (path_index.inotify_fd >= 0) {
+        alignas(struct inotify_event) char buf[4096];
+        bool changed = false;
+
+        // Drain everything queued, any event (or overflow) means rescan
+        while (true) {
+            ssize_t n = ::read(path_index.inotify_fd, buf, sizeof(buf));
+            if (n > 0) {
+                changed = true;
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+
+        return changed;
+    }
+
+    return mtimes_changed();
+}
+
+bool resolve_in_path(const char* name, std::string &out) {
+    if (!name || name[0] == '\0')
+        return false;
+
+    if (std::strchr(name, '/')) {
+        if (access(name, X_OK) != 0)
+            return false;
+        out = name;
+        return true;
+    }
+
+    const char* path_env = getenv("PATH");
+    if (!path_env)
+        return false;
+
+    std::lock_guard<std::mutex> guard(path_index.lock);
+
+    if (!path_index.built || path_index.path_env != path_env || is_stale())
+        rebuild(path_env);
+
+    // A miss pays for one stat per PATH entry, a directory created after the build has no watch
+    auto it = path_index.names.find(name);
+    if (it == path_index.names.end() && mtimes_changed()) {
+        rebuild(path_env);
+        it = path_index.names.find(name);
+    }
+    if (it == path_index.names.end())
+        return false;
+
+    // Index knows names only, the mode check happens once per hit
+    for (uint32_t i = it->second; i < path_index.dirs.size(); ++i) {
+        std::string candidate = path_index.dirs[i].dir;
+        candidate += '/';
+        candidate += name;
+
+        if (access(candidate.c_str(), X_OK) == 0) {
+            out = std::move(candidate);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool binary_exists_in_path(const char* name) {
+    std::string resolved;
+    return resolve_in_path(name, resolved);
+}
+
+} // namespace sigil::fs
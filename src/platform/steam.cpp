@@ -0,0 +1,393 @@
+#include <sigil/platform/steam.h>
+#include <sigil/platform/paths.h>
+#include <sigil/data/parser.h>
+#include <sigil/common.h>
+
+#include <unordered_map>
+#include <string_view>
+#include <filesystem>
+#include <algorithm>
+#include <charconv>
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <cerrno>
+
+namespace sigil::platform {
+
+const steam_app_t *steam_index_t::find_app(uint32_t appid) const noexcept {
+    auto it = std::lower_bound(apps.begin(), apps.end(), appid,
+                               [](const steam_app_t &a, uint32_t id) { return a.appid < id; });
+    return it != apps.end() && it->appid == appid ? &*it : nullptr;
+}
+
+bool find_steam_root(const ::sigil::platform::app_descriptor_t &app, std::filesystem::path &out) {
+    const std::filesystem::path home = ::sigil::platform::get_home(app);
+    const std::filesystem::path candidates[] = {
+        home / ".local/share/Steam",
+        home / ".steam/steam",
+        home / ".var/app/com.valvesoftware.Steam/.local/share/Steam",
+    };
+
+    std::error_code ec;
+    for (const auto &c : candidates) {
+        if (std::filesystem::is_directory(c / "steamapps", ec)) {
+            out = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* =========================
+   Manifests
+   ========================= */
+
+// KeyValues keys compare without case, Steam itself writes both "AppState" and "appstate"
+static ::sigil::data::value_t vdf_find(::sigil::data::value_t v, std::string_view key) {
+    for (::sigil::data::value_t child : v) {
+        const std::string_view k = child.key();
+        if (k.size() == key.size()
+            && std::equal(k.begin(), k.end(), key.begin(),
+                          [](char a, char b) { return (a | 0x20) == (b | 0x20); }))
+            return child;
+    }
+    return {};
+}
+
+static bool stat_key(const std::filesystem::path &p, ::sigil::fs::file_key_t &out) {
+    struct stat st;
+    if (::stat(p.c_str(), &st) != 0)
+        return false;
+    out.dev = st.st_dev;
+    out.ino = st.st_ino;
+    out.size = static_cast<uint64_t>(st.st_size);
+    out.mtime_sec = st.st_mtim.tv_sec;
+    out.mtime_nsec = static_cast<uint32_t>(st.st_mtim.tv_nsec);
+    return true;
+}
+
+// Library roots, root first, then every "path" of libraryfolders.vdf (older files list them as "1" "/path")
+static void parse_libraryfolders(const std::filesystem::path &file, const std::filesystem::path &root,
+                                 std::vector<std::filesystem::path> &out) {
+    out.clear();
+    out.push_back(root);
+
+    ::sigil::data::document_t doc;
+    if (doc.load(file, ::sigil::data::FORMAT_VDF).is_failure())
+        return;
+
+    for (::sigil::data::value_t entry : vdf_find(doc.root(), "libraryfolders")) {
+        std::filesystem::path p;
+        if (entry.is_object()) {
+            p = vdf_find(entry, "path").decode();
+        } else {
+            const std::string_view k = entry.key();
+            if (!k.empty() && std::all_of(k.begin(), k.end(), [](char c) { return c >= '0' && c <= '9'; }))
+                p = entry.decode();
+        }
+
+        if (p.empty())
+            continue;
+        p = p.lexically_normal();
+        if (!p.has_filename())
+            p = p.parent_path();
+        if (std::find(out.begin(), out.end(), p) == out.end())
+            out.push_back(std::move(p));
+    }
+}
+
+static bool parse_app_manifest(const std::filesystem::path &file, const std::filesystem::path &library, steam_app_t &out) {
+    ::sigil::data::document_t doc;
+    if (doc.load(file, ::sigil::data::FORMAT_VDF).is_failure())
+        return false;
+
+    const ::sigil::data::value_t state = vdf_find(doc.root(), "AppState");
+    int64_t appid = 0;
+    if (!vdf_find(state, "appid").as_int(appid) || appid <= 0 || appid > UINT32_MAX)
+        return false;
+
+    const std::string installdir = vdf_find(state, "installdir").decode();
+    if (installdir.empty())
+        return false;
+
+    int64_t size = 0, flags = 0;
+    vdf_find(state, "SizeOnDisk").as_int(size);
+    vdf_find(state, "StateFlags").as_int(flags);
+
+    out.appid = static_cast<uint32_t>(appid);
+    out.name = vdf_find(state, "name").decode();
+    out.library = library;
+    out.install_dir = library / "steamapps" / "common" / installdir;
+    out.size_on_disk = size > 0 ? static_cast<uint64_t>(size) : 0;
+    out.state_flags = static_cast<uint32_t>(flags);
+    return true;
+}
+
+// "compatibilitytools" { "compat_tools" { "<name>" { "install_path" "." "display_name" "..." } } }
+static void parse_tool_manifest(const std::filesystem::path &file, std::vector<steam_tool_t> &out) {
+    ::sigil::data::document_t doc;
+    if (doc.load(file, ::sigil::data::FORMAT_VDF).is_failure())
+        return;
+
+    const ::sigil::data::value_t tools = vdf_find(vdf_find(doc.root(), "compatibilitytools"), "compat_tools");
+    for (::sigil::data::value_t t : tools) {
+        if (!t.is_object())
+            continue;
+
+        steam_tool_t tool;
+        tool.name = std::string(t.key());
+        tool.display_name = vdf_find(t, "display_name").decode();
+        if (tool.display_name.empty())
+            tool.display_name = tool.name;
+
+        // install_path is relative to the manifest, usually "."
+        const std::filesystem::path install = vdf_find(t, "install_path").decode();
+        tool.path = (install.is_absolute() ? install : file.parent_path() / install).lexically_normal();
+        if (!tool.path.has_filename())
+            tool.path = tool.path.parent_path();
+        tool.manifest = file;
+        out.push_back(std::move(tool));
+    }
+}
+
+/* =========================
+   Listings
+   ========================= */
+
+// Names in dir, regular files starting with prefix or directories, sorted
+static bool list_steam_dir(const std::filesystem::path &path, std::string_view prefix, bool dirs,
+                           std::vector<std::string> &out) {
+    out.clear();
+    DIR *dir = ::opendir(path.c_str());
+    if (!dir)
+        return false;
+    const int dfd = ::dirfd(dir);
+
+    while (const dirent *e = ::readdir(dir)) {
+        const std::string_view name = e->d_name;
+        if (name.empty() || name.front() == '.' || name.substr(0, prefix.size()) != prefix)
+            continue;
+
+        // Tool directories are often symlinks into a download folder, follow them here
+        unsigned char type = e->d_type;
+        if (type == DT_UNKNOWN || type == DT_LNK) {
+            struct stat st;
+            if (::fstatat(dfd, e->d_name, &st, 0) != 0)
+                continue;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+
+        if (type == (dirs ? DT_DIR : DT_REG))
+            out.emplace_back(name);
+    }
+
+    ::closedir(dir);
+    std::sort(out.begin(), out.end());
+    return true;
+}
+
+// Names of dir, listed again only when its key moved since the last refresh
+static const std::vector<std::string> &refresh_listing(const std::vector<steam_index_t::listing_t> &old,
+                                                       std::vector<steam_index_t::listing_t> &next,
+                                                       const std::filesystem::path &path, std::string_view prefix,
+                                                       bool dirs, steam_index_stats_t &stats) {
+    steam_index_t::listing_t l;
+    l.path = path;
+    if (!stat_key(path, l.key))
+        return next.emplace_back(std::move(l)).names;
+
+    auto it = std::find_if(old.begin(), old.end(), [&](const steam_index_t::listing_t &o) { return o.path == path; });
+    if (it != old.end() && it->key == l.key) {
+        l.names = it->names;
+    } else {
+        list_steam_dir(path, prefix, dirs, l.names);
+        ++stats.listed;
+    }
+    return next.emplace_back(std::move(l)).names;
+}
+
+static const steam_index_t::source_t *find_source(const std::vector<steam_index_t::source_t> &v,
+                                                  const std::filesystem::path &path) {
+    auto it = std::lower_bound(v.begin(), v.end(), path,
+                               [](const steam_index_t::source_t &s, const std::filesystem::path &p) { return s.path < p; });
+    return it != v.end() && it->path == path ? &*it : nullptr;
+}
+
+/* =========================
+   Index
+   ========================= */
+
+::sigil::yield refresh_steam_index(const std::filesystem::path &root, steam_index_t &index,
+                                   bool &changed, steam_index_stats_t *stats) {
+    ::sigil::yield ret;
+    steam_index_stats_t local;
+
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root / "steamapps", ec))
+        return ret.set_state(sigil::yield_state::fail).set_code(ENOENT);
+
+    if (index.root != root) {
+        index = steam_index_t{};
+        index.root = root;
+        changed = true;
+    }
+
+    // Library folders, Steam moved the file from config/ to steamapps/ at some point
+    std::filesystem::path folders = root / "steamapps" / "libraryfolders.vdf";
+    ::sigil::fs::file_key_t folders_key;
+    if (!stat_key(folders, folders_key)) {
+        folders = root / "config" / "libraryfolders.vdf";
+        if (!stat_key(folders, folders_key))
+            folders_key = {};
+    }
+
+    if (index.libraries.empty() || !(folders_key == index.libraryfolders)) {
+        std::vector<std::filesystem::path> libraries;
+        if (folders_key == ::sigil::fs::file_key_t{}) {
+            libraries.push_back(root);
+        } else {
+            parse_libraryfolders(folders, root, libraries);
+            ++local.parsed;
+        }
+        changed |= libraries != index.libraries;
+        index.libraries = std::move(libraries);
+        index.libraryfolders = folders_key;
+    } else {
+        ++local.reused;
+    }
+
+    std::vector<steam_index_t::listing_t> listings;
+    listings.reserve(index.listings.size());
+
+    // App manifests, an unchanged one keeps the app it gave last time
+    std::unordered_map<uint32_t, const steam_app_t*> old_apps;
+    for (const auto &a : index.apps)
+        old_apps.emplace(a.appid, &a);
+
+    std::vector<steam_app_t> apps;
+    std::vector<steam_index_t::source_t> manifests;
+    apps.reserve(index.apps.size());
+    manifests.reserve(index.manifests.size());
+
+    for (const auto &library : index.libraries) {
+        const std::filesystem::path steamapps = library / "steamapps";
+        for (const auto &name : refresh_listing(index.listings, listings, steamapps, "appmanifest_", false, local)) {
+            if (name.size() < 4 || name.compare(name.size() - 4, 4, ".acf") != 0)
+                continue;
+
+            steam_index_t::source_t src;
+            src.path = steamapps / name;
+            if (!stat_key(src.path, src.key))
+                continue;
+
+            const steam_index_t::source_t *old = find_source(index.manifests, src.path);
+            uint32_t appid = 0;
+            const char *digits = name.data() + 12;
+            std::from_chars(digits, name.data() + name.size() - 4, appid);
+
+            auto it = old_apps.find(appid);
+            if (old && old->key == src.key) {
+                if (it != old_apps.end() && it->second->library == library)
+                    apps.push_back(*it->second);
+                ++local.reused;
+            } else {
+                steam_app_t app;
+                if (parse_app_manifest(src.path, library, app))
+                    apps.push_back(std::move(app));
+                ++local.parsed;
+                changed = true;
+            }
+            manifests.push_back(std::move(src));
+        }
+    }
+
+    // The first library listing an app wins, as in Steam
+    std::stable_sort(apps.begin(), apps.end(), [](const steam_app_t &a, const steam_app_t &b) { return a.appid < b.appid; });
+    apps.erase(std::unique(apps.begin(), apps.end(), [](const steam_app_t &a, const steam_app_t &b) { return a.appid == b.appid; }),
+               apps.end());
+    std::sort(manifests.begin(), manifests.end(),
+              [](const steam_index_t::source_t &a, const steam_index_t::source_t &b) { return a.path < b.path; });
+    changed |= manifests.size() != index.manifests.size();
+
+    // Custom tools
+    std::vector<steam_tool_t> tools;
+    std::vector<steam_index_t::source_t> tool_manifests;
+    const std::filesystem::path tools_dir = root / "compatibilitytools.d";
+    for (const auto &name : refresh_listing(index.listings, listings, tools_dir, "", true, local)) {
+        steam_index_t::source_t src;
+        src.path = tools_dir / name / "compatibilitytool.vdf";
+        if (!stat_key(src.path, src.key))
+            continue;
+
+        const steam_index_t::source_t *old = find_source(index.tool_manifests, src.path);
+        if (old && old->key == src.key) {
+            for (const auto &t : index.tools)
+                if (t.manifest == src.path)
+                    tools.push_back(t);
+            ++local.reused;
+        } else {
+            parse_tool_manifest(src.path, tools);
+            ++local.parsed;
+            changed = true;
+        }
+        tool_manifests.push_back(std::move(src));
+    }
+    std::sort(tool_manifests.begin(), tool_manifests.end(),
+              [](const steam_index_t::source_t &a, const steam_index_t::source_t &b) { return a.path < b.path; });
+    changed |= tool_manifests.size() != index.tool_manifests.size();
+
+    // Protons installed as apps, only names that look like one cost a stat
+    for (const auto &a : apps) {
+        if (a.name.compare(0, 6, "Proton") != 0 || !a.installed())
+            continue;
+        struct stat st;
+        if (::stat((a.install_dir / "proton").c_str(), &st) != 0)
+            continue;
+
+        steam_tool_t tool;
+        tool.name = a.name;
+        tool.display_name = a.name;
+        tool.path = a.install_dir;
+        tool.appid = a.appid;
+        tools.push_back(std::move(tool));
+    }
+
+    index.apps = std::move(apps);
+    index.tools = std::move(tools);
+    index.listings = std::move(listings);
+    index.manifests = std::move(manifests);
+    index.tool_manifests = std::move(tool_manifests);
+
+    if (stats)
+        *stats = local;
+    return ret;
+}
+
+std::shared_ptr<const steam_index_t> probe_steam(const ::sigil::platform::app_descriptor_t &app) {
+    static std::mutex lock;
+    static steam_index_t index;                             // refreshed in place, never handed out
+    static std::shared_ptr<const steam_index_t> snapshot;
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    std::filesystem::path root;
+    if (!find_steam_root(app, root))
+        return nullptr;
+
+    bool changed = false;
+    if (refresh_steam_index(root, index, changed).is_failure())
+        return nullptr;
+
+    if (changed || !snapshot)
+        snapshot = std::make_shared<const steam_index_t>(index);
+    return snapshot;
+}
+
+} // namespace sigil::platform
@@ -0,0 +1,269 @@
+#include <sigil/platform/theme_template.h>
+#include <sigil/platform/fs.h>
+#include <sigil/data/parser.h>
+#include <sigil/math/hash.h>
+#include <sigil/common.h>
+
+#include <string_view>
+#include <utility>
+#include <string>
+#include <mutex>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+namespace sigil::desktop {
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+const std::string *theme_pattern_t::find(std::string_view key) const {
+    auto it = values.find(key);
+    return it == values.end() ? nullptr : &it->second;
+}
+
+// Scalars of a map under prefix, nested maps become dotted keys
+static void flatten_pattern(const ::sigil::data::value_t &map, const std::string &prefix, theme_pattern_t &out) {
+    for (const ::sigil::data::value_t member : map) {
+        const std::string_view key = member.key();
+        std::string path = prefix.empty() ? std::string(key) : prefix + "." + std::string(key);
+
+        // Sequences carry nothing a template can use
+        if (member.is_object()) {
+            flatten_pattern(member, path, out);
+            continue;
+        }
+        if (member.kind() == ::sigil::data::NODE_ARRAY || member.kind() == ::sigil::data::NODE_NULL)
+            continue;
+
+        std::string value = member.decode();
+        if (path == "name")
+            out.name = value;
+
+        std::string_view stored = path;
+        if (stored.starts_with("tags."))
+            stored.remove_prefix(5);
+
+        // accent.primary also answers for accent, unless accent has its own value
+        if (key == "primary" && stored.size() > 8)
+            out.values.emplace(std::string(stored.substr(0, stored.size() - 8)), value);
+
+        out.values.insert_or_assign(std::string(stored), std::move(value));
+    }
+}
+
+::sigil::yield load_theme_pattern(const std::filesystem::path &file, theme_pattern_t &out) {
+    ::sigil::yield ret;
+    out = {};
+
+    ::sigil::data::document_t doc;
+    ret = doc.load(file, ::sigil::data::FORMAT_YAML);
+    if (ret.is_failure())
+        return ret;
+
+    const ::sigil::data::value_t root = doc.root();
+    if (root && !root.is_object())
+        return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+
+    flatten_pattern(root, {}, out);
+    return ret;
+}
+
+::sigil::yield compile_template(std::string source, template_plan_t &out) {
+    ::sigil::yield ret;
+
+    out.source = std::move(source);
+    out.ops.clear();
+    out.literal_bytes = 0;
+
+    const std::string_view src = out.source;
+    std::size_t pos = 0;
+
+    auto literal = [&](std::size_t from, std::size_t to) {
+        if (to <= from)
+            return;
+        out.ops.push_back({ static_cast<uint32_t>(from), static_cast<uint32_t>(to - from), false, TEMPLATE_FILTER_NONE });
+        out.literal_bytes += to - from;
+    };
+
+    while (pos < src.size()) {
+        const std::size_t open = src.find("{{", pos);
+        if (open == std::string_view::npos)
+            break;
+
+        const std::size_t close = src.find("}}", open + 2);
+        if (close == std::string_view::npos)
+            return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+
+        literal(pos, open);
+
+        std::string_view body = src.substr(open + 2, close - open - 2);
+        template_filter_t filter = TEMPLATE_FILTER_NONE;
+
+        const std::size_t bar = body.find('|');
+        if (bar != std::string_view::npos) {
+            const std::string_view name = trim(body.substr(bar + 1));
+            if (name == "nohash")   filter = TEMPLATE_FILTER_NOHASH;
+            else if (name == "rgb") filter = TEMPLATE_FILTER_RGB;
+            else return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+            body = body.substr(0, bar);
+        }
+
+        const std::string_view key = trim(body);
+        if (key.empty())
+            return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+
+        out.ops.push_back({ static_cast<uint32_t>(key.data() - src.data()), static_cast<uint32_t>(key.size()), true, filter });
+        pos = close + 2;
+    }
+
+    literal(pos, src.size());
+    return ret;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// "#RRGGBB" or "#RRGGBBAA" as "r, g, b", alpha is left to the template
+static bool append_rgb(std::string_view value, std::string &out) {
+    if (!value.empty() && value.front() == '#')
+        value.remove_prefix(1);
+    if (value.size() != 6 && value.size() != 8)
+        return false;
+
+    for (int i = 0; i < 3; ++i) {
+        const int hi = hex_digit(value[i * 2]);
+        const int lo = hex_digit(value[i * 2 + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        if (i > 0)
+            out += ", ";
+        out += std::to_string(hi * 16 + lo);
+    }
+    return true;
+}
+
+::sigil::yield render_template(const template_plan_t &plan, const theme_pattern_t &pattern,
+                               std::string &out, std::string *missing) {
+    ::sigil::yield ret;
+    const std::string_view src = plan.source;
+
+    out.reserve(out.size() + plan.literal_bytes + (plan.ops.size() / 2) * 8);
+
+    for (const auto &op : plan.ops) {
+        const std::string_view text = src.substr(op.offset, op.length);
+        if (!op.slot) {
+            out += text;
+            continue;
+        }
+
+        const std::string *value = pattern.find(text);
+        if (!value) {
+            if (missing) missing->assign(text);
+            return ret.set_state(sigil::yield_state::fail).set_code(ENOENT);
+        }
+
+        switch (op.filter) {
+        case TEMPLATE_FILTER_NONE:
+            out += *value;
+            break;
+        case TEMPLATE_FILTER_NOHASH:
+            out += std::string_view(*value).substr(!value->empty() && value->front() == '#' ? 1 : 0);
+            break;
+        case TEMPLATE_FILTER_RGB:
+            if (!append_rgb(*value, out)) {
+                if (missing) missing->assign(text);
+                return ret.set_state(sigil::yield_state::fail).set_code(EINVAL);
+            }
+            break;
+        }
+    }
+
+    return ret;
+}
+
+// Shared by every theme build in the process, a resident daemon keeps it warm
+static struct {
+    std::mutex lock;
+    std::map<::sigil::fs::file_digest_t, std::shared_ptr<const template_plan_t>> plans;
+} plan_cache;
+
+static std::shared_ptr<const template_plan_t> plan_cache_lookup(const ::sigil::fs::file_digest_t &digest) {
+    std::lock_guard<std::mutex> guard(plan_cache.lock);
+    auto it = plan_cache.plans.find(digest);
+    return it == plan_cache.plans.end() ? nullptr : it->second;
+}
+
+static bool read_whole(const std::filesystem::path &file, std::size_t size_hint, std::string &out) {
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    out.clear();
+    out.resize(size_hint + 1);
+
+    std::size_t len = 0;
+    for (;;) {
+        if (len == out.size())
+            out.resize(out.size() * 2);
+
+        const ssize_t n = ::read(fd, out.data() + len, out.size() - len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            const int err = errno;
+            ::close(fd);
+            errno = err;
+            return false;
+        }
+        if (n == 0)
+            break;
+        len += static_cast<std::size_t>(n);
+    }
+
+    ::close(fd);
+    out.resize(len);
+    return true;
+}
+
+::sigil::yield load_template_plan(const std::filesystem::path &file, std::shared_ptr<const template_plan_t> &out) {
+    ::sigil::yield ret;
+    out.reset();
+
+    ::sigil::fs::file_key_t key;
+    if (!::sigil::fs::get_file_key(file, key))
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    ::sigil::fs::file_digest_t digest;
+    if (::sigil::fs::digest_cache_lookup(key, digest) && (out = plan_cache_lookup(digest)))
+        return ret;
+
+    std::string source;
+    if (!read_whole(file, key.size, source))
+        return ret.set_state(sigil::yield_state::fail).set_code(errno);
+
+    ::sigil::math::xxh128_hash_bytes(source.data(), source.size(), digest);
+    ::sigil::fs::digest_cache_store(key, digest);
+
+    // Same content under another path compiles only once
+    if ((out = plan_cache_lookup(digest)))
+        return ret;
+
+    auto plan = std::make_shared<template_plan_t>();
+    ret = compile_template(std::move(source), *plan);
+    if (ret.is_failure())
+        return ret;
+
+    std::lock_guard<std::mutex> guard(plan_cache.lock);
+    out = plan_cache.plans.emplace(digest, std::move(plan)).first->second;
+    return ret;
+}
+
+} // namespace sigil::desktop
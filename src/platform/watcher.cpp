@@ -0,0 +1,478 @@
+#include <sigil/platform/watcher.h>
+#include <sigil/common.h>
+
+#include <unordered_map>
+#include <system_error>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <mutex>
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#include <ctime>
+
+namespace sigil::fs {
+
+using clock_type = std::chrono::steady_clock;
+
+static constexpr uint32_t watch_mask =
+    IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+    IN_DELETE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW;
+
+// Files touched this long before the last good read are re-reported after an overflow
+static constexpr int64_t overflow_slack_ns = 1'000'000'000;
+
+struct watched_dir_t {
+    std::filesystem::path path;
+    bool recursive = false;
+};
+
+struct watcher_t::state_t {
+    watcher_config_t cfg = {};
+
+    int inotify_fd = -1;
+    int wake_fd = -1;       // stop requests for the worker
+    int ready_fd = -1;      // batches available for the consumer
+
+    std::mutex lock;        // guards watches and roots, worker and add()/remove() share them
+    std::unordered_map<int, watched_dir_t> watches;
+    std::vector<watched_dir_t> roots;
+
+    std::thread worker;
+    std::atomic<bool> stop{false};
+
+    // SPSC ring, worker produces, consumer drains
+    std::vector<watch_batch_t> slots;
+    std::size_t mask = 0;
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+
+    // Worker-only
+    std::unordered_map<std::string, uint32_t> pending;
+    clock_type::time_point first_event = {};
+    clock_type::time_point last_event = {};
+    bool overflow = false;
+    uint64_t sequence = 0;
+    int64_t last_sync_ns = 0;
+};
+
+static int64_t realtime_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+static void note(watcher_t::state_t &st, const std::filesystem::path &p, uint32_t kinds) {
+    const auto now = clock_type::now();
+    if (st.pending.empty())
+        st.first_event = now;
+    st.last_event = now;
+    st.pending[p.string()] |= kinds;
+}
+
+// Caller holds st.lock
+static bool add_watch_locked(watcher_t::state_t &st, const std::filesystem::path &dir, bool recursive) {
+    int wd = inotify_add_watch(st.inotify_fd, dir.c_str(), watch_mask);
+    if (wd < 0)
+        return false;
+
+    // Same wd comes back for a directory that was moved, refresh its path
+    st.watches[wd] = { dir, recursive };
+    return true;
+}
+
+// Caller holds st.lock. Watches dir and everything below; report lists the files found.
+static bool add_tree_locked(watcher_t::state_t &st, const std::filesystem::path &dir,
+                            bool recursive, std::vector<std::filesystem::path> *report) {
+    if (!add_watch_locked(st, dir, recursive))
+        return false;
+    if (!recursive)
+        return true;
+
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator it(dir, std::filesystem::directory_options::skip_permission_denied, ec);
+    if (ec)
+        return true;
+
+    for (; it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec)
+            break;
+
+        if (it->is_symlink(ec)) {
+            if (report) report->push_back(it->path());
+            continue;
+        }
+
+        if (it->is_directory(ec))
+            add_watch_locked(st, it->path(), true);
+        else if (report)
+            report->push_back(it->path());
+    }
+
+    return true;
+}
+
+static bool is_under(const std::filesystem::path &p, const std::filesystem::path &base) {
+    const std::string &s = p.native();
+    const std::string &b = base.native();
+    return s.size() >= b.size()
+        && s.compare(0, b.size(), b) == 0
+        && (s.size() == b.size() || s[b.size()] == '/');
+}
+
+// Caller holds st.lock
+static void remove_tree_locked(watcher_t::state_t &st, const std::filesystem::path &dir) {
+    for (auto it = st.watches.begin(); it != st.watches.end();) {
+        if (is_under(it->second.path, dir)) {
+            inotify_rm_watch(st.inotify_fd, it->first);
+            it = st.watches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * @brief
+ * Events were dropped by the kernel. Walk every root again, pick up
+ * new directories, and report only what changed since the last good read:
+ * files by mtime/ctime, directories as RESCAN since removals leave no trace.
+ */
+static void recover_overflow(watcher_t::state_t &st) {
+    const int64_t since = st.last_sync_ns - overflow_slack_ns;
+
+    std::vector<std::filesystem::path> dirs;
+    {
+        std::lock_guard<std::mutex> guard(st.lock);
+        for (const auto &root : st.roots) {
+            add_tree_locked(st, root.path, root.recursive, nullptr);
+        }
+        for (const auto &[wd, w] : st.watches)
+            dirs.push_back(w.path);
+    }
+
+    auto changed_since = [since](const struct statx &stx) {
+        auto ns = [](const struct statx_timestamp &t) {
+            return static_cast<int64_t>(t.tv_sec) * 1'000'000'000 + t.tv_nsec;
+        };
+        return ns(stx.stx_mtime) >= since || ns(stx.stx_ctime) >= since;
+    };
+
+    for (const auto &dir : dirs) {
+        struct statx stx;
+        if (statx(AT_FDCWD, dir.c_str(), AT_SYMLINK_NOFOLLOW, STATX_MTIME | STATX_CTIME, &stx) != 0) {
+            note(st, dir, WATCH_REMOVED);
+            continue;
+        }
+
+        if (changed_since(stx))
+            note(st, dir, WATCH_RESCAN);
+
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_directory(ec) && !it->is_symlink(ec))
+                continue;
+            if (statx(AT_FDCWD, it->path().c_str(), AT_SYMLINK_NOFOLLOW, STATX_MTIME | STATX_CTIME, &stx) == 0
+                && changed_since(stx)) {
+                note(st, it->path(), WATCH_MODIFIED);
+            }
+        }
+    }
+
+    st.overflow = true;
+}
+
+static void handle_event(watcher_t::state_t &st, const struct inotify_event &ev) {
+    std::filesystem::path dir;
+    bool recursive = false;
+
+    {
+        std::lock_guard<std::mutex> guard(st.lock);
+        auto it = st.watches.find(ev.wd);
+        if (it == st.watches.end())
+            return;
+
+        if (ev.mask & IN_IGNORED) {
+            st.watches.erase(it);
+            return;
+        }
+
+        dir = it->second.path;
+        recursive = it->second.recursive;
+    }
+
+    const std::filesystem::path p = ev.len ? dir / ev.name : dir;
+    const bool is_dir = ev.mask & IN_ISDIR;
+
+    if (ev.mask & IN_DELETE_SELF) {
+        note(st, p, WATCH_REMOVED);
+        return;
+    }
+
+    if (is_dir && (ev.mask & IN_MOVED_FROM)) {
+        // Watches below keep firing with stale paths, drop them; a move within the tree re-adds
+        std::lock_guard<std::mutex> guard(st.lock);
+        remove_tree_locked(st, p);
+    }
+
+    if (is_dir && recursive && (ev.mask & (IN_CREATE | IN_MOVED_TO))) {
+        // Anything written before the watch landed has no events, report it from a scan
+        std::vector<std::filesystem::path> found;
+        {
+            std::lock_guard<std::mutex> guard(st.lock);
+            add_tree_locked(st, p, true, &found);
+        }
+        for (const auto &f : found)
+            note(st, f, WATCH_CREATED);
+    }
+
+    uint32_t kinds = 0;
+    if (ev.mask & (IN_CREATE | IN_MOVED_TO)) kinds |= WATCH_CREATED;
+    if (ev.mask & IN_CLOSE_WRITE)            kinds |= WATCH_MODIFIED;
+    if (ev.mask & (IN_DELETE | IN_MOVED_FROM)) kinds |= WATCH_REMOVED;
+
+    if (kinds)
+        note(st, p, kinds);
+}
+
+static void drain_inotify(watcher_t::state_t &st) {
+    alignas(struct inotify_event) char buf[64 * 1024];
+
+    while (true) {
+        const int64_t read_start = realtime_ns();
+        ssize_t n = read(st.inotify_fd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+
+        bool overflowed = false;
+        for (char *ptr = buf; ptr < buf + n;) {
+            auto *ev = reinterpret_cast<struct inotify_event*>(ptr);
+            if (ev->mask & IN_Q_OVERFLOW)
+                overflowed = true;
+            else
+                handle_event(st, *ev);
+            ptr += sizeof(struct inotify_event) + ev->len;
+        }
+
+        if (overflowed)
+            recover_overflow(st);
+
+        // Everything up to this read is accounted for
+        st.last_sync_ns = read_start;
+    }
+}
+
+// Hand the pending set to the consumer, false when the queue is full
+static bool publish(watcher_t::state_t &st) {
+    const std::size_t t = st.tail.load(std::memory_order_relaxed);
+    if (t - st.head.load(std::memory_order_acquire) >= st.slots.size())
+        return false;
+
+    watch_batch_t &batch = st.slots[t & st.mask];
+    batch.events.clear();
+    batch.events.reserve(st.pending.size());
+    for (auto &[path, kinds] : st.pending)
+        batch.events.push_back({ path, kinds });
+
+    std::sort(batch.events.begin(), batch.events.end(), [](const watch_event_t &a, const watch_event_t &b) {
+        return a.path < b.path;
+    });
+
+    batch.sequence = ++st.sequence;
+    batch.overflow = st.overflow;
+
+    st.pending.clear();
+    st.overflow = false;
+    st.tail.store(t + 1, std::memory_order_release);
+
+    uint64_t one = 1;
+    (void)!write(st.ready_fd, &one, sizeof(one));
+    return true;
+}
+
+static void worker_loop(watcher_t::state_t &st) {
+    const auto debounce = std::chrono::milliseconds(st.cfg.debounce_ms);
+    const auto max_latency = std::chrono::milliseconds(st.cfg.max_latency_ms);
+
+    while (!st.stop.load(std::memory_order_acquire)) {
+        int timeout = -1;
+        if (!st.pending.empty()) {
+            const auto deadline = std::min(st.last_event + debounce, st.first_event + max_latency);
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock_type::now());
+            timeout = static_cast<int>(std::max<int64_t>(0, left.count()));
+        }
+
+        struct pollfd fds[2] = {
+            { st.inotify_fd, POLLIN, 0 },
+            { st.wake_fd,    POLLIN, 0 },
+        };
+
+        int r = ::poll(fds, 2, timeout);
+        if (r < 0 && errno != EINTR)
+            break;
+
+        if (fds[1].revents & POLLIN) {
+            uint64_t v;
+            (void)!read(st.wake_fd, &v, sizeof(v));
+        }
+
+        if (fds[0].revents & POLLIN)
+            drain_inotify(st);
+
+        if (st.pending.empty())
+            continue;
+
+        const auto now = clock_type::now();
+        if (now >= st.last_event + debounce || now >= st.first_event + max_latency) {
+            // Consumer is behind, keep coalescing into the same set and retry
+            if (!publish(st))
+                st.last_event = now;
+        }
+    }
+}
+
+watcher_t::watcher_t() : state(std::make_unique<state_t>()) {}
+
+watcher_t::~watcher_t() {
+    stop();
+}
+
+::sigil::yield watcher_t::start(const watcher_config_t &cfg) {
+    ::sigil::yield ret;
+
+    if (state->inotify_fd >= 0)
+        return ret.set_state(::sigil::yield_state::fail).set_code(EBUSY);
+
+    state->cfg = cfg;
+
+    std::size_t cap = 1;
+    while (cap < std::max<uint32_t>(cfg.queue_capacity, 2)) cap <<= 1;
+    state->slots.assign(cap, {});
+    state->mask = cap - 1;
+    state->head.store(0);
+    state->tail.store(0);
+
+    state->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    state->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    state->ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (state->inotify_fd < 0 || state->wake_fd < 0 || state->ready_fd < 0) {
+        ret.set_state(::sigil::yield_state::fail).set_code(errno);
+        stop();
+        return ret;
+    }
+
+    state->last_sync_ns = realtime_ns();
+    state->stop.store(false);
+    state->worker = std::thread(worker_loop, std::ref(*state));
+
+    return ret;
+}
+
+void watcher_t::stop() {
+    if (state->worker.joinable()) {
+        state->stop.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        (void)!write(state->wake_fd, &one, sizeof(one));
+        state->worker.join();
+    }
+
+    for (int *fd : { &state->inotify_fd, &state->wake_fd, &state->ready_fd }) {
+        if (*fd >= 0) close(*fd);
+        *fd = -1;
+    }
+
+    std::lock_guard<std::mutex> guard(state->lock);
+    state->watches.clear();
+    state->roots.clear();
+    state->pending.clear();
+}
+
+::sigil::yield watcher_t::add(const std::filesystem::path &root, bool recursive) {
+    ::sigil::yield ret;
+
+    if (state->inotify_fd < 0)
+        return ret.set_state(::sigil::yield_state::fail).set_code(ENODEV);
+
+    std::error_code ec;
+    std::filesystem::path abs = std::filesystem::weakly_canonical(root, ec);
+    if (ec || !std::filesystem::is_directory(abs, ec))
+        return ret.set_state(::sigil::yield_state::fail).set_code(ENOTDIR);
+
+    std::lock_guard<std::mutex> guard(state->lock);
+
+    const std::size_t before = state->watches.size();
+    if (!add_tree_locked(*state, abs, recursive, nullptr))
+        return ret.set_state(::sigil::yield_state::fail).set_code(errno);
+
+    state->roots.push_back({ abs, recursive });
+    return ret.set_info(state->watches.size() - before);
+}
+
+void watcher_t::remove(const std::filesystem::path &root) {
+    std::error_code ec;
+    std::filesystem::path abs = std::filesystem::weakly_canonical(root, ec);
+    if (ec)
+        return;
+
+    std::lock_guard<std::mutex> guard(state->lock);
+    remove_tree_locked(*state, abs);
+    state->roots.erase(std::remove_if(state->roots.begin(), state->roots.end(),
+                                      [&](const watched_dir_t &r) { return r.path == abs; }),
+                       state->roots.end());
+}
+
+bool watcher_t::poll(watch_batch_t &out) {
+    const std::size_t h = state->head.load(std::memory_order_relaxed);
+
+    if (h == state->tail.load(std::memory_order_acquire)) {
+        // Clear readiness, then look again so a publish in between is not lost
+        uint64_t v;
+        if (state->ready_fd < 0 || read(state->ready_fd, &v, sizeof(v)) <= 0)
+            return false;
+        if (h == state->tail.load(std::memory_order_acquire))
+            return false;
+    }
+
+    out = std::move(state->slots[h & state->mask]);
+    state->head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+bool watcher_t::wait(watch_batch_t &out, int timeout_ms) {
+    if (state->ready_fd < 0)
+        return false;
+
+    const auto deadline = clock_type::now() + std::chrono::milliseconds(timeout_ms);
+
+    while (true) {
+        if (poll(out))
+            return true;
+
+        int left = -1;
+        if (timeout_ms >= 0) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock_type::now()).count();
+            if (ms <= 0)
+                return false;
+            left = static_cast<int>(ms);
+        }
+
+        struct pollfd pfd = { state->ready_fd, POLLIN, 0 };
+        if (::poll(&pfd, 1, left) < 0 && errno != EINTR)
+            return false;
+    }
+}
+
+int watcher_t::ready_fd() const noexcept {
+    return state->ready_fd;
+}
+
+} // namespace sigil::fs
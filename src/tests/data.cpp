@@ -0,0 +1,236 @@
+#include <sigil/data/parser.h>
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+namespace fs = std::filesystem;
+using sigil::data::document_t;
+using sigil::data::value_t;
+
+TEST(Data, StructuralScanMatchesTable) {
+    // Longer than one SIMD block, structurals on both sides of the 32 and 64 byte seams
+    std::string text;
+    for (int i = 0; i < 40; ++i)
+        text += "key_" + std::to_string(i) + ": {\"v\": [1, 'a'], \"p\": \"a\\\\b/c\"} # n\n";
+
+    std::vector<uint32_t> scanned;
+    sigil::data::scan_structurals(text, scanned);
+
+    const std::string_view set = "{}[]:,\"'\\/#\n";
+    std::vector<uint32_t> expected;
+    for (std::size_t i = 0; i < text.size(); ++i)
+        if (set.find(text[i]) != std::string_view::npos)
+            expected.push_back(static_cast<uint32_t>(i));
+
+    EXPECT_EQ(scanned, expected);
+}
+
+TEST(Data, YamlMapsSequencesAndScalars) {
+    const std::string text =
+        "# pattern\n"
+        "name: Night\n"
+        "tags:\n"
+        "  color:\n"
+        "    accent: \"#6AAEFF\"   # quoted, the hash stays\n"
+        "    text:\n"
+        "      primary: '#E6E6F0'\n"
+        "  opacity: 0.97\n"
+        "list:\n"
+        "- plain word # comment\n"
+        "- key: v\n"
+        "  other: 'it''s'\n"
+        "- [1, \"two\", {x: y}]\n"
+        "url: http://example.com/a:b\n"
+        "empty:\n"
+        "escaped: \"tab\\there \\u00e9\"\n";
+
+    document_t doc;
+    ASSERT_TRUE(doc.parse(text, sigil::data::FORMAT_YAML).is_ok());
+
+    const value_t root = doc.root();
+    ASSERT_TRUE(root.is_object());
+    EXPECT_EQ(root.size(), 6u);
+    EXPECT_EQ(root["name"].str(), "Night");
+    EXPECT_EQ(root.path("tags.color.accent").str(), "#6AAEFF");
+    EXPECT_EQ(root.path("tags.color.text.primary").str(), "#E6E6F0");
+
+    double opacity = 0;
+    EXPECT_TRUE(root.path("tags.opacity").as_double(opacity));
+    EXPECT_DOUBLE_EQ(opacity, 0.97);
+
+    const value_t list = root["list"];
+    ASSERT_TRUE(list.is_array());
+    ASSERT_EQ(list.size(), 3u);
+    EXPECT_EQ(list.at(0).str(), "plain word");
+    EXPECT_EQ(list.at(1)["key"].str(), "v");
+    EXPECT_EQ(list.at(1)["other"].decode(), "it's");
+    EXPECT_EQ(list.at(2).size(), 3u);
+    EXPECT_EQ(list.at(2).at(2)["x"].str(), "y");
+
+    EXPECT_EQ(root["url"].str(), "http://example.com/a:b");
+    EXPECT_EQ(root["empty"].kind(), sigil::data::NODE_NULL);
+    EXPECT_EQ(root["escaped"].decode(), "tab\there \xC3\xA9");
+
+    // Missing keys chain into invalid values instead of failing
+    EXPECT_FALSE(root.path("tags.nope.deeper"));
+    EXPECT_TRUE(root.path("tags.nope.deeper").str().empty());
+}
+
+TEST(Data, JsoncCommentsAndTrailingCommas) {
+    const std::string text =
+        "// waybar\n"
+        "{\n"
+        "  \"layer\": \"top\", /* inline */\n"
+        "  \"height\": 34,\n"
+        "  \"modules-right\": [\"clock\", \"battery#bat2\",],\n"
+        "  \"format\": \"{:%H:%M} \\\"q\\\" // not a comment\",\n"
+        "  \"nested\": { \"on\": true, \"none\": null },\n"
+        "}\n";
+
+    document_t doc;
+    ASSERT_TRUE(doc.parse(text, sigil::data::FORMAT_JSONC).is_ok());
+
+    const value_t root = doc.root();
+    ASSERT_TRUE(root.is_object());
+    EXPECT_EQ(root.size(), 5u);
+    EXPECT_EQ(root["layer"].str(), "top");
+
+    int64_t height = 0;
+    EXPECT_TRUE(root["height"].as_int(height));
+    EXPECT_EQ(height, 34);
+
+    ASSERT_EQ(root["modules-right"].size(), 2u);
+    EXPECT_EQ(root["modules-right"].at(1).str(), "battery#bat2");
+    EXPECT_EQ(root["format"].decode(), "{:%H:%M} \"q\" // not a comment");
+
+    bool on = false;
+    EXPECT_TRUE(root.path("nested.on").as_bool(on));
+    EXPECT_TRUE(on);
+    EXPECT_EQ(root.path("nested.none").kind(), sigil::data::NODE_NULL);
+
+    std::vector<std::string> keys;
+    for (const value_t member : root)
+        keys.emplace_back(member.key());
+    EXPECT_EQ(keys, (std::vector<std::string>{ "layer", "height", "modules-right", "format", "nested" }));
+}
+
+TEST(Data, RejectsMalformedInput) {
+    document_t doc;
+
+    const auto bad_json = doc.parse("{\"a\" 1}", sigil::data::FORMAT_JSONC);
+    EXPECT_TRUE(bad_json.is_failure());
+    EXPECT_EQ(bad_json.code, EINVAL);
+    EXPECT_FALSE(doc.root());
+
+    EXPECT_TRUE(doc.parse("[1, 2", sigil::data::FORMAT_JSONC).is_failure());
+    EXPECT_TRUE(doc.parse("{\"a\": [1}", sigil::data::FORMAT_JSONC).is_failure());
+    EXPECT_TRUE(doc.parse("\"open", sigil::data::FORMAT_JSONC).is_failure());
+
+    const auto bad_indent = doc.parse("a: 1\n   b: 2\n", sigil::data::FORMAT_YAML);
+    EXPECT_TRUE(bad_indent.is_failure());
+    EXPECT_EQ(bad_indent.info, 8u);
+
+    EXPECT_TRUE(doc.parse("a:\n\tb: 2\n", sigil::data::FORMAT_YAML).is_failure());
+    EXPECT_TRUE(doc.parse("a: \"open\n", sigil::data::FORMAT_YAML).is_failure());
+
+    std::string deep;
+    for (uint32_t i = 0; i <= sigil::data::max_document_depth; ++i)
+        deep += '[';
+    EXPECT_TRUE(doc.parse(deep, sigil::data::FORMAT_JSONC).is_failure());
+
+    // A failed parse leaves the document reusable
+    ASSERT_TRUE(doc.parse("a: 1\n", sigil::data::FORMAT_YAML).is_ok());
+    EXPECT_EQ(doc.root()["a"].str(), "1");
+}
+
+TEST(Data, LoadReadsFileAndPicksFormat) {
+    const fs::path dir = fs::temp_directory_path() / ("sigil-data-test-" + std::to_string(getpid()));
+    fs::create_directories(dir);
+
+    {
+        std::ofstream(dir / "profile") << "version: 1\ntarget: /games/a b/game.exe\nrunner: /opt/proton\n";
+        std::ofstream(dir / "character.json") << "{ \"name\": \"Ann\", \"attrs\": [ { \"rest\": 4 } ] }\n";
+        std::ofstream(dir / "empty.yaml");
+    }
+
+    document_t profile;
+    ASSERT_TRUE(profile.load(dir / "profile").is_ok());
+    EXPECT_EQ(profile.root()["target"].str(), "/games/a b/game.exe");
+
+    // The text is the document's own, a file truncated or rewritten behind it changes nothing
+    fs::resize_file(dir / "profile", 0);
+    EXPECT_EQ(profile.root()["runner"].str(), "/opt/proton");
+
+    document_t character;
+    ASSERT_TRUE(character.load(dir / "character.json").is_ok());
+    int64_t rest = 0;
+    EXPECT_TRUE(character.root()["attrs"].at(0)["rest"].as_int(rest));
+    EXPECT_EQ(rest, 4);
+
+    // Values stay valid after the document moves, the buffer goes with it
+    document_t moved = std::move(character);
+    EXPECT_EQ(moved.root()["name"].str(), "Ann");
+
+    document_t empty;
+    EXPECT_TRUE(empty.load(dir / "empty.yaml").is_ok());
+    EXPECT_FALSE(empty.root());
+
+    const auto missing = empty.load(dir / "missing.yaml");
+    EXPECT_TRUE(missing.is_failure());
+    EXPECT_EQ(missing.code, ENOENT);
+
+    fs::remove_all(dir);
+}
+
+TEST(Data, VdfKeyValues) {
+    const std::string text =
+        "// libraryfolders\n"
+        "\"libraryfolders\"\n"
+        "{\n"
+        "\t\"0\"\n"
+        "\t{\n"
+        "\t\t\"path\"\t\t\"/home/ann/.local/share/Steam\"\n"
+        "\t\t\"label\"\t\t\"say \\\"hi\\\"\"\n"
+        "\t\t\"apps\" { \"228980\" \"285212\" \"1493710\" \"3081\" }\n"
+        "\t}\n"
+        "\tbare value [$LINUX]\n"
+        "\t\"empty\" {}\n"
+        "}\n";
+
+    document_t doc;
+    ASSERT_TRUE(doc.parse(text, sigil::data::FORMAT_VDF).is_ok());
+
+    const value_t root = doc.root();
+    ASSERT_TRUE(root.is_object());
+    ASSERT_EQ(root.size(), 1u);
+
+    const value_t folders = root["libraryfolders"];
+    ASSERT_TRUE(folders.is_object());
+    EXPECT_EQ(folders.size(), 3u);
+    EXPECT_EQ(folders["0"]["path"].str(), "/home/ann/.local/share/Steam");
+    EXPECT_EQ(folders["0"]["label"].decode(), "say \"hi\"");
+    EXPECT_EQ(folders["bare"].str(), "value");
+    EXPECT_EQ(folders["empty"].size(), 0u);
+
+    std::vector<std::string> apps;
+    for (const value_t app : folders.path("0.apps"))
+        apps.emplace_back(app.key());
+    EXPECT_EQ(apps, (std::vector<std::string>{ "228980", "1493710" }));
+
+    int64_t size = 0;
+    EXPECT_TRUE(folders.path("0.apps.1493710").as_int(size));
+    EXPECT_EQ(size, 3081);
+
+    EXPECT_TRUE(doc.parse("\"a\" { \"b\" \"c\"", sigil::data::FORMAT_VDF).is_failure());
+    EXPECT_TRUE(doc.parse("\"a\" { \"b\" }", sigil::data::FORMAT_VDF).is_failure());
+    EXPECT_TRUE(doc.parse("}", sigil::data::FORMAT_VDF).is_failure());
+    EXPECT_TRUE(doc.parse("{ \"a\" \"b\" }", sigil::data::FORMAT_VDF).is_failure());
+    EXPECT_TRUE(doc.parse("\"open", sigil::data::FORMAT_VDF).is_failure());
+
+    ASSERT_TRUE(doc.parse("", sigil::data::FORMAT_VDF).is_ok());
+    EXPECT_EQ(doc.root().size(), 0u);
+}
@@ -0,0 +1,90 @@
+#include <sigil/vm/ecs.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+
+TEST(Ecs, LedgerReusesSlotsUnderNewGenerations) {
+    sigil::ledger l;
+    EXPECT_FALSE(sigil::exists(l, {}));
+
+    const sigil::entity a = sigil::create(l);
+    const sigil::entity b = sigil::create(l);
+    const sigil::entity c = sigil::create(l);
+    EXPECT_TRUE(a && b && c);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(l.size(), 3u);
+    EXPECT_TRUE(sigil::exists(l, b));
+
+    ASSERT_TRUE(sigil::retire(l, b).is_ok());
+    EXPECT_FALSE(sigil::exists(l, b));
+    EXPECT_TRUE(sigil::exists(l, a));
+    EXPECT_TRUE(sigil::exists(l, c));
+    EXPECT_EQ(l.size(), 2u);
+    EXPECT_TRUE(sigil::retire(l, b).is_failure());
+
+    // b's slot comes back, the old handle stays dead
+    const sigil::entity d = sigil::create(l);
+    EXPECT_EQ(d.index, b.index);
+    EXPECT_NE(d.generation, b.generation);
+    EXPECT_FALSE(sigil::exists(l, b));
+    EXPECT_TRUE(sigil::exists(l, d));
+    EXPECT_EQ(l.slots.size(), 3u);
+
+    // A handle for the generation a free slot waits with was never handed out
+    ASSERT_TRUE(sigil::retire(l, a).is_ok());
+    EXPECT_FALSE(sigil::exists(l, { a.index, a.generation + 1 }));
+    EXPECT_TRUE(sigil::retire(l, { a.index, a.generation + 1 }).is_failure());
+    EXPECT_EQ(l.size(), 2u);
+
+    std::vector<sigil::entity> seen(l.begin(), l.end());
+    std::sort(seen.begin(), seen.end(), [](sigil::entity x, sigil::entity y) { return x.index < y.index; });
+    EXPECT_EQ(seen, (std::vector<sigil::entity>{ d, c }));
+}
+
+TEST(Ecs, LedgerBatchesKeepAliveDense) {
+    sigil::ledger l;
+    std::vector<sigil::entity> es(1000);
+    sigil::create(l, es);
+    EXPECT_EQ(l.size(), 1000u);
+
+    // Every other one
+    std::vector<sigil::entity> odd;
+    for (std::size_t i = 1; i < es.size(); i += 2)
+        odd.push_back(es[i]);
+    ASSERT_TRUE(sigil::retire(l, odd).is_ok());
+    EXPECT_EQ(l.size(), 500u);
+
+    for (std::size_t i = 0; i < es.size(); ++i)
+        EXPECT_EQ(sigil::exists(l, es[i]), i % 2 == 0);
+    for (const sigil::entity e : l)
+        EXPECT_EQ(e.index % 2, 0u);
+
+    // Retiring them again fails but leaves the rest alone
+    EXPECT_TRUE(sigil::retire(l, odd).is_failure());
+    EXPECT_EQ(l.size(), 500u);
+
+    // Churn stays inside the slots already there
+    std::vector<sigil::entity> again(500);
+    for (int round = 0; round < 10; ++round) {
+        sigil::create(l, again);
+        ASSERT_TRUE(sigil::retire(l, again).is_ok());
+    }
+    EXPECT_EQ(l.slots.size(), 1000u);
+    EXPECT_EQ(l.size(), 500u);
+}
+
+TEST(Ecs, OwnershipTreeRejectsCycles) {
+    sigil::ledger l;
+    const sigil::entity a = sigil::create(l);
+    const sigil::entity b = sigil::create(l);
+    const sigil::entity c = sigil::create(l);
+
+    sigil::ownership_tree t;
+    ASSERT_TRUE(sigil::attach(t, a, b).is_ok());
+    ASSERT_TRUE(sigil::attach(t, b, c).is_ok());
+    EXPECT_TRUE(sigil::owns(t, a, c));
+    EXPECT_TRUE(sigil::attach(t, c, a).is_failure());
+    EXPECT_TRUE(sigil::attach(t, a, sigil::entity{}).is_failure());
+    EXPECT_TRUE(sigil::detach(t, c).is_ok());
+    EXPECT_FALSE(sigil::owns(t, a, c));
+}
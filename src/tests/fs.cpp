@@ -0,0 +1,1163 @@
+#include <sigil/platform/dircache.h>
+#include <sigil/platform/watcher.h>
+#include <sigil/platform/theme_template.h>
+#include <sigil/platform/desktop_ipc.h>
+#include <sigil/platform/desktop.h>
+#include <sigil/platform/compat.h>
+#include <sigil/data/parser.h>
+#include <sigil/platform/paths.h>
+#include <sigil/platform/fs.h>
+#include <sigil/platform/io.h>
+#include <sigil/math/hash.h>
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include <filesystem>
+#include <functional>
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <csignal>
+#include <poll.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+static fs::path make_temp_dir(const char *tag) {
+    fs::path base = fs::temp_directory_path();
+    fs::path dir;
+
+    for (int i = 0; i < 100; ++i) {
+        dir = base / ("sigil-fs-test-" + std::string(tag) + "-" + std::to_string(getpid()) + "-" + std::to_string(i));
+        if (!fs::exists(dir)) {
+            fs::create_directories(dir);
+            return dir;
+        }
+    }
+
+    return {};
+}
+
+TEST(FS, CopyTreeMirrorsStructure) {
+    fs::path root = make_temp_dir("copy");
+    ASSERT_FALSE(root.empty());
+
+    write_file(root / "src" / "a.txt", "alpha");
+    write_file(root / "src" / "nested" / "b.txt", "beta");
+    write_file(root / "src" / "nested" / "deeper" / "c.txt", std::string(300000, 'c'));
+    fs::create_directories(root / "src" / "empty");
+
+    ::sigil::fs::copy_stats_t stats;
+    ::sigil::yield s = ::sigil::fs::copy_tree(root / "src", root / "dst", stats);
+    ASSERT_TRUE(s.is_ok());
+
+    EXPECT_EQ(read_file(root / "dst" / "a.txt"), "alpha");
+    EXPECT_EQ(read_file(root / "dst" / "nested" / "b.txt"), "beta");
+    EXPECT_EQ(read_file(root / "dst" / "nested" / "deeper" / "c.txt"), std::string(300000, 'c'));
+    EXPECT_TRUE(fs::is_directory(root / "dst" / "empty"));
+
+    EXPECT_EQ(stats.files_copied + stats.files_cloned, 3u);
+    EXPECT_EQ(stats.bytes_copied + stats.bytes_cloned, 5u + 4u + 300000u);
+    EXPECT_EQ(stats.files_skipped, 0u);
+
+    fs::remove_all(root);
+}
+
+TEST(FS, CopyTreeSkipsUnchanged) {
+    fs::path root = make_temp_dir("skip");
+    ASSERT_FALSE(root.empty());
+
+    write_file(root / "src" / "a.txt", "alpha");
+    write_file(root / "src" / "b.txt", "beta");
+
+    ::sigil::fs::copy_stats_t first;
+    ASSERT_TRUE(::sigil::fs::copy_tree(root / "src", root / "dst", first).is_ok());
+
+    ::sigil::fs::copy_stats_t second;
+    ASSERT_TRUE(::sigil::fs::copy_tree(root / "src", root / "dst", second).is_ok());
+    EXPECT_EQ(second.files_skipped, 2u);
+    EXPECT_EQ(second.files_copied + second.files_cloned, 0u);
+
+    // Same size, new content and mtime, must be picked up
+    write_file(root / "src" / "a.txt", "ALPHA");
+    fs::last_write_time(root / "src" / "a.txt", fs::last_write_time(root / "src" / "a.txt") + std::chrono::seconds(5));
+
+    ::sigil::fs::copy_stats_t third;
+    ASSERT_TRUE(::sigil::fs::copy_tree(root / "src", root / "dst", third).is_ok());
+    EXPECT_EQ(third.files_skipped, 1u);
+    EXPECT_EQ(third.files_copied + third.files_cloned, 1u);
+    EXPECT_EQ(read_file(root / "dst" / "a.txt"), "ALPHA");
+
+    fs::remove_all(root);
+}
+
+TEST(FS, CopyTreeMissingSourceFails) {
+    fs::path root = make_temp_dir("missing");
+    ASSERT_FALSE(root.empty());
+
+    ::sigil::yield s = ::sigil::fs::copy_tree(root / "nope", root / "dst");
+    EXPECT_TRUE(s.is_failure());
+
+    fs::remove_all(root);
+}
+
+TEST(FS, IdenticalFiles) {
+    fs::path root = make_temp_dir("identical");
+    ASSERT_FALSE(root.empty());
+
+    std::string big(3u << 20, 'x');
+    big[(3u << 20) - 7] = 'y';
+
+    write_file(root / "a", big);
+    write_file(root / "b", big);
+    EXPECT_TRUE(::sigil::fs::files_are_identical(root / "a", root / "b"));
+
+    // Difference in the last window
+    big[(3u << 20) - 7] = 'z';
+    write_file(root / "c", big);
+    EXPECT_FALSE(::sigil::fs::files_are_identical(root / "a", root / "c"));
+
+    // Same inode through a hardlink
+    fs::create_hard_link(root / "a", root / "a-link");
+    EXPECT_TRUE(::sigil::fs::files_are_identical(root / "a", root / "a-link"));
+
+    write_file(root / "short", "x");
+    EXPECT_FALSE(::sigil::fs::files_are_identical(root / "a", root / "short"));
+    EXPECT_FALSE(::sigil::fs::files_are_identical(root / "a", root / "missing"));
+    EXPECT_FALSE(::sigil::fs::files_are_identical(root, root / "a"));
+
+    fs::remove_all(root);
+}
+
+TEST(FS, IdenticalUsesDigestCache) {
+    fs::path root = make_temp_dir("digest");
+    ASSERT_FALSE(root.empty());
+
+    write_file(root / "a", "same-size-1");
+    write_file(root / "b", "same-size-2");
+
+    ::sigil::fs::file_key_t ka, kb;
+    ASSERT_TRUE(::sigil::fs::get_file_key(root / "a", ka));
+    ASSERT_TRUE(::sigil::fs::get_file_key(root / "b", kb));
+
+    // Digests claim equality, only trusted lookups short-circuit on them
+    ::sigil::fs::file_digest_t d{};
+    d[0] = 0x42;
+    ::sigil::fs::digest_cache_store(ka, d);
+    ::sigil::fs::digest_cache_store(kb, d);
+
+    EXPECT_TRUE(::sigil::fs::files_are_identical(root / "a", root / "b"));
+    EXPECT_FALSE(::sigil::fs::files_are_identical(root / "a", root / "b", false));
+
+    fs::remove_all(root);
+}
+
+TEST(FS, PathIndexResolves) {
+    fs::path root = make_temp_dir("pathidx");
+    ASSERT_FALSE(root.empty());
+
+    const char *old_path = getenv("PATH");
+    std::string saved = old_path ? old_path : "";
+
+    fs::path bin_a = root / "a";
+    fs::path bin_b = root / "b";
+    fs::create_directories(bin_a);
+    fs::create_directories(bin_b);
+
+    write_file(bin_b / "sigil-tool", "#!/bin/sh\n");
+    fs::permissions(bin_b / "sigil-tool", fs::perms::owner_all);
+
+    std::string path_env = bin_a.string() + ":" + bin_b.string();
+    setenv("PATH", path_env.c_str(), 1);
+
+    std::string resolved;
+    ASSERT_TRUE(::sigil::fs::resolve_in_path("sigil-tool", resolved));
+    EXPECT_EQ(resolved, (bin_b / "sigil-tool").string());
+
+    // Earlier PATH entry added after the index was built must win
+    write_file(bin_a / "sigil-tool", "#!/bin/sh\n");
+    fs::permissions(bin_a / "sigil-tool", fs::perms::owner_all);
+    ASSERT_TRUE(::sigil::fs::resolve_in_path("sigil-tool", resolved));
+    EXPECT_EQ(resolved, (bin_a / "sigil-tool").string());
+
+    // A PATH entry that did not exist when the index was built
+    fs::path bin_late = root / "late";
+    path_env += ":" + bin_late.string();
+    setenv("PATH", path_env.c_str(), 1);
+    EXPECT_FALSE(::sigil::fs::binary_exists_in_path("sigil-late"));
+    write_file(bin_late / "sigil-late", "#!/bin/sh\n");
+    fs::permissions(bin_late / "sigil-late", fs::perms::owner_all);
+    ASSERT_TRUE(::sigil::fs::resolve_in_path("sigil-late", resolved));
+    EXPECT_EQ(resolved, (bin_late / "sigil-late").string());
+
+    // Not executable is not a match
+    write_file(bin_a / "plain-file", "data");
+    EXPECT_FALSE(::sigil::fs::binary_exists_in_path("plain-file"));
+    EXPECT_FALSE(::sigil::fs::binary_exists_in_path("sigil-missing"));
+
+    setenv("PATH", saved.c_str(), 1);
+    EXPECT_TRUE(::sigil::fs::binary_exists_in_path("sh"));
+
+    fs::remove_all(root);
+}
+
+// Polls the cache like a frame loop would, up to ~2s
+template <typename Pred>
+static std::shared_ptr<const ::sigil::fs::dir_snapshot_t>
+wait_for_snapshot(::sigil::fs::dir_cache_t &cache, const fs::path &dir, Pred pred) {
+    for (int i = 0; i < 200; ++i) {
+        auto snap = cache.get(dir);
+        if (snap && pred(*snap))
+            return snap;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return nullptr;
+}
+
+TEST(FS, DirCacheListsAndFollowsChanges) {
+    fs::path root = make_temp_dir("dircache");
+    ASSERT_FALSE(root.empty());
+
+    write_file(root / "b.txt", "b");
+    write_file(root / "a.txt", "a");
+    fs::create_directories(root / "zdir");
+
+    ::sigil::fs::dir_cache_t cache;
+
+    auto snap = wait_for_snapshot(cache, root, [](const auto &) { return true; });
+    ASSERT_NE(snap, nullptr);
+    ASSERT_EQ(snap->error, 0);
+    ASSERT_EQ(snap->entries.size(), 3u);
+
+    // Directories first, labels prebuilt
+    EXPECT_EQ(snap->entries[0].label, "[D] zdir");
+    EXPECT_EQ(snap->entries[1].label, "a.txt");
+    EXPECT_EQ(snap->entries[2].label, "b.txt");
+
+    write_file(root / "c.txt", "c");
+
+    snap = wait_for_snapshot(cache, root, [](const auto &s) { return s.entries.size() == 4; });
+    ASSERT_NE(snap, nullptr);
+    EXPECT_EQ(snap->entries.back().name, "c.txt");
+
+    fs::remove_all(root);
+}
+
+// openat -> write -> fsync -> close -> statx -> openat -> read, through one service
+static void run_io_roundtrip(::sigil::fs::io_service_t &io, const fs::path &file) {
+    const std::string path = file.string();
+    const std::string payload = "io-service-payload";
+
+    ::sigil::fs::io_request_t req;
+    req.op = ::sigil::fs::IO_OPENAT;
+    req.path = path.c_str();
+    req.flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    req.mode = 0644;
+    ASSERT_TRUE(io.run(&req, 1).is_ok());
+    const int wfd = static_cast<int>(req.result.info);
+
+    ::sigil::fs::io_request_t batch[2];
+    batch[0].op = ::sigil::fs::IO_WRITE;
+    batch[0].fd = wfd;
+    batch[0].buffer = const_cast<char*>(payload.data());
+    batch[0].length = static_cast<uint32_t>(payload.size());
+    batch[1].op = ::sigil::fs::IO_WRITE;
+    batch[1].fd = wfd;
+    batch[1].buffer = const_cast<char*>(payload.data());
+    batch[1].length = static_cast<uint32_t>(payload.size());
+    batch[1].offset = payload.size();
+    ASSERT_TRUE(io.run(batch, 2).is_ok());
+    EXPECT_EQ(batch[0].result.info, payload.size());
+    EXPECT_EQ(batch[1].result.info, payload.size());
+
+    int callbacks = 0;
+    ::sigil::fs::io_request_t tail[2];
+    tail[0].op = ::sigil::fs::IO_FSYNC;
+    tail[0].fd = wfd;
+    tail[0].flags = IORING_FSYNC_DATASYNC;
+    tail[0].on_complete = [&](::sigil::fs::io_request_t &) { ++callbacks; };
+    ASSERT_TRUE(io.run(&tail[0], 1).is_ok());
+    tail[1].op = ::sigil::fs::IO_CLOSE;
+    tail[1].fd = wfd;
+    tail[1].on_complete = [&](::sigil::fs::io_request_t &) { ++callbacks; };
+    ASSERT_TRUE(io.run(&tail[1], 1).is_ok());
+    EXPECT_EQ(callbacks, 2);
+
+    struct statx stx;
+    ::sigil::fs::io_request_t st;
+    st.op = ::sigil::fs::IO_STATX;
+    st.path = path.c_str();
+    st.mode = STATX_SIZE;
+    st.buffer = &stx;
+    ASSERT_TRUE(io.run(&st, 1).is_ok());
+    EXPECT_EQ(stx.stx_size, payload.size() * 2);
+
+    ::sigil::fs::io_request_t rd;
+    rd.op = ::sigil::fs::IO_OPENAT;
+    rd.path = path.c_str();
+    rd.flags = O_RDONLY | O_CLOEXEC;
+    ASSERT_TRUE(io.run(&rd, 1).is_ok());
+    const int rfd = static_cast<int>(rd.result.info);
+
+    // Read through a registered file slot
+    ASSERT_TRUE(io.register_files(&rfd, 1).is_ok());
+    std::string back(payload.size() * 2, '\0');
+    ::sigil::fs::io_request_t r;
+    r.op = ::sigil::fs::IO_READ;
+    r.fd = 0;
+    r.fixed_file = true;
+    r.buffer = back.data();
+    r.length = static_cast<uint32_t>(back.size());
+    ASSERT_TRUE(io.run(&r, 1).is_ok());
+    EXPECT_EQ(back, payload + payload);
+    ASSERT_TRUE(io.register_files(nullptr, 0).is_ok());
+    close(rfd);
+
+    ::sigil::fs::io_request_t missing;
+    missing.op = ::sigil::fs::IO_OPENAT;
+    missing.path = "/nonexistent/sigil-io-test";
+    missing.flags = O_RDONLY;
+    EXPECT_TRUE(io.run(&missing, 1).is_failure());
+    EXPECT_EQ(missing.result.code, static_cast<uint32_t>(ENOENT));
+}
+
+TEST(FS, IoServiceRoundTrip) {
+    fs::path root = make_temp_dir("io");
+    ASSERT_FALSE(root.empty());
+
+    ::sigil::fs::io_service_t io;
+    ASSERT_TRUE(io.init().is_ok());
+    EXPECT_NE(io.backend(), ::sigil::fs::IO_BACKEND_NONE);
+    run_io_roundtrip(io, root / "data");
+    EXPECT_EQ(io.in_flight(), 0u);
+
+    fs::remove_all(root);
+}
+
+TEST(FS, IoServiceThreadFallback) {
+    fs::path root = make_temp_dir("io-thread");
+    ASSERT_FALSE(root.empty());
+
+    ::sigil::fs::io_config_t cfg;
+    cfg.force_fallback = true;
+
+    ::sigil::fs::io_service_t io;
+    ASSERT_TRUE(io.init(cfg).is_ok());
+    EXPECT_EQ(io.backend(), ::sigil::fs::IO_BACKEND_THREAD);
+    run_io_roundtrip(io, root / "data");
+
+    fs::remove_all(root);
+}
+
+TEST(FS, IoServiceBacklogBeyondRing) {
+    fs::path root = make_temp_dir("io-backlog");
+    ASSERT_FALSE(root.empty());
+    write_file(root / "src", std::string(4096, 'q'));
+
+    ::sigil::fs::io_config_t cfg;
+    cfg.entries = 4;
+
+    ::sigil::fs::io_service_t io;
+    ASSERT_TRUE(io.init(cfg).is_ok());
+
+    const std::string path = (root / "src").string();
+    ::sigil::fs::io_request_t open_req;
+    open_req.op = ::sigil::fs::IO_OPENAT;
+    open_req.path = path.c_str();
+    open_req.flags = O_RDONLY | O_CLOEXEC;
+    ASSERT_TRUE(io.run(&open_req, 1).is_ok());
+    const int fd = static_cast<int>(open_req.result.info);
+
+    std::vector<char> buf(4096);
+    std::vector<::sigil::fs::io_request_t> reads(64);
+    for (std::size_t i = 0; i < reads.size(); ++i) {
+        reads[i].op = ::sigil::fs::IO_READ;
+        reads[i].fd = fd;
+        reads[i].buffer = buf.data() + i * 64;
+        reads[i].length = 64;
+        reads[i].offset = i * 64;
+    }
+    ASSERT_TRUE(io.run(reads.data(), reads.size()).is_ok());
+    for (const auto &r : reads)
+        EXPECT_EQ(r.result.info, 64u);
+    EXPECT_EQ(std::string(buf.begin(), buf.end()), std::string(4096, 'q'));
+
+    close(fd);
+    fs::remove_all(root);
+}
+
+// Collects batches until pred holds over everything seen so far, up to ~2s
+template <typename Pred>
+static bool wait_for_events(::sigil::fs::watcher_t &w, std::vector<::sigil::fs::watch_event_t> &seen, Pred pred) {
+    for (int i = 0; i < 40; ++i) {
+        ::sigil::fs::watch_batch_t batch;
+        if (w.wait(batch, 50))
+            seen.insert(seen.end(), batch.events.begin(), batch.events.end());
+        if (pred(seen))
+            return true;
+    }
+    return false;
+}
+
+static uint32_t kinds_for(const std::vector<::sigil::fs::watch_event_t> &seen, const fs::path &p) {
+    uint32_t k = 0;
+    for (const auto &e : seen) {
+        if (e.path == p) k |= e.kinds;
+    }
+    return k;
+}
+
+TEST(FS, WatcherCoalescesAndFollowsNewDirs) {
+    fs::path root = fs::weakly_canonical(make_temp_dir("watch"));
+    ASSERT_FALSE(root.empty());
+    fs::create_directories(root / "hypr");
+
+    ::sigil::fs::watcher_t w;
+    ASSERT_TRUE(w.start().is_ok());
+    ASSERT_TRUE(w.add(root).is_ok());
+
+    // Several writes to one file inside a debounce window collapse into one entry
+    for (int i = 0; i < 5; ++i)
+        write_file(root / "hypr" / "theme.conf", "gen " + std::to_string(i));
+
+    std::vector<::sigil::fs::watch_event_t> seen;
+    ASSERT_TRUE(wait_for_events(w, seen, [&](const auto &s) {
+        return kinds_for(s, root / "hypr" / "theme.conf") & ::sigil::fs::WATCH_MODIFIED;
+    }));
+
+    std::size_t entries = 0;
+    for (const auto &e : seen) {
+        if (e.path == root / "hypr" / "theme.conf") ++entries;
+    }
+    EXPECT_EQ(entries, 1u);
+
+    // New directory tree gets watched, and files already inside are reported
+    seen.clear();
+    write_file(root / "waybar" / "styles" / "base.css", "a");
+    ASSERT_TRUE(wait_for_events(w, seen, [&](const auto &s) {
+        return kinds_for(s, root / "waybar" / "styles" / "base.css") != 0;
+    }));
+
+    seen.clear();
+    write_file(root / "waybar" / "styles" / "base.css", "b");
+    ASSERT_TRUE(wait_for_events(w, seen, [&](const auto &s) {
+        return kinds_for(s, root / "waybar" / "styles" / "base.css") & ::sigil::fs::WATCH_MODIFIED;
+    }));
+
+    seen.clear();
+    fs::remove(root / "hypr" / "theme.conf");
+    ASSERT_TRUE(wait_for_events(w, seen, [&](const auto &s) {
+        return kinds_for(s, root / "hypr" / "theme.conf") & ::sigil::fs::WATCH_REMOVED;
+    }));
+
+    // Removed roots stay quiet
+    w.remove(root);
+    seen.clear();
+    write_file(root / "hypr" / "late.conf", "x");
+    EXPECT_FALSE(wait_for_events(w, seen, [](const auto &s) { return !s.empty(); }));
+
+    w.stop();
+    fs::remove_all(root);
+}
+
+TEST(FS, WatcherRejectsMissingRoot) {
+    ::sigil::fs::watcher_t w;
+    EXPECT_TRUE(w.add("/nonexistent/sigil-watch").is_failure());
+    ASSERT_TRUE(w.start().is_ok());
+    EXPECT_TRUE(w.add("/nonexistent/sigil-watch").is_failure());
+}
+
+TEST(FS, ThemeDeployWritesOnlyDifferences) {
+    fs::path root = make_temp_dir("deploy");
+    ASSERT_FALSE(root.empty());
+
+    const fs::path theme = root / "themes" / "nord";
+    write_file(theme / "hypr" / "hyprland.conf", "general {}");
+    write_file(theme / "waybar" / "config", "w1");
+    write_file(theme / "wofi" / "style.css", "wofi");
+    write_file(theme / "shell" / "starship.toml", "format = ''");
+
+    const auto test = make_test_app(root, {
+        "XDG_CONFIG_HOME=" + (root / "cfg").string(),
+        "XDG_STATE_HOME=" + (root / "state").string()
+    });
+    ASSERT_NE(test, nullptr);
+    const auto &app = test->app;
+
+    std::vector<std::string> changed;
+    ASSERT_TRUE(::sigil::desktop::deploy_theme_files(app, theme, changed).is_ok());
+    EXPECT_EQ(changed, (std::vector<std::string>{ "hypr", "shell", "waybar", "wofi" }));
+    EXPECT_EQ(read_file(root / "cfg" / "waybar" / "config"), "w1");
+    EXPECT_EQ(read_file(root / "cfg" / "starship.toml"), "format = ''");
+    EXPECT_TRUE(fs::exists(theme / ".manifest"));
+    EXPECT_TRUE(fs::exists(root / "state" / "sigilvm" / "themes" / "deployed.manifest"));
+
+    // Nothing changed, nothing to write or reload
+    ASSERT_TRUE(::sigil::desktop::deploy_theme_files(app, theme, changed).is_ok());
+    EXPECT_TRUE(changed.empty());
+
+    struct stat hypr_before{};
+    ASSERT_EQ(stat((root / "cfg" / "hypr" / "hyprland.conf").c_str(), &hypr_before), 0);
+
+    // One template changed, one removed
+    write_file(theme / "waybar" / "config", "w2 longer");
+    fs::remove(theme / "wofi" / "style.css");
+    ASSERT_TRUE(::sigil::desktop::deploy_theme_files(app, theme, changed).is_ok());
+    EXPECT_EQ(changed, (std::vector<std::string>{ "wofi", "waybar" }));
+    EXPECT_EQ(read_file(root / "cfg" / "waybar" / "config"), "w2 longer");
+    EXPECT_FALSE(fs::exists(root / "cfg" / "wofi" / "style.css"));
+
+    struct stat hypr_after{};
+    ASSERT_EQ(stat((root / "cfg" / "hypr" / "hyprland.conf").c_str(), &hypr_after), 0);
+    EXPECT_EQ(hypr_before.st_mtim.tv_nsec, hypr_after.st_mtim.tv_nsec);
+    EXPECT_EQ(hypr_before.st_ctim.tv_nsec, hypr_after.st_ctim.tv_nsec);
+
+    // A deployed file edited by hand is noticed and restored
+    write_file(root / "cfg" / "hypr" / "hyprland.conf", "edited by hand");
+    ASSERT_TRUE(::sigil::desktop::deploy_theme_files(app, theme, changed).is_ok());
+    EXPECT_EQ(changed, (std::vector<std::string>{ "hypr" }));
+    EXPECT_EQ(read_file(root / "cfg" / "hypr" / "hyprland.conf"), "general {}");
+
+    fs::remove_all(root);
+}
+
+TEST(FS, ThemeManifestRoundTrip) {
+    fs::path root = make_temp_dir("manifest");
+    ASSERT_FALSE(root.empty());
+
+    write_file(root / "theme" / "hypr" / "a b.conf", "spaces in name");
+    write_file(root / "theme" / "mako" / "config", "mako");
+
+    ::sigil::desktop::theme_manifest_t built;
+    ASSERT_TRUE(::sigil::desktop::update_theme_manifest(root / "theme", built).is_ok());
+    ASSERT_EQ(built.entries.size(), 2u);
+    ASSERT_NE(built.find("hypr/a b.conf"), nullptr);
+    EXPECT_EQ(built.find("hypr/missing"), nullptr);
+
+    ::sigil::desktop::theme_manifest_t loaded;
+    ASSERT_TRUE(loaded.load(root / "theme" / ".manifest").is_ok());
+    EXPECT_EQ(loaded.entries, built.entries);
+
+    write_file(root / "bad.manifest", "not a manifest\n");
+    EXPECT_TRUE(loaded.load(root / "bad.manifest").is_failure());
+    EXPECT_TRUE(loaded.entries.empty());
+
+    fs::remove_all(root);
+}
+
+TEST(FS, ThemeManifestHashesInBatches) {
+    fs::path root = make_temp_dir("manifest-batch");
+    ASSERT_FALSE(root.empty());
+
+    // More files than one batch, one empty and one too large to be read whole
+    for (int i = 0; i < 150; ++i)
+        write_file(root / "theme" / "icons" / ("icon-" + std::to_string(i) + ".svg"), "<svg id=\"" + std::to_string(i) + "\"/>");
+    write_file(root / "theme" / "empty", "");
+    write_file(root / "theme" / "wallpaper.png", std::string(512 * 1024, 'w'));
+
+    ::sigil::desktop::theme_manifest_t built;
+    ASSERT_TRUE(::sigil::desktop::update_theme_manifest(root / "theme", built).is_ok());
+    ASSERT_EQ(built.entries.size(), 152u);
+
+    // Same digests as hashing each file on its own
+    for (const auto &e : built.entries) {
+        ::sigil::math::xxh128_payload_t hp;
+        hp.path = root / "theme" / e.path;
+        ASSERT_TRUE(::sigil::math::xxh128_hash(hp).is_ok());
+        EXPECT_EQ(e.digest, hp.output) << e.path;
+    }
+
+    fs::remove_all(root);
+}
+
+TEST(FS, ThemeGenerationSwitchAndRollback) {
+    fs::path root = make_temp_dir("generation");
+    ASSERT_FALSE(root.empty());
+
+    const fs::path nord = root / "themes" / "nord";
+    const fs::path dune = root / "themes" / "dune";
+    write_file(nord / "hypr" / "hyprland.conf", "nord");
+    write_file(nord / "waybar" / "config", "bar");
+    write_file(dune / "hypr" / "hyprland.conf", "dune");
+    write_file(dune / "waybar" / "config", "bar");
+
+    // Hand-made config that must survive the first switch
+    write_file(root / "cfg" / "hypr" / "hyprland.conf", "mine");
+
+    const auto test = make_test_app(root, {
+        "XDG_CONFIG_HOME=" + (root / "cfg").string(),
+        "XDG_DATA_HOME=" + (root / "data").string(),
+        "XDG_STATE_HOME=" + (root / "state").string()
+    });
+    ASSERT_NE(test, nullptr);
+    const auto &app = test->app;
+
+    std::vector<std::string> changed;
+    ASSERT_TRUE(::sigil::desktop::switch_theme_generation(app, nord, changed).is_ok());
+    EXPECT_EQ(changed, (std::vector<std::string>{ "hypr", "waybar" }));
+    EXPECT_TRUE(fs::is_symlink(root / "cfg" / "hypr"));
+    EXPECT_EQ(read_file(root / "cfg" / "hypr" / "hyprland.conf"), "nord");
+    EXPECT_EQ(read_file(root / "state" / "sigilvm" / "themes" / "original" / "hypr" / "hyprland.conf"), "mine");
+
+    // Same content, same generation: waybar does not move
+    const fs::path bar_gen = fs::read_symlink(root / "cfg" / "waybar");
+    ASSERT_TRUE(::sigil::desktop::switch_theme_generation(app, dune, changed).is_ok());
+    EXPECT_EQ(changed, (std::vector<std::string>{ "hypr" }));
+    EXPECT_EQ(read_file(root / "cfg" / "hypr" / "hyprland.conf"), "dune");
+    EXPECT_EQ(fs::read_symlink(root / "cfg" / "waybar"), bar_gen);
+
+    ASSERT_TRUE(::sigil::desktop::switch_theme_generation(app, dune, changed).is_ok());
+    EXPECT_TRUE(changed.empty());
+
+    ASSERT_TRUE(::sigil::desktop::rollback_theme_generation(app, changed).is_ok());
+    EXPECT_EQ(changed, (std::vector<std::string>{ "hypr" }));
+    EXPECT_EQ(read_file(root / "cfg" / "hypr" / "hyprland.conf"), "nord");
+
+    // Rolling back twice returns to where the rollback started
+    ASSERT_TRUE(::sigil::desktop::rollback_theme_generation(app, changed).is_ok());
+    EXPECT_EQ(read_file(root / "cfg" / "hypr" / "hyprland.conf"), "dune");
+
+    // In-place deploy replaces the links with real files, generations stay intact
+    ASSERT_TRUE(::sigil::desktop::deploy_theme_files(app, nord, changed).is_ok());
+    EXPECT_FALSE(fs::is_symlink(root / "cfg" / "hypr"));
+    EXPECT_EQ(read_file(root / "cfg" / "hypr" / "hyprland.conf"), "nord");
+    EXPECT_EQ(read_file(fs::path(bar_gen) / "config"), "bar");
+
+    // A third theme: generation is ash, generation.prev dune, nord's hypr is unreachable and goes
+    const fs::path ash = root / "themes" / "ash";
+    write_file(ash / "hypr" / "hyprland.conf", "ash");
+    write_file(ash / "waybar" / "config", "bar");
+    ASSERT_TRUE(::sigil::desktop::switch_theme_generation(app, ash, changed).is_ok());
+    EXPECT_EQ(read_file(root / "cfg" / "hypr" / "hyprland.conf"), "ash");
+
+    std::vector<std::string> hypr_gens;
+    for (const auto &e : fs::directory_iterator(root / "data" / "sigilvm" / "generations" / "hypr"))
+        hypr_gens.push_back(read_file(e.path() / "hyprland.conf"));
+    std::sort(hypr_gens.begin(), hypr_gens.end());
+    EXPECT_EQ(hypr_gens, (std::vector<std::string>{ "ash", "dune" }));
+    EXPECT_TRUE(fs::exists(bar_gen));
+
+    ASSERT_TRUE(::sigil::desktop::rollback_theme_generation(app, changed).is_ok());
+    EXPECT_EQ(read_file(root / "cfg" / "hypr" / "hyprland.conf"), "dune");
+
+    fs::remove_all(root);
+}
+
+static const char *test_pattern =
+    "name: Test\n"
+    "tags:\n"
+    "  color:\n"
+    "    background: \"#0D0D12\"   # comment\n"
+    "    accent:\n"
+    "      primary: \"#b330b8\"\n"
+    "      secondary: '#91289a'\n"
+    "    text:\n"
+    "      primary: \"#E6E6F0\"\n"
+    "  opacity:\n"
+    "    active: 0.97\n";
+
+TEST(FS, ThemeTemplateCompilesAndRenders) {
+    fs::path root = make_temp_dir("template");
+    ASSERT_FALSE(root.empty());
+    write_file(root / "test.yaml", test_pattern);
+
+    ::sigil::desktop::theme_pattern_t pattern;
+    ASSERT_TRUE(::sigil::desktop::load_theme_pattern(root / "test.yaml", pattern).is_ok());
+    EXPECT_EQ(pattern.name, "Test");
+    ASSERT_NE(pattern.find("color.accent"), nullptr);
+    EXPECT_EQ(*pattern.find("color.accent"), "#b330b8");
+    EXPECT_EQ(*pattern.find("color.accent.secondary"), "#91289a");
+    EXPECT_EQ(*pattern.find("color.background"), "#0D0D12");
+    EXPECT_EQ(*pattern.find("opacity.active"), "0.97");
+
+    ::sigil::desktop::template_plan_t plan;
+    ASSERT_TRUE(::sigil::desktop::compile_template(
+        "border {{ color.accent }}; rgb({{color.background|nohash}}) rgba({{ color.text | rgb }}, {{ opacity.active }})",
+        plan).is_ok());
+    EXPECT_TRUE(plan.has_slots());
+
+    std::string out;
+    ASSERT_TRUE(::sigil::desktop::render_template(plan, pattern, out).is_ok());
+    EXPECT_EQ(out, "border #b330b8; rgb(0D0D12) rgba(230, 230, 240, 0.97)");
+
+    std::string missing;
+    ASSERT_TRUE(::sigil::desktop::compile_template("{{ color.nope }}", plan).is_ok());
+    out.clear();
+    EXPECT_TRUE(::sigil::desktop::render_template(plan, pattern, out, &missing).is_failure());
+    EXPECT_EQ(missing, "color.nope");
+
+    EXPECT_TRUE(::sigil::desktop::compile_template("a {{ color.accent", plan).is_failure());
+    EXPECT_TRUE(::sigil::desktop::compile_template("a {{ color.accent | upper }}", plan).is_failure());
+
+    ASSERT_TRUE(::sigil::desktop::compile_template("${(s.:.)LS_COLORS}", plan).is_ok());
+    EXPECT_FALSE(plan.has_slots());
+
+    fs::remove_all(root);
+}
+
+TEST(FS, ThemeBuildRendersTemplates) {
+    fs::path root = make_temp_dir("build");
+    ASSERT_FALSE(root.empty());
+
+    write_file(root / "assets" / "patterns" / "test.yaml", test_pattern);
+    write_file(root / "assets" / "common" / "mako" / "config", "background-color={{ color.background }}\n");
+    write_file(root / "assets" / "common" / "hypr" / "theme.conf", "col = rgb({{ color.accent | nohash }})\n");
+    write_file(root / "assets" / "common" / "shell" / ".zshrc", "plain ${HOME}\n");
+
+    const auto test = make_test_app(root, {
+        "XDG_DATA_HOME=" + (root / "data").string(),
+        "SIGILVM_THEME_ROOT=" + (root / "assets").string()
+    });
+    ASSERT_NE(test, nullptr);
+    const auto &app = test->app;
+
+    const fs::path theme = root / "data" / "sigilvm" / "themes" / "test";
+    ASSERT_TRUE(::sigil::desktop::build_theme(app, "test").is_ok());
+    EXPECT_EQ(read_file(theme / "mako" / "config"), "background-color=#0D0D12\n");
+    EXPECT_EQ(read_file(theme / "hypr" / "theme.conf"), "col = rgb(b330b8)\n");
+    EXPECT_EQ(read_file(theme / "shell" / ".zshrc"), "plain ${HOME}\n");
+    EXPECT_TRUE(fs::exists(theme / ".manifest"));
+
+    // Unchanged output is not rewritten
+    struct stat before{}, after{};
+    ASSERT_EQ(stat((theme / "mako" / "config").c_str(), &before), 0);
+    ASSERT_TRUE(::sigil::desktop::build_theme(app, "test").is_ok());
+    ASSERT_EQ(stat((theme / "mako" / "config").c_str(), &after), 0);
+    EXPECT_EQ(before.st_ino, after.st_ino);
+
+    // Template edits take effect, the plan cache is keyed by content
+    write_file(root / "assets" / "common" / "mako" / "config", "text={{ color.text.primary }}\n");
+    ASSERT_TRUE(::sigil::desktop::build_theme(app, "test", { "mako" }).is_ok());
+    EXPECT_EQ(read_file(theme / "mako" / "config"), "text=#E6E6F0\n");
+
+    write_file(root / "assets" / "common" / "mako" / "config", "{{ color.missing }}\n");
+    EXPECT_TRUE(::sigil::desktop::build_theme(app, "test", { "mako" }).is_failure());
+
+    fs::remove_all(root);
+}
+
+TEST(FS, ThemeVariantCacheRendersOnce) {
+    fs::path root = make_temp_dir("variant");
+    ASSERT_FALSE(root.empty());
+
+    write_file(root / "assets" / "patterns" / "test.yaml", test_pattern);
+    write_file(root / "assets" / "patterns" / "other.yaml", "tags:\n  color:\n    background: \"#000000\"\n");
+    write_file(root / "assets" / "common" / "mako" / "config", "background-color={{ color.background }}\n");
+
+    const auto test = make_test_app(root, {
+        "XDG_CACHE_HOME=" + (root / "cache").string(),
+        "SIGILVM_THEME_ROOT=" + (root / "assets").string()
+    });
+    ASSERT_NE(test, nullptr);
+    const auto &app = test->app;
+
+    ::sigil::desktop::theme_variant_t first, again;
+    ASSERT_TRUE(::sigil::desktop::get_theme_variant(app, "test", first).is_ok());
+    EXPECT_TRUE(first.built);
+    EXPECT_FALSE(first.prewarmed);
+    EXPECT_EQ(first.dir.filename(), "test");
+    EXPECT_EQ(read_file(first.dir / "mako" / "config"), "background-color=#0D0D12\n");
+
+    ASSERT_TRUE(::sigil::desktop::get_theme_variant(app, "test", again).is_ok());
+    EXPECT_FALSE(again.built);
+    EXPECT_EQ(again.dir, first.dir);
+
+    // Only the pattern without a variant gets rendered
+    std::size_t built = 0;
+    ASSERT_TRUE(::sigil::desktop::prewarm_theme_variants(app, built).is_ok());
+    EXPECT_EQ(built, 1u);
+    ASSERT_TRUE(::sigil::desktop::get_theme_variant(app, "test", again).is_ok());
+    EXPECT_TRUE(again.prewarmed);
+
+    // New templates, new key, the old variants go with the next prewarm
+    write_file(root / "assets" / "common" / "mako" / "config", "bg={{ color.background }}\n");
+    ASSERT_TRUE(::sigil::desktop::get_theme_variant(app, "test", again).is_ok());
+    EXPECT_TRUE(again.built);
+    EXPECT_FALSE(again.prewarmed);
+    EXPECT_NE(again.dir, first.dir);
+    EXPECT_EQ(read_file(again.dir / "mako" / "config"), "bg=#0D0D12\n");
+
+    ASSERT_TRUE(::sigil::desktop::prewarm_theme_variants(app, built).is_ok());
+    EXPECT_EQ(built, 1u);
+    EXPECT_FALSE(fs::exists(first.dir));
+    EXPECT_TRUE(fs::exists(again.dir));
+
+    ::sigil::desktop::theme_variant_t missing;
+    EXPECT_TRUE(::sigil::desktop::get_theme_variant(app, "nope", missing).is_failure());
+
+    // Same contents under another name: same variant directory, its own tree
+    fs::copy_file(root / "assets" / "patterns" / "test.yaml", root / "assets" / "patterns" / "twin.yaml");
+    ::sigil::desktop::theme_variant_t twin;
+    ASSERT_TRUE(::sigil::desktop::get_theme_variant(app, "twin", twin).is_ok());
+    EXPECT_TRUE(twin.built);
+    EXPECT_EQ(twin.dir.parent_path(), again.dir.parent_path());
+    EXPECT_EQ(read_file(twin.dir / "mako" / "config"), "bg=#0D0D12\n");
+    EXPECT_TRUE(fs::exists(again.dir));
+
+    // Staging of a live process is somebody rendering, that of a dead one is debris
+    const pid_t gone = fork();
+    if (gone == 0)
+        _exit(0);
+    ASSERT_GT(gone, 0);
+    waitpid(gone, nullptr, 0);
+
+    const fs::path live_staging = again.dir.parent_path().string() + ".tmp-" + std::to_string(getpid());
+    const fs::path dead_staging = again.dir.parent_path().string() + ".tmp-" + std::to_string(gone);
+    fs::create_directories(live_staging / "test");
+    fs::create_directories(dead_staging / "test");
+    ASSERT_TRUE(::sigil::desktop::prewarm_theme_variants(app, built).is_ok());
+    EXPECT_TRUE(fs::exists(live_staging));
+    EXPECT_FALSE(fs::exists(dead_staging));
+    EXPECT_TRUE(fs::exists(twin.dir));
+
+    fs::remove_all(root);
+}
+
+// Unix socket answering one request per connection, the way Hyprland and hyprpaper do
+struct fake_ipc_server_t {
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> stop = false;
+    std::mutex lock;
+    std::vector<std::string> requests;
+
+    bool start(const fs::path &path, std::function<std::string(const std::string&)> answer) {
+        fs::create_directories(path.parent_path());
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 8) != 0)
+            return false;
+
+        thread = std::thread([this, answer] {
+            while (!stop) {
+                pollfd p{ fd, POLLIN, 0 };
+                if (poll(&p, 1, 20) <= 0)
+                    continue;
+
+                const int c = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (c < 0)
+                    continue;
+
+                char buf[4096];
+                const ssize_t n = read(c, buf, sizeof(buf));
+                const std::string request(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    requests.push_back(request);
+                }
+
+                const std::string reply = answer(request);
+                EXPECT_EQ(write(c, reply.data(), reply.size()), static_cast<ssize_t>(reply.size()));
+                close(c);
+            }
+        });
+        return true;
+    }
+
+    std::vector<std::string> seen() {
+        std::lock_guard<std::mutex> guard(lock);
+        return requests;
+    }
+
+    ~fake_ipc_server_t() {
+        stop = true;
+        if (thread.joinable())
+            thread.join();
+        if (fd >= 0)
+            close(fd);
+    }
+};
+
+TEST(FS, DesktopReloadTalksToHyprlandSocket) {
+    fs::path root = make_temp_dir("ipc");
+    ASSERT_FALSE(root.empty());
+
+    const fs::path hypr_dir = root / "run" / "hypr" / "sigtest";
+    const fs::path wallpaper = root / "cfg" / "hypr" / "default.jpg";
+    const fs::path kvconfig = root / "cfg" / "Kvantum" / "kvantum.kvconfig";
+    write_file(wallpaper, "jpg");
+    write_file(kvconfig, "[General]\ntheme=KvArc\n\n[Applications]\nKvArc=dolphin\n");
+
+    fake_ipc_server_t hyprland;
+    ASSERT_TRUE(hyprland.start(hypr_dir / ".socket.sock", [](const std::string &request) -> std::string {
+        if (request == "j/monitors")
+            return "[{ \"id\": 0, \"name\": \"DP-1\", \"disabled\": false },"
+                   " { \"id\": 1, \"name\": \"HDMI-A-1\", \"disabled\": true }]";
+        if (request == "reload" || request == "[[BATCH]]reload;reload")
+            return request == "reload" ? "ok" : "ok\n\nok";
+        return "unknown request";
+    }));
+
+    fake_ipc_server_t hyprpaper;
+    ASSERT_TRUE(hyprpaper.start(hypr_dir / ".hyprpaper.sock", [](const std::string&) { return std::string("ok"); }));
+
+    const auto test = make_test_app(root, {
+        "XDG_CONFIG_HOME=" + (root / "cfg").string(),
+        "XDG_RUNTIME_DIR=" + (root / "run").string(),
+        "HYPRLAND_INSTANCE_SIGNATURE=sigtest"
+    });
+    ASSERT_NE(test, nullptr);
+    const auto &app = test->app;
+
+    ::sigil::desktop::hypr_instance_t instance;
+    ASSERT_TRUE(::sigil::desktop::find_hypr_instance(app.process, instance));
+    EXPECT_EQ(instance.dir, hypr_dir);
+
+    ASSERT_TRUE(::sigil::desktop::reload_components(app, { "hypr", "Kvantum" }).is_ok());
+    EXPECT_EQ(hyprland.seen(), (std::vector<std::string>{ "reload", "j/monitors" }));
+    EXPECT_EQ(hyprpaper.seen(), (std::vector<std::string>{ "wallpaper DP-1," + wallpaper.string() + ",fill" }));
+    EXPECT_EQ(read_file(kvconfig), "[General]\ntheme=sigilvm\n\n[Applications]\nKvArc=dolphin\n");
+
+    // Components that reload on their own never reach the sockets
+    ASSERT_TRUE(::sigil::desktop::reload_components(app, { "alacritty", "wofi" }).is_ok());
+    EXPECT_EQ(hyprland.seen().size(), 2u);
+
+    EXPECT_TRUE(::sigil::desktop::hypr_dispatch(instance, "[[BATCH]]reload;reload").is_ok());
+    const ::sigil::yield refused = ::sigil::desktop::hypr_dispatch(instance, "bogus");
+    EXPECT_TRUE(refused.is_failure());
+    EXPECT_EQ(refused.code, EPROTO);
+
+    // No signature, no instance: reload takes the spawn path
+    const auto bare = make_test_app(root, { "XDG_RUNTIME_DIR=" + (root / "run").string() });
+    ASSERT_NE(bare, nullptr);
+    EXPECT_FALSE(::sigil::desktop::find_hypr_instance(bare->proc, instance));
+
+    fs::remove_all(root);
+}
+
+TEST(FS, DesktopSignalsProcessesByName) {
+    sigset_t usr2, old;
+    sigemptyset(&usr2);
+    sigaddset(&usr2, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &usr2, &old);
+
+    const pid_t child = fork();
+    if (child == 0) {
+        prctl(PR_SET_NAME, "sigil-fakebar");
+        int sig = 0;
+        sigwait(&usr2, &sig);
+        _exit(sig == SIGUSR2 ? 42 : 1);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    ASSERT_GT(child, 0);
+
+    // The name shows up in /proc once the child ran prctl
+    std::size_t signalled = 0;
+    for (int i = 0; i < 200 && signalled == 0; ++i) {
+        signalled = ::sigil::desktop::signal_processes("sigil-fakebar", SIGUSR2);
+        if (signalled == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    if (signalled == 0)
+        kill(child, SIGKILL);
+    EXPECT_EQ(signalled, 1u);
+
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 42);
+
+    EXPECT_EQ(::sigil::desktop::signal_processes("sigil-fakebar", SIGUSR2), 0u);
+}
+
+TEST(FS, CompatProfileIndexSkipsUnchangedTargets) {
+    fs::path root = make_temp_dir("compat");
+    ASSERT_FALSE(root.empty());
+
+    const fs::path profiles = root / "profiles";
+    const fs::path index_file = root / "cache" / "profiles.index";
+    write_file(root / "game" / "game.exe", "MZ game v1");
+    write_file(root / "runner" / "wine", "");
+    fs::create_directories(root / "prefix");
+    fs::create_directories(profiles);
+
+    const std::string body =
+        "target: " + (root / "game" / "game.exe").string() + "\n"
+        "runner: " + (root / "runner" / "wine").string() + "\n"
+        "prefix: " + (root / "prefix").string() + "\n"
+        "sha256: e489a14d6291a2b8b25b9ce7beea6438fd961343457e75d6498e7a118b106f65\n";
+    write_file(profiles / "game.yaml", body);
+    write_file(profiles / "broken.yaml", "target: [unterminated\n");
+
+    using sigil::platform::compat_profile_index_t;
+    using sigil::platform::compat_index_stats_t;
+    std::vector<sigil::platform::compat_profile_t> out;
+    bool changed = false;
+
+    // First run parses and hashes
+    {
+        compat_profile_index_t index;
+        compat_index_stats_t stats;
+        EXPECT_TRUE(index.load(index_file).is_failure());
+        ASSERT_TRUE(sigil::platform::refresh_compat_profiles(profiles, index, out, changed, &stats).is_ok());
+        EXPECT_TRUE(changed);
+        ASSERT_EQ(out.size(), 1u);
+        EXPECT_EQ(out[0].target, root / "game" / "game.exe");
+        EXPECT_EQ(stats.parsed, 2u);
+        EXPECT_EQ(stats.hashed, 1u);
+        EXPECT_EQ(stats.rejected, 1u);
+        ASSERT_TRUE(index.save(index_file).is_ok());
+    }
+
+    // Reloaded index, nothing touched: no parse, no hash, nothing to save
+    {
+        compat_profile_index_t index;
+        compat_index_stats_t stats;
+        ASSERT_TRUE(index.load(index_file).is_ok());
+        ASSERT_TRUE(sigil::platform::refresh_compat_profiles(profiles, index, out, changed, &stats).is_ok());
+        EXPECT_FALSE(changed);
+        EXPECT_EQ(out.size(), 1u);
+        EXPECT_EQ(stats.parsed, 0u);
+        EXPECT_EQ(stats.reused, 2u);
+        EXPECT_EQ(stats.hashed, 0u);
+        EXPECT_EQ(stats.hash_skipped, 1u);
+    }
+
+    compat_profile_index_t index;
+    ASSERT_TRUE(index.load(index_file).is_ok());
+
+    // Profile edited, same sha256 and target: parsed again, the verdict stays
+    {
+        write_file(profiles / "game.yaml", body + "extra: -windowed\n");
+        compat_index_stats_t stats;
+        ASSERT_TRUE(sigil::platform::refresh_compat_profiles(profiles, index, out, changed, &stats).is_ok());
+        EXPECT_TRUE(changed);
+        ASSERT_EQ(out.size(), 1u);
+        EXPECT_EQ(out[0].extra, "-windowed");
+        EXPECT_EQ(stats.parsed, 1u);
+        EXPECT_EQ(stats.hashed, 0u);
+    }
+
+    // Target replaced: hashed again and rejected
+    {
+        write_file(root / "game" / "game.exe", "MZ game v2, patched");
+        compat_index_stats_t stats;
+        ASSERT_TRUE(sigil::platform::refresh_compat_profiles(profiles, index, out, changed, &stats).is_ok());
+        EXPECT_TRUE(changed);
+        EXPECT_TRUE(out.empty());
+        EXPECT_EQ(stats.hashed, 1u);
+
+        // The mismatch is remembered as well
+        stats = {};
+        ASSERT_TRUE(sigil::platform::refresh_compat_profiles(profiles, index, out, changed, &stats).is_ok());
+        EXPECT_FALSE(changed);
+        EXPECT_TRUE(out.empty());
+        EXPECT_EQ(stats.hashed, 0u);
+    }
+
+    // Removed profiles leave the index
+    fs::remove(profiles / "game.yaml");
+    ASSERT_TRUE(sigil::platform::refresh_compat_profiles(profiles, index, out, changed).is_ok());
+    EXPECT_TRUE(changed);
+    ASSERT_EQ(index.entries.size(), 1u);
+    EXPECT_EQ(index.entries[0].name, "broken.yaml");
+
+    // Corrupt index files are refused and leave the index empty
+    write_file(index_file, read_file(index_file).substr(0, 20));
+    EXPECT_EQ(index.load(index_file).code, EINVAL);
+    EXPECT_TRUE(index.entries.empty());
+
+    fs::remove_all(root);
+}
+
+TEST(FS, CloneTreeKeepsSymlinksAndLinksImmutables) {
+    fs::path root = make_temp_dir("clonetree");
+    ASSERT_FALSE(root.empty());
+
+    write_file(root / "src" / "system.reg", "registry");
+    write_file(root / "src" / "drive_c" / "windows" / "kernel32.dll", "builtin");
+    fs::create_directories(root / "src" / "dosdevices");
+    fs::create_symlink("../drive_c", root / "src" / "dosdevices" / "c:");
+
+    ::sigil::fs::copy_stats_t stats;
+    auto is_dll = [](const fs::path &rel) { return rel.extension() == ".dll"; };
+    ASSERT_TRUE(::sigil::fs::clone_tree(root / "src", root / "dst", stats, is_dll).is_ok());
+
+    EXPECT_TRUE(fs::is_symlink(root / "dst" / "dosdevices" / "c:"));
+    EXPECT_EQ(fs::read_symlink(root / "dst" / "dosdevices" / "c:"), "../drive_c");
+    EXPECT_EQ(read_file(root / "dst" / "system.reg"), "registry");
+    EXPECT_EQ(read_file(root / "dst" / "drive_c" / "windows" / "kernel32.dll"), "builtin");
+    EXPECT_EQ(stats.files_cloned + stats.files_linked + stats.files_copied, 2u);
+
+    // Without reflinks the DLL shares its inode, the registry never does
+    EXPECT_EQ(fs::hard_link_count(root / "dst" / "system.reg"), 1u);
+    if (stats.files_cloned == 0) {
+        EXPECT_EQ(stats.files_linked, 1u);
+        EXPECT_EQ(fs::hard_link_count(root / "src" / "drive_c" / "windows" / "kernel32.dll"), 2u);
+    }
+
+    EXPECT_EQ(::sigil::fs::clone_tree(root / "src", root / "dst", stats).code, EEXIST);
+
+    fs::remove_all(root);
+}
+
+TEST(FS, CompatPrefixClonesTemplateOnce) {
+    fs::path root = make_temp_dir("prefix");
+    ASSERT_FALSE(root.empty());
+
+    // Stand-in for wine, counts wineboot runs and lays out a minimal prefix
+    const fs::path runner = root / "runner" / "bin" / "wine";
+    write_file(runner,
+        "#!/bin/sh\n"
+        "echo boot >> \"" + (root / "boots").string() + "\"\n"
+        "mkdir -p \"$WINEPREFIX/drive_c/windows/system32\" \"$WINEPREFIX/dosdevices\"\n"
+        "echo builtin > \"$WINEPREFIX/drive_c/windows/system32/kernel32.dll\"\n"
+        "echo registry > \"$WINEPREFIX/system.reg\"\n"
+        "ln -s ../drive_c \"$WINEPREFIX/dosdevices/c:\"\n");
+    fs::permissions(runner, fs::perms::owner_all);
+
+    const auto test = make_test_app(root, { "XDG_DATA_HOME=" + (root / "data").string() });
+    ASSERT_NE(test, nullptr);
+    const auto &app = test->app;
+
+    fs::path first, second;
+    ::sigil::fs::copy_stats_t stats;
+    ASSERT_TRUE(::sigil::platform::create_compat_prefix(app, runner, "game-a", first, &stats).is_ok());
+    ASSERT_TRUE(::sigil::platform::create_compat_prefix(app, runner, "game-b", second).is_ok());
+    EXPECT_EQ(read_file(root / "boots"), "boot\n");
+
+    EXPECT_EQ(first, ::sigil::platform::get_compdata_root(app) / "prefixes" / "game-a");
+    EXPECT_EQ(read_file(second / "system.reg"), "registry\n");
+    EXPECT_TRUE(fs::is_symlink(second / "dosdevices" / "c:"));
+    EXPECT_EQ(stats.files_copied + stats.files_cloned + stats.files_linked, 2u);
+
+    // Nothing is hardlinked, an installer rewriting a system DLL only touches its own prefix
+    const fs::path dll = fs::path("drive_c") / "windows" / "system32" / "kernel32.dll";
+    EXPECT_EQ(stats.files_linked, 0u);
+    EXPECT_EQ(fs::hard_link_count(first / dll), 1u);
+    fs::permissions(first / dll, fs::perms::owner_write, fs::perm_options::add);
+    write_file(first / dll, "patched\n");
+    EXPECT_EQ(read_file(second / dll), "builtin\n");
+    EXPECT_EQ(read_file(::sigil::platform::get_prefix_template_path(app, runner) / dll), "builtin\n");
+
+    ::sigil::data::document_t manifest;
+    ASSERT_TRUE(manifest.load(first / "sigil-prefix.yaml").is_ok());
+    int64_t shared = -1;
+    EXPECT_TRUE(manifest.root()["shared_bytes"].as_int(shared));
+    EXPECT_EQ(static_cast<uint64_t>(shared), stats.bytes_cloned + stats.bytes_linked);
+    EXPECT_EQ(manifest.root()["template"].str(),
+              ::sigil::platform::get_prefix_template_path(app, runner).string());
+    EXPECT_FALSE(fs::exists(first.parent_path() / ".game-a.staging"));
+
+    EXPECT_EQ(::sigil::platform::create_compat_prefix(app, runner, "game-a", first).code, EEXIST);
+    EXPECT_EQ(::sigil::platform::create_compat_prefix(app, runner, "../escape", first).code, EINVAL);
+
+    // An upgraded runner boots a template of its own
+    const fs::path old_template = ::sigil::platform::get_prefix_template_path(app, runner);
+    write_file(runner, read_file(runner) + "# upgraded\n");
+    EXPECT_NE(::sigil::platform::get_prefix_template_path(app, runner), old_template);
+    ASSERT_TRUE(::sigil::platform::create_compat_prefix(app, runner, "game-c", second).is_ok());
+    EXPECT_EQ(read_file(root / "boots"), "boot\nboot\n");
+
+    fs::remove_all(root);
+}
@@ -0,0 +1,313 @@
+#include <sigil/platform/library.h>
+#include <sigil/platform/paths.h>
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using sigil::platform::library_index_t;
+using sigil::platform::library_scan_stats_t;
+
+static void put16(std::string &b, std::size_t at, uint16_t v) {
+    if (b.size() < at + 2) b.resize(at + 2);
+    b[at] = static_cast<char>(v);
+    b[at + 1] = static_cast<char>(v >> 8);
+}
+
+static void put32(std::string &b, std::size_t at, uint32_t v) {
+    put16(b, at, static_cast<uint16_t>(v));
+    put16(b, at + 2, static_cast<uint16_t>(v >> 16));
+}
+
+static void pad4(std::string &b) {
+    b.resize((b.size() + 3) & ~std::size_t(3));
+}
+
+static std::string utf16(const std::string &s) {
+    std::string out;
+    for (const char c : s) {
+        out += c;
+        out += '\0';
+    }
+    out.append(2, '\0');
+    return out;
+}
+
+// VS_VERSIONINFO style node: header, key, value, children, each part on a 4 byte boundary
+static std::string version_block(const std::string &key, uint16_t type, const std::string &value,
+                                 uint16_t value_length, const std::string &children) {
+    std::string b(6, '\0');
+    b += utf16(key);
+    pad4(b);
+    b += value;
+    pad4(b);
+    b += children;
+    put16(b, 0, static_cast<uint16_t>(b.size()));
+    put16(b, 2, value_length);
+    put16(b, 4, type);
+    pad4(b);
+    return b;
+}
+
+/**
+ * PE32+ GUI image with one .rsrc section holding a version resource
+ * (1.2.3.4, ProductName), an icon group of a 16px and a 256px entry,
+ * and the 256px icon itself.
+ */
+static std::string make_pe(const std::string &product, uint16_t characteristics = 0x0022) {
+    constexpr uint32_t raw = 0x200, rva = 0x1000;
+
+    std::string fixed(52, '\0');
+    put32(fixed, 0, 0xFEEF04BDu);
+    put32(fixed, 4, 0x00010000u);
+    put32(fixed, 8, (1u << 16) | 2u);
+    put32(fixed, 12, (3u << 16) | 4u);
+    put32(fixed, 16, (1u << 16) | 0u);
+    put32(fixed, 20, 0u);
+
+    const std::string name_value = utf16(product);
+    const std::string str = version_block("ProductName", 1, name_value, static_cast<uint16_t>(name_value.size() / 2), "");
+    const std::string table = version_block("040904B0", 1, "", 0, str);
+    const std::string sfi = version_block("StringFileInfo", 1, "", 0, table);
+    const std::string version = version_block("VS_VERSION_INFO", 0, fixed, 52, sfi);
+
+    std::string group(6 + 2 * 14, '\0');
+    put16(group, 2, 1);
+    put16(group, 4, 2);
+    group[6] = 16; group[7] = 16; put16(group, 6 + 4, 1); put16(group, 6 + 6, 32); put32(group, 6 + 8, 40); put16(group, 6 + 12, 2);
+    group[20] = 0; group[21] = 0; put16(group, 20 + 4, 1); put16(group, 20 + 6, 32); put32(group, 20 + 8, 40); put16(group, 20 + 12, 1);
+
+    const std::string icon(40, 'I');
+
+    // Tree: root (3 types) -> one name each -> one language each -> data entry
+    std::string res(232, '\0');
+    const uint32_t types[3] = { 3, 14, 16 };
+    const uint32_t names[3] = { 1, 101, 1 };
+    put16(res, 14, 3);
+    for (uint32_t i = 0; i < 3; ++i) {
+        const uint32_t type_dir = 40 + i * 24, name_dir = 112 + i * 24, data = 184 + i * 16;
+        put32(res, 16 + i * 8, types[i]);
+        put32(res, 16 + i * 8 + 4, 0x80000000u | type_dir);
+        put16(res, type_dir + 14, 1);
+        put32(res, type_dir + 16, names[i]);
+        put32(res, type_dir + 20, 0x80000000u | name_dir);
+        put16(res, name_dir + 14, 1);
+        put32(res, name_dir + 16, 0x409);
+        put32(res, name_dir + 20, data);
+    }
+
+    const std::string *blobs[3] = { &icon, &group, &version };
+    for (uint32_t i = 0; i < 3; ++i) {
+        pad4(res);
+        put32(res, 184 + i * 16, rva + static_cast<uint32_t>(res.size()));
+        put32(res, 184 + i * 16 + 4, static_cast<uint32_t>(blobs[i]->size()));
+        res += *blobs[i];
+    }
+    pad4(res);
+
+    std::string img(raw, '\0');
+    img[0] = 'M'; img[1] = 'Z';
+    put32(img, 0x3C, 0x40);
+    std::memcpy(&img[0x40], "PE\0\0", 4);
+    const uint32_t coff = 0x44, opt = coff + 20;
+    put16(img, coff, 0x8664);
+    put16(img, coff + 2, 1);
+    put32(img, coff + 4, 0x5F000000u);
+    put16(img, coff + 16, 240);
+    put16(img, coff + 18, characteristics);
+    put16(img, opt, 0x20b);
+    put16(img, opt + 68, 2);
+    put32(img, opt + 108, 16);
+    put32(img, opt + 112 + 16, rva);
+    put32(img, opt + 112 + 20, static_cast<uint32_t>(res.size()));
+
+    const uint32_t section = opt + 240;
+    std::memcpy(&img[section], ".rsrc", 5);
+    put32(img, section + 8, static_cast<uint32_t>(res.size()));
+    put32(img, section + 12, rva);
+    put32(img, section + 16, static_cast<uint32_t>(res.size()));
+    put32(img, section + 20, raw);
+
+    return img + res;
+}
+
+TEST(Library, ParsesPeHeadersAndResources) {
+    const std::string img = make_pe("Test Game");
+
+    sigil::platform::pe_info_t info;
+    ASSERT_TRUE(sigil::platform::parse_pe_image(img, info).is_ok());
+    EXPECT_EQ(info.machine, sigil::platform::PE_MACHINE_AMD64);
+    EXPECT_EQ(info.subsystem, sigil::platform::PE_SUBSYSTEM_GUI);
+    EXPECT_EQ(info.timestamp, 0x5F000000u);
+    EXPECT_FALSE(info.is_dll());
+    EXPECT_TRUE(info.is_64bit());
+
+    const uint16_t version[4] = { 1, 2, 3, 4 };
+    EXPECT_TRUE(std::equal(version, version + 4, info.file_version));
+    EXPECT_EQ(info.product_version[0], 1);
+    EXPECT_EQ(info.product_name, "Test Game");
+
+    // The 256px image is the one picked, and it is where the offset says
+    EXPECT_EQ(info.icon_width, 256);
+    ASSERT_EQ(info.icon_size, 40u);
+    ASSERT_LE(info.icon_offset + info.icon_size, img.size());
+    EXPECT_EQ(img.substr(info.icon_offset, info.icon_size), std::string(40, 'I'));
+
+    // Headers intact, resources cut off: still a PE, nothing made up
+    ASSERT_TRUE(sigil::platform::parse_pe_image(std::string_view(img).substr(0, 0x200), info).is_ok());
+    EXPECT_EQ(info.machine, sigil::platform::PE_MACHINE_AMD64);
+    EXPECT_TRUE(info.product_name.empty());
+    EXPECT_EQ(info.icon_offset, 0u);
+
+    EXPECT_EQ(sigil::platform::parse_pe_image("MZ not really", info).code, ENOEXEC);
+    EXPECT_EQ(sigil::platform::parse_pe_image(std::string_view(img).substr(0, 0x50), info).code, ENOEXEC);
+}
+
+TEST(Library, ReadsPeInfoFromFiles) {
+    const fs::path root = fs::temp_directory_path() / ("sigil-library-read-" + std::to_string(getpid()));
+    fs::remove_all(root);
+
+    const std::string img = make_pe("Test Game");
+    write_file(root / "game.exe", img);
+
+    sigil::platform::pe_info_t from_file, from_memory;
+    ASSERT_TRUE(sigil::platform::read_pe_info(root / "game.exe", from_file).is_ok());
+    ASSERT_TRUE(sigil::platform::parse_pe_image(img, from_memory).is_ok());
+    EXPECT_EQ(from_file.product_name, "Test Game");
+    EXPECT_EQ(from_file.icon_offset, from_memory.icon_offset);
+    EXPECT_EQ(from_file.icon_size, from_memory.icon_size);
+    EXPECT_TRUE(std::equal(from_file.file_version, from_file.file_version + 4, from_memory.file_version));
+
+    // Cut off after the headers, as an update in progress leaves it: headers only, no crash
+    write_file(root / "game.exe", img.substr(0, 0x200));
+    ASSERT_TRUE(sigil::platform::read_pe_info(root / "game.exe", from_file).is_ok());
+    EXPECT_EQ(from_file.machine, sigil::platform::PE_MACHINE_AMD64);
+    EXPECT_TRUE(from_file.product_name.empty());
+
+    write_file(root / "tiny.exe", "MZ");
+    EXPECT_EQ(sigil::platform::read_pe_info(root / "tiny.exe", from_file).code, ENOEXEC);
+    EXPECT_EQ(sigil::platform::read_pe_info(root / "missing.exe", from_file).code, ENOENT);
+
+    fs::remove_all(root);
+}
+
+TEST(Library, RescanTouchesOnlyWhatChanged) {
+    const fs::path root = fs::temp_directory_path() / ("sigil-library-test-" + std::to_string(getpid()));
+    fs::remove_all(root);
+
+    write_file(root / "GameA" / "game.exe", make_pe("Game A"));
+    write_file(root / "GameA" / "unins000.exe", make_pe("Uninstaller"));
+    write_file(root / "GameA" / "readme.txt", "hi");
+    write_file(root / "GameA" / "pfx" / "drive_c" / "windows" / "notepad.exe", make_pe("Notepad"));
+    write_file(root / "GameB" / "bin" / "x64" / "b.exe", make_pe("Game B"));
+    write_file(root / "GameB" / "engine.exe", make_pe("Engine", 0x2022));
+    write_file(root / "GameB" / "broken.exe", "not a PE");
+    write_file(root / ".cache" / "hidden.exe", make_pe("Hidden"));
+
+    const std::vector<fs::path> roots = { root };
+    const fs::path index_file = root.string() + ".index";
+    std::vector<std::string> launchable;
+    auto collect = [&](const library_index_t &index) {
+        launchable.clear();
+        for (const auto &e : index.executables)
+            if (sigil::platform::library_exe_is_launchable(e))
+                launchable.emplace_back(e.name());
+    };
+
+    {
+        library_index_t index;
+        library_scan_stats_t stats;
+        bool changed = false;
+        ASSERT_TRUE(sigil::platform::scan_game_library(roots, index, changed, &stats, 4).is_ok());
+        EXPECT_TRUE(changed);
+        EXPECT_EQ(stats.exes_parsed, 5u);
+        EXPECT_EQ(stats.not_pe, 1u);
+        EXPECT_EQ(index.executables.size(), 5u);
+
+        collect(index);
+        EXPECT_EQ(launchable, (std::vector<std::string>{ "game.exe", "b.exe" }));
+
+        const auto *game = index.find((root / "GameA" / "game.exe").string());
+        ASSERT_NE(game, nullptr);
+        EXPECT_EQ(game->info.product_name, "Game A");
+        ASSERT_TRUE(index.save(index_file).is_ok());
+    }
+
+    library_index_t index;
+    ASSERT_TRUE(index.load(index_file).is_ok());
+
+    // Nothing changed: no listing, no parsing
+    {
+        library_scan_stats_t stats;
+        bool changed = true;
+        ASSERT_TRUE(sigil::platform::scan_game_library(roots, index, changed, &stats).is_ok());
+        EXPECT_FALSE(changed);
+        EXPECT_EQ(stats.dirs_listed, 0u);
+        EXPECT_EQ(stats.exes_parsed, 0u);
+        EXPECT_EQ(stats.exes_reused, 5u);
+        EXPECT_EQ(index.find((root / "GameB" / "bin" / "x64" / "b.exe").string())->info.product_name, "Game B");
+    }
+
+    // Rewritten file: parsed again, its directory is not relisted
+    {
+        write_file(root / "GameB" / "bin" / "x64" / "b.exe", make_pe("Game B Remastered"));
+        library_scan_stats_t stats;
+        bool changed = false;
+        ASSERT_TRUE(sigil::platform::scan_game_library(roots, index, changed, &stats).is_ok());
+        EXPECT_TRUE(changed);
+        EXPECT_EQ(stats.dirs_listed, 0u);
+        EXPECT_EQ(stats.exes_parsed, 1u);
+        EXPECT_EQ(index.find((root / "GameB" / "bin" / "x64" / "b.exe").string())->info.product_name, "Game B Remastered");
+    }
+
+    // New file and removed directory
+    {
+        write_file(root / "GameA" / "launcher.exe", make_pe("Launcher"));
+        fs::remove_all(root / "GameB");
+        library_scan_stats_t stats;
+        bool changed = false;
+        ASSERT_TRUE(sigil::platform::scan_game_library(roots, index, changed, &stats).is_ok());
+        EXPECT_TRUE(changed);
+        EXPECT_EQ(stats.exes_parsed, 1u);
+        collect(index);
+        EXPECT_EQ(launchable, (std::vector<std::string>{ "game.exe", "launcher.exe" }));
+        EXPECT_EQ(index.find((root / "GameB" / "engine.exe").string()), nullptr);
+    }
+
+    // Corrupt index files are refused
+    {
+        std::ofstream(index_file, std::ios::binary | std::ios::trunc) << "SGLIBIX";
+        library_index_t broken;
+        EXPECT_EQ(broken.load(index_file).code, EINVAL);
+        EXPECT_TRUE(broken.executables.empty());
+    }
+
+    fs::remove_all(root);
+    fs::remove(index_file);
+}
+
+TEST(Library, RootsComeFromConfig) {
+    const fs::path root = fs::temp_directory_path() / ("sigil-library-roots-" + std::to_string(getpid()));
+    fs::remove_all(root);
+
+    const auto test = make_test_app(root, { "XDG_CONFIG_HOME=" + (root / "cfg").string() });
+    ASSERT_NE(test, nullptr);
+    const auto &app = test->app;
+
+    std::vector<fs::path> roots;
+    ASSERT_TRUE(sigil::platform::load_library_roots(app, roots).is_ok());
+    EXPECT_EQ(roots, (std::vector<fs::path>{ root / "Games" }));
+
+    write_file(root / "cfg" / "sigilvm" / "library.yaml", "roots:\n  - ~/Games\n  - /storage/games\n");
+    ASSERT_TRUE(sigil::platform::load_library_roots(app, roots).is_ok());
+    EXPECT_EQ(roots, (std::vector<fs::path>{ root / "Games", "/storage/games" }));
+
+    fs::remove_all(root);
+}
@@ -1,10 +1,20 @@
+#include <sigil/platform/exec_graph.h>
+#include <sigil/platform/daemon.h>
+#include <sigil/platform/paths.h>
 #include <sigil/platform/exec.h>
 #include <gtest/gtest.h>
 #include <filesystem>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <cerrno>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string>
+#include <vector>
 
 using namespace sigil::platform;
 
@@ -187,6 +197,706 @@ TEST(PEU, ExecNoPathFails) {
     ASSERT_NE(peu.result.exit_code, 0);
 }
 
+TEST(PEU, ExecBackendsAgree) {
+    std::filesystem::path dir = make_temp_dir();
+    ASSERT_FALSE(dir.empty());
+
+    for (spawn_backend_t backend : { SPAWN_POSIX, SPAWN_FORK }) {
+        proc_exec_unit_t peu;
+        peu.set_target("sh")
+           .push_argument("-c")
+           .push_argument("pwd; echo $SIGIL_TEST_VAR >&2; read x; exit 3")
+           .export_var("SIGIL_TEST_VAR", "err")
+           .set_workdir(dir.string())
+           .set_spawn_backend(backend)
+           .set_stdio_mode(STDIO_NULL, STDIO_CAPTURE, STDIO_CAPTURE);
+
+        ::sigil::yield s = execute(peu);
+        ASSERT_EQ(s.is_ok(), true);
+        EXPECT_EQ(peu.result.exit_code, 3);
+        EXPECT_EQ(read_all_fd(peu.result.stdout_fd), dir.string() + "\n");
+        EXPECT_EQ(read_all_fd(peu.result.stderr_fd), "err\n");
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(PEU, ExecStartFailuresExit127) {
+    for (spawn_backend_t backend : { SPAWN_POSIX, SPAWN_FORK }) {
+        proc_exec_unit_t missing;
+        missing.set_target("/nonexistent-binary").set_spawn_backend(backend);
+        ASSERT_EQ(execute(missing).is_ok(), true);
+        EXPECT_EQ(missing.result.exit_code, 127);
+
+        proc_exec_unit_t bad_dir;
+        bad_dir.set_target("/bin/true")
+               .set_workdir("/nonexistent-dir")
+               .set_spawn_backend(backend);
+        ASSERT_EQ(execute(bad_dir).is_ok(), true);
+        EXPECT_EQ(bad_dir.result.exit_code, 127);
+    }
+}
+
+TEST(PEU, AsyncChildrenRunConcurrently) {
+    exec_supervisor_t sup;
+    std::vector<pid_t> reaped;
+
+    for (int i = 0; i < 4; ++i) {
+        proc_exec_unit_t peu;
+        peu.set_target("/bin/sleep").push_argument("0.3");
+        ASSERT_EQ(sup.launch(peu, [&](const proc_exec_result_t& r) {
+            EXPECT_EQ(r.exit_code, 0);
+            reaped.push_back(r.pid);
+        }).is_ok(), true);
+    }
+
+    // All four are in flight before anything is waited for
+    EXPECT_EQ(sup.active(), 4u);
+    ASSERT_EQ(sup.run().is_ok(), true);
+    EXPECT_EQ(sup.active(), 0u);
+
+    // Every callback fired once and the supervisor left no zombie behind
+    ASSERT_EQ(reaped.size(), 4u);
+    for (const pid_t pid : reaped) {
+        EXPECT_GT(pid, 0);
+        EXPECT_EQ(::waitpid(pid, nullptr, WNOHANG), -1);
+        EXPECT_EQ(errno, ECHILD);
+    }
+}
+
+TEST(PEU, AsyncCaptureAndExitCode) {
+    exec_supervisor_t sup;
+    std::string out;
+    int code = -1;
+
+    proc_exec_unit_t peu;
+    peu.set_target("sh")
+       .push_argument("-c")
+       .push_argument("echo async; exit 5")
+       .set_stdio_mode(STDIO_INHERIT, STDIO_CAPTURE, STDIO_INHERIT);
+
+    ASSERT_EQ(sup.launch(peu, [&](const proc_exec_result_t& r) {
+        out = read_all_fd(r.stdout_fd);
+        code = r.exit_code;
+        close(r.stdout_fd);
+    }).is_ok(), true);
+
+    ASSERT_EQ(sup.run().is_ok(), true);
+    EXPECT_EQ(out, "async\n");
+    EXPECT_EQ(code, 5);
+}
+
+TEST(PEU, AsyncTimeoutAndCancel) {
+    exec_supervisor_t sup;
+    proc_exec_result_t timed = {};
+    proc_exec_result_t cancelled = {};
+
+    proc_exec_unit_t slow;
+    slow.set_target("/bin/sleep").push_argument("10");
+    ASSERT_EQ(sup.launch(slow, [&](const proc_exec_result_t& r) { timed = r; }, 100).is_ok(), true);
+
+    proc_exec_unit_t other;
+    other.set_target("/bin/sleep").push_argument("10");
+    ::sigil::yield h = sup.launch(other, [&](const proc_exec_result_t& r) { cancelled = r; });
+    ASSERT_EQ(h.is_ok(), true);
+    ASSERT_EQ(sup.cancel(h.info, SIGKILL).is_ok(), true);
+
+    // run() returning at all means both sleeps were killed and reaped
+    ASSERT_EQ(sup.run().is_ok(), true);
+    EXPECT_EQ(sup.active(), 0u);
+
+    EXPECT_TRUE(timed.timed_out);
+    EXPECT_EQ(timed.term_signal, SIGTERM);
+    EXPECT_FALSE(cancelled.timed_out);
+    EXPECT_EQ(cancelled.term_signal, SIGKILL);
+    EXPECT_EQ(::waitpid(timed.pid, nullptr, WNOHANG), -1);
+    EXPECT_EQ(::waitpid(cancelled.pid, nullptr, WNOHANG), -1);
+}
+
+TEST(PEU, AsyncMissingBinaryCompletes) {
+    exec_supervisor_t sup;
+    int code = -1;
+
+    proc_exec_unit_t peu;
+    peu.set_target("/nonexistent-binary");
+    ASSERT_EQ(sup.launch(peu, [&](const proc_exec_result_t& r) { code = r.exit_code; }).is_ok(), true);
+    ASSERT_EQ(sup.run().is_ok(), true);
+    EXPECT_EQ(code, 127);
+}
+
+TEST(PEU, GraphRunsIndependentStepsConcurrently) {
+    exec_graph_t graph;
+    proc_exec_unit_t peu;
+
+    peu.set_target("/bin/sleep").push_argument("0.2");
+    const std::size_t a = graph.add("a", peu);
+    const std::size_t b = graph.add("b", peu);
+
+    peu.clean();
+    peu.set_target("/bin/sleep").push_argument("0.1");
+    const std::size_t c = graph.add("c", peu, { a });
+
+    ASSERT_EQ(graph.run().is_ok(), true);
+
+    for (const auto& node : graph.nodes) {
+        EXPECT_EQ(node.state, EXEC_NODE_DONE);
+        EXPECT_EQ(node.peu.result.exit_code, 0);
+    }
+
+    // a and b overlap, c waits for a
+    EXPECT_LT(graph.nodes[b].start_ms, graph.nodes[a].end_ms);
+    EXPECT_LT(graph.nodes[a].start_ms, graph.nodes[b].end_ms);
+    EXPECT_GE(graph.nodes[c].start_ms, graph.nodes[a].end_ms);
+    EXPECT_GT(graph.nodes[c].end_ms, graph.nodes[c].start_ms);
+
+    std::vector<std::size_t> path = graph.critical_path();
+    ASSERT_EQ(path.size(), 2u);
+    EXPECT_EQ(path[0], a);
+    EXPECT_EQ(path[1], c);
+    EXPECT_NE(graph.timings().find("* c"), std::string::npos);
+}
+
+TEST(PEU, GraphSkipsAfterFailedRequiredStep) {
+    exec_graph_t graph;
+    proc_exec_unit_t peu;
+
+    peu.set_target("/bin/false");
+    const std::size_t gate = graph.add("gate", peu, {}, true);
+
+    peu.clean();
+    peu.set_target("/bin/true");
+    const std::size_t after = graph.add("after", peu, { gate });
+    const std::size_t chained = graph.add("chained", peu, { after });
+    const std::size_t free = graph.add("free", peu);
+
+    ASSERT_EQ(graph.run().is_ok(), true);
+    EXPECT_EQ(graph.nodes[gate].state, EXEC_NODE_DONE);
+    EXPECT_EQ(graph.nodes[after].state, EXEC_NODE_SKIPPED);
+    EXPECT_EQ(graph.nodes[chained].state, EXEC_NODE_SKIPPED);
+    EXPECT_EQ(graph.nodes[free].state, EXEC_NODE_DONE);
+}
+
+TEST(PEU, GraphRunsAfterRequiredDetachedStep) {
+    exec_graph_t graph;
+    proc_exec_unit_t peu;
+
+    peu.set_target("/bin/true").set_exec_mode(EXEC_DETACH);
+    const std::size_t daemon = graph.add("daemon", peu, {}, true);
+
+    peu.clean();
+    peu.set_target("/bin/true");
+    const std::size_t client = graph.add("client", peu, { daemon });
+
+    ASSERT_TRUE(graph.run().is_ok());
+    EXPECT_EQ(graph.nodes[daemon].peu.result.exit_code, 0);
+    EXPECT_EQ(graph.nodes[client].state, EXEC_NODE_DONE);
+    EXPECT_EQ(graph.nodes[client].peu.result.exit_code, 0);
+}
+
+TEST(PEU, StreamWaitSplitsLines) {
+    std::vector<std::string> out;
+    std::vector<std::string> err;
+
+    proc_exec_unit_t peu;
+    peu.set_target("sh")
+       .push_argument("-c")
+       .push_argument("printf 'a\\nb\\n'; echo oops >&2; printf partial")
+       .set_stdio_mode(STDIO_NULL, STDIO_STREAM, STDIO_STREAM)
+       .set_line_handler([&](int stream, std::string_view line) {
+           (stream == STDOUT_FILENO ? out : err).emplace_back(line);
+       });
+
+    ASSERT_EQ(execute(peu).is_ok(), true);
+    EXPECT_EQ(peu.result.exit_code, 0);
+    EXPECT_EQ(peu.result.stdout_fd, -1);
+    EXPECT_EQ(out, (std::vector<std::string>{ "a", "b", "partial" }));
+    EXPECT_EQ(err, (std::vector<std::string>{ "oops" }));
+}
+
+TEST(PEU, StreamSplitsOversizedLines) {
+    std::size_t total = 0;
+    std::size_t pieces = 0;
+
+    proc_exec_unit_t peu;
+    peu.set_target("sh")
+       .push_argument("-c")
+       .push_argument("head -c 200000 /dev/zero | tr '\\0' x")
+       .set_stdio_mode(STDIO_NULL, STDIO_STREAM, STDIO_INHERIT)
+       .set_line_handler([&](int, std::string_view line) {
+           total += line.size();
+           ++pieces;
+       });
+
+    ASSERT_EQ(execute(peu).is_ok(), true);
+    EXPECT_EQ(total, 200000u);
+    EXPECT_GE(pieces, 3u);
+}
+
+TEST(PEU, StreamAsyncDeliversWhileRunning) {
+    exec_supervisor_t sup;
+    std::vector<std::string> lines;
+    bool exited = false;
+
+    proc_exec_unit_t peu;
+    peu.set_target("sh")
+       .push_argument("-c")
+       .push_argument("echo first; sleep 0.5; echo second")
+       .set_stdio_mode(STDIO_NULL, STDIO_STREAM, STDIO_NULL)
+       .set_line_handler([&](int, std::string_view line) { lines.emplace_back(line); });
+
+    ASSERT_EQ(sup.launch(peu, [&](const proc_exec_result_t& r) {
+        EXPECT_EQ(r.stdout_fd, -1);
+        exited = true;
+    }).is_ok(), true);
+
+    for (int i = 0; i < 40 && lines.empty(); ++i)
+        sup.poll(10);
+
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_EQ(lines[0], "first");
+    EXPECT_FALSE(exited);
+
+    ASSERT_EQ(sup.run().is_ok(), true);
+    EXPECT_TRUE(exited);
+    EXPECT_EQ(lines, (std::vector<std::string>{ "first", "second" }));
+}
+
+// Records what the last dispatched handler saw
+static struct dispatch_probe_t {
+    int hits = 0;
+    std::string handler;
+    std::vector<std::string> args;
+    std::vector<std::string> switches;
+} dispatch_probe;
+
+static ::sigil::yield record_dispatch(const char* name, const cmd_handler_args_t &handler_args) {
+    dispatch_probe.hits++;
+    dispatch_probe.handler = name;
+    dispatch_probe.args.assign(handler_args.args.begin(), handler_args.args.end());
+    dispatch_probe.switches.clear();
+    for (const auto &s : handler_args.switches)
+        dispatch_probe.switches.push_back(std::string(s.name) + "=" + std::string(s.value.value_or("")));
+    return {};
+}
+
+static ::sigil::yield probe_root(const cmd_handler_args_t &a)      { return record_dispatch("root", a); }
+static ::sigil::yield probe_theme_set(const cmd_handler_args_t &a) { return record_dispatch("theme set", a); }
+static ::sigil::yield probe_theme(const cmd_handler_args_t &a)     { return record_dispatch("theme", a); }
+static ::sigil::yield probe_flush(const cmd_handler_args_t &a)     { return record_dispatch("flush", a); }
+
+static constexpr auto probe_commands = make_command_table<4>({{
+    { {                  }, false, probe_root      },
+    { { "theme", "set"   }, true,  probe_theme_set },
+    { { "theme"          }, true,  probe_theme     },
+    { { "flush"          }, false, probe_flush     },
+}});
+
+static_assert(probe_commands.max_depth == 2);
+
+TEST(PEU, CompiledTableDispatchesLongestPath) {
+    const char* argv[] = { "tools", "theme", "--dry-run", "set", "nord", "--mode=dark" };
+    dispatch_probe = {};
+
+    ASSERT_TRUE(dispatch_command(probe_commands, 6, argv).is_ok());
+    EXPECT_EQ(dispatch_probe.handler, "theme set");
+    EXPECT_EQ(dispatch_probe.args, (std::vector<std::string>{ "nord" }));
+    EXPECT_EQ(dispatch_probe.switches, (std::vector<std::string>{ "--dry-run=", "--mode=dark" }));
+
+    ASSERT_TRUE(dispatch_command(probe_commands, "theme other").is_ok());
+    EXPECT_EQ(dispatch_probe.handler, "theme");
+    EXPECT_EQ(dispatch_probe.args, (std::vector<std::string>{ "other" }));
+
+    ASSERT_TRUE(dispatch_command(probe_commands, "  ").is_ok());
+    EXPECT_EQ(dispatch_probe.handler, "root");
+    EXPECT_EQ(dispatch_probe.hits, 3);
+}
+
+TEST(PEU, CompiledTableRejectsLikeRuntimeTree) {
+    command_registry_t reg;
+    ASSERT_TRUE(register_command(reg, {
+        command_t({                }, false, probe_root),
+        command_t({ "theme", "set" }, true,  probe_theme_set),
+        command_t({ "theme"        }, true,  probe_theme),
+        command_t({ "flush"        }, false, probe_flush),
+    }).is_ok());
+
+    // Handler clobbering stays an error
+    EXPECT_TRUE(register_command(reg, command_t({ "flush" }, false, probe_root)).is_failure());
+
+    const char* inputs[] = { "flush", "flush extra", "unknown", "theme set a b --x", "--bad=" };
+    for (const char* in : inputs) {
+        dispatch_probe = {};
+        const bool compiled_ok = dispatch_command(probe_commands, in).is_ok();
+        const auto compiled = dispatch_probe;
+
+        dispatch_probe = {};
+        const bool runtime_ok = dispatch_command(reg, std::string_view(in)).is_ok();
+
+        EXPECT_EQ(compiled_ok, runtime_ok) << in;
+        EXPECT_EQ(compiled.handler, dispatch_probe.handler) << in;
+        EXPECT_EQ(compiled.args, dispatch_probe.args) << in;
+    }
+
+    ::sigil::yield st = dispatch_command(probe_commands, "flush --bad=");
+    EXPECT_TRUE(st.is_failure());
+    EXPECT_EQ(st.code, EINVAL);
+}
+
+TEST(PEU, TokenizeStopsAtCapacity) {
+    cmd_tokens_t tokens;
+    ASSERT_TRUE(tokenize(" a\tbb  ccc\n", tokens).is_ok());
+    ASSERT_EQ(tokens.size(), 3u);
+    EXPECT_EQ(tokens[1], "bb");
+    EXPECT_THROW(tokens.at(3), std::out_of_range);
+
+    std::string many;
+    for (std::size_t i = 0; i <= max_command_args; ++i)
+        many += "x ";
+
+    cmd_tokens_t full;
+    ::sigil::yield st = tokenize(many, full);
+    EXPECT_TRUE(st.is_failure());
+    EXPECT_EQ(st.code, E2BIG);
+}
+
+TEST(PEU, DaemonRunsForwardedCommand) {
+    std::filesystem::path dir = make_temp_dir();
+    std::filesystem::path sock = dir / "run" / "tools.sock";
+
+    daemon_server_t server;
+    ASSERT_TRUE(server.listen(sock).is_ok());
+
+    // A second daemon must not take over a live socket
+    daemon_server_t second;
+    ::sigil::yield busy = second.listen(sock);
+    EXPECT_TRUE(busy.is_failure());
+    EXPECT_EQ(busy.code, EADDRINUSE);
+
+    std::thread serving([&] {
+        server.run([](const daemon_request_t &req) {
+            std::cout << req.argc << ":" << req.argv[1] << ":" << req.argv[2]
+                      << ":" << (getenv("SIGIL_DAEMON_TEST") ? getenv("SIGIL_DAEMON_TEST") : "-")
+                      << ":" << std::filesystem::current_path().filename().string() << std::endl;
+            return 7;
+        });
+    });
+
+    int out = memfd_create("daemon-out", MFD_CLOEXEC);
+    ASSERT_GE(out, 0);
+
+    const std::filesystem::path cwd = std::filesystem::current_path();
+    std::filesystem::current_path(dir);
+
+    const char *argv[] = { "sigilvm-tools", "theme", "set", nullptr };
+    const char *envp[] = { "SIGIL_DAEMON_TEST=forwarded", nullptr };
+    int exit_code = -1;
+
+    ::sigil::yield st = daemon_forward(sock, 3, argv, envp, exit_code, { 0, out, 2 });
+    std::filesystem::current_path(cwd);
+
+    ASSERT_TRUE(st.is_ok());
+    EXPECT_EQ(exit_code, 7);
+    EXPECT_EQ(getenv("SIGIL_DAEMON_TEST"), nullptr);
+
+    lseek(out, 0, SEEK_SET);
+    EXPECT_EQ(read_all_fd(out), "3:theme:set:forwarded:" + dir.filename().string() + "\n");
+    close(out);
+
+    server.stop();
+    serving.join();
+    server.close();
+
+    EXPECT_FALSE(std::filesystem::exists(sock));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(PEU, DaemonResolvesPathsForTheCaller) {
+    std::filesystem::path dir = make_temp_dir();
+    std::filesystem::path sock = dir / "tools.sock";
+
+    daemon_server_t server;
+    ASSERT_TRUE(server.listen(sock).is_ok());
+
+    std::thread serving([&] {
+        server.run([](const daemon_request_t &req) {
+            process_descriptor_t proc;
+            app_descriptor_t app;
+            if (daemon_client_app(req, proc, app).is_failure())
+                return 1;
+            std::cout << get_sigilvm_config_root(app).string() << "|" << get_home(app).string() << std::endl;
+            return 0;
+        });
+    });
+
+    int out = memfd_create("daemon-out", MFD_CLOEXEC);
+    ASSERT_GE(out, 0);
+
+    const std::string home = "HOME=" + (dir / "home").string();
+    const std::string config = "XDG_CONFIG_HOME=" + (dir / "client-config").string();
+    const char *argv[] = { "sigilvm-tools", "theme", "set", nullptr };
+    const char *envp[] = { home.c_str(), config.c_str(), nullptr };
+    int exit_code = -1;
+
+    ASSERT_TRUE(daemon_forward(sock, 3, argv, envp, exit_code, { 0, out, 2 }).is_ok());
+    EXPECT_EQ(exit_code, 0);
+
+    lseek(out, 0, SEEK_SET);
+    EXPECT_EQ(read_all_fd(out), (dir / "client-config" / "sigilvm").string() + "|" + (dir / "home").string() + "\n");
+    close(out);
+
+    server.stop();
+    serving.join();
+    server.close();
+    std::filesystem::remove_all(dir);
+}
+
+TEST(PEU, BusyDaemonLeavesCallsToTheClient) {
+    std::filesystem::path dir = make_temp_dir();
+    std::filesystem::path sock = dir / "tools.sock";
+
+    daemon_server_t server;
+    ASSERT_TRUE(server.listen(sock).is_ok());
+
+    static std::atomic<int> served;
+    static std::atomic<bool> release;
+    served = 0;
+    release = false;
+
+    std::thread serving([&] {
+        server.run([](const daemon_request_t &req) {
+            ++served;
+            while (req.argv[1][0] == 'w' && !release)
+                usleep(1000);
+            return 0;
+        });
+    });
+
+    // The first call holds the daemon
+    const char *wait_argv[] = { "sigilvm-tools", "wait", nullptr };
+    int first_code = -1;
+    std::thread first([&] {
+        daemon_forward(sock, 2, wait_argv, nullptr, first_code, { 0, 1, 2 });
+    });
+    while (served == 0)
+        usleep(1000);
+
+    // The second is not picked up in time, the client runs it
+    const char *argv[] = { "sigilvm-tools", "probe", nullptr };
+    int exit_code = -1;
+    ::sigil::yield st = daemon_forward(sock, 2, argv, nullptr, exit_code, { 0, 1, 2 }, 50);
+    EXPECT_TRUE(st.is_failure());
+    EXPECT_EQ(st.code, ETIMEDOUT);
+    EXPECT_EQ(exit_code, -1);
+
+    release = true;
+    first.join();
+    EXPECT_EQ(first_code, 0);
+
+    // Served after the abandoned one, which the daemon must have dropped
+    ASSERT_TRUE(daemon_forward(sock, 2, argv, nullptr, exit_code, { 0, 1, 2 }, 5000).is_ok());
+    EXPECT_EQ(exit_code, 0);
+    EXPECT_EQ(served, 2);
+
+    server.stop();
+    serving.join();
+    server.close();
+    std::filesystem::remove_all(dir);
+}
+
+TEST(PEU, DaemonForwardWithoutDaemonFails) {
+    std::filesystem::path dir = make_temp_dir();
+    const char *argv[] = { "sigilvm-tools", nullptr };
+    int exit_code = -1;
+
+    ::sigil::yield st = daemon_forward(dir / "none.sock", 1, argv, nullptr, exit_code);
+    EXPECT_TRUE(st.is_failure());
+    EXPECT_EQ(st.code, ENOENT);
+    EXPECT_EQ(exit_code, -1);
+
+    // Socket file of a daemon that died without cleaning up
+    {
+        daemon_server_t dead;
+        ASSERT_TRUE(dead.listen(dir / "stale.sock").is_ok());
+        close(dead.listen_fd);
+        dead.listen_fd = -1;
+    }
+    ASSERT_TRUE(std::filesystem::exists(dir / "stale.sock"));
+
+    st = daemon_forward(dir / "stale.sock", 1, argv, nullptr, exit_code);
+    EXPECT_TRUE(st.is_failure());
+    EXPECT_EQ(st.code, ECONNREFUSED);
+
+    daemon_server_t fresh;
+    EXPECT_TRUE(fresh.listen(dir / "stale.sock").is_ok());
+    fresh.close();
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(PEU, ZygoteSpawnsOnBehalfOfCaller) {
+    ASSERT_TRUE(zygote_start().is_ok());
+    const pid_t helper = zygote_pid();
+    ASSERT_GT(helper, 0);
+
+    std::filesystem::path dir = make_temp_dir();
+    const std::filesystem::path cwd = std::filesystem::current_path();
+    std::filesystem::current_path(dir);
+
+    // Child of the zygote, in the caller's cwd, with exports and captured output
+    proc_exec_unit_t peu;
+    peu.set_target("sh")
+       .push_argument("-c")
+       .push_argument("echo $PPID $(pwd) $SIGIL_ZYGOTE; echo oops >&2; exit 3")
+       .export_var("SIGIL_ZYGOTE", "yes")
+       .set_stdio_mode(STDIO_NULL, STDIO_CAPTURE, STDIO_CAPTURE);
+
+    ASSERT_TRUE(execute(peu).is_ok());
+    std::filesystem::current_path(cwd);
+
+    EXPECT_EQ(peu.result.exit_code, 3);
+    EXPECT_EQ(read_all_fd(peu.result.stdout_fd),
+              std::to_string(helper) + " " + std::filesystem::canonical(dir).string() + " yes\n");
+    EXPECT_EQ(read_all_fd(peu.result.stderr_fd), "oops\n");
+    close(peu.result.stdout_fd);
+    close(peu.result.stderr_fd);
+
+    // Streams and workdir go through the zygote as well
+    std::vector<std::string> lines;
+    proc_exec_unit_t streamed;
+    streamed.set_target("sh")
+            .push_argument("-c")
+            .push_argument("pwd; echo two")
+            .set_workdir(dir.string())
+            .set_stdio_mode(STDIO_NULL, STDIO_STREAM, STDIO_NULL)
+            .set_line_handler([&](int, std::string_view line) { lines.emplace_back(line); });
+
+    ASSERT_TRUE(execute(streamed).is_ok());
+    EXPECT_EQ(streamed.result.exit_code, 0);
+    EXPECT_EQ(lines, (std::vector<std::string>{ std::filesystem::canonical(dir).string(), "two" }));
+
+    proc_exec_unit_t missing;
+    missing.set_target("/nonexistent-binary");
+    ASSERT_TRUE(execute(missing).is_ok());
+    EXPECT_EQ(missing.result.exit_code, 127);
+
+    // A dead zygote is dropped, the next call spawns directly
+    kill(helper, SIGKILL);
+    proc_exec_unit_t after;
+    after.set_target("/bin/true");
+    ASSERT_TRUE(execute(after).is_ok());
+    EXPECT_EQ(after.result.exit_code, 0);
+    EXPECT_EQ(zygote_pid(), -1);
+
+    zygote_stop();
+    std::filesystem::remove_all(dir);
+}
+
+TEST(PEU, ZygoteDiesUnderConcurrentSpawns) {
+    ASSERT_TRUE(zygote_start().is_ok());
+    const pid_t helper = zygote_pid();
+    ASSERT_GT(helper, 0);
+    kill(helper, SIGKILL);
+
+    // Every thread finds it dead, one drops it and all of them fall back to spawning directly
+    std::atomic<int> ok{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10; ++i) {
+                proc_exec_unit_t peu;
+                peu.set_target("/bin/true");
+                if (execute(peu).is_ok() && peu.result.exit_code == 0)
+                    ++ok;
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+
+    EXPECT_EQ(ok, 80);
+    EXPECT_EQ(zygote_pid(), -1);
+
+    // And it can be started again afterwards
+    ASSERT_TRUE(zygote_start().is_ok());
+    EXPECT_GT(zygote_pid(), 0);
+    zygote_stop();
+    EXPECT_EQ(zygote_pid(), -1);
+}
+
+TEST(PEU, EnvIndexMatchesGetenvRules) {
+    const char *envp[] = { "A=1", "B=two", "A=shadowed", "EMPTY=", "=nokey", "NOEQ", nullptr };
+
+    env_index_t index;
+    index.build(envp);
+
+    ASSERT_NE(index.find("A"), nullptr);
+    EXPECT_STREQ(index.find("A")->value, "1");
+    EXPECT_EQ(index.find("A")->position, 0u);
+    EXPECT_STREQ(index.find("B")->value, "two");
+    EXPECT_EQ(index.find("B")->position, 1u);
+    EXPECT_STREQ(index.find("EMPTY")->value, "");
+    EXPECT_EQ(index.find("NOEQ"), nullptr);
+    EXPECT_EQ(index.find("C"), nullptr);
+    EXPECT_EQ(index.find(""), nullptr);
+}
+
+TEST(PEU, ExportsOverrideInheritedEnvironment) {
+    setenv("SIGIL_ENV_TEST", "inherited", 1);
+
+    auto run = [](std::vector<std::pair<std::string, std::string>> exports) {
+        proc_exec_unit_t peu;
+        peu.set_target("sh")
+           .push_argument("-c")
+           .push_argument("echo \"$SIGIL_ENV_TEST:$SIGIL_ENV_NEW\"")
+           .set_stdio_mode(STDIO_NULL, STDIO_CAPTURE, STDIO_NULL);
+        for (auto &[k, v] : exports)
+            peu.export_var(k, v);
+
+        execute(peu);
+        std::string out = read_all_fd(peu.result.stdout_fd);
+        close(peu.result.stdout_fd);
+        return out;
+    };
+
+    EXPECT_EQ(run({ { "SIGIL_ENV_TEST", "exported" }, { "SIGIL_ENV_NEW", "new" } }), "exported:new\n");
+    EXPECT_EQ(run({ { "SIGIL_ENV_NEW", "again" } }), "inherited:again\n");
+    EXPECT_EQ(run({}), "inherited:\n");
+
+    // setenv after the block was built is picked up
+    setenv("SIGIL_ENV_TEST", "changed", 1);
+    EXPECT_EQ(run({ { "SIGIL_ENV_NEW", "x" } }), "changed:x\n");
+
+    unsetenv("SIGIL_ENV_TEST");
+}
+
+TEST(PEU, ResolvedPathsMatchGetters) {
+    const char *argv[] = { "/usr/bin/sigilvm-tools", nullptr };
+    const char *envp[] = { "HOME=/home/u", "XDG_CONFIG_HOME=/cfg", "XDG_RUNTIME_DIR=/run/user/1", nullptr };
+
+    process_descriptor_t proc;
+    ASSERT_TRUE(process_initialize(proc, 1, argv, envp).is_ok());
+    EXPECT_STREQ(env_get(proc, "XDG_CONFIG_HOME"), "/cfg");
+    EXPECT_EQ(env_get(proc, "XDG_DATA_HOME"), nullptr);
+
+    app_descriptor_t app;
+    ASSERT_TRUE(app_initialize(app, proc).is_ok());
+
+    const std::filesystem::path config = get_local_config(app);
+    const std::filesystem::path data = get_sigilvm_data_root(app);
+    const std::filesystem::path sock = get_local_socket(app);
+
+    resolve_app_paths(app);
+    ASSERT_TRUE(app.paths.resolved);
+
+    EXPECT_EQ(config, "/cfg/sigilvm/sigilvm-tools");
+    EXPECT_EQ(data, "/home/u/.local/share/sigilvm");
+    EXPECT_EQ(sock, "/run/user/1/sigilvm/sigilvm-tools.sock");
+    EXPECT_EQ(get_local_config(app), config);
+    EXPECT_EQ(get_sigilvm_data_root(app), data);
+    EXPECT_EQ(get_local_socket(app), sock);
+    EXPECT_EQ(get_home(app), "/home/u");
+}
+
 // EXEC_REPLACE must be death-tested
 TEST(PEU, ExecReplaceFailsGracefully) {
     ASSERT_EXIT({
@@ -0,0 +1,156 @@
+#include <sigil/platform/compat.h>
+#include <sigil/platform/steam.h>
+#include <sigil/platform/paths.h>
+#include <gtest/gtest.h>
+#include "test_utils.h"
+#include <filesystem>
+#include <algorithm>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using sigil::platform::steam_index_t;
+using sigil::platform::steam_index_stats_t;
+
+static std::string app_manifest(unsigned appid, const std::string &name, const std::string &installdir,
+                                unsigned flags = 4) {
+    return "\"AppState\"\n{\n"
+           "\t\"appid\"\t\t\"" + std::to_string(appid) + "\"\n"
+           "\t\"Universe\"\t\t\"1\"\n"
+           "\t\"name\"\t\t\"" + name + "\"\n"
+           "\t\"StateFlags\"\t\t\"" + std::to_string(flags) + "\"\n"
+           "\t\"installdir\"\t\t\"" + installdir + "\"\n"
+           "\t\"SizeOnDisk\"\t\t\"1048576\"\n"
+           "\t\"UserConfig\"\n\t{\n\t\t\"language\"\t\t\"english\"\n\t}\n"
+           "}\n";
+}
+
+// Steam root with a second library, two games, Steam's Proton and a GE build in compatibilitytools.d
+static void make_steam(const fs::path &root, const fs::path &library) {
+    write_file(root / "steamapps" / "libraryfolders.vdf",
+               "\"libraryfolders\"\n{\n"
+               "\t\"0\"\n\t{\n\t\t\"path\"\t\t\"" + root.string() + "\"\n"
+               "\t\t\"apps\"\n\t\t{\n\t\t\t\"1493710\"\t\t\"0\"\n\t\t}\n\t}\n"
+               "\t\"1\"\n\t{\n\t\t\"path\"\t\t\"" + library.string() + "/\"\n"
+               "\t\t\"label\"\t\t\"games\"\n\t}\n"
+               "}\n");
+
+    write_file(root / "steamapps" / "appmanifest_1493710.acf", app_manifest(1493710, "Proton Experimental", "Proton - Experimental"));
+    write_file(root / "steamapps" / "common" / "Proton - Experimental" / "proton", "#!/bin/sh\n");
+    write_file(library / "steamapps" / "appmanifest_570.acf", app_manifest(570, "Dota 2", "dota 2 beta"));
+    write_file(library / "steamapps" / "appmanifest_620.acf", app_manifest(620, "Portal 2", "Portal 2", 1026));
+    write_file(library / "steamapps" / "libraryfolder.vdf", "\"libraryfolder\" { }\n");
+
+    write_file(root / "compatibilitytools.d" / "GE-Proton9-20" / "compatibilitytool.vdf",
+               "\"compatibilitytools\"\n{\n  \"compat_tools\"\n  {\n"
+               "    \"GE-Proton9-20\" // Internal name of this tool\n    {\n"
+               "      \"install_path\" \".\"\n"
+               "      \"display_name\" \"GE-Proton9-20\"\n"
+               "      \"from_oslist\"  \"windows\"\n"
+               "      \"to_oslist\"    \"linux\"\n"
+               "    }\n  }\n}\n");
+    write_file(root / "compatibilitytools.d" / "GE-Proton9-20" / "proton", "#!/bin/sh\n");
+}
+
+TEST(Steam, IndexesLibrariesAppsAndTools) {
+    const fs::path base = fs::temp_directory_path() / ("sigil-steam-test-" + std::to_string(getpid()));
+    fs::remove_all(base);
+    const fs::path root = base / "Steam";
+    const fs::path library = base / "games";
+    make_steam(root, library);
+
+    steam_index_t index;
+    steam_index_stats_t stats;
+    bool changed = false;
+    ASSERT_TRUE(sigil::platform::refresh_steam_index(root, index, changed, &stats).is_ok());
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(stats.parsed, 5u);    // libraryfolders, three manifests, one tool
+    EXPECT_EQ(stats.listed, 3u);
+
+    EXPECT_EQ(index.libraries, (std::vector<fs::path>{ root, library }));
+    ASSERT_EQ(index.apps.size(), 3u);
+    EXPECT_EQ(index.apps[0].appid, 570u);
+    EXPECT_EQ(index.apps[2].appid, 1493710u);
+
+    const auto *dota = index.find_app(570);
+    ASSERT_NE(dota, nullptr);
+    EXPECT_EQ(dota->name, "Dota 2");
+    EXPECT_EQ(dota->install_dir, library / "steamapps" / "common" / "dota 2 beta");
+    EXPECT_EQ(dota->size_on_disk, 1048576u);
+    EXPECT_TRUE(dota->installed());
+    EXPECT_FALSE(index.find_app(620)->installed());
+    EXPECT_EQ(index.find_app(440), nullptr);
+
+    ASSERT_EQ(index.tools.size(), 2u);
+    EXPECT_EQ(index.tools[0].name, "GE-Proton9-20");
+    EXPECT_EQ(index.tools[0].path, root / "compatibilitytools.d" / "GE-Proton9-20");
+    EXPECT_EQ(index.tools[0].appid, 0u);
+    EXPECT_EQ(index.tools[1].display_name, "Proton Experimental");
+    EXPECT_EQ(index.tools[1].path, root / "steamapps" / "common" / "Proton - Experimental");
+    EXPECT_EQ(index.tools[1].appid, 1493710u);
+
+    // Nothing touched: every file is only stat'ed
+    changed = false;
+    ASSERT_TRUE(sigil::platform::refresh_steam_index(root, index, changed, &stats).is_ok());
+    EXPECT_FALSE(changed);
+    EXPECT_EQ(stats.parsed, 0u);
+    EXPECT_EQ(stats.listed, 0u);
+    EXPECT_EQ(stats.reused, 5u);
+    EXPECT_EQ(index.apps.size(), 3u);
+    EXPECT_EQ(index.tools.size(), 2u);
+
+    // One manifest rewritten in place: only that one is read again
+    write_file(library / "steamapps" / "appmanifest_620.acf", app_manifest(620, "Portal 2", "Portal 2", 4));
+    changed = false;
+    ASSERT_TRUE(sigil::platform::refresh_steam_index(root, index, changed, &stats).is_ok());
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(stats.parsed, 1u);
+    EXPECT_TRUE(index.find_app(620)->installed());
+
+    // Uninstalled: the directory moved, so it is listed again and the app is gone
+    fs::remove(library / "steamapps" / "appmanifest_570.acf");
+    changed = false;
+    ASSERT_TRUE(sigil::platform::refresh_steam_index(root, index, changed, &stats).is_ok());
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(stats.parsed, 0u);
+    EXPECT_EQ(stats.listed, 1u);
+    EXPECT_EQ(index.find_app(570), nullptr);
+    EXPECT_EQ(index.apps.size(), 2u);
+
+    EXPECT_EQ(sigil::platform::refresh_steam_index(base / "nowhere", index, changed).code, ENOENT);
+
+    fs::remove_all(base);
+}
+
+TEST(Steam, CompatToolsComeFromTheIndex) {
+    const fs::path home = fs::temp_directory_path() / ("sigil-steam-home-" + std::to_string(getpid()));
+    fs::remove_all(home);
+    const fs::path root = home / ".local" / "share" / "Steam";
+    make_steam(root, home / "games");
+
+    const auto test = make_test_app(home, {
+        "XDG_DATA_HOME=" + (home / "data").string(),
+        "PATH=" + (home / "bin").string()
+    });
+    ASSERT_NE(test, nullptr);
+    const auto &app = test->app;
+
+    fs::path found;
+    ASSERT_TRUE(sigil::platform::find_steam_root(app, found));
+    EXPECT_EQ(found, root);
+
+    const auto steam = sigil::platform::probe_steam(app);
+    ASSERT_NE(steam, nullptr);
+    EXPECT_EQ(steam->apps.size(), 3u);
+
+    std::vector<sigil::platform::compat_tool_t> tools;
+    ASSERT_TRUE(sigil::platform::probe_compat_tools(app, tools).is_ok());
+    std::vector<std::string> names;
+    for (const auto &t : tools)
+        if (t.origin == sigil::platform::COMPAT_STEAM)
+            names.push_back(t.name);
+    EXPECT_EQ(names, (std::vector<std::string>{ "GE-Proton9-20", "Proton Experimental" }));
+
+    fs::remove_all(home);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+/**
+ * file: src/tests/test_utils.h
+ *
+ * Fixture helpers shared by the test executables.
+ */
+
+#include <sigil/platform/paths.h>
+#include <sigil/platform/app.h>
+#include <initializer_list>
+#include <filesystem>
+#include <iterator>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+inline void write_file(const std::filesystem::path &p, const std::string &content) {
+    std::filesystem::create_directories(p.parent_path());
+    std::ofstream out(p, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+inline std::string read_file(const std::filesystem::path &p) {
+    std::ifstream in(p, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief
+ * Descriptors of a sigilvm-tools run with its paths resolved, over an
+ * environment this owns, proc and app point into it.
+ */
+struct test_app_t {
+    std::vector<std::string> env;
+    std::vector<const char*> envp;
+    const char *argv[2] = { "sigilvm-tools", nullptr };
+    ::sigil::platform::process_descriptor_t proc;
+    ::sigil::platform::app_descriptor_t app;
+
+    test_app_t() = default;
+    test_app_t(const test_app_t&) = delete;
+    test_app_t& operator=(const test_app_t&) = delete;
+};
+
+// HOME=root followed by env, nullptr when the descriptors do not initialize
+inline std::unique_ptr<test_app_t> make_test_app(const std::filesystem::path &root,
+                                                 std::initializer_list<std::string> env = {}) {
+    auto t = std::make_unique<test_app_t>();
+    t->env.push_back("HOME=" + root.string());
+    t->env.insert(t->env.end(), env.begin(), env.end());
+
+    for (const auto &e : t->env)
+        t->envp.push_back(e.c_str());
+    t->envp.push_back(nullptr);
+
+    if (::sigil::platform::process_initialize(t->proc, 1, t->argv, t->envp.data()).is_failure()
+        || ::sigil::platform::app_initialize(t->app, t->proc).is_failure())
+        return nullptr;
+
+    ::sigil::platform::resolve_app_paths(t->app);
+    return t;
+}
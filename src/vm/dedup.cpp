@@ -1,3 +1,4 @@
+#include <sigil/platform/fs.h>
 #include <sigil/math/hash.h>
 #include <sigil/vm/dedup.h>
 #include <sigil/common.h>
@@ -17,12 +18,12 @@ namespace fs = std::filesystem;
 namespace sigil::data {
 
 struct move_action {
-    fs::path from;
-    fs::path to;
+    ::fs::path from;
+    ::fs::path to;
 };
 
 struct hash_result {
-    fs::path path;
+    ::fs::path path;
     std::array<std::uint8_t,16> hash;
     ::sigil::yield result;
 };
@@ -38,9 +39,9 @@ static std::string hash_to_hex(const std::array<std::uint8_t,16>& h) {
     return out;
 }
 
-static fs::path cache_file_path() {
+static ::fs::path cache_file_path() {
     const char* home = std::getenv("HOME");
-    fs::path base = home ? fs::path(home) : fs::temp_directory_path();
+    ::fs::path base = home ? ::fs::path(home) : ::fs::temp_directory_path();
     base /= ".cache/sigilvm/dedup";
 
     const auto now = std::chrono::system_clock::now();
@@ -57,8 +58,8 @@ static fs::path cache_file_path() {
 }
 
 ::sigil::yield dedup(
-    const fs::path& src,
-    const fs::path& dst,
+    const ::fs::path& src,
+    const ::fs::path& dst,
     bool dry_run
 ) noexcept {
     ::sigil::yield ret;
@@ -67,21 +68,21 @@ static fs::path cache_file_path() {
         return ret.set_state(::sigil::yield_state::fail)
                   .set_code(1);
 
-    if (!fs::exists(src) || !fs::is_directory(src))
+    if (!::fs::exists(src) || !::fs::is_directory(src))
         return ret.set_state(::sigil::yield_state::fail)
                   .set_code(2);
 
     ::sigil::contain(ret, [&] {
-        if (!fs::exists(dst))
-            fs::create_directories(dst);
+        if (!::fs::exists(dst))
+            ::fs::create_directories(dst);
     });
 
     if (!ret.is_ok())
         return ret;
 
     // collect files
-    std::vector<fs::path> files;
-    for (fs::recursive_directory_iterator it(src), end; it != end; ++it) {
+    std::vector<::fs::path> files;
+    for (::fs::recursive_directory_iterator it(src), end; it != end; ++it) {
         if (it->is_regular_file())
             files.push_back(it->path());
     }
@@ -108,8 +109,14 @@ static fs::path cache_file_path() {
             hp.path = files[i];
 
             results[i].result = sigil::math::xxh128_hash(hp);
-            if (results[i].result.is_ok())
+            if (results[i].result.is_ok()) {
                 results[i].hash = hp.output;
+
+                // Share the digest with later comparisons (copy skip, verify)
+                sigil::fs::file_key_t key;
+                if (sigil::fs::get_file_key(files[i], key))
+                    sigil::fs::digest_cache_store(key, hp.output);
+            }
         }
     };
 
@@ -128,7 +135,7 @@ static fs::path cache_file_path() {
     }
 
     // ---- phase 2: plan assembly (single-threaded) ---------------------------
-    std::unordered_map<std::string, fs::path> seen_hashes;
+    std::unordered_map<std::string, ::fs::path> seen_hashes;
     std::vector<move_action> actions;
 
     for (const auto& r : results) {
@@ -137,14 +144,15 @@ static fs::path cache_file_path() {
         auto [it_hash, inserted] =
             seen_hashes.emplace(hash_hex, r.path);
 
-        if (!inserted)
+        // Verify before treating as duplicate, a digest match is not proof
+        if (!inserted && sigil::fs::files_are_identical(r.path, it_hash->second, false))
             continue;
 
-        fs::path rel = fs::relative(r.path, src);
-        fs::path target = dst / rel;
+        ::fs::path rel = ::fs::relative(r.path, src);
+        ::fs::path target = dst / rel;
 
-        if (fs::exists(target)) {
-            fs::path parent = target.parent_path();
+        if (::fs::exists(target)) {
+            ::fs::path parent = target.parent_path();
             target = parent / (hash_hex + "-" + target.filename().string());
         }
 
@@ -153,10 +161,10 @@ static fs::path cache_file_path() {
 
     // ---- dry run ------------------------------------------------------------
     if (dry_run) {
-        fs::path out_file = cache_file_path();
+        ::fs::path out_file = cache_file_path();
 
         ::sigil::contain(ret, [&] {
-            fs::create_directories(out_file.parent_path());
+            ::fs::create_directories(out_file.parent_path());
             std::ofstream out(out_file);
             if (!out)
                 throw std::runtime_error("cannot open dry-run file");
@@ -177,8 +185,8 @@ static fs::path cache_file_path() {
     // ---- phase 3: execute ---------------------------------------------------
     for (const auto& a : actions) {
         ::sigil::contain(ret, [&] {
-            fs::create_directories(a.to.parent_path());
-            fs::rename(a.from, a.to);
+            ::fs::create_directories(a.to.parent_path());
+            ::fs::rename(a.from, a.to);
         });
 
         if (!ret.is_ok())